@@ -0,0 +1,64 @@
+#ifndef CATALOG_H
+#define CATALOG_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "data.h"
+
+#define CATALOG_MAGIC "FY3GCATL"
+#define CATALOG_VERSION 1
+#define CATALOG_BYTE_ORDER 0x01020304u // as written by the little endian writer, see FLAT_CLIP_BYTE_ORDER
+#define CATALOG_FILE_NAME_LENGTH 256
+
+// ================ Clip Catalog ================
+// one file for the whole archive: this header, then the records appended by every run, each
+// record of a clip followed by one level record per height level, the next record starts at recordSize
+typedef struct {
+    char magic[8];
+    uint32_t version, byteOrder;
+    uint32_t headerSize, recordHeaderSize; // the record header without its levels, a newer writer may grow it
+} CatalogFileHeader;
+
+typedef struct {
+    uint32_t recordSize; // this header and its levels
+    uint32_t bandIndex, clipIndex, levelCount;
+    int64_t startTime, endTime; // seconds since 1970-01-01T00:00:00, the granule time interpolated over the scan lines of the clip
+    float minLatitude, maxLatitude, minLongitude, maxLongitude; // of the cells of Value with a value, of the clip without any
+    float minHeight, heightGap; // level h is at minHeight + h * heightGap
+    uint32_t validCount;
+    float minValue, maxValue, meanValue; // -999 without a value
+    char fileName[CATALOG_FILE_NAME_LENGTH]; // the file holding the clip, as given to the run
+} CatalogRecord;
+
+typedef struct {
+    uint32_t validCount;
+    float minValue, maxValue, meanValue; // -999 without a value
+} CatalogLevel;
+
+typedef struct {
+    void* mapping;
+    size_t mappingSize;
+    size_t size; // the bytes of the records read, up to the end of the last complete one, a run appending truncates a record cut short past it
+    const CatalogFileHeader* header; // into the mapping
+    unsigned int recordCount; // the complete records, a record cut short by a failed run is dropped
+} CatalogFile;
+
+typedef struct {
+    float minLatitude, maxLatitude, minLongitude, maxLongitude; // overlapped by the cells with a value of a clip
+    int64_t startTime, endTime; // overlapped by the time of a clip
+    float minHeight, maxHeight; // a level in it has a value, any clip for the whole range
+    float minValue; // a level in the height range reaches it, -INFINITY for any clip
+} CatalogQuery;
+
+int64_t DateTimeToSeconds(const DateTime* dateTime);
+DateTime SecondsToDateTime(const int64_t seconds);
+bool ComputeClipStatistics(ClipGrid* clipGrid);
+bool AppendCatalog(const char* catalogFileName, const unsigned int bandIndex, const char* dataFileName, const ClipGridResult* clipResult);
+CatalogFile* OpenCatalogFile(const char* fileName);
+const CatalogRecord* NextCatalogRecord(const CatalogFile* file, const CatalogRecord* record);
+const CatalogLevel* GetCatalogLevels(const CatalogFile* file, const CatalogRecord* record);
+void CloseCatalogFile(CatalogFile* file);
+void InitCatalogQuery(CatalogQuery* query);
+bool MatchCatalogRecord(const CatalogFile* file, const CatalogRecord* record, const CatalogQuery* query);
+#endif // CATALOG_H
@@ -0,0 +1,31 @@
+#ifndef CHUNKWRITER_H
+#define CHUNKWRITER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <hdf5.h>
+#include "config.h"
+
+#define OUTPUT_FILL_VALUE -999.0f // the fill value of every output dataset, a chunk holding only it is not written
+#define OUTPUT_CHUNKS_PER_THREAD 4 // chunks compressed by a thread between two serial writes
+#define OUTPUT_INT16_FILL_VALUE INT16_MIN // the _FillValue of an OUTPUT_ENCODING=INT16 dataset, the counts are clamped to +-INT16_MAX
+
+// ================ Chunked Output Datasets ================
+typedef struct {
+    unsigned int rank; // 3, or 2 for a plane whose dims[2] is 1
+    hsize_t dims[3];
+    hsize_t chunkDims[3]; // all 0 for a contiguous dataset
+    OutputCompression compression;
+    unsigned int level; // deflate level
+    OutputEncoding encoding; // the type of the cells in the file, the data in memory is float
+    float scaleFactor, addOffset; // of OUTPUT_ENCODING_INT16
+} ChunkLayout;
+
+void InitChunkLayout(const hsize_t* dims, ChunkLayout* layout);
+void InitPlaneChunkLayout(const hsize_t* dims, ChunkLayout* layout);
+size_t OutputElementSize(const OutputEncoding encoding);
+void EncodeOutputCells(const ChunkLayout* layout, const float* cells, const size_t count, void* encoded);
+hid_t CreateChunkedDataset(hid_t groupID, const char* name, const ChunkLayout* layout);
+bool WriteChunkedDataset(hid_t datasetID, const ChunkLayout* layout, const float* data);
+bool WriteChunkedRows(hid_t datasetID, const ChunkLayout* layout, const float* data, const hsize_t firstRow, const hsize_t rowCount);
+#endif // CHUNKWRITER_H
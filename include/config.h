@@ -1,5 +1,6 @@
 #ifndef CONFIG_H
 #define CONFIG_H
+#include <stdbool.h>
 #define DEFAULT_MAX_LONGITUDE_WIDTH 5 // 5 degrees
 #define DEFAULT_K_NEIGHBOR 5
 #define DEFAULT_KDTREE_CAPACITY 100000
@@ -12,9 +13,94 @@
 #define DEFAULT_MAX_DISTANCE_TOLERANCE 0.08 // 0.08 degrees
 #define DEFAULT_MAX_NEIGHBOR_DISTANCE 10000 // 5000m * 2
 #define DEFAULT_MIN_NEIGHBOR_DISTANCE 100 // 100m
+#define DEFAULT_VERTICAL_SCALE 1.0f // weight of the height difference in the neighbor distance, 1 is isotropic
+#define DEFAULT_MAX_VERTICAL_DISTANCE -1 // neighbors further in height are dropped, 0 disables, unset is 2 * HEIGHT_GAP
 
 #define DEFAULT_BATCH_SIZE 500 // deprecated
 
+#define MAX_EXTRA_VARIABLE_COUNT 8 // PRE datasets resampled with the neighbors and weights of zFactorMeasured
+#define MAX_VARIABLE_NAME_LENGTH 64
+
+typedef enum {
+    RESAMPLE_ENGINE_POINT_CLOUD, // IDW of the 3D nearest bins of every cell, searched with INDEX_ENGINE
+    RESAMPLE_ENGINE_SEPARABLE, // every ray in 1D onto the target heights, then every level in 2D across the rays, see separable.h
+    RESAMPLE_ENGINE_SCATTER // every valid bin splatted onto the cells within SCATTER_RADIUS, no index, see scatter.h
+} ResampleEngine;
+#define DEFAULT_RESAMPLE_ENGINE RESAMPLE_ENGINE_POINT_CLOUD
+#define DEFAULT_SCATTER_RADIUS 0.0f // meters, 0 for GRID_SIZE
+
+typedef enum {
+    INDEX_ENGINE_RSTAR, // libspatialindex R* tree
+    INDEX_ENGINE_KNN, // static float KD tree, see knnindex.h
+    INDEX_ENGINE_STRUCTURED, // no tree, stencil lookup on the scan layout, see structured.h
+    INDEX_ENGINE_VOXEL // uniform voxel hash bounded by MAX_NEIGHBOR_DISTANCE, see voxelindex.h
+} IndexEngine;
+#define DEFAULT_INDEX_ENGINE INDEX_ENGINE_RSTAR
+#define DEFAULT_KNN_LEAF_SIZE 32
+#define DEFAULT_STRUCTURED_CELL_RADIUS 1 // stencil half size in line and angle
+#define DEFAULT_STRUCTURED_BIN_RADIUS 8 // stencil half size along the ray
+#define DEFAULT_VOXEL_RING_COUNT 1 // voxel edge is MAX_NEIGHBOR_DISTANCE / ring count, 1 scans the 27 neighboring voxels
+#define DEFAULT_SHARED_INDEX false // one index for the whole band instead of one per clip
+#define DEFAULT_ECHO_TOP_CUTOFF true // the cells out of reach of the highest valid bins are not queried, see echotop.h
+
+typedef enum {
+    QUERY_ORDER_LATTICE, // longitude, latitude, height loop order of the clip grid
+    QUERY_ORDER_MORTON // Morton curve over the (longitude, latitude) columns, heights innermost, see morton.h
+} QueryOrder;
+#define DEFAULT_QUERY_ORDER QUERY_ORDER_LATTICE
+
+typedef enum {
+    CLIP_STORAGE_DENSE, // one float per cell and variable
+    CLIP_STORAGE_SPARSE // bricks of CLIP_BRICK_EDGE^3 cells allocated at the first value, see ClipBrickStorage
+} ClipStorage;
+#define DEFAULT_CLIP_STORAGE CLIP_STORAGE_DENSE
+
+typedef enum {
+    OUTPUT_COMPRESSION_NONE, // raw chunks, contiguous datasets with OUTPUT_CHUNK_SIZE=0
+    OUTPUT_COMPRESSION_DEFLATE // shuffle then deflate, the HDF5 built-in filters, see chunkwriter.h
+} OutputCompression;
+#define DEFAULT_OUTPUT_COMPRESSION OUTPUT_COMPRESSION_DEFLATE
+#define DEFAULT_OUTPUT_CHUNK_SIZE 16 // chunk edge along the first two dimensions, the last one is whole
+#define DEFAULT_OUTPUT_DEFLATE_LEVEL 4
+
+typedef enum {
+    OUTPUT_ENCODING_FLOAT32, // IEEE 754 single precision
+    OUTPUT_ENCODING_INT16, // value = stored * OUTPUT_SCALE_FACTOR + OUTPUT_ADD_OFFSET, with the CF attributes
+    OUTPUT_ENCODING_FLOAT16 // IEEE 754 half precision, about 3 significant digits
+} OutputEncoding;
+#define DEFAULT_OUTPUT_ENCODING OUTPUT_ENCODING_FLOAT32
+#define DEFAULT_OUTPUT_SCALE_FACTOR 0.01f // dBZ per count, the int16 range covers +-327 dBZ
+#define DEFAULT_OUTPUT_ADD_OFFSET 0.0f
+
+typedef enum {
+    OUTPUT_FORMAT_HDF5, // the clip groups of both bands in clip_output_file_name
+    OUTPUT_FORMAT_FLAT // one page aligned float32 container per band, mapped as is by the reader, see flatclip.h
+} OutputFormat;
+#define DEFAULT_OUTPUT_FORMAT OUTPUT_FORMAT_HDF5
+
+typedef enum {
+    OUTPUT_LAYOUT_SINGLE, // every slice group inside the clip output file
+    OUTPUT_LAYOUT_PER_CLIP // every clip in its own file, the clip output file links them as <band>/slice_N
+} OutputLayout;
+#define DEFAULT_OUTPUT_LAYOUT OUTPUT_LAYOUT_SINGLE
+#define DEFAULT_CROP_EMPTY_BORDERS false // a slice keeps only the box of its cells with a value, see FindClipValidBox
+
+typedef enum {
+    DERIVED_PRODUCT_COMPOSITE = 1, // column maximum of Value, dBZ
+    DERIVED_PRODUCT_ECHO_TOP = 2, // height of the highest cell at or above ECHO_TOP_THRESHOLD, m
+    DERIVED_PRODUCT_VIL = 4 // vertically integrated liquid, kg/m^2
+} DerivedProduct;
+#define DEFAULT_DERIVED_PRODUCTS 0 // bit mask of DerivedProduct, see derived.h
+#define DEFAULT_ECHO_TOP_THRESHOLD 18.0f // dBZ
+#define DEFAULT_GEODETIC_OUTPUT false // the geolocated bins of every scan line to geo_output_file_name, see geodeticwriter.h
+#define DEFAULT_GEODETIC_BIN_BEGIN 0
+#define DEFAULT_GEODETIC_BIN_END 0 // the bins [begin, end) of every ray are written, 0 for up to the last bin
+#define DEFAULT_GEODETIC_LINE_BLOCK 16 // scan lines of a chunk and of a window written as it is geolocated
+#define DEFAULT_WRITE_BEHIND_DEPTH 2 // finished clips waiting for the writer thread, 0 writes every clip after the interpolation
+#define DEFAULT_WRITE_THREADS 2 // OpenMP threads of the writer thread compressing output chunks
+#define DEFAULT_IDW_POWER 2.0f // 1, 2 and 3 have kernels without pow()
+#define DEFAULT_QUERY_CHUNK_SIZE 16384 // queries per batch, the buffers of a thread are about chunk size * (64 + 16 * k) bytes
+
 struct Config{
     char input_file_name[256];
     char geo_output_file_name[256];
@@ -25,11 +111,45 @@ struct Config{
     float max_distance_tolerance;
     float max_neighbor_distance;
     float min_neighbor_distance;
+    float vertical_scale;
+    float max_vertical_distance;
     unsigned int height_count;
     unsigned int k_neighbor;
     unsigned int kdtree_capacity;
     unsigned int grid_size;
     unsigned int batch_size;
+    ResampleEngine resample_engine;
+    float scatter_radius;
+    IndexEngine index_engine;
+    unsigned int knn_leaf_size;
+    bool shared_index;
+    bool echo_top_cutoff;
+    unsigned int structured_cell_radius;
+    unsigned int structured_bin_radius;
+    unsigned int voxel_ring_count;
+    QueryOrder query_order;
+    unsigned int query_chunk_size;
+    float idw_power;
+    char extra_variables[MAX_EXTRA_VARIABLE_COUNT][MAX_VARIABLE_NAME_LENGTH];
+    unsigned int extra_variable_count;
+    ClipStorage clip_storage;
+    OutputCompression output_compression;
+    unsigned int output_chunk_size;
+    unsigned int output_deflate_level;
+    OutputEncoding output_encoding;
+    float output_scale_factor, output_add_offset;
+    OutputFormat output_format;
+    OutputLayout output_layout;
+    bool crop_empty_borders;
+    unsigned int derived_products;
+    float echo_top_threshold;
+    unsigned int write_behind_depth;
+    unsigned int write_threads;
+    char resample_plan_file[256]; // empty without a resample plan, see plan.h
+    char catalog_file[256]; // empty without a catalog, see catalog.h
+    bool geodetic_output;
+    unsigned int geodetic_bin_begin, geodetic_bin_end;
+    unsigned int geodetic_line_block;
 };
 
 extern struct Config *g_config;
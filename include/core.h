@@ -4,11 +4,42 @@
 #include "data.h"
 #include "index.h"
 #include "kdtree.h"
+#include "interpolate.h"
+#include "separable.h"
+#include "scatter.h"
+#include "writebehind.h"
+#include "geodeticwriter.h"
+#include "morton.h"
 
-bool ProcessDataset(const HDFDataset* dataset, GeodeticGrid* geodeticGrid, PointBatch* pointBatch);
+typedef struct {
+    unsigned int chunkCapacity; // queries of a chunk
+    unsigned int k;
+    double* queryPoints; // [chunkCapacity][3]
+    double* queryGeodetic; // [chunkCapacity][3]
+    unsigned int* queryIDs; // [chunkCapacity], lattice index in the clip
+    int64_t* resultIds; // [chunkCapacity][k]
+    double* resultDistances; // [chunkCapacity][k]
+    uint64_t* resultCounts; // [chunkCapacity]
+    float power; // IDW power
+    IDWBatchKernel idwKernel; // selected once for the power
+    float* neighborDistances; // [k][IDW_BATCH_BLOCK], a block of results in SoA form for the IDW kernel
+    float* neighborValues; // [k][IDW_BATCH_BLOCK]
+    float* interpolated; // [1 + extraCapacity][chunkCapacity], value then the extra variables
+    unsigned int extraCapacity; // extra variables a chunk can carry
+    float* neighborWeights; // [k][IDW_BATCH_BLOCK], the weights shared by the variables, or recorded into a resample plan
+    int64_t* neighborIds; // [k][IDW_BATCH_BLOCK]
+    MortonSortBuffer* mortonBuffer; // sort scratch of a chunk, QUERY_ORDER_MORTON only
+    size_t cellCount, skippedCount; // lattice cells walked, and those above the echo tops filled without a query
+} InterpolateWorkspace;
+
+bool ProcessDataset(const HDFDataset* dataset, GeodeticGrid* geodeticGrid, PointBatch* pointBatch, GeodeticWriter* writer);
 void CalculateGridData(const GridInfo* dataset, GeodeticGrid* geodeticGrid, PointBatch* pointBatch, unsigned int lineIndex, unsigned int angleIndex);
-bool InterpolateGrid(const GeodeticGrid* processedGrid, IndexForest* forest, ClipGridResult* finalGrid);
-bool InitClipResult(const HDFDataset* dataset, const GeodeticGrid* geodeticGrid, const PointBatch* pointBatch, IndexForest* forest, ClipGridResult* finalGrid);
+bool InterpolateGrid(const GeodeticGrid* processedGrid, IndexForest* forest, ClipGridResult* finalGrid, ClipWriter* writer);
+bool InitClipResult(const HDFDataset* dataset, const GeodeticGrid* geodeticGrid, const PointBatch* pointBatch, const char* planFileName, IndexForest* forest, ClipGridResult* finalGrid);
 bool InterpolateClipGrid(const RStarPoint* points, KDTree** flatindexForest, RStarIndex* indexTree, const float* valueArray, ClipGrid* clipGrid);
-bool InterpolateClipGridBatch(RStarIndex* indexTree, KDTree** flatindexForest, const float* valueArray, ClipGrid* clipGrid);
+bool SortQueriesByMorton(const ClipGrid* clipGrid, const unsigned int queryCount, double* queryPoints, double* queryGeodetic, unsigned int* queryIDs, MortonSortBuffer* buffer);
+InterpolateWorkspace* CreateInterpolateWorkspace(const unsigned int chunkCapacity, const unsigned int k, const float power, const unsigned int extraCapacity);
+void DestroyInterpolateWorkspace(InterpolateWorkspace* workspace);
+bool InterpolateClipGridBatch(IndexForest* forest, const unsigned int clipIndex, const float* valueArray, const float* heightArray, const float* const* extraValueArrays, ClipGrid* clipGrid, InterpolateWorkspace* workspace,
+                              ClipResamplePlan* plan);
 #endif
\ No newline at end of file
@@ -5,6 +5,7 @@
 #define GEOLOCATION_GROUP_NAME "Geolocation"
 #define PRE_GROUP_NAME "PRE"
 #include <stdlib.h>
+#include <stdbool.h>
 #include <hdf5.h>
 
 typedef struct {
@@ -12,6 +13,7 @@ typedef struct {
     float airL, airB, zeta;
     float evaluation, clutterFreeBottomIndex;
     float *heightArray, *measuredArray;
+    float *extraArray; // [extraCount][SCAN_HEIGHT_COUNT] the extra variables of the ray, NULL without
 } GridInfo;
 
 typedef struct{
@@ -28,20 +30,56 @@ extern const char* BAND_NAMES[2];
 typedef struct {    
     GridInfo** infoArray;
     HDFGlobalAttribute globalAttribute;
+    unsigned int extraCount; // extra PRE variables read with zFactorMeasured
 } HDFDataset;
 
 typedef struct {
     unsigned int lineCount, heightCount;
     float *latitudeArray, *longitudeArray, *elevationArray, *valueArray; // [lineCount][angleCount][heightCount]
     bool *validArray; // [lineCount][angleCount][heightCount]
+    unsigned int extraCount;
+    float **extraValueArrays; // [extraCount], each [lineCount][angleCount][heightCount], -999 where the variable has no value
 } GeodeticGrid;
 
+#define CLIP_BRICK_EDGE 8 // cells of a brick along longitude, latitude and height
+#define CLIP_BRICK_CELL_COUNT (CLIP_BRICK_EDGE * CLIP_BRICK_EDGE * CLIP_BRICK_EDGE)
+#define DERIVED_PRODUCT_COUNT 3 // composite reflectivity, echo top height and VIL of every column, see derived.h
+
+typedef struct {
+    unsigned int longitudeBrickCount, latitudeBrickCount, heightBrickCount;
+    float** bricks; // [longitudeBrickCount][latitudeBrickCount][heightBrickCount], NULL until a cell of the brick gets a value, else [1 + extraCount][CLIP_BRICK_CELL_COUNT]
+    unsigned int allocatedCount;
+    bool failed; // a brick could not be allocated and a value was lost, the clip fails in FinishClip
+} ClipBrickStorage;
+
+typedef struct {
+    unsigned int longitudeBegin, longitudeEnd, latitudeBegin, latitudeEnd, heightBegin, heightEnd; // [begin, end) of the cells with a value in any variable, empty for a clip without any
+} ClipValidBox;
+
+typedef struct {
+    unsigned int validCount;
+    float minValue, maxValue, meanValue; // of the cells of Value with a value, -999 without
+} ClipLevelStatistics;
+
+typedef struct {
+    ClipLevelStatistics total;
+    ClipValidBox box; // of the cells of Value with a value
+    ClipLevelStatistics* levels; // [heightCount]
+} ClipStatistics;
+
 typedef struct {
     unsigned int latitudeCount, longitudeCount, heightCount;
     unsigned int leftLineIndex, rightLineIndex;
     float maxLatitude, minLatitude, maxLongitude, minLongitude, minHeight;
     float latitudeGap, longitudeGap, heightGap;
-    float *value; // [latitudeCount][longitudeCount][heightCount]
+    float *value; // [latitudeCount][longitudeCount][heightCount], NULL until the clip is interpolated with WRITE_BEHIND_DEPTH, see AllocateClipGridCells
+    unsigned int extraCount;
+    float *extraValue; // [extraCount][latitudeCount][longitudeCount][heightCount], interpolated with the weights of value
+    ClipBrickStorage *sparse; // CLIP_STORAGE=SPARSE keeps value and extraValue NULL and the cells in bricks, see SetClipValue
+    float *products; // [DERIVED_PRODUCT_COUNT][longitudeCount][latitudeCount] with DERIVED_PRODUCTS, see ComputeClipProducts
+    ClipValidBox validBox; // found as the clip is finished with CROP_EMPTY_BORDERS, the writer keeps the box only, see FindClipValidBox
+    bool cropped;
+    ClipStatistics* statistics; // with CATALOG_FILE, kept after the cells are released until the catalog is appended, see ComputeClipStatistics
 } ClipGrid;
 
 typedef struct{
@@ -54,6 +92,60 @@ DateTime CreateDateTime(const char* date, const char* time);
 int getNumber(const char* str, int length);
 char* ConstructDateTimeString(const DateTime* dateTime);
 bool InitGeodeticGrid(GeodeticGrid* finalGrid, const int lineCount, const int heightCount);
+bool InitGeodeticGridExtra(GeodeticGrid* finalGrid, const unsigned int extraCount);
+bool InitClipGridExtra(ClipGridResult* clipGridResult, const unsigned int extraCount);
+bool InitClipGridSparse(ClipGrid* clipGrid);
+bool AllocateClipGridCells(ClipGrid* clipGrid, const bool sparse);
+void ReleaseClipGridCells(ClipGrid* clipGrid);
+float* AllocateClipBrick(ClipGrid* clipGrid, const size_t brick);
+void ClearClipGridExtra(ClipGrid* clipGrid);
+bool CopyClipVariable(const ClipGrid* clipGrid, const unsigned int variable, float* dense);
+void FindClipValidBox(ClipGrid* clipGrid);
+void GetClipWriteBox(const ClipGrid* clipGrid, ClipValidBox* box);
+bool CopyClipVariableBox(const ClipGrid* clipGrid, const unsigned int variable, const ClipValidBox* box, float* block);
+size_t ClipGridResultBytes(const ClipGridResult* clipGridResult);
+
+static inline size_t ClipBrickCell(const ClipGrid* clipGrid, const size_t index, size_t* brick){
+    // the brick of a lattice index (longitude, latitude, height order) and the cell inside it
+    const unsigned int h = index % clipGrid->heightCount;
+    const unsigned int b = (index / clipGrid->heightCount) % clipGrid->latitudeCount;
+    const unsigned int l = index / ((size_t)clipGrid->heightCount * clipGrid->latitudeCount);
+    const ClipBrickStorage* sparse = clipGrid->sparse;
+    *brick = ((size_t)(l / CLIP_BRICK_EDGE) * sparse->latitudeBrickCount + b / CLIP_BRICK_EDGE) * sparse->heightBrickCount + h / CLIP_BRICK_EDGE;
+    return ((l % CLIP_BRICK_EDGE) * CLIP_BRICK_EDGE + b % CLIP_BRICK_EDGE) * CLIP_BRICK_EDGE + h % CLIP_BRICK_EDGE;
+}
+
+static inline void SetClipValue(ClipGrid* clipGrid, const unsigned int variable, const size_t index, const float value){
+    /**
+    @brief Write a cell of a clip, variable 0 is value and 1 + v the extra variable v; a fill value needs no brick, a brick that cannot be allocated marks the clip failed
+    */
+    if (!clipGrid->sparse){
+        if (variable == 0) clipGrid->value[index] = value;
+        else clipGrid->extraValue[(variable - 1) * (size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount + index] = value;
+        return;
+    }
+    size_t brick;
+    const size_t cell = ClipBrickCell(clipGrid, index, &brick);
+    float* cells = clipGrid->sparse->bricks[brick];
+    if (!cells){
+        if (value <= -999) return;
+        cells = AllocateClipBrick(clipGrid, brick);
+        if (!cells){
+            clipGrid->sparse->failed = true;
+            return;
+        }
+    }
+    cells[(size_t)variable * CLIP_BRICK_CELL_COUNT + cell] = value;
+}
+
+static inline float GetClipValue(const ClipGrid* clipGrid, const unsigned int variable, const size_t index){
+    if (!clipGrid->sparse)
+        return variable == 0 ? clipGrid->value[index] : clipGrid->extraValue[(variable - 1) * (size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount + index];
+    size_t brick;
+    const size_t cell = ClipBrickCell(clipGrid, index, &brick);
+    const float* cells = clipGrid->sparse->bricks[brick];
+    return cells ? cells[(size_t)variable * CLIP_BRICK_CELL_COUNT + cell] : -999.0f;
+}
 
 void DestroyGridInfo(GridInfo* info);
 void DestroyHDFDataset(HDFDataset* dataset);
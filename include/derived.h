@@ -0,0 +1,19 @@
+#ifndef DERIVED_H
+#define DERIVED_H
+
+#include <stdbool.h>
+#include "data.h"
+
+#define VIL_COEFFICIENT 3.44e-6f // kg/m^2 per m and (mm^6/m^3)^(4/7), Greene and Clark 1972
+#define VIL_EXPONENT (4.0f / 7.0f)
+#define VIL_MAX_REFLECTIVITY 56.0f // dBZ, the cells above are capped so hail does not dominate the liquid water
+
+// ================ Derived Column Products ================
+// product p of the column (l, b) is products[(p * longitudeCount + l) * latitudeCount + b], -999 for a column without a value
+extern const char* DERIVED_PRODUCT_NAMES[DERIVED_PRODUCT_COUNT];
+extern const char* DERIVED_PRODUCT_UNITS[DERIVED_PRODUCT_COUNT];
+extern const float DERIVED_PRODUCT_INT16_SCALES[DERIVED_PRODUCT_COUNT]; // the scale_factor of OUTPUT_ENCODING=INT16, 0 for OUTPUT_SCALE_FACTOR
+
+void AccumulateColumnProducts(const float* column, const unsigned int heightCount, const float minHeight, const float heightGap, const float echoTopThreshold, float* products);
+bool ComputeClipProducts(ClipGrid* clipGrid, const float echoTopThreshold);
+#endif // DERIVED_H
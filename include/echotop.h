@@ -0,0 +1,19 @@
+#ifndef ECHOTOP_H
+#define ECHOTOP_H
+
+#include <stdbool.h>
+#include "data.h"
+
+#define ECHO_TOP_REACH_MARGIN 1.01f // the stretched space bends the horizontal and vertical distances by less than 1%
+
+// ================ Echo Top Raster ================
+typedef struct {
+    unsigned int lineCount;
+    float* topHeights; // [lineCount][SCAN_ANGLE_COUNT], the height of the highest valid bin of the footprint, -INFINITY without one
+    float* bounds; // [lineCount][SCAN_ANGLE_COUNT][4], min and max latitude, min and max longitude of the valid bins of the footprint
+} EchoTopRaster;
+
+EchoTopRaster* CreateEchoTopRaster(const GeodeticGrid* grid);
+float* EstimateClipColumnTops(const EchoTopRaster* raster, const ClipGrid* clipGrid, const unsigned int firstLine, const unsigned int lastLine, const float horizontalReach);
+void DestroyEchoTopRaster(EchoTopRaster* raster);
+#endif // ECHOTOP_H
@@ -0,0 +1,67 @@
+#ifndef FLATCLIP_H
+#define FLATCLIP_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "data.h"
+#include "config.h"
+
+#define FLAT_CLIP_MAGIC "FY3GFLAT"
+#define FLAT_CLIP_VERSION 1
+#define FLAT_CLIP_PAGE_SIZE 4096 // every block starts on a page, independent of the page size of the host
+#define FLAT_CLIP_BYTE_ORDER 0x01020304u // as written by the little endian writer, a reader of the other order sees 0x04030201
+#define FLAT_CLIP_FILL_VALUE -999.0f
+#define FLAT_CLIP_EXTENSION ".flat"
+#define FLAT_CLIP_INDEX_EXTENSION ".idx" // the text sidecar, appended to the name of the container
+#define FLAT_CLIP_MAX_VARIABLE_COUNT (1 + MAX_EXTRA_VARIABLE_COUNT)
+
+// ================ Flat Clip Container ================
+// one file per band: this header, the clip table, then for every clip one page aligned
+// block per variable of float32 cells in the order [longitudeCount][latitudeCount][heightCount] as the HDF5 datasets
+typedef struct {
+    char magic[8];
+    uint32_t version, byteOrder;
+    uint32_t pageSize, headerSize; // headerSize covers this header and the clip table
+    uint32_t bandIndex, clipCount;
+    uint32_t variableCount, scanLineCount; // variable 0 is Value, 1 + v the extra variable v
+    uint32_t ascending;
+    float fillValue;
+    DateTime startDateTime, endDateTime;
+    char variableNames[FLAT_CLIP_MAX_VARIABLE_COUNT][MAX_VARIABLE_NAME_LENGTH];
+} FlatClipFileHeader;
+
+typedef struct {
+    uint32_t longitudeCount, latitudeCount, heightCount, reserved;
+    float minLatitude, maxLatitude, minLongitude, maxLongitude;
+    float minHeight, latitudeGap, longitudeGap, heightGap;
+    uint64_t offset; // of the block of variable 0, page aligned
+    uint64_t blockStride; // from the block of a variable to the next one, page aligned
+} FlatClipHeader;
+
+typedef struct {
+    int descriptor;
+    char fileName[256];
+    FlatClipFileHeader header;
+    FlatClipHeader* clips; // [clipCount]
+    bool* written; // [clipCount], the header is only written once every clip is
+    float* dense; // a clip sized block to expand a sparse clip
+    size_t denseCount;
+} FlatClipWriter;
+
+typedef struct {
+    void* mapping;
+    size_t mappingSize;
+    const FlatClipFileHeader* header; // into the mapping
+    const FlatClipHeader* clips; // [clipCount], into the mapping
+} FlatClipFile;
+
+char* ConstructFlatClipFilename(const char* clipFileName, const unsigned int bandIndex);
+FlatClipWriter* CreateFlatClipWriter(const unsigned int bandIndex, const char* fileName, const ClipGridResult* clipResult);
+bool WriteFlatClip(FlatClipWriter* writer, const unsigned int clipIndex, const ClipGrid* clipGrid);
+bool CloseFlatClipWriter(FlatClipWriter* writer);
+bool WriteFlatClipResult(const unsigned int bandIndex, const char* clipFileName, const ClipGridResult* clipResult);
+FlatClipFile* OpenFlatClipFile(const char* fileName);
+const float* GetFlatClipBlock(const FlatClipFile* file, const unsigned int clipIndex, const unsigned int variable);
+void CloseFlatClipFile(FlatClipFile* file);
+#endif // FLATCLIP_H
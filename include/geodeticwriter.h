@@ -0,0 +1,32 @@
+#ifndef GEODETICWRITER_H
+#define GEODETICWRITER_H
+
+#include <stdbool.h>
+#include <hdf5.h>
+#include "data.h"
+#include "config.h"
+#include "chunkwriter.h"
+
+#define GEODETIC_COORDINATE_COUNT 3 // Latitude, Longitude and Elevation, then Value and the extra variables
+#define GEODETIC_MAX_DATASET_COUNT (GEODETIC_COORDINATE_COUNT + 1 + MAX_EXTRA_VARIABLE_COUNT)
+
+// ================ Geodetic Product Writer ================
+// every dataset of a band is [lineCount][SCAN_ANGLE_COUNT][binCount] over the bins [binBegin, binBegin + binCount) of
+// every ray, chunked by lineBlock scan lines so a window of lines is written as soon as it is geolocated
+typedef struct {
+    hid_t fileID, bandGroupID;
+    unsigned int bandIndex;
+    unsigned int lineCount, binBegin, binCount, lineBlock;
+    unsigned int datasetCount;
+    hid_t datasetIDs[GEODETIC_MAX_DATASET_COUNT];
+    ChunkLayout coordinateLayout, valueLayout; // the coordinates keep single precision, the variables follow OUTPUT_ENCODING
+    float* window; // [lineBlock][SCAN_ANGLE_COUNT][binCount], a dataset of a window gathered from the grid
+    unsigned int writtenLineCount;
+    HDFGlobalAttribute globalAttribute;
+    bool success;
+} GeodeticWriter;
+
+GeodeticWriter* CreateGeodeticWriter(const unsigned int bandIndex, const char* filename, const unsigned int lineCount, const unsigned int extraCount, const HDFGlobalAttribute* globalAttribute);
+bool WriteGeodeticWindow(GeodeticWriter* writer, const GeodeticGrid* grid, const unsigned int firstLine, const unsigned int lineCount);
+bool CloseGeodeticWriter(GeodeticWriter* writer);
+#endif // GEODETICWRITER_H
@@ -13,12 +13,20 @@ typedef struct{
     double l, b, h;
 } Coordinate;
 
+static inline double WrapLongitudeDifference(double difference){
+    // clip longitudes may be shifted into [0, 360)
+    while (difference >= 180) difference -= 360;
+    while (difference < -180) difference += 360;
+    return difference;
+}
+
 double ComputeN(const double latitude);
 double ComputeS(const double t1, const double t2, const double t3, const double t4, const double e, const double r);
 double ToRadians(const double degree);
 double ToDegrees(const double radians);
 bool IsGeodeticValid(const double latitude, const double longitude, const double height);
 bool TransferGeodeticToCartesian(const double latitude, const double longitude, const double height, double *x, double *y, double *z);
+bool TransferGeodeticToScaledCartesian(const double latitude, const double longitude, const double height, const double verticalScale, double *x, double *y, double *z);
 Coordinate TransferCartesianToGeodetic(const double x, const double y, const double z, const bool iterative);
 void TransferCartesianToGeodeticLagrange(const double x, const double y, const double z, double *latitude, double *height);
 void TransferCartesianToGeodeticIterative(const double x, const double y, const double z, double *latitude, double *height);
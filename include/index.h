@@ -6,7 +6,13 @@
 #include "kdtree.h"
 #include "avltree.h"
 #include "rstartree.h"
+#include "knnindex.h"
+#include "structured.h"
+#include "voxelindex.h"
+#include "plan.h"
+#include "echotop.h"
 #include "data.h"
+#include "config.h"
 
 typedef struct {
     RStarPoint* points;
@@ -41,17 +47,30 @@ PointBatchAtHeight* CreatePointBatchAtHeight(unsigned int initialCapacity);
 void DestroyPointBatchAtHeight(PointBatchAtHeight* batch);
 
 typedef struct {
-    RStarIndex** index; // [clipCount]
+    IndexEngine engine;
+    RStarIndex** index; // [clipCount], INDEX_ENGINE_RSTAR
+    StaticKNNIndex** knnIndex; // [clipCount], INDEX_ENGINE_KNN
+    VoxelIndex** voxelIndex; // [clipCount], INDEX_ENGINE_VOXEL
+    StructuredLocator* locator; // INDEX_ENGINE_STRUCTURED, shared by every clip
     KDTree** flatindex; // [hightCount]
     unsigned int RStarForestSize, KDTreeSize;
+    bool shared; // a single index over the whole band is queried by every clip
+    EchoTopRaster* echoTop; // the highest valid bin of every footprint, NULL without ECHO_TOP_CUTOFF
+    ResamplePlan* plan; // recorded while interpolating, or loaded to interpolate without any index, NULL without RESAMPLE_PLAN_FILE
 } IndexForest;
 
 RStarIndex* CreateRStarIndexFromBatch(const PointBatch* batch, const unsigned int startIndex, const unsigned int endIndex, const BulkLoadConfig* config);
+StaticKNNIndex* CreateKNNIndexFromBatch(const PointBatch* batch, const unsigned int startIndex, const unsigned int endIndex);
+VoxelIndex* CreateVoxelIndexFromBatch(const PointBatch* batch, const unsigned int startIndex, const unsigned int endIndex);
 AVLTree* CreateAVLTreeFromBatch(const PointBatch* pointBatch, const unsigned int startIndex, const unsigned int endIndex);
 KDTree* CreateKDTreeFromBatch(KDCalcPointClip* clip, unsigned int heightIndex);
 bool CreateRStarForest(const PointBatch* pointBatch, ClipGridResult* finalGrid, IndexForest* forest);
+bool CreateKNNForest(const PointBatch* pointBatch, ClipGridResult* finalGrid, IndexForest* forest);
+bool CreateVoxelForest(const PointBatch* pointBatch, ClipGridResult* finalGrid, IndexForest* forest);
+bool CreateSharedIndex(const PointBatch* pointBatch, IndexForest* forest);
 bool CreateKDTreeForest(const GeodeticGrid* geodeticGrid, IndexForest* forest);
 bool CreateIndexForest(const GeodeticGrid* geodeticGrid, const PointBatch* pointBatch, ClipGridResult* finalGrid, IndexForest* forest);
 void DestroyIndexForest(IndexForest* forest);
 bool ProtentialToInterpolate(double latitude, double longitude, double height, KDTree** flatindexForest);
+bool QueryNearestNeighborBatch(const IndexForest* forest, const unsigned int clipIndex, const unsigned int k, const unsigned int queryCount, double* queryPoints, const double* queryGeodetic, int64_t* ids, uint64_t* counts, double* distances);
 #endif
\ No newline at end of file
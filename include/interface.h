@@ -7,6 +7,9 @@
 
 typedef struct {
     hid_t elevationID, latitudeID, longitudeID, zenithID, heightID, groundHeightID, valueID, binClutterID;
+    unsigned int extraCount;
+    hid_t extraIDs[MAX_EXTRA_VARIABLE_COUNT]; // the EXTRA_VARIABLES datasets of the PRE group
+    int extraRanks[MAX_EXTRA_VARIABLE_COUNT]; // 3 for a value per bin, 2 for a value per ray
 } HDFBandRequired;
 
 typedef struct {
@@ -26,6 +29,11 @@ bool ReadSingleScanLine(int lineIndex, const HDFBandRequired* required, GridInfo
 bool ReadSingleDataset(int rank, hid_t datasetID, hsize_t* offset, hsize_t* count, void* buffer);
 char* ConstructPath(const char* pathNames[], const int pathLength);
 bool WriteTotalGeodetic(const unsigned int bandIndex, const char* filename, const GeodeticGrid* finalGrid, const HDFGlobalAttribute* globalAttribute);
+hid_t OpenClipOutputFile(const unsigned int bandIndex, const char* filename);
+bool WriteClipGroup(hid_t bandGroupID, const unsigned int clipIndex, const ClipGrid* clipGrid);
+char* ConstructClipFilename(const char* filename, const unsigned int bandIndex, const unsigned int clipIndex);
+bool WriteClipFile(const unsigned int bandIndex, const char* filename, const unsigned int clipIndex, const ClipGrid* clipGrid);
+bool LinkClipFile(hid_t bandGroupID, const unsigned int bandIndex, const char* filename, const unsigned int clipIndex);
 bool WriteClipResult(const unsigned int bandIndex, const char* filename, const ClipGridResult* clipResult);
 bool WriteGlobalAttribute(hid_t fileID, const HDFGlobalAttribute* globalAttribute);
 bool ReadBatchScanLines(hsize_t startLine, hsize_t batchSize, const HDFBandRequired* required, BatchReadContext* ctx, GridInfo** infoArray);
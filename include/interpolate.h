@@ -8,6 +8,11 @@
 #include "data.h"
 #include "rstartree.h"
 
+#define IDW_BATCH_BLOCK 256 // queries accumulated together by the batch IDW kernels
+
+// IDW of queryCount queries in SoA form, distances and values are [k][stride], empty neighbor slots have INFINITY distance
+typedef void (*IDWBatchKernel)(const unsigned int queryCount, const unsigned int k, const unsigned int stride, const float* distances, const float* values, const float power, float* results);
+
 typedef struct {
     double groundX, groundY, groundZ, groundH;
     double airX, airY, airZ, airH;
@@ -25,5 +30,14 @@ unsigned int SearchLineIndex(const float latitude, unsigned int bias, GridInfo**
 float QueryBoundingBox(ClipGrid* clipGrid, GridInfo** const infoArray, const unsigned int lineCount);
 double InterpolateValueIDW(const double queryPoint[3], const float queryHeight, const SpatialQueryResult* result, const float* valueArray, float power);
 double InterpolateValueIDW_v(const unsigned int neightborCount, const double* distances, const int64_t* ids, const float* valueArray, const float power);
+IDWBatchKernel SelectIDWBatchKernel(const float power);
+void InterpolateValueIDWBatch(const IDWBatchKernel kernel, const float power, const unsigned int queryCount, const unsigned int k, const uint64_t* counts, const double* distances, const int64_t* ids, const float* valueArray,
+                              const float* heightArray, const double* queryGeodetic, float* neighborDistances, float* neighborValues, float* results);
+size_t CalculateIDWWeightsBatch(const float power, const unsigned int queryCount, const unsigned int k, const uint64_t* counts, const double* distances, const int64_t* ids,
+                                const float* heightArray, const double* queryGeodetic, const unsigned int stride, float* weights, int64_t* weightIds);
+void InterpolateValuesIDWBatch(const float power, const unsigned int queryCount, const unsigned int k, const uint64_t* counts, const double* distances, const int64_t* ids,
+                               const unsigned int variableCount, const float* const* valueArrays, const float* heightArray, const double* queryGeodetic,
+                               float* neighborWeights, int64_t* neighborIds, float* results);
+void CalculateIDWWeights(const unsigned int neighborCount, const double* distances, const float power, double* weights);
 float QueryClipNextMinLongitude(const unsigned int leftLineIndex, const unsigned int rightLineIndex, const float maxClipLatitude, GridInfo** const infoArray);
 #endif
\ No newline at end of file
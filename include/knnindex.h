@@ -0,0 +1,99 @@
+#ifndef KNNINDEX_H
+#define KNNINDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <math.h>
+#include "rstartree.h"
+
+#define KNN_MAX_LEAF_SIZE 256
+#define KNN_MAX_DEPTH 64
+
+// ================ Static 3D KNN Index ================
+typedef struct {
+    float min[3], max[3]; // bounding box relative to the index origin
+    unsigned int start, count; // point range covered by the node
+    unsigned int left, right; // child node index, 0 for leaf (root is never a child)
+} KNNNode;
+
+typedef struct {
+    float *x, *y, *z; // [pointCount] coordinates relative to origin, stored in leaf order
+    uint32_t *ids; // [pointCount] point id in the point batch
+    KNNNode *nodes; // [nodeCount], nodes[0] is the root
+    unsigned int pointCount, nodeCount, nodeCapacity;
+    unsigned int leafSize;
+    double origin[3]; // center of the bounding box, keep float coordinates well conditioned
+} StaticKNNIndex;
+
+// plain comparisons, fminf/fmaxf are library calls unless the math is finite-only
+static inline float MinFloat(const float a, const float b){ return a < b ? a : b; }
+static inline float MaxFloat(const float a, const float b){ return a > b ? a : b; }
+
+static inline float BoxDistanceSquared(const KNNNode* node, const float qx, const float qy, const float qz){
+    const float dx = MaxFloat(MaxFloat(node->min[0] - qx, qx - node->max[0]), 0.0f);
+    const float dy = MaxFloat(MaxFloat(node->min[1] - qy, qy - node->max[1]), 0.0f);
+    const float dz = MaxFloat(MaxFloat(node->min[2] - qz, qz - node->max[2]), 0.0f);
+    return dx * dx + dy * dy + dz * dz;
+}
+
+// bounded max heap of the k nearest candidates, shared by the point engines
+static inline void PushBoundedHeap(float* heapDistances, uint32_t* heapIds, unsigned int* size, const unsigned int k, const float distance, const uint32_t id){
+    // max heap on distance, the root is the current k-th nearest neighbor
+    unsigned int i;
+    if (*size < k){
+        i = (*size)++;
+        while (i > 0){
+            const unsigned int parent = (i - 1) / 2;
+            if (heapDistances[parent] >= distance) break;
+            heapDistances[i] = heapDistances[parent];
+            heapIds[i] = heapIds[parent];
+            i = parent;
+        }
+    }
+    else{
+        if (distance >= heapDistances[0]) return;
+        i = 0;
+        while (true){
+            unsigned int child = 2 * i + 1;
+            if (child >= k) break;
+            if (child + 1 < k && heapDistances[child + 1] > heapDistances[child]) child++;
+            if (heapDistances[child] <= distance) break;
+            heapDistances[i] = heapDistances[child];
+            heapIds[i] = heapIds[child];
+            i = child;
+        }
+    }
+    heapDistances[i] = distance;
+    heapIds[i] = id;
+}
+
+static inline void SortBoundedHeap(float* heapDistances, uint32_t* heapIds, const unsigned int size){
+    // heap sort in place, ascending distance
+    for (unsigned int end = size; end > 1; end--){
+        const float distance = heapDistances[end - 1];
+        const uint32_t id = heapIds[end - 1];
+        heapDistances[end - 1] = heapDistances[0];
+        heapIds[end - 1] = heapIds[0];
+        unsigned int heapSize = end - 1, i = 0;
+        while (true){
+            unsigned int child = 2 * i + 1;
+            if (child >= heapSize) break;
+            if (child + 1 < heapSize && heapDistances[child + 1] > heapDistances[child]) child++;
+            if (heapDistances[child] <= distance) break;
+            heapDistances[i] = heapDistances[child];
+            heapIds[i] = heapIds[child];
+            i = child;
+        }
+        heapDistances[i] = distance;
+        heapIds[i] = id;
+    }
+}
+
+StaticKNNIndex* CreateStaticKNNIndex(const RStarPoint* points, const unsigned int startIndex, const unsigned int endIndex, const unsigned int leafSize);
+void DestroyStaticKNNIndex(StaticKNNIndex* index);
+size_t StaticKNNIndex_MemoryUsage(const StaticKNNIndex* index);
+
+unsigned int StaticKNNIndex_NearestNeighborQuery(const StaticKNNIndex* index, const double queryPoint[3], const unsigned int k, float* heapDistances, uint32_t* heapIds);
+bool StaticKNNIndex_NearestNeighborBatchQuery(const StaticKNNIndex* index, const unsigned int k, const unsigned int queryCount, const double* queryPoints, int64_t* ids, uint64_t* counts, double* distances);
+#endif // KNNINDEX_H
@@ -0,0 +1,45 @@
+#ifndef MORTON_H
+#define MORTON_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MORTON_AXIS_BITS 21 // three axes fit in 63 bits
+#define MORTON_RADIX_BITS 16
+#define MORTON_RADIX_SIZE (1u << MORTON_RADIX_BITS)
+
+// ================ Space Filling Curve ================
+static inline uint64_t SpreadMortonBits(uint64_t value){
+    // insert two zero bits between the low 21 bits of value
+    value &= 0x1FFFFFull;
+    value = (value | value << 32) & 0x1F00000000FFFFull;
+    value = (value | value << 16) & 0x1F0000FF0000FFull;
+    value = (value | value << 8) & 0x100F00F00F00F00Full;
+    value = (value | value << 4) & 0x10C30C30C30C30C3ull;
+    value = (value | value << 2) & 0x1249249249249249ull;
+    return value;
+}
+
+static inline uint64_t EncodeMorton3D(const uint32_t x, const uint32_t y, const uint32_t z){
+    return SpreadMortonBits(x) | SpreadMortonBits(y) << 1 | SpreadMortonBits(z) << 2;
+}
+
+static inline uint64_t EncodeMorton2D(const uint32_t x, const uint32_t y){
+    // same spread as the 3D curve, the third bit of every triple stays zero
+    return SpreadMortonBits(x) | SpreadMortonBits(y) << 1;
+}
+
+typedef struct {
+    unsigned int capacity; // keys the buffer can sort
+    uint64_t *keys, *keyBuffer; // [capacity], the keys and the other half of the ping-pong
+    uint32_t *order, *orderBuffer; // [capacity]
+    uint32_t* histogram; // [MORTON_RADIX_SIZE]
+    double* points; // [capacity][3], source of a permutation of query points
+    unsigned int* ids; // [capacity], source of a permutation of query ids
+} MortonSortBuffer;
+
+MortonSortBuffer* CreateMortonSortBuffer(const unsigned int capacity);
+void DestroyMortonSortBuffer(MortonSortBuffer* buffer);
+bool RadixSortKeys(uint64_t* keys, uint32_t* order, const unsigned int count, const uint64_t maxKey);
+bool RadixSortKeysInBuffer(uint64_t* keys, uint32_t* order, const unsigned int count, const uint64_t maxKey, MortonSortBuffer* buffer);
+#endif // MORTON_H
@@ -0,0 +1,48 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "data.h"
+
+#define RESAMPLE_PLAN_MAGIC "FY3GPLAN"
+#define RESAMPLE_PLAN_VERSION 2
+
+// ================ Persisted Resampling Plan ================
+typedef struct {
+    uint32_t scanLineCount, ascending; // the granule
+    DateTime startDateTime, endDateTime;
+    uint32_t gridSize, heightCount, k, indexEngine; // the grid and the neighbors
+    uint32_t sharedIndex, structuredCellRadius, structuredBinRadius; // the points searched
+    float minimalHeight, heightGap, maxDistanceTolerance;
+    float idwPower, minNeighborDistance, maxNeighborDistance, maxVerticalDistance, verticalScale;
+} ResamplePlanKey;
+
+typedef struct {
+    unsigned int cellCount, k;
+    uint32_t* rowOffsets; // [cellCount + 1], the entries of cell c are rowOffsets[c] .. rowOffsets[c + 1] - 1
+    uint32_t* sourceIds; // the geodetic grid index of the source point of every entry
+    float* weights; // the IDW weight of every entry, a cell closer than the min neighbor distance to a point has that single entry
+} ClipResamplePlan;
+
+typedef struct {
+    ResamplePlanKey key;
+    char fileName[256];
+    unsigned int clipCount;
+    ClipResamplePlan* clips; // [clipCount]
+    void* mapping; // the loaded file the clips point into, NULL while the plan is recorded
+    size_t mappingSize;
+} ResamplePlan;
+
+void InitResamplePlanKey(const HDFGlobalAttribute* globalAttribute, ResamplePlanKey* key);
+ResamplePlan* CreateResamplePlan(const char* fileName, const ResamplePlanKey* key, const ClipGridResult* finalGrid, const unsigned int k);
+bool BeginClipResamplePlan(ClipResamplePlan* clip);
+void RecordClipPlanChunk(ClipResamplePlan* clip, const unsigned int queryCount, const unsigned int* queryIDs, const float power, const uint64_t* counts, const double* distances, const int64_t* ids,
+                         const float* heightArray, const double* queryGeodetic, float* neighborWeights, int64_t* neighborIds);
+void FinishClipResamplePlan(ClipResamplePlan* clip);
+bool ApplyClipResamplePlan(const ClipResamplePlan* clip, const float* valueArray, const float* const* extraValueArrays, ClipGrid* clipGrid);
+bool SaveResamplePlan(const ResamplePlan* plan, const ClipGridResult* finalGrid);
+ResamplePlan* LoadResamplePlan(const char* fileName, const ResamplePlanKey* key, const ClipGridResult* finalGrid);
+void DestroyResamplePlan(ResamplePlan* plan);
+#endif // PLAN_H
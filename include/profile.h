@@ -0,0 +1,12 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+#include <stddef.h>
+#include <stdbool.h>
+
+size_t GetResidentMemory(void);
+size_t GetPeakResidentMemory(void);
+bool ResetPeakResidentMemory(void);
+double ToMegaBytes(const size_t bytes);
+int StartCacheMissCounter(void);
+long long StopCacheMissCounter(const int counter);
+#endif
@@ -0,0 +1,11 @@
+#ifndef SCATTER_H
+#define SCATTER_H
+
+#include <stdbool.h>
+#include "data.h"
+
+#define SCATTER_TILE_WIDTH 16 // longitude columns whose weighted sums are accumulated at once
+
+// ================ Forward Splatting Resampling ================
+bool InterpolateClipGridScatter(const GeodeticGrid* grid, const float radius, const float power, ClipGrid* clipGrid);
+#endif // SCATTER_H
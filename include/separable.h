@@ -0,0 +1,23 @@
+#ifndef SEPARABLE_H
+#define SEPARABLE_H
+
+#include <stdbool.h>
+#include "data.h"
+#include "structured.h"
+
+#define SEPARABLE_MAX_NEIGHBOR 64
+
+// ================ Separable Ray / Level Resampling ================
+typedef struct {
+    unsigned int rayCount, levelCount; // a ray is line * SCAN_ANGLE_COUNT + angle of the geodetic grid
+    float minHeight, heightGap; // the target height of level t is minHeight + t * heightGap
+    float *latitude, *longitude; // [levelCount][rayCount] footprint of every ray at every level
+    float *value; // [levelCount][rayCount], -999 where the ray has no valid bin near the level
+    unsigned int extraCount; // the extra variables of the geodetic grid
+    float *extraValue; // [extraCount][levelCount][rayCount], resampled with the weights of value
+} RayLevelProfile;
+
+RayLevelProfile* CreateRayLevelProfile(const GeodeticGrid* grid, const float minHeight, const float heightGap, const unsigned int levelCount, const float maxVerticalDistance);
+void DestroyRayLevelProfile(RayLevelProfile* profile);
+bool InterpolateClipGridSeparable(const StructuredLocator* locator, const RayLevelProfile* profile, const unsigned int k, const float power, ClipGrid* clipGrid);
+#endif // SEPARABLE_H
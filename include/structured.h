@@ -0,0 +1,34 @@
+#ifndef STRUCTURED_H
+#define STRUCTURED_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "data.h"
+
+#define STRUCTURED_MAX_NEWTON_STEP 8
+#define STRUCTURED_MAX_WALK_STEP 64
+#define STRUCTURED_COARSE_LINE_STRIDE 8
+#define STRUCTURED_MAX_CELL_RADIUS 3
+#define STRUCTURED_MAX_STENCIL_COLUMN ((2 * STRUCTURED_MAX_CELL_RADIUS + 1) * (2 * STRUCTURED_MAX_CELL_RADIUS + 1))
+
+// ================ Structured Scan Locator ================
+typedef struct {
+    float latitude, longitude; // footprint of the ray at zero height
+    float latitudeSlope, longitudeSlope; // degree per meter of height, the ray is straight over a few kilometers
+    float firstHeight, binHeightStep; // elevation of bin 0 and the elevation step per bin
+} ScanColumn;
+
+typedef struct {
+    const GeodeticGrid* grid; // borrowed, must outlive the locator
+    ScanColumn* columns; // [lineCount][SCAN_ANGLE_COUNT]
+    unsigned int lineCount, heightCount;
+    unsigned int cellRadius, binRadius; // half size of the line x angle x bin stencil
+    double verticalScale; // weight of the height difference in the distance
+} StructuredLocator;
+
+StructuredLocator* CreateStructuredLocator(const GeodeticGrid* grid, const unsigned int cellRadius, const unsigned int binRadius, const float verticalScale);
+void DestroyStructuredLocator(StructuredLocator* locator);
+bool StructuredLocator_LocateColumn(const StructuredLocator* locator, const double latitude, const double longitude, const double height, unsigned int* lineIndex, unsigned int* angleIndex);
+unsigned int StructuredLocator_NearestNeighborQuery(const StructuredLocator* locator, const double queryGeodetic[3], const unsigned int k, unsigned int* lineIndex, unsigned int* angleIndex, double* distances, int64_t* ids);
+bool StructuredLocator_NearestNeighborBatchQuery(const StructuredLocator* locator, const unsigned int k, const unsigned int queryCount, const double* queryGeodetic, int64_t* ids, uint64_t* counts, double* distances);
+#endif // STRUCTURED_H
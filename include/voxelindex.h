@@ -0,0 +1,40 @@
+#ifndef VOXELINDEX_H
+#define VOXELINDEX_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stddef.h>
+#include "rstartree.h"
+
+#define VOXEL_MAX_RING_COUNT 4
+#define VOXEL_MAX_AXIS_CELL (1u << 21)
+#define VOXEL_EMPTY_SLOT UINT32_MAX
+#define VOXEL_SCAN_CHUNK 256
+
+// ================ Uniform Voxel Hash Index ================
+typedef struct {
+    int16_t dx, dy, dz;
+    float minDistance; // lower bound of the distance from any point of the center voxel, in cell edges squared
+} VoxelOffset;
+
+typedef struct {
+    float *x, *y, *z; // [pointCount] coordinates relative to origin, grouped by voxel
+    uint32_t *ids; // [pointCount] point id in the point batch
+    uint64_t *cellKeys; // [cellCount] ascending voxel keys of the occupied voxels
+    uint32_t *cellStarts; // [cellCount + 1] offset table, points of cell c are in [cellStarts[c], cellStarts[c + 1])
+    uint32_t *slots; // [slotMask + 1] open addressing hash from voxel key to cell, VOXEL_EMPTY_SLOT if empty
+    VoxelOffset *offsets; // [offsetCount] neighboring voxels sorted by minDistance
+    unsigned int pointCount, cellCount, slotMask, slotShift, offsetCount;
+    unsigned int cellCountX, cellCountY, cellCountZ; // extent of the voxel grid
+    float cellSize, radius; // the cell edge is radius / ringCount, so ringCount rings cover the search radius
+    unsigned int ringCount;
+    double origin[3]; // min corner of the bounding box
+} VoxelIndex;
+
+VoxelIndex* CreateVoxelIndex(const RStarPoint* points, const unsigned int startIndex, const unsigned int endIndex, const float radius, const unsigned int ringCount);
+void DestroyVoxelIndex(VoxelIndex* index);
+size_t VoxelIndex_MemoryUsage(const VoxelIndex* index);
+
+unsigned int VoxelIndex_NearestNeighborQuery(const VoxelIndex* index, const double queryPoint[3], const unsigned int k, float* heapDistances, uint32_t* heapIds);
+bool VoxelIndex_NearestNeighborBatchQuery(const VoxelIndex* index, const unsigned int k, const unsigned int queryCount, const double* queryPoints, int64_t* ids, uint64_t* counts, double* distances);
+#endif // VOXELINDEX_H
@@ -0,0 +1,31 @@
+#ifndef WRITEBEHIND_H
+#define WRITEBEHIND_H
+
+#include <stdbool.h>
+#include <pthread.h>
+#include <hdf5.h>
+#include "data.h"
+#include "flatclip.h"
+
+// ================ Write-behind Clip Writer ================
+typedef struct {
+    ClipGridResult* clipResult; // every clip is written then released once submitted
+    unsigned int bandIndex;
+    unsigned int depth; // submitted clips not written yet, SubmitClip waits above it
+    hid_t fileID, bandGroupID;
+    char* filename; // the clip output file, the clip files are named after it with OUTPUT_LAYOUT=PER_CLIP
+    bool perClip;
+    FlatClipWriter* flat; // the container of the band with OUTPUT_FORMAT=FLAT, no HDF5 file then
+    unsigned int* queue; // [clipCount], the clip indices in submission order
+    unsigned int submittedCount, writtenCount;
+    unsigned int peakPendingCount; // the most clips waiting for the writer at once
+    bool closing, success;
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t submitted, written;
+} ClipWriter;
+
+ClipWriter* CreateClipWriter(const unsigned int bandIndex, const char* filename, ClipGridResult* clipResult, const unsigned int depth);
+bool SubmitClip(ClipWriter* writer, const unsigned int clipIndex);
+bool CloseClipWriter(ClipWriter* writer);
+#endif // WRITEBEHIND_H
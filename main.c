@@ -1,6 +1,9 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include "interface.h"
 #include "core.h"
+#include "flatclip.h"
+#include "catalog.h"
 #include "config.h"
 
 int main(int argc, char *argv[]) {
@@ -25,7 +28,23 @@ int main(int argc, char *argv[]) {
         GeodeticGrid processedGrid;
         unsigned int capacity = dataset.globalAttribute.scanLineCount * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
         PointBatch* pointBatch = CreateRStarPointBatch(capacity);
-        if (!ProcessDataset(&dataset, &processedGrid, pointBatch)){
+        // the geodetic product is written block by block as the lines are geolocated
+        GeodeticWriter* geodeticWriter = NULL;
+        if (g_config->geodetic_output){
+            geodeticWriter = CreateGeodeticWriter(bandIndex, g_config->geo_output_file_name, dataset.globalAttribute.scanLineCount, dataset.extraCount, &dataset.globalAttribute);
+            if (!geodeticWriter){
+                printf("Failed to create geodetic writer\n");
+                DestroyHDFDataset(&dataset);
+                DestroyRStarPointBatch(pointBatch);
+                return -2;
+            }
+        }
+        bool processed = ProcessDataset(&dataset, &processedGrid, pointBatch, geodeticWriter);
+        if (geodeticWriter && !CloseGeodeticWriter(geodeticWriter)){
+            printf("Failed to write geodetic product\n");
+            processed = false;
+        }
+        if (!processed){
             printf("Failed to process dataset\n");
             DestroyHDFDataset(&dataset);
             DestroyRStarPointBatch(pointBatch);
@@ -36,7 +55,13 @@ int main(int argc, char *argv[]) {
     
         IndexForest forest;
         ClipGridResult finalGrid;
-        if (!InitClipResult(&dataset, &processedGrid, pointBatch, &forest, &finalGrid)){
+        // one plan per band, e.g. plan.bin holds plan_Ka.bin and plan_Ku.bin
+        char bandSuffix[8];
+        snprintf(bandSuffix, sizeof(bandSuffix), "_%s", BAND_NAMES[bandIndex]);
+        char* planFileName = g_config->resample_plan_file[0] ? ConstructOutputFilename(g_config->resample_plan_file, bandSuffix) : NULL;
+        const bool initialized = InitClipResult(&dataset, &processedGrid, pointBatch, planFileName, &forest, &finalGrid);
+        free(planFileName);
+        if (!initialized){
             printf("Failed to init clip result\n");
             DestroyHDFDataset(&dataset);
             DestroyRStarPointBatch(pointBatch);
@@ -49,16 +74,41 @@ int main(int argc, char *argv[]) {
         DestroyHDFDataset(&dataset);
         DestroyRStarPointBatch(pointBatch);
         
-        if (!InterpolateGrid(&processedGrid, &forest, &finalGrid)){
+        // the clips are written behind the interpolation, or all at once after it
+        ClipWriter* writer = NULL;
+        if (g_config->write_behind_depth > 0){
+            writer = CreateClipWriter(bandIndex, g_config->clip_output_file_name, &finalGrid, g_config->write_behind_depth);
+            if (!writer){
+                printf("Failed to create clip writer\n");
+                DestroyIndexForest(&forest);
+                DestroyClipGridResult(&finalGrid);
+                DestroyGeodeticGrid(&processedGrid);
+                return -5;
+            }
+        }
+        if (!InterpolateGrid(&processedGrid, &forest, &finalGrid, writer)){
             printf("Failed to interpolate grid\n");
+            CloseClipWriter(writer);
             DestroyIndexForest(&forest);
             DestroyClipGridResult(&finalGrid);
             DestroyGeodeticGrid(&processedGrid);
             return -4;
         }
     
-        printf("Interpolate grid successfully\n");
-        if (!WriteClipResult(bandIndex, g_config->clip_output_file_name, &finalGrid)){
+        bool written = false;
+        if (writer){
+            const unsigned int peakPendingCount = writer->peakPendingCount;
+            written = CloseClipWriter(writer);
+            printf("Interpolate grid successfully, up to %u clips waited for the writer\n", peakPendingCount);
+        }
+        else{
+            printf("Interpolate grid successfully, clip storage %.1f MB\n", ClipGridResultBytes(&finalGrid) / (1024.0 * 1024.0));
+            if (g_config->output_format == OUTPUT_FORMAT_FLAT)
+                written = WriteFlatClipResult(bandIndex, g_config->clip_output_file_name, &finalGrid);
+            else
+                written = WriteClipResult(bandIndex, g_config->clip_output_file_name, &finalGrid);
+        }
+        if (!written){
             printf("Failed to write clip result\n");
             DestroyIndexForest(&forest);
             DestroyClipGridResult(&finalGrid);
@@ -66,6 +116,20 @@ int main(int argc, char *argv[]) {
             return -5;
         }
         printf("Write clip result successfully\n");
+        if (g_config->catalog_file[0]){
+            // the flat container holds the clips of a band in its own file
+            char* flatFileName = g_config->output_format == OUTPUT_FORMAT_FLAT ? ConstructFlatClipFilename(g_config->clip_output_file_name, bandIndex) : NULL;
+            const bool cataloged = AppendCatalog(g_config->catalog_file, bandIndex, flatFileName ? flatFileName : g_config->clip_output_file_name, &finalGrid);
+            free(flatFileName);
+            if (!cataloged){
+                printf("Failed to append the clips to the catalog\n");
+                DestroyIndexForest(&forest);
+                DestroyClipGridResult(&finalGrid);
+                DestroyGeodeticGrid(&processedGrid);
+                return -6;
+            }
+            printf("Append the clips to the catalog %s successfully\n", g_config->catalog_file);
+        }
     
         DestroyGeodeticGrid(&processedGrid);
         DestroyIndexForest(&forest);
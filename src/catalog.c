@@ -0,0 +1,426 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "catalog.h"
+
+static int64_t DaysFromCivil(int64_t year, const unsigned int month, const unsigned int day){
+    // days since 1970-01-01 of a date of the proleptic Gregorian calendar
+    year -= month <= 2;
+    const int64_t era = (year >= 0 ? year : year - 399) / 400;
+    const int64_t yearOfEra = year - era * 400;
+    const int64_t dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    const int64_t dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+    return era * 146097 + dayOfEra - 719468;
+}
+
+int64_t DateTimeToSeconds(const DateTime* dateTime){
+    /**
+    @brief The seconds since 1970-01-01T00:00:00 of a date time in UTC
+    @param dateTime: the date time
+    @return the seconds
+    */
+    const int64_t days = DaysFromCivil(dateTime->year, dateTime->month, dateTime->day);
+    return days * 86400 + dateTime->hour * 3600 + dateTime->minute * 60 + dateTime->second;
+}
+
+DateTime SecondsToDateTime(const int64_t seconds){
+    /**
+    @brief The date time in UTC of the seconds since 1970-01-01T00:00:00
+    @param seconds: the seconds
+    @return the date time
+    */
+    const int64_t days = (seconds >= 0 ? seconds : seconds - 86399) / 86400;
+    const int64_t secondOfDay = seconds - days * 86400;
+    const int64_t shifted = days + 719468;
+    const int64_t era = (shifted >= 0 ? shifted : shifted - 146096) / 146097;
+    const int64_t dayOfEra = shifted - era * 146097;
+    const int64_t yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+    const int64_t dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+    const int64_t monthIndex = (5 * dayOfYear + 2) / 153;
+    DateTime dateTime;
+    dateTime.day = (unsigned int)(dayOfYear - (153 * monthIndex + 2) / 5 + 1);
+    dateTime.month = (unsigned int)(monthIndex < 10 ? monthIndex + 3 : monthIndex - 9);
+    dateTime.year = (unsigned int)(yearOfEra + era * 400 + (dateTime.month <= 2));
+    dateTime.hour = (unsigned int)(secondOfDay / 3600);
+    dateTime.minute = (unsigned int)(secondOfDay % 3600 / 60);
+    dateTime.second = (unsigned int)(secondOfDay % 60);
+    return dateTime;
+}
+
+static inline void AddStatisticsCell(ClipLevelStatistics* level, double* sum, ClipValidBox* box, const unsigned int l, const unsigned int b, const unsigned int h, const float value){
+    if (value <= -999) return;
+    if (level->validCount == 0 || value < level->minValue) level->minValue = value;
+    if (level->validCount == 0 || value > level->maxValue) level->maxValue = value;
+    level->validCount++;
+    *sum += value;
+    if (l < box->longitudeBegin) box->longitudeBegin = l;
+    if (l >= box->longitudeEnd) box->longitudeEnd = l + 1;
+    if (b < box->latitudeBegin) box->latitudeBegin = b;
+    if (b >= box->latitudeEnd) box->latitudeEnd = b + 1;
+    if (h < box->heightBegin) box->heightBegin = h;
+    if (h >= box->heightEnd) box->heightEnd = h + 1;
+}
+
+static void FinishLevelStatistics(ClipLevelStatistics* level, const double sum){
+    if (level->validCount == 0)
+        level->minValue = level->maxValue = level->meanValue = -999.0f;
+    else
+        level->meanValue = (float)(sum / level->validCount);
+}
+
+bool ComputeClipStatistics(ClipGrid* clipGrid){
+    /**
+    @brief The statistics of Value of a finished clip, of every height level and of the whole clip, only the allocated bricks of a sparse clip are read
+    @param clipGrid: the interpolated clip, its statistics are allocated, freed with the clip result
+    @return true if successful, false otherwise
+    */
+    ClipStatistics* statistics = (ClipStatistics*)calloc(1, sizeof(ClipStatistics));
+    ClipLevelStatistics* levels = (ClipLevelStatistics*)calloc(clipGrid->heightCount > 0 ? clipGrid->heightCount : 1, sizeof(ClipLevelStatistics));
+    double* sums = (double*)calloc(clipGrid->heightCount > 0 ? clipGrid->heightCount : 1, sizeof(double));
+    if (!statistics || !levels || !sums){
+        fprintf(stderr, "Failed to allocate memory for the statistics of a clip\n");
+        free(statistics);
+        free(levels);
+        free(sums);
+        return false;
+    }
+    ClipValidBox box = {clipGrid->longitudeCount, 0, clipGrid->latitudeCount, 0, clipGrid->heightCount, 0};
+    const ClipBrickStorage* sparse = clipGrid->sparse;
+    if (!sparse){
+        const float* cells = clipGrid->value;
+        for (unsigned int l = 0; l < clipGrid->longitudeCount; l++)
+            for (unsigned int b = 0; b < clipGrid->latitudeCount; b++, cells += clipGrid->heightCount)
+                for (unsigned int h = 0; h < clipGrid->heightCount; h++)
+                    AddStatisticsCell(&levels[h], &sums[h], &box, l, b, h, cells[h]);
+    }
+    else{
+        // brick by brick, a missing brick has no value
+        for (unsigned int lb = 0; lb < sparse->longitudeBrickCount; lb++)
+            for (unsigned int bb = 0; bb < sparse->latitudeBrickCount; bb++)
+                for (unsigned int hb = 0; hb < sparse->heightBrickCount; hb++){
+                    const float* brick = sparse->bricks[((size_t)lb * sparse->latitudeBrickCount + bb) * sparse->heightBrickCount + hb];
+                    if (!brick) continue;
+                    for (unsigned int l = lb * CLIP_BRICK_EDGE; l < clipGrid->longitudeCount && l < (lb + 1) * CLIP_BRICK_EDGE; l++)
+                        for (unsigned int b = bb * CLIP_BRICK_EDGE; b < clipGrid->latitudeCount && b < (bb + 1) * CLIP_BRICK_EDGE; b++)
+                            for (unsigned int h = hb * CLIP_BRICK_EDGE; h < clipGrid->heightCount && h < (hb + 1) * CLIP_BRICK_EDGE; h++)
+                                AddStatisticsCell(&levels[h], &sums[h], &box, l, b, h, brick[((l % CLIP_BRICK_EDGE) * CLIP_BRICK_EDGE + b % CLIP_BRICK_EDGE) * CLIP_BRICK_EDGE + h % CLIP_BRICK_EDGE]);
+                }
+    }
+    double sum = 0;
+    for (unsigned int h = 0; h < clipGrid->heightCount; h++){
+        ClipLevelStatistics* level = &levels[h];
+        if (level->validCount > 0){
+            if (statistics->total.validCount == 0 || level->minValue < statistics->total.minValue) statistics->total.minValue = level->minValue;
+            if (statistics->total.validCount == 0 || level->maxValue > statistics->total.maxValue) statistics->total.maxValue = level->maxValue;
+            statistics->total.validCount += level->validCount;
+            sum += sums[h];
+        }
+        FinishLevelStatistics(level, sums[h]);
+    }
+    FinishLevelStatistics(&statistics->total, sum);
+    if (statistics->total.validCount == 0) box = (ClipValidBox){0};
+    statistics->box = box;
+    statistics->levels = levels;
+    free(sums);
+    if (clipGrid->statistics) free(clipGrid->statistics->levels);
+    free(clipGrid->statistics);
+    clipGrid->statistics = statistics;
+    return true;
+}
+
+static size_t CatalogRecordSize(const ClipGrid* clipGrid){
+    return sizeof(CatalogRecord) + (size_t)clipGrid->heightCount * sizeof(CatalogLevel);
+}
+
+static void FillCatalogRecord(const unsigned int bandIndex, const unsigned int clipIndex, const char* dataFileName, const ClipGridResult* clipResult, CatalogRecord* record){
+    // the record of a clip and its levels behind it
+    const ClipGrid* clipGrid = &clipResult->clipGrids[clipIndex];
+    const ClipStatistics* statistics = clipGrid->statistics;
+    memset(record, 0, sizeof(CatalogRecord));
+    record->recordSize = (uint32_t)CatalogRecordSize(clipGrid);
+    record->bandIndex = bandIndex;
+    record->clipIndex = clipIndex;
+    record->levelCount = clipGrid->heightCount;
+    // the scan lines are evenly spaced in time over the granule
+    const HDFGlobalAttribute* attribute = &clipResult->globalAttribute;
+    const int64_t start = DateTimeToSeconds(&attribute->startDateTime), end = DateTimeToSeconds(&attribute->endDateTime);
+    const double lineDuration = attribute->scanLineCount > 1 ? (double)(end - start) / (attribute->scanLineCount - 1) : 0;
+    record->startTime = start + (int64_t)floor(clipGrid->leftLineIndex * lineDuration);
+    record->endTime = start + (int64_t)ceil(clipGrid->rightLineIndex * lineDuration);
+    if (statistics->total.validCount > 0){
+        const ClipValidBox* box = &statistics->box;
+        record->minLatitude = clipGrid->minLatitude + box->latitudeBegin * clipGrid->latitudeGap;
+        record->maxLatitude = clipGrid->minLatitude + (box->latitudeEnd - 1) * clipGrid->latitudeGap;
+        record->minLongitude = clipGrid->minLongitude + box->longitudeBegin * clipGrid->longitudeGap;
+        record->maxLongitude = clipGrid->minLongitude + (box->longitudeEnd - 1) * clipGrid->longitudeGap;
+    }
+    else{
+        record->minLatitude = clipGrid->minLatitude;
+        record->maxLatitude = clipGrid->maxLatitude;
+        record->minLongitude = clipGrid->minLongitude;
+        record->maxLongitude = clipGrid->maxLongitude;
+    }
+    record->minHeight = clipGrid->minHeight;
+    record->heightGap = clipGrid->heightGap;
+    record->validCount = statistics->total.validCount;
+    record->minValue = statistics->total.minValue;
+    record->maxValue = statistics->total.maxValue;
+    record->meanValue = statistics->total.meanValue;
+    strncpy(record->fileName, dataFileName, sizeof(record->fileName) - 1);
+    CatalogLevel* levels = (CatalogLevel*)(record + 1);
+    for (unsigned int h = 0; h < clipGrid->heightCount; h++){
+        levels[h].validCount = statistics->levels[h].validCount;
+        levels[h].minValue = statistics->levels[h].minValue;
+        levels[h].maxValue = statistics->levels[h].maxValue;
+        levels[h].meanValue = statistics->levels[h].meanValue;
+    }
+}
+
+static bool WriteAll(const int descriptor, const char* buffer, size_t size){
+    while (size > 0){
+        const ssize_t written = write(descriptor, buffer, size);
+        if (written <= 0) return false;
+        buffer += written;
+        size -= written;
+    }
+    return true;
+}
+
+static bool FindCatalogEnd(const int descriptor, const size_t fileSize, size_t* end){
+    // the end of the last complete record of a catalog with a valid header
+    void* mapping = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, descriptor, 0);
+    if (mapping == MAP_FAILED) return false;
+    const CatalogFile file = {mapping, fileSize, fileSize, (const CatalogFileHeader*)mapping, 0};
+    *end = sizeof(CatalogFileHeader);
+    for (const CatalogRecord* record = NextCatalogRecord(&file, NULL); record; record = NextCatalogRecord(&file, record))
+        *end = (size_t)((const char*)record - (const char*)mapping) + record->recordSize;
+    munmap(mapping, fileSize);
+    return true;
+}
+
+bool AppendCatalog(const char* catalogFileName, const unsigned int bandIndex, const char* dataFileName, const ClipGridResult* clipResult){
+    /**
+    @brief Append the records of the clips of a band with statistics to the catalog, created with its header if missing or empty
+    @param catalogFileName: the catalog file, shared by the runs of an archive
+    @param bandIndex: the band index
+    @param dataFileName: the file holding the clips, kept in the records as an absolute path once it exists
+    @param clipResult: the clips, a clip without statistics has no record
+    @return true if successful, false otherwise
+    */
+    // the records outlive the working directory of the run
+    char* resolved = realpath(dataFileName, NULL);
+    const char* fileName = resolved ? resolved : dataFileName;
+    if (strlen(fileName) >= CATALOG_FILE_NAME_LENGTH){
+        fprintf(stderr, "The name of %s is too long for the catalog\n", fileName);
+        free(resolved);
+        return false;
+    }
+    // the records of the band at once, so a concurrent run never interleaves with them
+    size_t size = sizeof(CatalogFileHeader);
+    for (unsigned int clipIndex = 0; clipIndex < clipResult->clipCount; clipIndex++)
+        if (clipResult->clipGrids[clipIndex].statistics) size += CatalogRecordSize(&clipResult->clipGrids[clipIndex]);
+    char* buffer = (char*)malloc(size);
+    if (!buffer){
+        fprintf(stderr, "Failed to allocate memory for the catalog records\n");
+        free(resolved);
+        return false;
+    }
+    CatalogFileHeader* header = (CatalogFileHeader*)buffer;
+    memset(header, 0, sizeof(CatalogFileHeader));
+    memcpy(header->magic, CATALOG_MAGIC, sizeof(header->magic));
+    header->version = CATALOG_VERSION;
+    header->byteOrder = CATALOG_BYTE_ORDER;
+    header->headerSize = sizeof(CatalogFileHeader);
+    header->recordHeaderSize = sizeof(CatalogRecord);
+    size_t offset = sizeof(CatalogFileHeader);
+    for (unsigned int clipIndex = 0; clipIndex < clipResult->clipCount; clipIndex++){
+        if (!clipResult->clipGrids[clipIndex].statistics) continue;
+        FillCatalogRecord(bandIndex, clipIndex, fileName, clipResult, (CatalogRecord*)(buffer + offset));
+        offset += CatalogRecordSize(&clipResult->clipGrids[clipIndex]);
+    }
+    free(resolved);
+
+    const int descriptor = open(catalogFileName, O_RDWR | O_CREAT | O_APPEND, 0644);
+    if (descriptor < 0){
+        fprintf(stderr, "Failed to open catalog file: %s\n", catalogFileName);
+        free(buffer);
+        return false;
+    }
+    bool success = flock(descriptor, LOCK_EX) == 0;
+    struct stat status;
+    success = success && fstat(descriptor, &status) == 0;
+    if (success && status.st_size > 0 && (size_t)status.st_size < sizeof(CatalogFileHeader)){
+        // a header cut short by a failed run is written again
+        char existing[sizeof(CatalogFileHeader)];
+        success = pread(descriptor, existing, status.st_size, 0) == (ssize_t)status.st_size && memcmp(existing, buffer, status.st_size) == 0;
+        success = success && ftruncate(descriptor, 0) == 0;
+        status.st_size = 0;
+        if (!success)
+            fprintf(stderr, "%s is not a catalog file of this version\n", catalogFileName);
+    }
+    else if (success && status.st_size > 0){
+        // appended after the header of the catalog only if it was written by this version
+        CatalogFileHeader existing;
+        success = pread(descriptor, &existing, sizeof(existing), 0) == (ssize_t)sizeof(existing)
+            && memcmp(existing.magic, CATALOG_MAGIC, sizeof(existing.magic)) == 0 && existing.version == CATALOG_VERSION
+            && existing.byteOrder == CATALOG_BYTE_ORDER && existing.headerSize == sizeof(CatalogFileHeader) && existing.recordHeaderSize == sizeof(CatalogRecord);
+        if (!success)
+            fprintf(stderr, "%s is not a catalog file of this version\n", catalogFileName);
+    }
+    // the records go right after the last complete one, a record cut short by a failed run would hide them
+    size_t end = 0;
+    if (success && status.st_size > 0){
+        success = FindCatalogEnd(descriptor, status.st_size, &end);
+        if (success && end < (size_t)status.st_size){
+            fprintf(stderr, "Dropping %zu bytes of a record cut short at the end of %s\n", (size_t)status.st_size - end, catalogFileName);
+            success = ftruncate(descriptor, end) == 0;
+        }
+        if (!success)
+            fprintf(stderr, "Failed to find the last record of catalog file: %s\n", catalogFileName);
+    }
+    const size_t skipped = success && status.st_size > 0 ? sizeof(CatalogFileHeader) : 0;
+    if (success && !WriteAll(descriptor, buffer + skipped, size - skipped)){
+        fprintf(stderr, "Failed to append to catalog file: %s\n", catalogFileName);
+        success = false;
+    }
+    flock(descriptor, LOCK_UN);
+    close(descriptor);
+    free(buffer);
+    return success;
+}
+
+CatalogFile* OpenCatalogFile(const char* fileName){
+    /**
+    @brief Map a catalog read only and count its complete records
+    @param fileName: the catalog file
+    @return the file, NULL if it is missing or not a catalog of this version
+    */
+    if (!fileName) return NULL;
+    const int descriptor = open(fileName, O_RDONLY);
+    if (descriptor < 0){
+        fprintf(stderr, "Failed to open catalog file: %s\n", fileName);
+        return NULL;
+    }
+    // shared with the other readers, a run appending waits until the records are counted
+    flock(descriptor, LOCK_SH);
+    struct stat status;
+    void* mapping = MAP_FAILED;
+    size_t fileSize = 0;
+    if (fstat(descriptor, &status) == 0 && (size_t)status.st_size >= sizeof(CatalogFileHeader)){
+        fileSize = status.st_size;
+        mapping = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, descriptor, 0);
+    }
+    if (mapping == MAP_FAILED){
+        fprintf(stderr, "Failed to map catalog file: %s\n", fileName);
+        close(descriptor);
+        return NULL;
+    }
+    const CatalogFileHeader* header = (const CatalogFileHeader*)mapping;
+    CatalogFile* file = NULL;
+    if (memcmp(header->magic, CATALOG_MAGIC, sizeof(header->magic)) != 0 || header->version != CATALOG_VERSION)
+        fprintf(stderr, "%s is not a catalog file of this version\n", fileName);
+    else if (header->byteOrder != CATALOG_BYTE_ORDER)
+        fprintf(stderr, "%s was written with another byte order\n", fileName);
+    else if (header->headerSize != sizeof(CatalogFileHeader) || header->recordHeaderSize < sizeof(CatalogRecord) || header->recordHeaderSize % 8 != 0)
+        fprintf(stderr, "The header of %s is damaged\n", fileName);
+    else
+        file = (CatalogFile*)calloc(1, sizeof(CatalogFile));
+    if (!file){
+        munmap(mapping, fileSize);
+        close(descriptor);
+        return NULL;
+    }
+    file->mapping = mapping;
+    file->mappingSize = file->size = fileSize;
+    file->header = header;
+    size_t end = header->headerSize;
+    for (const CatalogRecord* record = NextCatalogRecord(file, NULL); record; record = NextCatalogRecord(file, record)){
+        file->recordCount++;
+        end = (size_t)((const char*)record - (const char*)mapping) + record->recordSize;
+    }
+    // the tail past the records may be truncated once the lock is released, it is never read
+    file->size = end;
+    close(descriptor);
+    return file;
+}
+
+const CatalogRecord* NextCatalogRecord(const CatalogFile* file, const CatalogRecord* record){
+    /**
+    @brief The record after a record of the catalog
+    @param file: the mapped catalog
+    @param record: the record, NULL for the first one
+    @return the next complete record, NULL at the end or at a record cut short
+    */
+    const char* begin = (const char*)file->mapping;
+    const size_t offset = record ? (size_t)((const char*)record - begin) + record->recordSize : file->header->headerSize;
+    if (offset + file->header->recordHeaderSize > file->size) return NULL;
+    const CatalogRecord* next = (const CatalogRecord*)(begin + offset);
+    const size_t recordSize = file->header->recordHeaderSize + (size_t)next->levelCount * sizeof(CatalogLevel);
+    if (next->recordSize != recordSize || offset + recordSize > file->size) return NULL;
+    return next;
+}
+
+const CatalogLevel* GetCatalogLevels(const CatalogFile* file, const CatalogRecord* record){
+    /**
+    @brief The level records of a record, [levelCount] from the lowest level
+    @param file: the mapped catalog
+    @param record: the record
+    @return the levels, valid until CloseCatalogFile
+    */
+    return (const CatalogLevel*)((const char*)record + file->header->recordHeaderSize);
+}
+
+void CloseCatalogFile(CatalogFile* file){
+    if (!file) return;
+    munmap(file->mapping, file->mappingSize);
+    free(file);
+}
+
+void InitCatalogQuery(CatalogQuery* query){
+    /**
+    @brief A query matching every record
+    @param query: the query
+    */
+    query->minLatitude = query->minLongitude = -INFINITY;
+    query->maxLatitude = query->maxLongitude = INFINITY;
+    query->startTime = INT64_MIN;
+    query->endTime = INT64_MAX;
+    query->minHeight = -INFINITY;
+    query->maxHeight = INFINITY;
+    query->minValue = -INFINITY;
+}
+
+static inline bool LongitudeOverlap(const CatalogRecord* record, const CatalogQuery* query){
+    // clip longitudes may be shifted into [0, 360)
+    for (int shift = -360; shift <= 360; shift += 360)
+        if (record->minLongitude + shift <= query->maxLongitude && record->maxLongitude + shift >= query->minLongitude) return true;
+    return false;
+}
+
+bool MatchCatalogRecord(const CatalogFile* file, const CatalogRecord* record, const CatalogQuery* query){
+    /**
+    @brief Whether a clip of the catalog overlaps the box and the time of a query, with a level of values in its height range reaching its value
+    @param file: the mapped catalog
+    @param record: the record of the clip
+    @param query: the query
+    @return true if the clip matches
+    */
+    if (record->minLatitude > query->maxLatitude || record->maxLatitude < query->minLatitude || !LongitudeOverlap(record, query)) return false;
+    if (record->startTime > query->endTime || record->endTime < query->startTime) return false;
+    // the value and the height range filter each on its own, the levels are looked at if either is set
+    const bool anyValue = query->minValue == -INFINITY, anyHeight = query->minHeight == -INFINITY && query->maxHeight == INFINITY;
+    if (anyValue && anyHeight) return true;
+    if (record->validCount == 0 || (!anyValue && record->maxValue < query->minValue)) return false;
+    const CatalogLevel* levels = GetCatalogLevels(file, record);
+    for (unsigned int h = 0; h < record->levelCount; h++){
+        const float height = record->minHeight + h * record->heightGap;
+        if (height >= query->minHeight && height <= query->maxHeight && levels[h].validCount > 0 && (anyValue || levels[h].maxValue >= query->minValue)) return true;
+    }
+    return false;
+}
@@ -0,0 +1,335 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include <zlib.h>
+#include "chunkwriter.h"
+
+typedef struct {
+    float* raw; // [chunk cells], the cells of the chunk, the fill value past the dataset
+    void* encoded; // [chunk cells], the cells in the type of the file, NULL for OUTPUT_ENCODING_FLOAT32
+    unsigned char* shuffled; // [chunk bytes], the bytes of the cells grouped by significance as the HDF5 shuffle filter
+    unsigned char* packed; // [compressBound(chunk bytes)]
+    size_t packedSize; // 0 for a chunk of fill values only
+    bool failed;
+} ChunkSlot;
+
+void InitChunkLayout(const hsize_t* dims, ChunkLayout* layout){
+    /**
+    @brief Init the layout of a 3D output dataset from the output parameters, the chunks span OUTPUT_CHUNK_SIZE along the first two dimensions and the whole last one
+    @param dims: the dimensions of the dataset
+    @param layout: the layout to init
+    */
+    const unsigned int edge = g_config ? g_config->output_chunk_size : 0;
+    layout->rank = 3;
+    layout->compression = g_config ? g_config->output_compression : OUTPUT_COMPRESSION_NONE;
+    layout->level = g_config ? g_config->output_deflate_level : DEFAULT_OUTPUT_DEFLATE_LEVEL;
+    layout->encoding = g_config ? g_config->output_encoding : OUTPUT_ENCODING_FLOAT32;
+    layout->scaleFactor = g_config && g_config->output_scale_factor > 0 ? g_config->output_scale_factor : DEFAULT_OUTPUT_SCALE_FACTOR;
+    layout->addOffset = g_config ? g_config->output_add_offset : DEFAULT_OUTPUT_ADD_OFFSET;
+    for (unsigned int d = 0; d < 3; d++){
+        layout->dims[d] = dims[d];
+        layout->chunkDims[d] = 0;
+    }
+    // a filter needs chunks, the default edge is taken when the chunks are turned off
+    const unsigned int chunkEdge = edge > 0 ? edge : (layout->compression != OUTPUT_COMPRESSION_NONE ? DEFAULT_OUTPUT_CHUNK_SIZE : 0);
+    if (chunkEdge == 0 || dims[0] == 0 || dims[1] == 0 || dims[2] == 0) return;
+    layout->chunkDims[0] = dims[0] < chunkEdge ? dims[0] : chunkEdge;
+    layout->chunkDims[1] = dims[1] < chunkEdge ? dims[1] : chunkEdge;
+    layout->chunkDims[2] = dims[2];
+}
+
+void InitPlaneChunkLayout(const hsize_t* dims, ChunkLayout* layout){
+    /**
+    @brief Init the layout of a 2D output dataset as InitChunkLayout, the plane is written as rows of one cell deep columns
+    @param dims: the 2 dimensions of the dataset
+    @param layout: the layout to init
+    */
+    const hsize_t planeDims[3] = {dims[0], dims[1], 1};
+    InitChunkLayout(planeDims, layout);
+    layout->rank = 2;
+}
+
+size_t OutputElementSize(const OutputEncoding encoding){
+    /**
+    @brief The bytes of a cell in the file
+    @param encoding: the output encoding
+    @return the bytes
+    */
+    return encoding == OUTPUT_ENCODING_FLOAT32 ? sizeof(float) : sizeof(uint16_t);
+}
+
+static inline int16_t FloatToScaled(const float value, const float scaleFactor, const float addOffset){
+    // the nearest count, saturated above the fill count, selects rather than fminf and fmaxf keep the loop vectorized
+    float count = rintf((value - addOffset) / scaleFactor);
+    count = count < -INT16_MAX ? -INT16_MAX : (count > INT16_MAX ? INT16_MAX : count);
+    return (int16_t)(value == OUTPUT_FILL_VALUE ? OUTPUT_INT16_FILL_VALUE : (int32_t)count);
+}
+
+static inline uint16_t FloatToHalf(const float value){
+    // round to nearest even, the three ranges are selects so the loops over the cells vectorize
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t magnitude = bits & 0x7fffffffu;
+    // below 2^-14 the float addition of 0.5 aligns and rounds the subnormal mantissa
+    float absolute;
+    memcpy(&absolute, &magnitude, sizeof(absolute));
+    const float aligned = absolute + 0.5f;
+    uint32_t alignedBits;
+    memcpy(&alignedBits, &aligned, sizeof(alignedBits));
+    const uint32_t subnormal = alignedBits - 0x3f000000u;
+    // rebias the exponent from 127 to 15, and round the 13 dropped mantissa bits
+    const uint32_t normal = (magnitude + 0xc8000fffu + ((magnitude >> 13) & 1u)) >> 13;
+    // 65520 and above round to infinity, NaN stays a quiet NaN
+    const uint32_t overflow = magnitude > 0x7f800000u ? 0x7e00u : 0x7c00u;
+    const uint32_t half = magnitude >= 0x477ff000u ? overflow : (magnitude < 0x38800000u ? subnormal : normal);
+    return (uint16_t)(half | sign);
+}
+
+void EncodeOutputCells(const ChunkLayout* layout, const float* cells, const size_t count, void* encoded){
+    /**
+    @brief Convert cells to the type of the file, the fill value to the fill value of the encoding
+    @param layout: the layout with the encoding, see InitChunkLayout
+    @param cells: the cells
+    @param count: the number of cells
+    @param encoded: output, count cells of OutputElementSize bytes
+    */
+    if (layout->encoding == OUTPUT_ENCODING_INT16){
+        int16_t* counts = (int16_t*)encoded;
+        const float scaleFactor = layout->scaleFactor, addOffset = layout->addOffset;
+        #pragma omp simd
+        for (size_t c = 0; c < count; c++)
+            counts[c] = FloatToScaled(cells[c], scaleFactor, addOffset);
+    }
+    else if (layout->encoding == OUTPUT_ENCODING_FLOAT16){
+        uint16_t* halves = (uint16_t*)encoded;
+        #pragma omp simd
+        for (size_t c = 0; c < count; c++)
+            halves[c] = FloatToHalf(cells[c]);
+    }
+    else
+        memcpy(encoded, cells, count * sizeof(float));
+}
+
+static hid_t CreateOutputType(const OutputEncoding encoding){
+    // the type of the cells in the file, closed by the caller
+    if (encoding == OUTPUT_ENCODING_INT16) return H5Tcopy(H5T_STD_I16LE);
+    if (encoding != OUTPUT_ENCODING_FLOAT16) return H5Tcopy(H5T_NATIVE_FLOAT);
+    // HDF5 1.10 has no predefined half type, the IEEE binary16 layout is derived from the single one
+    hid_t typeID = H5Tcopy(H5T_IEEE_F32LE);
+    if (typeID < 0) return typeID;
+    if (H5Tset_fields(typeID, 15, 10, 5, 0, 10) < 0 || H5Tset_size(typeID, 2) < 0 || H5Tset_ebias(typeID, 15) < 0){
+        H5Tclose(typeID);
+        return -1;
+    }
+    return typeID;
+}
+
+static bool WriteScalarAttribute(hid_t objectID, const char* name, hid_t typeID, const void* value){
+    // a scalar attribute of the type in memory and in the file
+    hid_t spaceID = H5Screate(H5S_SCALAR);
+    hid_t attributeID = spaceID < 0 ? -1 : H5Acreate(objectID, name, typeID, spaceID, H5P_DEFAULT, H5P_DEFAULT);
+    const bool success = attributeID >= 0 && H5Awrite(attributeID, typeID, value) >= 0;
+    if (!success)
+        fprintf(stderr, "Failed to write attribute: %s\n", name);
+    if (attributeID >= 0) H5Aclose(attributeID);
+    if (spaceID >= 0) H5Sclose(spaceID);
+    return success;
+}
+
+hid_t CreateChunkedDataset(hid_t groupID, const char* name, const ChunkLayout* layout){
+    /**
+    @brief Create a dataset of the output encoding with the chunks, filters and fill value of the layout, an int16 dataset gets the scale_factor, add_offset and _FillValue attributes
+    @param groupID: the group of the dataset
+    @param name: the name of the dataset
+    @param layout: the layout, see InitChunkLayout
+    @return the dataset ID, negative if failed
+    */
+    hid_t dataspaceID = H5Screate_simple(layout->rank, layout->dims, NULL);
+    hid_t propertyID = H5Pcreate(H5P_DATASET_CREATE);
+    hid_t typeID = CreateOutputType(layout->encoding);
+    if (dataspaceID < 0 || propertyID < 0 || typeID < 0){
+        fprintf(stderr, "Failed to create dataspace of dataset: %s\n", name);
+        if (dataspaceID >= 0) H5Sclose(dataspaceID);
+        if (propertyID >= 0) H5Pclose(propertyID);
+        if (typeID >= 0) H5Tclose(typeID);
+        return -1;
+    }
+    const float fill = OUTPUT_FILL_VALUE;
+    const int16_t countFill = OUTPUT_INT16_FILL_VALUE;
+    herr_t status = layout->encoding == OUTPUT_ENCODING_INT16 ? H5Pset_fill_value(propertyID, H5T_NATIVE_SHORT, &countFill) : H5Pset_fill_value(propertyID, H5T_NATIVE_FLOAT, &fill);
+    if (layout->chunkDims[0] > 0){
+        status |= H5Pset_chunk(propertyID, layout->rank, layout->chunkDims);
+        // the order of the pipeline is the order WriteChunkedDataset applies the filters in
+        if (layout->compression == OUTPUT_COMPRESSION_DEFLATE){
+            status |= H5Pset_shuffle(propertyID);
+            status |= H5Pset_deflate(propertyID, layout->level);
+        }
+    }
+    hid_t datasetID = status < 0 ? -1 : H5Dcreate(groupID, name, typeID, dataspaceID, H5P_DEFAULT, propertyID, H5P_DEFAULT);
+    if (datasetID < 0)
+        fprintf(stderr, "Failed to create dataset: %s\n", name);
+    // the CF packing attributes, value = stored * scale_factor + add_offset
+    if (datasetID >= 0 && layout->encoding == OUTPUT_ENCODING_INT16 &&
+        (!WriteScalarAttribute(datasetID, "scale_factor", H5T_NATIVE_FLOAT, &layout->scaleFactor) || !WriteScalarAttribute(datasetID, "add_offset", H5T_NATIVE_FLOAT, &layout->addOffset) ||
+         !WriteScalarAttribute(datasetID, "_FillValue", H5T_NATIVE_SHORT, &countFill))){
+        H5Dclose(datasetID);
+        datasetID = -1;
+    }
+    H5Tclose(typeID);
+    H5Pclose(propertyID);
+    H5Sclose(dataspaceID);
+    return datasetID;
+}
+
+static void PackChunk(const ChunkLayout* layout, const float* data, const hsize_t firstRow, const hsize_t rowEnd, const hsize_t* offset, ChunkSlot* slot){
+    // gather the chunk from the rows [firstRow, rowEnd) in data, then shuffle and deflate it as the filters of the dataset would
+    const hsize_t* dims = layout->dims;
+    const hsize_t* chunkDims = layout->chunkDims;
+    const size_t cellCount = (size_t)chunkDims[0] * chunkDims[1] * chunkDims[2];
+    bool filled = true;
+    for (hsize_t i = 0; i < chunkDims[0]; i++)
+        for (hsize_t j = 0; j < chunkDims[1]; j++){
+            float* row = slot->raw + ((size_t)i * chunkDims[1] + j) * chunkDims[2];
+            const hsize_t x = offset[0] + i, y = offset[1] + j;
+            const size_t extent = offset[2] + chunkDims[2] > dims[2] ? dims[2] - offset[2] : chunkDims[2];
+            size_t k = 0;
+            if (x < rowEnd && y < dims[1]){
+                const float* source = data + ((size_t)(x - firstRow) * dims[1] + y) * dims[2] + offset[2];
+                for (; k < extent; k++){
+                    row[k] = source[k];
+                    filled &= source[k] == OUTPUT_FILL_VALUE;
+                }
+            }
+            for (; k < chunkDims[2]; k++) row[k] = OUTPUT_FILL_VALUE;
+        }
+    slot->failed = false;
+    if (filled){
+        slot->packedSize = 0;
+        return;
+    }
+    const size_t elementSize = OutputElementSize(layout->encoding);
+    const size_t byteCount = cellCount * elementSize;
+    const unsigned char* bytes = (const unsigned char*)slot->raw;
+    if (slot->encoded){
+        EncodeOutputCells(layout, slot->raw, cellCount, slot->encoded);
+        bytes = (const unsigned char*)slot->encoded;
+    }
+    if (layout->compression == OUTPUT_COMPRESSION_NONE){
+        memcpy(slot->packed, bytes, byteCount);
+        slot->packedSize = byteCount;
+        return;
+    }
+    for (size_t c = 0; c < cellCount; c++)
+        for (size_t b = 0; b < elementSize; b++)
+            slot->shuffled[b * cellCount + c] = bytes[c * elementSize + b];
+    uLongf packedSize = compressBound(byteCount);
+    slot->failed = compress2(slot->packed, &packedSize, slot->shuffled, byteCount, layout->level) != Z_OK;
+    slot->packedSize = packedSize;
+}
+
+bool WriteChunkedDataset(hid_t datasetID, const ChunkLayout* layout, const float* data){
+    /**
+    @brief Write a whole float dataset in the output encoding, the chunks are encoded and packed in parallel and handed to HDF5 one at a time by direct chunk writes, the chunks of fill values only are left to the fill value
+    @param datasetID: the dataset created by CreateChunkedDataset with the same layout
+    @param layout: the layout of the dataset
+    @param data: the values [dims[0]][dims[1]][dims[2]]
+    @return true if successful, false otherwise
+    */
+    return WriteChunkedRows(datasetID, layout, data, 0, layout->dims[0]);
+}
+
+static bool WriteContiguousRows(hid_t datasetID, const ChunkLayout* layout, const float* data, const hsize_t firstRow, const hsize_t rowCount){
+    // the rows are encoded and written in the type of the file through a hyperslab
+    const size_t cellCount = (size_t)rowCount * layout->dims[1] * layout->dims[2];
+    const bool whole = firstRow == 0 && rowCount == layout->dims[0];
+    void* encoded = layout->encoding != OUTPUT_ENCODING_FLOAT32 ? malloc(cellCount * OutputElementSize(layout->encoding)) : NULL;
+    hid_t typeID = layout->encoding != OUTPUT_ENCODING_FLOAT32 ? H5Dget_type(datasetID) : H5Tcopy(H5T_NATIVE_FLOAT);
+    const hsize_t start[3] = {firstRow, 0, 0}, count[3] = {rowCount, layout->dims[1], layout->dims[2]};
+    hid_t fileSpaceID = whole ? H5S_ALL : H5Dget_space(datasetID);
+    hid_t memorySpaceID = whole ? H5S_ALL : H5Screate_simple(layout->rank, count, NULL);
+    bool success = (encoded || layout->encoding == OUTPUT_ENCODING_FLOAT32) && typeID >= 0 && fileSpaceID >= 0 && memorySpaceID >= 0;
+    if (success && !whole)
+        success = H5Sselect_hyperslab(fileSpaceID, H5S_SELECT_SET, start, NULL, count, NULL) >= 0;
+    if (success){
+        if (encoded) EncodeOutputCells(layout, data, cellCount, encoded);
+        success = H5Dwrite(datasetID, typeID, memorySpaceID, fileSpaceID, H5P_DEFAULT, encoded ? encoded : data) >= 0;
+    }
+    if (!whole && memorySpaceID >= 0) H5Sclose(memorySpaceID);
+    if (!whole && fileSpaceID >= 0) H5Sclose(fileSpaceID);
+    if (typeID >= 0) H5Tclose(typeID);
+    free(encoded);
+    return success;
+}
+
+bool WriteChunkedRows(hid_t datasetID, const ChunkLayout* layout, const float* data, const hsize_t firstRow, const hsize_t rowCount){
+    /**
+    @brief Write rows of a float dataset along its first dimension as WriteChunkedDataset, e.g. a window of scan lines as it is ready
+    @param datasetID: the dataset created by CreateChunkedDataset with the same layout
+    @param layout: the layout of the dataset
+    @param data: the values of the rows [rowCount][dims[1]][dims[2]]
+    @param firstRow: the first row, at the start of a chunk of a chunked dataset
+    @param rowCount: the rows, whole chunks unless they reach the end of the dataset
+    @return true if successful, false otherwise
+    */
+    const hsize_t rowEnd = firstRow + rowCount;
+    if (rowEnd > layout->dims[0] || (layout->chunkDims[0] > 0 && (firstRow % layout->chunkDims[0] != 0 || (rowCount % layout->chunkDims[0] != 0 && rowEnd != layout->dims[0])))){
+        fprintf(stderr, "Failed to write rows %llu to %llu, they are not whole chunks of the dataset\n", (unsigned long long)firstRow, (unsigned long long)rowEnd);
+        return false;
+    }
+    if (rowCount == 0) return true;
+    if (layout->chunkDims[0] == 0) return WriteContiguousRows(datasetID, layout, data, firstRow, rowCount);
+    const hsize_t* dims = layout->dims;
+    const hsize_t* chunkDims = layout->chunkDims;
+    const hsize_t firstChunkRow = firstRow / chunkDims[0];
+    const size_t counts[3] = {(rowEnd + chunkDims[0] - 1) / chunkDims[0] - firstChunkRow, (dims[1] + chunkDims[1] - 1) / chunkDims[1], (dims[2] + chunkDims[2] - 1) / chunkDims[2]};
+    const size_t chunkCount = counts[0] * counts[1] * counts[2];
+    const size_t chunkCellCount = (size_t)chunkDims[0] * chunkDims[1] * chunkDims[2];
+    const size_t byteCount = chunkCellCount * OutputElementSize(layout->encoding);
+    const int packThreads = omp_get_max_threads(); // WRITE_THREADS on the write-behind thread
+    const size_t maxSlotCount = (size_t)packThreads * OUTPUT_CHUNKS_PER_THREAD;
+    const unsigned int slotCount = (unsigned int)(chunkCount < maxSlotCount ? chunkCount : maxSlotCount);
+    ChunkSlot* slots = (ChunkSlot*)calloc(slotCount, sizeof(ChunkSlot));
+    bool success = slots != NULL;
+    for (unsigned int s = 0; s < slotCount && success; s++){
+        slots[s].raw = (float*)malloc(chunkCellCount * sizeof(float));
+        slots[s].encoded = layout->encoding != OUTPUT_ENCODING_FLOAT32 ? malloc(byteCount) : NULL;
+        slots[s].shuffled = (unsigned char*)malloc(byteCount);
+        slots[s].packed = (unsigned char*)malloc(compressBound(byteCount));
+        success = slots[s].raw && (slots[s].encoded || layout->encoding == OUTPUT_ENCODING_FLOAT32) && slots[s].shuffled && slots[s].packed;
+    }
+    if (!success)
+        fprintf(stderr, "Failed to allocate memory for %u output chunks of %zu bytes\n", slotCount, byteCount);
+    for (size_t start = 0; start < chunkCount && success; start += slotCount){
+        const unsigned int batchCount = chunkCount - start < slotCount ? (unsigned int)(chunkCount - start) : slotCount;
+        #pragma omp parallel for schedule(dynamic) num_threads(packThreads)
+        for (unsigned int s = 0; s < batchCount; s++){
+            const size_t chunk = start + s;
+            const hsize_t offset[3] = {(firstChunkRow + chunk / (counts[1] * counts[2])) * chunkDims[0], chunk / counts[2] % counts[1] * chunkDims[1], chunk % counts[2] * chunkDims[2]};
+            PackChunk(layout, data, firstRow, rowEnd, offset, &slots[s]);
+        }
+        // HDF5 is entered by this thread only
+        for (unsigned int s = 0; s < batchCount && success; s++){
+            const size_t chunk = start + s;
+            const hsize_t offset[3] = {(firstChunkRow + chunk / (counts[1] * counts[2])) * chunkDims[0], chunk / counts[2] % counts[1] * chunkDims[1], chunk % counts[2] * chunkDims[2]};
+            if (slots[s].failed){
+                fprintf(stderr, "Failed to compress output chunk %zu\n", chunk);
+                success = false;
+            }
+            else if (slots[s].packedSize > 0 && H5Dwrite_chunk(datasetID, H5P_DEFAULT, 0, offset, slots[s].packedSize, slots[s].packed) < 0){
+                fprintf(stderr, "Failed to write output chunk %zu\n", chunk);
+                success = false;
+            }
+        }
+    }
+    for (unsigned int s = 0; slots && s < slotCount; s++){
+        free(slots[s].raw);
+        free(slots[s].encoded);
+        free(slots[s].shuffled);
+        free(slots[s].packed);
+    }
+    free(slots);
+    return success;
+}
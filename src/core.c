@@ -1,10 +1,15 @@
 #include <omp.h>
+#include <string.h>
 #include "core.h"
 #include "data.h"
 #include "interpolate.h"
 #include "geotransfer.h"
 #include "index.h"
 #include "config.h"
+#include "morton.h"
+#include "plan.h"
+#include "derived.h"
+#include "catalog.h"
 
 static bool IsValidHeightData(const float coordinateHeight, const float elevation, const unsigned int heightIndex, const float clutterFreeBottomIndex){
     if (heightIndex >= clutterFreeBottomIndex) return false;
@@ -41,31 +46,57 @@ void CalculateGridData(const GridInfo* sampleGridInfo, GeodeticGrid* geodeticGri
         if (geodeticGrid->valueArray[index] > -999 && IsValidHeightData(coordinate.h, sampleGridInfo->evaluation, heightIndex ,sampleGridInfo->clutterFreeBottomIndex)){
             pointBatch->points[index] = *CreateRStarPoint(coordinate.x, coordinate.y, coordinate.z, index);  
             pointBatch->points[index].h = coordinate.h;
+            if (g_config->vertical_scale != 1){
+                // the indexes search in the space stretched by the vertical scale, the queries are stretched alike
+                double x, y, z;
+                TransferGeodeticToScaledCartesian(coordinate.l, coordinate.b, coordinate.h, g_config->vertical_scale, &x, &y, &z);
+                pointBatch->points[index].x = x;
+                pointBatch->points[index].y = y;
+                pointBatch->points[index].z = z;
+            }
         }
         else{
             pointBatch->points[index].h = -1; // to sign the invalid height data
             geodeticGrid->validArray[index] = false;
         }
+        // the extra variables keep their own fill values apart, only the points of zFactorMeasured are neighbors
+        for (unsigned int v = 0; v < geodeticGrid->extraCount; v++){
+            const float extra = sampleGridInfo->extraArray ? sampleGridInfo->extraArray[v * SCAN_HEIGHT_COUNT + heightIndex] : -999;
+            geodeticGrid->extraValueArrays[v][index] = isfinite(extra) && extra > -999 ? extra : -999;
+        }
     }
 }
 
-bool ProcessDataset(const HDFDataset* dataset, GeodeticGrid* geodeticGrid, PointBatch* pointBatch){
+bool ProcessDataset(const HDFDataset* dataset, GeodeticGrid* geodeticGrid, PointBatch* pointBatch, GeodeticWriter* writer){
     /**
     @brief Read the raw data and process it into grids
     @param dataset: the dataset to construct the final grid
     @param geodeticGrid: the grid to store the processed raw data
     @param pointBatch: the point batch to store the point data for further batch utilization
+    @param writer: the geodetic product writer, every block of lines is written once it is geolocated and before the next one starts, NULL without
     @return true if successful, false otherwise
     */
     if (!InitGeodeticGrid(geodeticGrid, dataset->globalAttribute.scanLineCount, SCAN_HEIGHT_COUNT)){
         fprintf(stderr, "Failed to initialize final grid\n");
         return false;
     }
-    #pragma omp parallel for shared(dataset, geodeticGrid, pointBatch) collapse(2)
-    for (unsigned int lineIndex = 0; lineIndex < geodeticGrid->lineCount; lineIndex++)
-        for (unsigned int angleIndex = 0; angleIndex < SCAN_ANGLE_COUNT; angleIndex++)
-            CalculateGridData(&dataset->infoArray[lineIndex][angleIndex], geodeticGrid, pointBatch, lineIndex, angleIndex);
-    return true;
+    if (!InitGeodeticGridExtra(geodeticGrid, dataset->extraCount)){
+        fprintf(stderr, "Failed to initialize the extra variables of the grid\n");
+        return false;
+    }
+    const unsigned int lineCount = geodeticGrid->lineCount;
+    const unsigned int window = writer ? writer->lineBlock : lineCount;
+    bool success = true;
+    for (unsigned int firstLine = 0; firstLine < lineCount && success; firstLine += window){
+        const unsigned int lastLine = lineCount - firstLine < window ? lineCount : firstLine + window;
+        #pragma omp parallel for shared(dataset, geodeticGrid, pointBatch) collapse(2)
+        for (unsigned int lineIndex = firstLine; lineIndex < lastLine; lineIndex++)
+            for (unsigned int angleIndex = 0; angleIndex < SCAN_ANGLE_COUNT; angleIndex++)
+                CalculateGridData(&dataset->infoArray[lineIndex][angleIndex], geodeticGrid, pointBatch, lineIndex, angleIndex);
+        // not overlapped with the next window, and the whole grid stays allocated for the interpolation
+        if (writer) success = WriteGeodeticWindow(writer, geodeticGrid, firstLine, lastLine - firstLine);
+    }
+    return success;
 }
 
 bool InterpolateClipGrid(const RStarPoint* points, KDTree** flatindexForest, RStarIndex* indexTree, const float* valueArray, ClipGrid* clipGrid){
@@ -92,129 +123,273 @@ bool InterpolateClipGrid(const RStarPoint* points, KDTree** flatindexForest, RSt
                 unsigned int index = l * clipGrid->latitudeCount * clipGrid->heightCount + b * clipGrid->heightCount + h;
                 if (ProtentialToInterpolate(latitude, longitude, height, flatindexForest)){
                     double queryPoint[3];
-                    TransferGeodeticToCartesian(latitude, longitude, height, &queryPoint[0], &queryPoint[1], &queryPoint[2]);
+                    TransferGeodeticToScaledCartesian(latitude, longitude, height, g_config->vertical_scale, &queryPoint[0], &queryPoint[1], &queryPoint[2]);
                     SpatialQueryResult* result = RStarIndex_NearestNeighborQuery(indexTree, queryPoint, g_config->k_neighbor);
                     FillQueryPointCoordinates(points, result->count, result);
                     if (!result){
                         fprintf(stderr, "Failed to query nearest neighbor for clip grid %d, %d, %d\n", b, l, h);
                         return false;
                     }
-                    clipGrid->value[index] = (float)InterpolateValueIDW(queryPoint, height, result, valueArray, 2.0f);
+                    SetClipValue(clipGrid, 0, index, (float)InterpolateValueIDW(queryPoint, height, result, valueArray, g_config->idw_power));
                     //printf("The %u line, %u angle, %u height's value is %f\n", b, l, h, clipGrid->value[index]);
                     DestroySpatialQueryResult(result);
                 }
                 else
-                    clipGrid->value[index] = -999;
+                    SetClipValue(clipGrid, 0, index, -999);
             }
     return true;
 }
 
-bool InterpolateClipGridBatch(RStarIndex* indexTree, KDTree** flatindexForest, const float* valueArray, ClipGrid* clipGrid){
+static bool PermuteQueriesByMorton(const ClipGrid* clipGrid, const unsigned int queryCount, double* queryPoints, double* queryGeodetic, unsigned int* queryIDs, MortonSortBuffer* buffer){
+    // key, sort and permute the queries through the scratch of the buffer, which holds at least queryCount keys
+    const unsigned int latitudeCount = clipGrid->latitudeCount, heightCount = clipGrid->heightCount;
+    uint64_t* keys = buffer->keys;
+    uint32_t* order = buffer->order;
+    for (unsigned int i = 0; i < queryCount; i++){
+        const unsigned int index = queryIDs[i];
+        const unsigned int h = index % heightCount;
+        const unsigned int b = index / heightCount % latitudeCount;
+        const unsigned int l = index / heightCount / latitudeCount;
+        keys[i] = EncodeMorton2D(l, b) * heightCount + h;
+        order[i] = i;
+    }
+    const uint64_t maxKey = EncodeMorton2D(clipGrid->longitudeCount - 1, latitudeCount - 1) * heightCount + heightCount - 1;
+    if (!RadixSortKeysInBuffer(keys, order, queryCount, maxKey, buffer)) return false;
+    double* points = buffer->points;
+    unsigned int* ids = buffer->ids;
+    memcpy(points, queryPoints, (size_t)queryCount * 3 * sizeof(double));
+    memcpy(ids, queryIDs, (size_t)queryCount * sizeof(unsigned int));
+    for (unsigned int i = 0; i < queryCount; i++){
+        memcpy(&queryPoints[i * 3], &points[(size_t)order[i] * 3], 3 * sizeof(double));
+        queryIDs[i] = ids[order[i]];
+    }
+    if (queryGeodetic){
+        memcpy(points, queryGeodetic, (size_t)queryCount * 3 * sizeof(double));
+        for (unsigned int i = 0; i < queryCount; i++)
+            memcpy(&queryGeodetic[i * 3], &points[(size_t)order[i] * 3], 3 * sizeof(double));
+    }
+    return true;
+}
+
+bool SortQueriesByMorton(const ClipGrid* clipGrid, const unsigned int queryCount, double* queryPoints, double* queryGeodetic, unsigned int* queryIDs, MortonSortBuffer* buffer){
     /**
-     * @brief Batch version of InterpolateClipGrid using bulk query APIs for improved efficiency
-     * @param indexTree: the R* tree index
-     * @param flatindexForest: the KD tree slide by height index
+     * @brief Reorder the queries of a clip along the Morton curve over their (longitude, latitude) columns, so consecutive queries visit the same index nodes
+     * @note the height stack of a column stays contiguous, a 200 m height step is far shorter than a column step and a 3D curve over the lattice indices was slower than the lattice order
+     * @param clipGrid: the clip grid, its counts decode the lattice index stored in queryIDs
+     * @param queryCount: the number of queries
+     * @param queryPoints: the cartesian query points [queryCount][3], permuted in place
+     * @param queryGeodetic: the geodetic query points [queryCount][3], permuted in place, can be NULL
+     * @param queryIDs: the lattice index of each query, permuted in place so results still scatter back by id
+     * @param buffer: the sort scratch of the calling thread, see the workspace, NULL to allocate one for this call
+     * @return true if successful, false otherwise
+     */
+    if (!clipGrid || !queryPoints || !queryIDs) return false;
+    if (queryCount < 2) return true;
+    const unsigned int latitudeCount = clipGrid->latitudeCount, heightCount = clipGrid->heightCount;
+    if (clipGrid->longitudeCount > (1u << MORTON_AXIS_BITS) || latitudeCount > (1u << MORTON_AXIS_BITS) || heightCount > (1u << MORTON_AXIS_BITS)){
+        fprintf(stderr, "Clip grid too large for Morton ordering\n");
+        return false;
+    }
+    if (buffer){
+        if (queryCount > buffer->capacity){
+            fprintf(stderr, "Morton sort buffer of %u keys cannot hold %u queries\n", buffer->capacity, queryCount);
+            return false;
+        }
+        return PermuteQueriesByMorton(clipGrid, queryCount, queryPoints, queryGeodetic, queryIDs, buffer);
+    }
+    MortonSortBuffer* callBuffer = CreateMortonSortBuffer(queryCount);
+    if (!callBuffer) return false;
+    const bool success = PermuteQueriesByMorton(clipGrid, queryCount, queryPoints, queryGeodetic, queryIDs, callBuffer);
+    DestroyMortonSortBuffer(callBuffer);
+    return success;
+}
+
+InterpolateWorkspace* CreateInterpolateWorkspace(const unsigned int chunkCapacity, const unsigned int k, const float power, const unsigned int extraCapacity){
+    /**
+     * @brief Create the query and result buffers of one interpolation thread, reused for every chunk of every clip
+     * @param chunkCapacity: the number of queries of a chunk
+     * @param k: the number of neighbors of a query
+     * @param power: the IDW power, its kernel is selected here
+     * @param extraCapacity: the number of extra variables interpolated with the value, at most MAX_EXTRA_VARIABLE_COUNT
+     * @return the workspace, NULL if failed
+     */
+    if (extraCapacity > MAX_EXTRA_VARIABLE_COUNT) return NULL;
+    if (chunkCapacity == 0 || k == 0) return NULL;
+    InterpolateWorkspace* workspace = (InterpolateWorkspace*)calloc(1, sizeof(InterpolateWorkspace));
+    if (!workspace){
+        fprintf(stderr, "Failed to allocate memory for interpolate workspace\n");
+        return NULL;
+    }
+    workspace->chunkCapacity = chunkCapacity;
+    workspace->k = k;
+    workspace->queryPoints = (double*)malloc((size_t)chunkCapacity * 3 * sizeof(double));
+    workspace->queryGeodetic = (double*)malloc((size_t)chunkCapacity * 3 * sizeof(double));
+    workspace->queryIDs = (unsigned int*)malloc((size_t)chunkCapacity * sizeof(unsigned int));
+    workspace->resultIds = (int64_t*)malloc((size_t)chunkCapacity * k * sizeof(int64_t));
+    workspace->resultDistances = (double*)malloc((size_t)chunkCapacity * k * sizeof(double));
+    workspace->resultCounts = (uint64_t*)malloc((size_t)chunkCapacity * sizeof(uint64_t));
+    workspace->power = power;
+    workspace->idwKernel = SelectIDWBatchKernel(power);
+    workspace->neighborDistances = (float*)malloc((size_t)IDW_BATCH_BLOCK * k * sizeof(float));
+    workspace->neighborValues = (float*)malloc((size_t)IDW_BATCH_BLOCK * k * sizeof(float));
+    workspace->interpolated = (float*)malloc((size_t)(1 + extraCapacity) * chunkCapacity * sizeof(float));
+    workspace->extraCapacity = extraCapacity;
+    workspace->neighborWeights = (float*)malloc((size_t)IDW_BATCH_BLOCK * k * sizeof(float));
+    workspace->neighborIds = (int64_t*)malloc((size_t)IDW_BATCH_BLOCK * k * sizeof(int64_t));
+    if (g_config->query_order == QUERY_ORDER_MORTON)
+        workspace->mortonBuffer = CreateMortonSortBuffer(chunkCapacity);
+    if (!workspace->queryPoints || !workspace->queryGeodetic || !workspace->queryIDs || !workspace->resultIds || !workspace->resultDistances || !workspace->resultCounts ||
+        !workspace->neighborDistances || !workspace->neighborValues || !workspace->interpolated || !workspace->neighborWeights || !workspace->neighborIds ||
+        (g_config->query_order == QUERY_ORDER_MORTON && !workspace->mortonBuffer)){
+        fprintf(stderr, "Failed to allocate memory for interpolate workspace of %u queries\n", chunkCapacity);
+        DestroyInterpolateWorkspace(workspace);
+        return NULL;
+    }
+    return workspace;
+}
+
+void DestroyInterpolateWorkspace(InterpolateWorkspace* workspace){
+    if (!workspace) return;
+    free(workspace->queryPoints);
+    free(workspace->queryGeodetic);
+    free(workspace->queryIDs);
+    free(workspace->resultIds);
+    free(workspace->resultDistances);
+    free(workspace->resultCounts);
+    free(workspace->neighborDistances);
+    free(workspace->neighborValues);
+    free(workspace->interpolated);
+    free(workspace->neighborWeights);
+    free(workspace->neighborIds);
+    DestroyMortonSortBuffer(workspace->mortonBuffer);
+    free(workspace);
+}
+
+static float EchoTopVerticalReach(const bool heightLimited){
+    // the largest height difference of a neighbor that still gets a weight
+    const float verticalScale = g_config->vertical_scale > 0 ? g_config->vertical_scale : 1.0f;
+    const float reach = g_config->max_neighbor_distance / verticalScale * ECHO_TOP_REACH_MARGIN;
+    if (heightLimited && g_config->max_vertical_distance > 0 && g_config->max_vertical_distance < reach)
+        return g_config->max_vertical_distance;
+    return reach;
+}
+
+static bool InterpolateQueryChunk(IndexForest* forest, const unsigned int clipIndex, const float* valueArray, const float* heightArray, const float* const* extraValueArrays, ClipGrid* clipGrid,
+                                  InterpolateWorkspace* workspace, const unsigned int queryCount, ClipResamplePlan* plan){
+    /**
+     * @brief Query and interpolate the queries gathered in the workspace, the values are scattered back by queryIDs
+     * @param queryCount: the number of queries in the workspace
+     * @param plan: the clip plan to record the weighted neighbors into instead of interpolating, NULL to interpolate
+     * @return true if successful, false otherwise
+     */
+    if (queryCount == 0) return true;
+    if (g_config->query_order == QUERY_ORDER_MORTON && !SortQueriesByMorton(clipGrid, queryCount, workspace->queryPoints, workspace->queryGeodetic, workspace->queryIDs, workspace->mortonBuffer))
+        fprintf(stderr, "Failed to sort queries of clip %d by Morton order, keep the lattice order\n", clipIndex);
+    if (!QueryNearestNeighborBatch(forest, clipIndex, workspace->k, queryCount, workspace->queryPoints, workspace->queryGeodetic, workspace->resultIds, workspace->resultCounts, workspace->resultDistances)){
+        fprintf(stderr, "Batch nearest neighbor query failed\n");
+        return false;
+    }
+    if (plan){
+        RecordClipPlanChunk(plan, queryCount, workspace->queryIDs, workspace->power, workspace->resultCounts, workspace->resultDistances, workspace->resultIds, heightArray,
+                            workspace->queryGeodetic, workspace->neighborWeights, workspace->neighborIds);
+        return true;
+    }
+    if (clipGrid->extraCount == 0){
+        InterpolateValueIDWBatch(workspace->idwKernel, workspace->power, queryCount, workspace->k, workspace->resultCounts, workspace->resultDistances, workspace->resultIds, valueArray,
+                                 heightArray, workspace->queryGeodetic, workspace->neighborDistances, workspace->neighborValues, workspace->interpolated);
+        for (unsigned int i = 0; i < queryCount; i++)
+            SetClipValue(clipGrid, 0, workspace->queryIDs[i], workspace->interpolated[i]);
+        return true;
+    }
+    // the neighbors and weights of the value are reused by every extra variable
+    const float* valueArrays[1 + MAX_EXTRA_VARIABLE_COUNT] = {valueArray};
+    for (unsigned int v = 0; v < clipGrid->extraCount; v++)
+        valueArrays[1 + v] = extraValueArrays[v];
+    InterpolateValuesIDWBatch(workspace->power, queryCount, workspace->k, workspace->resultCounts, workspace->resultDistances, workspace->resultIds, 1 + clipGrid->extraCount, valueArrays,
+                              heightArray, workspace->queryGeodetic, workspace->neighborWeights, workspace->neighborIds, workspace->interpolated);
+    for (unsigned int i = 0; i < queryCount; i++)
+        SetClipValue(clipGrid, 0, workspace->queryIDs[i], workspace->interpolated[i]);
+    for (unsigned int v = 0; v < clipGrid->extraCount; v++)
+        for (unsigned int i = 0; i < queryCount; i++)
+            SetClipValue(clipGrid, 1 + v, workspace->queryIDs[i], workspace->interpolated[(size_t)(1 + v) * queryCount + i]);
+    return true;
+}
+
+bool InterpolateClipGridBatch(IndexForest* forest, const unsigned int clipIndex, const float* valueArray, const float* heightArray, const float* const* extraValueArrays, ClipGrid* clipGrid, InterpolateWorkspace* workspace,
+                              ClipResamplePlan* plan){
+    /**
+     * @brief Batch version of InterpolateClipGrid, the lattice is queried in chunks of the workspace capacity so the memory does not grow with the clip size
+     * @param forest: the index forest, queried with its engine
+     * @param clipIndex: the index of the clip in the forest
      * @param valueArray: array of values to interpolate
+     * @param heightArray: heights of the points, for the max vertical distance, can be NULL
+     * @param extraValueArrays: the extra variables of the points, one per extra variable of the clip, can be NULL when the clip has none
      * @param clipGrid: the clip grid to interpolate
+     * @param workspace: the buffers of the calling thread, see CreateInterpolateWorkspace
+     * @param plan: the clip plan to record, the clip is then interpolated by the finished plan, NULL to interpolate directly
      * @return true if successful, false otherwise
      */
-    if (!indexTree || !clipGrid || !valueArray || !flatindexForest) return false;
-    
-    unsigned int capacity = clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount / 4;
-    unsigned int totalPoints = 0;
-    if (capacity == 0) return false;
-    
-    double* queryPoints = (double*)malloc(capacity * 3 * sizeof(double));
-    double* queryHeights = (double*)malloc(capacity * sizeof(double));
-    unsigned int* queryIDs = (unsigned int*)malloc(capacity * sizeof(unsigned int));
-    if (!queryPoints || !queryHeights || !queryIDs) {
-        fprintf(stderr, "Failed to allocate memory for batch query points\n");
+    if (!forest || !clipGrid || !valueArray || !workspace || !forest->flatindex) return false;
+    if (clipGrid->extraCount > 0 && (!extraValueArrays || clipGrid->extraCount > workspace->extraCapacity)){
+        fprintf(stderr, "The workspace cannot interpolate the %u extra variables of clip %u\n", clipGrid->extraCount, clipIndex);
         return false;
     }
-    
-    for (unsigned int l = 0; l < clipGrid->longitudeCount; l++) 
-        for (unsigned int b = 0; b < clipGrid->latitudeCount; b++) {{
-            for (unsigned int h = 0; h < clipGrid->heightCount; h++) {
+    if (plan && !BeginClipResamplePlan(plan)) return false;
+    ClearClipGridExtra(clipGrid); // the cells not queried
+    KDTree** flatindexForest = forest->flatindex;
+    float* columnTops = NULL;
+    if (forest->echoTop){
+        // a shared index finds neighbors on every line, a per-clip index only on the lines of the clip
+        const unsigned int firstLine = forest->shared ? 0 : clipGrid->leftLineIndex;
+        const unsigned int lastLine = forest->shared ? forest->echoTop->lineCount - 1 : clipGrid->rightLineIndex;
+        columnTops = EstimateClipColumnTops(forest->echoTop, clipGrid, firstLine, lastLine, g_config->max_neighbor_distance * ECHO_TOP_REACH_MARGIN);
+    }
+    const float verticalReach = EchoTopVerticalReach(heightArray != NULL);
+    unsigned int queryCount = 0;
+    for (unsigned int l = 0; l < clipGrid->longitudeCount; l++)
+        for (unsigned int b = 0; b < clipGrid->latitudeCount; b++){
+            unsigned int heightEnd = clipGrid->heightCount;
+            if (columnTops){
+                // no valid bin near the column reaches the cells above, they are filled without any search
+                const float top = columnTops[l * clipGrid->latitudeCount + b];
+                while (heightEnd > 0 && (top == -INFINITY || (clipGrid->minHeight + (heightEnd - 1) * clipGrid->heightGap) - top > verticalReach))
+                    heightEnd--;
+                const unsigned int column = l * clipGrid->latitudeCount * clipGrid->heightCount + b * clipGrid->heightCount;
+                for (unsigned int h = heightEnd; h < clipGrid->heightCount; h++)
+                    SetClipValue(clipGrid, 0, column + h, -999);
+            }
+            workspace->cellCount += clipGrid->heightCount;
+            workspace->skippedCount += clipGrid->heightCount - heightEnd;
+            for (unsigned int h = 0; h < heightEnd; h++){
                 const float latitude = clipGrid->minLatitude + b * clipGrid->latitudeGap;
                 const float longitude = clipGrid->minLongitude + l * clipGrid->longitudeGap;
                 const float height = clipGrid->minHeight + h * clipGrid->heightGap;
                 const unsigned int index = l * clipGrid->latitudeCount * clipGrid->heightCount + b * clipGrid->heightCount + h;
-                if (ProtentialToInterpolate(latitude, longitude, height, flatindexForest)){
-                    if (totalPoints >= capacity){
-                        capacity *= 2;
-                        queryPoints = (double*)realloc(queryPoints, capacity * 3 * sizeof(double));
-                        queryHeights = (double*)realloc(queryHeights, capacity * sizeof(double));
-                        queryIDs = (unsigned int*)realloc(queryIDs, capacity * sizeof(unsigned int));
+                if (!ProtentialToInterpolate(latitude, longitude, height, flatindexForest)){
+                    SetClipValue(clipGrid, 0, index, -999);
+                    continue;
+                }
+                const unsigned int queryIndex = queryCount++;
+                double* queryPoint = &workspace->queryPoints[queryIndex * 3];
+                TransferGeodeticToScaledCartesian(latitude, longitude, height, g_config->vertical_scale, &queryPoint[0], &queryPoint[1], &queryPoint[2]);
+                workspace->queryGeodetic[queryIndex * 3 + 0] = latitude;
+                workspace->queryGeodetic[queryIndex * 3 + 1] = longitude;
+                workspace->queryGeodetic[queryIndex * 3 + 2] = height;
+                workspace->queryIDs[queryIndex] = index;
+                if (queryCount == workspace->chunkCapacity){
+                    if (!InterpolateQueryChunk(forest, clipIndex, valueArray, heightArray, extraValueArrays, clipGrid, workspace, queryCount, plan)){
+                        free(columnTops);
+                        return false;
                     }
-                    const unsigned int queryIndex = totalPoints++;
-                    TransferGeodeticToCartesian(latitude, longitude, height, &queryPoints[queryIndex * 3 + 0], &queryPoints[queryIndex * 3 + 1], &queryPoints[queryIndex * 3 + 2]);
-                    queryHeights[queryIndex] = height;
-                    queryIDs[queryIndex] = index;
-                }else
-                    clipGrid->value[index] = -999;
+                    queryCount = 0;
+                }
             }
         }
-    }
-    
-    int64_t* resultIds = (int64_t*)malloc(totalPoints * g_config->k_neighbor * sizeof(int64_t));
-    double* resultDistances = (double*)malloc(totalPoints * g_config->k_neighbor * sizeof(double));
-    uint64_t* resultCounts = (uint64_t*)malloc(totalPoints * sizeof(uint64_t));
-    
-    if (!resultIds || !resultDistances || !resultCounts) {
-        fprintf(stderr, "Failed to allocate memory for batch query results\n");
-        if (queryPoints) free(queryPoints);
-        if (queryHeights) free(queryHeights);
-        if (resultIds) free(resultIds);
-        if (resultDistances) free(resultDistances);
-        if (resultCounts) free(resultCounts);
-        return false;
-    }
-    
-    // Perform batch nearest neighbor query using the new bulk API from PR #268
-    int64_t actualProcessed = 0;
-    RTError result = Index_NearestNeighbors_id_v(indexTree->spatialIndex,
-                                                 g_config->k_neighbor,    // knn: number of nearest neighbors to find
-                                                 totalPoints,           // n: number of query points
-                                                 3,                     // d: dimension (latitude, longitude, height)
-                                                 totalPoints * g_config->k_neighbor, // idsz: total size of ids array
-                                                 3,                     // d_i_stri: stride between query points
-                                                 1,                     // d_j_stri: stride between dimensions
-                                                 queryPoints,           // mins: query point coordinates
-                                                 queryPoints,           // maxs: same as mins for point queries
-                                                 resultIds,             // ids: output array for result ids
-                                                 resultCounts,          // cnts: count of results per query point
-                                                 resultDistances,       // dists: distances (optional)
-                                                 &actualProcessed);     // nr: actual number of processed queries
-    
-    if (result != RT_None) {
-        fprintf(stderr, "Batch nearest neighbor query failed\n");
-        free(queryPoints);
-        free(queryHeights);
-        free(resultIds);
-        free(resultDistances);
-        free(resultCounts);
-        return false;
-    }
-    
-    if (actualProcessed != totalPoints)
-        fprintf(stderr, "Warning: Only %ld out of %u queries were processed in batch\n", actualProcessed, totalPoints);
-        
-    unsigned int resultIndex = 0;
-    for (unsigned int i = 0; i < totalPoints; i++){
-        const unsigned int count = resultCounts[i];
-        const unsigned int index = queryIDs[i];
-        clipGrid->value[index] = (float)InterpolateValueIDW_v(count, resultDistances + resultIndex, resultIds + resultIndex, valueArray, 2.0f);
-        resultIndex += count;
-    }
-    
-    if (queryPoints) free(queryPoints);
-    if (queryHeights) free(queryHeights);
-    if (queryIDs) free(queryIDs);
-    if (resultIds) free(resultIds);
-    if (resultDistances) free(resultDistances);
-    if (resultCounts) free(resultCounts);
-    
-    return true;
+    free(columnTops);
+    if (!InterpolateQueryChunk(forest, clipIndex, valueArray, heightArray, extraValueArrays, clipGrid, workspace, queryCount, plan)) return false;
+    if (!plan) return true;
+    FinishClipResamplePlan(plan);
+    return ApplyClipResamplePlan(plan, valueArray, extraValueArrays, clipGrid);
 }
 
 static unsigned int GetOrder(unsigned int index, unsigned int total){
@@ -227,29 +402,180 @@ static unsigned int GetOrder(unsigned int index, unsigned int total){
     return order;
 }
 
-bool InterpolateGrid(const GeodeticGrid* processedGrid, IndexForest* forest, ClipGridResult* finalGrid){
+static inline bool BeginClip(const ClipWriter* writer, ClipGrid* clipGrid){
+    // behind a writer the cells are allocated as the clip starts
+    return !writer || AllocateClipGridCells(clipGrid, g_config->clip_storage == CLIP_STORAGE_SPARSE);
+}
+
+static bool FinishClip(ClipWriter* writer, ClipGridResult* finalGrid, const unsigned int clipIndex, bool interpolated){
+    // the column products, the catalog statistics and the valid box are found by the thread of the clip while its cells are hot, then the clip goes to the writer, which frees it once written, a failed clip is freed unwritten
+    ClipGrid* clipGrid = &finalGrid->clipGrids[clipIndex];
+    if (interpolated && clipGrid->sparse && clipGrid->sparse->failed){
+        fprintf(stderr, "Clip %u lost values to a brick that could not be allocated\n", clipIndex);
+        interpolated = false;
+    }
+    if (interpolated && g_config->derived_products) interpolated = ComputeClipProducts(clipGrid, g_config->echo_top_threshold);
+    if (interpolated && g_config->catalog_file[0]) interpolated = ComputeClipStatistics(clipGrid);
+    if (interpolated && g_config->crop_empty_borders) FindClipValidBox(clipGrid);
+    if (!writer) return interpolated;
+    if (interpolated) return SubmitClip(writer, clipIndex);
+    ReleaseClipGridCells(clipGrid);
+    return false;
+}
+
+static bool InterpolateGridSeparable(const GeodeticGrid* processedGrid, IndexForest* forest, ClipGridResult* finalGrid, ClipWriter* writer){
     /**
-    @brief Interpolate the grid
-    @param processedGrid: the processed grid
-    @param forest: the index forest
-    @param finalGrid: the final grid
+    @brief Interpolate the grid in two stages, the rays onto the target heights, then every level across the rays located by the structured locator
     @return true if successful, false otherwise
     */
+    if (!forest->locator){
+        fprintf(stderr, "Failed to interpolate grid, the structured locator is not created\n");
+        return false;
+    }
+    const double start = omp_get_wtime();
+    RayLevelProfile* profile = CreateRayLevelProfile(processedGrid, g_config->minimal_height, g_config->height_gap, g_config->height_count, g_config->max_vertical_distance);
+    if (!profile) return false;
+    printf("Resample %u rays onto %u levels in %.3f s\n", profile->rayCount, profile->levelCount, omp_get_wtime() - start);
     bool success = true;
     unsigned int clipCount = finalGrid->clipCount;
-    #pragma omp parallel for shared(forest, processedGrid, finalGrid, clipCount) reduction(||:success) schedule(dynamic)
+    #pragma omp parallel for schedule(dynamic) shared(forest, profile, finalGrid, clipCount, writer) reduction(&&:success)
     for (unsigned int clipIndex = 0; clipIndex < clipCount; clipIndex++){
         const unsigned int order = GetOrder(clipIndex, clipCount);
-        if (!InterpolateClipGridBatch(forest->index[order], forest->flatindex, processedGrid->valueArray, &finalGrid->clipGrids[order])){
+        ClipGrid* clipGrid = &finalGrid->clipGrids[order];
+        const bool interpolated = BeginClip(writer, clipGrid) && InterpolateClipGridSeparable(forest->locator, profile, g_config->k_neighbor, g_config->idw_power, clipGrid);
+        if (!FinishClip(writer, finalGrid, order, interpolated)){
             fprintf(stderr, "Failed to interpolate clip grid for clip %d\n", order);
             success = false;
         }
     }
+    DestroyRayLevelProfile(profile);
     return success;
 }
 
-bool InitClipResult(const HDFDataset* dataset, const GeodeticGrid* geodeticGrid, const PointBatch* pointBatch, IndexForest* forest, ClipGridResult* finalGrid){
-    InitClipGridArray(dataset, g_config->grid_size, g_config->minimal_height, g_config->height_gap, g_config->height_count, finalGrid);
-    CreateIndexForest(geodeticGrid, pointBatch, finalGrid, forest);
-    return true;
+static bool InterpolateGridScatter(const GeodeticGrid* processedGrid, ClipGridResult* finalGrid, ClipWriter* writer){
+    /**
+    @brief Interpolate the grid by splatting the bins of every clip, a clip is owned by one thread so its sums need no atomics
+    @return true if successful, false otherwise
+    */
+    const float radius = g_config->scatter_radius > 0 ? g_config->scatter_radius : (float)g_config->grid_size;
+    bool success = true;
+    unsigned int clipCount = finalGrid->clipCount;
+    #pragma omp parallel for schedule(dynamic) shared(processedGrid, finalGrid, clipCount, writer) reduction(&&:success)
+    for (unsigned int clipIndex = 0; clipIndex < clipCount; clipIndex++){
+        const unsigned int order = GetOrder(clipIndex, clipCount);
+        ClipGrid* clipGrid = &finalGrid->clipGrids[order];
+        const bool interpolated = BeginClip(writer, clipGrid) && InterpolateClipGridScatter(processedGrid, radius, g_config->idw_power, clipGrid);
+        if (!FinishClip(writer, finalGrid, order, interpolated)){
+            fprintf(stderr, "Failed to interpolate clip grid for clip %d\n", order);
+            success = false;
+        }
+    }
+    return success;
+}
+
+static bool InterpolateGridByPlan(const GeodeticGrid* processedGrid, const ResamplePlan* plan, ClipGridResult* finalGrid, ClipWriter* writer){
+    /**
+    @brief Interpolate the grid with a loaded resample plan, a sparse product per clip without any neighbor search
+    @return true if successful, false otherwise
+    */
+    const double start = omp_get_wtime();
+    bool success = true;
+    unsigned int clipCount = finalGrid->clipCount;
+    #pragma omp parallel for schedule(dynamic) shared(processedGrid, plan, finalGrid, clipCount, writer) reduction(&&:success)
+    for (unsigned int clipIndex = 0; clipIndex < clipCount; clipIndex++){
+        const unsigned int order = GetOrder(clipIndex, clipCount);
+        ClipGrid* clipGrid = &finalGrid->clipGrids[order];
+        const bool interpolated = BeginClip(writer, clipGrid) && ApplyClipResamplePlan(&plan->clips[order], processedGrid->valueArray, (const float* const*)processedGrid->extraValueArrays, clipGrid);
+        if (!FinishClip(writer, finalGrid, order, interpolated)){
+            fprintf(stderr, "Failed to apply the resample plan to clip %d\n", order);
+            success = false;
+        }
+    }
+    printf("Apply resample plan to %u clips in %.3f s\n", clipCount, omp_get_wtime() - start);
+    return success;
+}
+
+bool InterpolateGrid(const GeodeticGrid* processedGrid, IndexForest* forest, ClipGridResult* finalGrid, ClipWriter* writer){
+    /**
+    @brief Interpolate the grid
+    @param processedGrid: the processed grid
+    @param forest: the index forest
+    @param finalGrid: the final grid
+    @param writer: the write-behind writer every finished clip is submitted to, NULL keeps the clips for WriteClipResult
+    @return true if successful, false otherwise
+    */
+    if (g_config->resample_engine == RESAMPLE_ENGINE_SEPARABLE)
+        return InterpolateGridSeparable(processedGrid, forest, finalGrid, writer);
+    if (g_config->resample_engine == RESAMPLE_ENGINE_SCATTER)
+        return InterpolateGridScatter(processedGrid, finalGrid, writer);
+    if (forest->plan && forest->plan->mapping)
+        return InterpolateGridByPlan(processedGrid, forest->plan, finalGrid, writer);
+    bool success = true;
+    unsigned int clipCount = finalGrid->clipCount;
+    ResamplePlan* plan = forest->plan;
+    size_t cellCount = 0, skippedCount = 0;
+    #pragma omp parallel shared(forest, processedGrid, finalGrid, clipCount, writer) reduction(&&:success) reduction(+:cellCount, skippedCount)
+    {
+        // one workspace per thread, reused across the chunks of all its clips
+        InterpolateWorkspace* workspace = CreateInterpolateWorkspace(g_config->query_chunk_size, g_config->k_neighbor, g_config->idw_power, processedGrid->extraCount);
+        #pragma omp for schedule(dynamic)
+        for (unsigned int clipIndex = 0; clipIndex < clipCount; clipIndex++){
+            const unsigned int order = GetOrder(clipIndex, clipCount);
+            ClipGrid* clipGrid = &finalGrid->clipGrids[order];
+            const bool interpolated = BeginClip(writer, clipGrid) && InterpolateClipGridBatch(forest, order, processedGrid->valueArray, processedGrid->elevationArray, (const float* const*)processedGrid->extraValueArrays, clipGrid, workspace,
+                                                                                              plan ? &plan->clips[order] : NULL);
+            if (!FinishClip(writer, finalGrid, order, interpolated)){
+                fprintf(stderr, "Failed to interpolate clip grid for clip %d\n", order);
+                success = false;
+            }
+        }
+        if (workspace){
+            cellCount += workspace->cellCount;
+            skippedCount += workspace->skippedCount;
+        }
+        DestroyInterpolateWorkspace(workspace);
+    }
+    if (forest->echoTop && cellCount > 0)
+        printf("Skip %zu of %zu cells above the echo tops (%.1f%%)\n", skippedCount, cellCount, 100.0 * skippedCount / cellCount);
+    if (success && plan && SaveResamplePlan(plan, finalGrid))
+        printf("Save resample plan to %s\n", plan->fileName);
+    else if (success && plan)
+        fprintf(stderr, "Failed to save resample plan, the next run will record it again\n");
+    return success;
+}
+
+bool InitClipResult(const HDFDataset* dataset, const GeodeticGrid* geodeticGrid, const PointBatch* pointBatch, const char* planFileName, IndexForest* forest, ClipGridResult* finalGrid){
+    /**
+    @brief Init the clips of the granule and the index forest to interpolate them
+    @param dataset: the dataset of the band
+    @param geodeticGrid: the processed grid
+    @param pointBatch: the points of the grid
+    @param planFileName: the resample plan of the band, a matching plan replaces the index, otherwise it is recorded, NULL or empty without plan
+    @param forest: the index forest to create
+    @param finalGrid: the clips to init
+    @return true if successful, false otherwise
+    */
+    memset(forest, 0, sizeof(IndexForest)); // the caller destroys the forest on any failure below
+    if (!InitClipGridArray(dataset, g_config->grid_size, g_config->minimal_height, g_config->height_gap, g_config->height_count, finalGrid)) return false;
+    if (!InitClipGridExtra(finalGrid, geodeticGrid->extraCount)) return false;
+    const bool usePlan = planFileName && planFileName[0] != '\0';
+    if (usePlan && g_config->resample_engine != RESAMPLE_ENGINE_POINT_CLOUD)
+        fprintf(stderr, "The resample plan %s is only used by the point cloud resampling engine\n", planFileName);
+    ResamplePlan* plan = NULL;
+    if (usePlan && g_config->resample_engine == RESAMPLE_ENGINE_POINT_CLOUD){
+        ResamplePlanKey key;
+        InitResamplePlanKey(&dataset->globalAttribute, &key);
+        plan = LoadResamplePlan(planFileName, &key, finalGrid);
+        if (plan){
+            // the plan holds every neighbor and weight, no index is built
+            forest->engine = g_config->index_engine;
+            forest->plan = plan;
+            printf("Load resample plan %s of %u clips\n", planFileName, plan->clipCount);
+            return true;
+        }
+        plan = CreateResamplePlan(planFileName, &key, finalGrid, g_config->k_neighbor);
+    }
+    const bool indexed = CreateIndexForest(geodeticGrid, pointBatch, finalGrid, forest);
+    forest->plan = plan; // owned by the forest even when the index failed, so it is destroyed with it
+    return indexed;
 }
\ No newline at end of file
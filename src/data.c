@@ -1,4 +1,5 @@
 #include <string.h>
+#include <limits.h>
 #include <stdlib.h>
 #include "data.h"
 
@@ -10,6 +11,8 @@ void DestroyGridInfo(GridInfo* info) {
         free(info->heightArray);
     if (info->measuredArray)
         free(info->measuredArray);
+    if (info->extraArray)
+        free(info->extraArray);
 }
 
 void DestroyHDFDataset(HDFDataset* dataset){
@@ -34,6 +37,11 @@ void DestroyGeodeticGrid(GeodeticGrid* finalGrid){
         free(finalGrid->valueArray);
     if (finalGrid->validArray)
         free(finalGrid->validArray);
+    if (finalGrid->extraValueArrays){
+        for (unsigned int v = 0; v < finalGrid->extraCount; v++)
+            free(finalGrid->extraValueArrays[v]);
+        free(finalGrid->extraValueArrays);
+    }
 }
 
 int getNumber(const char* str, int length){
@@ -82,14 +90,316 @@ bool InitGeodeticGrid(GeodeticGrid* finalGrid, const int lineCount, const int he
         return false;
     }
     memset(finalGrid->validArray, true, memSize);
+    finalGrid->extraCount = 0;
+    finalGrid->extraValueArrays = NULL;
     return true;
 }
 
+bool InitGeodeticGridExtra(GeodeticGrid* finalGrid, const unsigned int extraCount){
+    /**
+    @brief Allocate the extra variables of an initialized grid, in the layout of valueArray
+    @param finalGrid: the grid, see InitGeodeticGrid
+    @param extraCount: the number of extra variables, 0 allocates nothing
+    @return true if successful, false otherwise
+    */
+    if (extraCount == 0) return true;
+    const size_t count = (size_t)finalGrid->lineCount * SCAN_ANGLE_COUNT * finalGrid->heightCount;
+    finalGrid->extraValueArrays = (float**)calloc(extraCount, sizeof(float*));
+    if (!finalGrid->extraValueArrays){
+        fprintf(stderr, "Failed to allocate memory for extra variables\n");
+        return false;
+    }
+    finalGrid->extraCount = extraCount;
+    for (unsigned int v = 0; v < extraCount; v++){
+        finalGrid->extraValueArrays[v] = (float*)malloc(count * sizeof(float));
+        if (!finalGrid->extraValueArrays[v]){
+            fprintf(stderr, "Failed to allocate memory for extra variable %u\n", v);
+            return false;
+        }
+    }
+    return true;
+}
+
+bool InitClipGridExtra(ClipGridResult* clipGridResult, const unsigned int extraCount){
+    /**
+    @brief Allocate the extra variables of every clip, one block of the clip size per variable
+    @param clipGridResult: the clips, see InitClipGridArray
+    @param extraCount: the number of extra variables, 0 allocates nothing
+    @return true if successful, false otherwise
+    */
+    bool success = true;
+    for (unsigned int clipIndex = 0; clipIndex < clipGridResult->clipCount; clipIndex++){
+        ClipGrid* clipGrid = &clipGridResult->clipGrids[clipIndex];
+        clipGrid->extraCount = 0;
+        clipGrid->extraValue = NULL;
+        if (extraCount == 0) continue;
+        if (clipGrid->sparse || !clipGrid->value){
+            // the bricks carry the extra variables, or the cells are allocated with the clip, see AllocateClipGridCells
+            clipGrid->extraCount = extraCount;
+            continue;
+        }
+        const size_t count = (size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+        clipGrid->extraValue = (float*)malloc(extraCount * count * sizeof(float));
+        if (!clipGrid->extraValue){
+            fprintf(stderr, "Failed to allocate memory for extra variables of clip %u\n", clipIndex);
+            success = false;
+            continue;
+        }
+        clipGrid->extraCount = extraCount;
+    }
+    return success;
+}
+
+bool InitClipGridSparse(ClipGrid* clipGrid){
+    /**
+    @brief Keep the cells of a clip in bricks of CLIP_BRICK_EDGE^3 cells, only the bricks with a value are allocated
+    @param clipGrid: the clip with its lattice set, before InitClipGridExtra, value is freed
+    @return true if successful, false otherwise
+    */
+    ClipBrickStorage* sparse = (ClipBrickStorage*)calloc(1, sizeof(ClipBrickStorage));
+    if (!sparse){
+        fprintf(stderr, "Failed to allocate memory for ClipBrickStorage\n");
+        return false;
+    }
+    sparse->longitudeBrickCount = (clipGrid->longitudeCount + CLIP_BRICK_EDGE - 1) / CLIP_BRICK_EDGE;
+    sparse->latitudeBrickCount = (clipGrid->latitudeCount + CLIP_BRICK_EDGE - 1) / CLIP_BRICK_EDGE;
+    sparse->heightBrickCount = (clipGrid->heightCount + CLIP_BRICK_EDGE - 1) / CLIP_BRICK_EDGE;
+    sparse->bricks = (float**)calloc((size_t)sparse->longitudeBrickCount * sparse->latitudeBrickCount * sparse->heightBrickCount, sizeof(float*));
+    if (!sparse->bricks){
+        fprintf(stderr, "Failed to allocate memory for the brick index of a clip\n");
+        free(sparse);
+        return false;
+    }
+    free(clipGrid->value);
+    clipGrid->value = NULL;
+    clipGrid->sparse = sparse;
+    return true;
+}
+
+bool AllocateClipGridCells(ClipGrid* clipGrid, const bool sparse){
+    /**
+    @brief Allocate the cells of a clip whose allocation was deferred to its interpolation
+    @param clipGrid: the clip with its lattice and extraCount set, nothing is done when its cells are allocated
+    @param sparse: true for the bricks of CLIP_STORAGE=SPARSE, false for the dense blocks
+    @return true if successful, false otherwise
+    */
+    if (clipGrid->value || clipGrid->sparse) return true;
+    if (sparse) return InitClipGridSparse(clipGrid);
+    const size_t count = (size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+    clipGrid->value = (float*)malloc(count * sizeof(float));
+    clipGrid->extraValue = clipGrid->extraCount > 0 ? (float*)malloc(clipGrid->extraCount * count * sizeof(float)) : NULL;
+    if (!clipGrid->value || (clipGrid->extraCount > 0 && !clipGrid->extraValue)){
+        fprintf(stderr, "Failed to allocate memory for the cells of a clip\n");
+        ReleaseClipGridCells(clipGrid);
+        return false;
+    }
+    return true;
+}
+
+float* AllocateClipBrick(ClipGrid* clipGrid, const size_t brick){
+    /**
+    @brief Allocate a brick of a sparse clip, every variable starts as the fill value
+    @param clipGrid: the sparse clip, written by a single thread
+    @param brick: the brick index, see ClipBrickCell
+    @return the cells of the brick [1 + extraCount][CLIP_BRICK_CELL_COUNT], NULL if failed
+    */
+    const size_t count = (size_t)(1 + clipGrid->extraCount) * CLIP_BRICK_CELL_COUNT;
+    float* cells = (float*)malloc(count * sizeof(float));
+    if (!cells){
+        fprintf(stderr, "Failed to allocate memory for a clip brick\n");
+        return NULL;
+    }
+    for (size_t i = 0; i < count; i++)
+        cells[i] = -999;
+    clipGrid->sparse->bricks[brick] = cells;
+    clipGrid->sparse->allocatedCount++;
+    return cells;
+}
+
+void ClearClipGridExtra(ClipGrid* clipGrid){
+    /**
+    @brief Set every extra variable of a clip to the fill value, the bricks of a sparse clip stay allocated
+    @param clipGrid: the clip
+    */
+    const size_t cellCount = (size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+    if (!clipGrid->sparse){
+        for (size_t i = 0; i < clipGrid->extraCount * cellCount; i++)
+            clipGrid->extraValue[i] = -999;
+        return;
+    }
+    const ClipBrickStorage* sparse = clipGrid->sparse;
+    const size_t brickCount = (size_t)sparse->longitudeBrickCount * sparse->latitudeBrickCount * sparse->heightBrickCount;
+    for (size_t brick = 0; brick < brickCount; brick++)
+        for (size_t i = CLIP_BRICK_CELL_COUNT; sparse->bricks[brick] && i < (size_t)(1 + clipGrid->extraCount) * CLIP_BRICK_CELL_COUNT; i++)
+            sparse->bricks[brick][i] = -999;
+}
+
+bool CopyClipVariable(const ClipGrid* clipGrid, const unsigned int variable, float* dense){
+    /**
+    @brief Copy a variable of a clip into the dense lattice order, e.g. to write a sparse clip
+    @param clipGrid: the clip
+    @param variable: 0 for value, 1 + v for the extra variable v
+    @param dense: output [longitudeCount][latitudeCount][heightCount]
+    @return true if successful, false otherwise
+    */
+    if (!clipGrid || !dense || variable > clipGrid->extraCount) return false;
+    const size_t cellCount = (size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+    if (!clipGrid->sparse){
+        memcpy(dense, variable == 0 ? clipGrid->value : clipGrid->extraValue + (variable - 1) * cellCount, cellCount * sizeof(float));
+        return true;
+    }
+    for (size_t index = 0; index < cellCount; index++)
+        dense[index] = GetClipValue(clipGrid, variable, index);
+    return true;
+}
+
+static inline void ExtendClipValidBox(ClipValidBox* box, const unsigned int l, const unsigned int b, const unsigned int h){
+    if (l < box->longitudeBegin) box->longitudeBegin = l;
+    if (l + 1 > box->longitudeEnd) box->longitudeEnd = l + 1;
+    if (b < box->latitudeBegin) box->latitudeBegin = b;
+    if (b + 1 > box->latitudeEnd) box->latitudeEnd = b + 1;
+    if (h < box->heightBegin) box->heightBegin = h;
+    if (h + 1 > box->heightEnd) box->heightEnd = h + 1;
+}
+
+void FindClipValidBox(ClipGrid* clipGrid){
+    /**
+    @brief Find the box of the cells of a finished clip holding a value in any variable, only the allocated bricks of a sparse clip are scanned
+    @param clipGrid: the interpolated clip, its validBox is set and it is marked cropped
+    */
+    ClipValidBox box = {UINT_MAX, 0, UINT_MAX, 0, UINT_MAX, 0};
+    const unsigned int variableCount = 1 + clipGrid->extraCount;
+    const size_t cellCount = (size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+    if (!clipGrid->sparse){
+        // the first and the last valid cell of every column
+        for (unsigned int l = 0; l < clipGrid->longitudeCount; l++)
+            for (unsigned int b = 0; b < clipGrid->latitudeCount; b++){
+                const size_t column = ((size_t)l * clipGrid->latitudeCount + b) * clipGrid->heightCount;
+                for (unsigned int variable = 0; variable < variableCount; variable++){
+                    const float* cells = (variable == 0 ? clipGrid->value : clipGrid->extraValue + (variable - 1) * cellCount) + column;
+                    unsigned int first = 0, last = clipGrid->heightCount;
+                    while (first < last && cells[first] <= -999) first++;
+                    if (first == last) continue;
+                    while (cells[last - 1] <= -999) last--;
+                    ExtendClipValidBox(&box, l, b, first);
+                    ExtendClipValidBox(&box, l, b, last - 1);
+                }
+            }
+    }
+    else{
+        const ClipBrickStorage* sparse = clipGrid->sparse;
+        for (unsigned int bl = 0; bl < sparse->longitudeBrickCount; bl++)
+            for (unsigned int bb = 0; bb < sparse->latitudeBrickCount; bb++)
+                for (unsigned int bh = 0; bh < sparse->heightBrickCount; bh++){
+                    const float* cells = sparse->bricks[((size_t)bl * sparse->latitudeBrickCount + bb) * sparse->heightBrickCount + bh];
+                    if (!cells) continue;
+                    for (unsigned int variable = 0; variable < variableCount; variable++)
+                        for (unsigned int cell = 0; cell < CLIP_BRICK_CELL_COUNT; cell++)
+                            if (cells[(size_t)variable * CLIP_BRICK_CELL_COUNT + cell] > -999)
+                                ExtendClipValidBox(&box, bl * CLIP_BRICK_EDGE + cell / (CLIP_BRICK_EDGE * CLIP_BRICK_EDGE),
+                                    bb * CLIP_BRICK_EDGE + cell / CLIP_BRICK_EDGE % CLIP_BRICK_EDGE, bh * CLIP_BRICK_EDGE + cell % CLIP_BRICK_EDGE);
+                }
+    }
+    if (box.longitudeEnd == 0) box = (ClipValidBox){0, 0, 0, 0, 0, 0};
+    clipGrid->validBox = box;
+    clipGrid->cropped = true;
+}
+
+void GetClipWriteBox(const ClipGrid* clipGrid, ClipValidBox* box){
+    /**
+    @brief The cells of a clip written to the output, the valid box of a cropped clip, else the whole lattice
+    @param clipGrid: the clip
+    @param box: output, a clip without any value keeps its first cell so every slice has its datasets
+    */
+    if (!clipGrid->cropped)
+        *box = (ClipValidBox){0, clipGrid->longitudeCount, 0, clipGrid->latitudeCount, 0, clipGrid->heightCount};
+    else if (clipGrid->validBox.longitudeEnd == 0)
+        *box = (ClipValidBox){0, 1, 0, 1, 0, 1};
+    else
+        *box = clipGrid->validBox;
+}
+
+bool CopyClipVariableBox(const ClipGrid* clipGrid, const unsigned int variable, const ClipValidBox* box, float* block){
+    /**
+    @brief Copy a box of a variable of a clip, e.g. to write a cropped clip
+    @param clipGrid: the clip
+    @param variable: 0 for value, 1 + v for the extra variable v
+    @param box: the box, inside the lattice
+    @param block: output [longitude][latitude][height] of the box
+    @return true if successful, false otherwise
+    */
+    if (!clipGrid || !block || variable > clipGrid->extraCount) return false;
+    if (box->longitudeEnd > clipGrid->longitudeCount || box->latitudeEnd > clipGrid->latitudeCount || box->heightEnd > clipGrid->heightCount) return false;
+    const size_t cellCount = (size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+    const unsigned int rowCount = box->heightEnd - box->heightBegin;
+    for (unsigned int l = box->longitudeBegin; l < box->longitudeEnd; l++)
+        for (unsigned int b = box->latitudeBegin; b < box->latitudeEnd; b++){
+            const size_t column = ((size_t)l * clipGrid->latitudeCount + b) * clipGrid->heightCount + box->heightBegin;
+            if (!clipGrid->sparse)
+                memcpy(block, (variable == 0 ? clipGrid->value : clipGrid->extraValue + (variable - 1) * cellCount) + column, rowCount * sizeof(float));
+            else
+                for (unsigned int h = 0; h < rowCount; h++)
+                    block[h] = GetClipValue(clipGrid, variable, column + h);
+            block += rowCount;
+        }
+    return true;
+}
+
+size_t ClipGridResultBytes(const ClipGridResult* clipGridResult){
+    /**
+    @brief The memory held by the cells of every clip, the allocated bricks and brick index of a sparse clip
+    @param clipGridResult: the clips
+    @return the bytes
+    */
+    size_t bytes = 0;
+    for (unsigned int clipIndex = 0; clipIndex < clipGridResult->clipCount; clipIndex++){
+        const ClipGrid* clipGrid = &clipGridResult->clipGrids[clipIndex];
+        const size_t variableCount = 1 + clipGrid->extraCount;
+        if (clipGrid->products) bytes += (size_t)DERIVED_PRODUCT_COUNT * clipGrid->longitudeCount * clipGrid->latitudeCount * sizeof(float);
+        if (!clipGrid->sparse){
+            if (!clipGrid->value) continue; // not allocated yet or already written
+            bytes += variableCount * clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float);
+            continue;
+        }
+        const ClipBrickStorage* sparse = clipGrid->sparse;
+        bytes += (size_t)sparse->longitudeBrickCount * sparse->latitudeBrickCount * sparse->heightBrickCount * sizeof(float*);
+        bytes += (size_t)sparse->allocatedCount * variableCount * CLIP_BRICK_CELL_COUNT * sizeof(float);
+    }
+    return bytes;
+}
+
+static void DestroyClipBrickStorage(ClipBrickStorage* sparse){
+    if (!sparse) return;
+    const size_t brickCount = (size_t)sparse->longitudeBrickCount * sparse->latitudeBrickCount * sparse->heightBrickCount;
+    for (size_t brick = 0; brick < brickCount; brick++)
+        free(sparse->bricks[brick]);
+    free(sparse->bricks);
+    free(sparse);
+}
+
+void ReleaseClipGridCells(ClipGrid* clipGrid){
+    /**
+    @brief Free the cells of a clip and keep its lattice, e.g. once the clip is written
+    @param clipGrid: the clip
+    */
+    free(clipGrid->value);
+    free(clipGrid->extraValue);
+    DestroyClipBrickStorage(clipGrid->sparse);
+    free(clipGrid->products);
+    clipGrid->value = NULL;
+    clipGrid->extraValue = NULL;
+    clipGrid->sparse = NULL;
+    clipGrid->products = NULL;
+}
+
 void DestroyClipGridResult(ClipGridResult* clipGridResult){
     if (!clipGridResult) return;
-    for (unsigned int clipIndex = 0; clipIndex < clipGridResult->clipCount; clipIndex++)
-        if (clipGridResult->clipGrids[clipIndex].value)
-            free(clipGridResult->clipGrids[clipIndex].value);
+    for (unsigned int clipIndex = 0; clipIndex < clipGridResult->clipCount; clipIndex++){
+        ClipGrid* clipGrid = &clipGridResult->clipGrids[clipIndex];
+        ReleaseClipGridCells(clipGrid);
+        if (clipGrid->statistics) free(clipGrid->statistics->levels);
+        free(clipGrid->statistics);
+    }
     if (clipGridResult->clipGrids)
         free(clipGridResult->clipGrids);
 }
\ No newline at end of file
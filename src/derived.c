@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "derived.h"
+
+const char* DERIVED_PRODUCT_NAMES[DERIVED_PRODUCT_COUNT] = {"Composite_Reflectivity", "Echo_Top_Height", "VIL"};
+const char* DERIVED_PRODUCT_UNITS[DERIVED_PRODUCT_COUNT] = {"dBZ", "m", "kg/m^2"};
+const float DERIVED_PRODUCT_INT16_SCALES[DERIVED_PRODUCT_COUNT] = {0.0f, 1.0f, 0.0f}; // the echo tops in m overflow the counts of a dBZ scale
+
+void AccumulateColumnProducts(const float* column, const unsigned int heightCount, const float minHeight, const float heightGap, const float echoTopThreshold, float* products){
+    /**
+    @brief The products of a column in one pass from the bottom, the composite reflectivity, the echo top height and the VIL
+    @param column: the reflectivity of the column, dBZ, -999 for no value
+    @param heightCount: the cells of the column
+    @param minHeight: the height of the first cell
+    @param heightGap: the height between two cells
+    @param echoTopThreshold: the reflectivity of the echo top, dBZ
+    @param products: output [DERIVED_PRODUCT_COUNT]
+    */
+    float composite = -999.0f, echoTop = -999.0f, vil = 0.0f;
+    bool valid = false;
+    float previous = 0.0f; // Z of the cell below, mm^6/m^3, 0 when it has no value
+    for (unsigned int h = 0; h < heightCount; h++){
+        const float value = column[h];
+        if (value <= -999){
+            previous = 0.0f;
+            continue;
+        }
+        valid = true;
+        if (value > composite) composite = value;
+        if (value >= echoTopThreshold) echoTop = minHeight + h * heightGap;
+        // the layers between two cells with a value, the mean Z of their ends
+        const float z = powf(10.0f, fminf(value, VIL_MAX_REFLECTIVITY) / 10.0f);
+        if (previous > 0.0f) vil += VIL_COEFFICIENT * powf(0.5f * (previous + z), VIL_EXPONENT) * heightGap;
+        previous = z;
+    }
+    products[0] = composite;
+    products[1] = echoTop;
+    products[2] = valid ? vil : -999.0f;
+}
+
+bool ComputeClipProducts(ClipGrid* clipGrid, const float echoTopThreshold){
+    /**
+    @brief The products of every column of a finished clip from its Value, only the allocated bricks of a sparse clip are read
+    @param clipGrid: the interpolated clip, its products are allocated, freed with its cells
+    @param echoTopThreshold: the reflectivity of the echo top, dBZ
+    @return true if successful, false otherwise
+    */
+    const size_t columnCount = (size_t)clipGrid->longitudeCount * clipGrid->latitudeCount;
+    free(clipGrid->products);
+    clipGrid->products = (float*)malloc((columnCount > 0 ? columnCount : 1) * DERIVED_PRODUCT_COUNT * sizeof(float));
+    float* column = clipGrid->sparse ? (float*)malloc((clipGrid->heightCount > 0 ? clipGrid->heightCount : 1) * sizeof(float)) : NULL;
+    if (!clipGrid->products || (clipGrid->sparse && !column)){
+        fprintf(stderr, "Failed to allocate memory for the derived products of a clip\n");
+        free(clipGrid->products);
+        clipGrid->products = NULL;
+        free(column);
+        return false;
+    }
+    const ClipBrickStorage* sparse = clipGrid->sparse;
+    for (unsigned int l = 0; l < clipGrid->longitudeCount; l++)
+        for (unsigned int b = 0; b < clipGrid->latitudeCount; b++){
+            const size_t columnIndex = (size_t)l * clipGrid->latitudeCount + b;
+            const float* cells = NULL;
+            if (!sparse)
+                cells = clipGrid->value + columnIndex * clipGrid->heightCount;
+            else{
+                // the column through its bricks, a missing brick is fill only
+                const size_t firstBrick = ((size_t)(l / CLIP_BRICK_EDGE) * sparse->latitudeBrickCount + b / CLIP_BRICK_EDGE) * sparse->heightBrickCount;
+                const unsigned int inBrick = ((l % CLIP_BRICK_EDGE) * CLIP_BRICK_EDGE + b % CLIP_BRICK_EDGE) * CLIP_BRICK_EDGE;
+                for (unsigned int h = 0; h < clipGrid->heightCount; h++){
+                    const float* brick = sparse->bricks[firstBrick + h / CLIP_BRICK_EDGE];
+                    column[h] = brick ? brick[inBrick + h % CLIP_BRICK_EDGE] : -999.0f;
+                }
+                cells = column;
+            }
+            float products[DERIVED_PRODUCT_COUNT];
+            AccumulateColumnProducts(cells, clipGrid->heightCount, clipGrid->minHeight, clipGrid->heightGap, echoTopThreshold, products);
+            for (unsigned int p = 0; p < DERIVED_PRODUCT_COUNT; p++)
+                clipGrid->products[p * columnCount + columnIndex] = products[p];
+        }
+    free(column);
+    return true;
+}
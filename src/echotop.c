@@ -0,0 +1,132 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "echotop.h"
+#include "geotransfer.h"
+
+#define ECHO_TOP_MAX_PADDING 4096 // cells, a longer reach gives no estimate
+#define ECHO_TOP_MAX_LATITUDE 89.0 // degrees, closer to the poles the longitude reach is unbounded
+
+static inline void CanvasRange(const double low, const double high, const unsigned int padding, const unsigned int count, int* first, int* last){
+    // the canvas cells around the fractional lattice range, first > last when there is none
+    const double start = floor(low) + padding, end = ceil(high) + padding;
+    *first = start < 0 ? 0 : (start >= count ? (int)count : (int)start);
+    *last = end >= count ? (int)count - 1 : (end < 0 ? -1 : (int)end);
+}
+
+EchoTopRaster* CreateEchoTopRaster(const GeodeticGrid* grid){
+    /**
+    @brief Create the raster of the highest valid bin of every footprint, with the extent of its valid bins
+    @param grid: the processed geodetic grid
+    @return the raster, NULL if failed
+    */
+    if (!grid || grid->lineCount == 0) return NULL;
+    EchoTopRaster* raster = (EchoTopRaster*)calloc(1, sizeof(EchoTopRaster));
+    if (!raster){
+        fprintf(stderr, "Failed to allocate memory for echo top raster\n");
+        return NULL;
+    }
+    const unsigned int footprintCount = grid->lineCount * SCAN_ANGLE_COUNT;
+    raster->lineCount = grid->lineCount;
+    raster->topHeights = (float*)malloc((size_t)footprintCount * sizeof(float));
+    raster->bounds = (float*)malloc((size_t)footprintCount * 4 * sizeof(float));
+    if (!raster->topHeights || !raster->bounds){
+        fprintf(stderr, "Failed to allocate memory for echo top raster of %u footprints\n", footprintCount);
+        DestroyEchoTopRaster(raster);
+        return NULL;
+    }
+    #pragma omp parallel for schedule(static)
+    for (unsigned int footprint = 0; footprint < footprintCount; footprint++){
+        float top = -INFINITY;
+        float* bounds = &raster->bounds[(size_t)footprint * 4];
+        bounds[0] = bounds[2] = INFINITY;
+        bounds[1] = bounds[3] = -INFINITY;
+        for (unsigned int bin = 0; bin < grid->heightCount; bin++){
+            const size_t point = (size_t)footprint * grid->heightCount + bin;
+            if (!grid->validArray[point]) continue;
+            // the slant ray drifts with the height, the extent covers every valid bin
+            const float latitude = grid->latitudeArray[point], longitude = grid->longitudeArray[point];
+            if (grid->elevationArray[point] > top) top = grid->elevationArray[point];
+            if (latitude < bounds[0]) bounds[0] = latitude;
+            if (latitude > bounds[1]) bounds[1] = latitude;
+            if (bounds[2] == INFINITY) bounds[2] = bounds[3] = longitude; // the longitudes are compared across the antimeridian
+            else if (WrapLongitudeDifference(longitude - bounds[2]) < 0) bounds[2] = longitude;
+            else if (WrapLongitudeDifference(longitude - bounds[3]) > 0) bounds[3] = longitude;
+        }
+        raster->topHeights[footprint] = top;
+    }
+    return raster;
+}
+
+float* EstimateClipColumnTops(const EchoTopRaster* raster, const ClipGrid* clipGrid, const unsigned int firstLine, const unsigned int lastLine, const float horizontalReach){
+    /**
+    @brief Estimate the highest valid bin within the horizontal reach of every column of a clip, the footprints are drawn on a padded canvas and dilated by a box that holds the reach
+    @param raster: the echo top raster of the granule
+    @param clipGrid: the clip grid, only its lattice is read
+    @param firstLine, lastLine: the scan lines whose footprints can be neighbors of the clip
+    @param horizontalReach: the max horizontal distance of a neighbor in meters
+    @return the column tops [longitudeCount][latitudeCount], never below the highest valid bin within the reach, -INFINITY without one, NULL if there is no estimate
+    */
+    if (!raster || !clipGrid || firstLine > lastLine || lastLine >= raster->lineCount || horizontalReach <= 0) return NULL;
+    if (clipGrid->latitudeGap <= 0 || clipGrid->longitudeGap <= 0) return NULL;
+    // the shortest meridian degree and the shortest parallel degree over the clip give the widest box
+    const double e2 = WGS84_E * WGS84_E;
+    const double latitudeReach = horizontalReach / ToRadians(WGS84_A * (1 - e2));
+    const double maxLatitude = clipGrid->minLatitude + (clipGrid->latitudeCount - 1) * clipGrid->latitudeGap;
+    const double polarLatitude = fmax(fabs(clipGrid->minLatitude), fabs(maxLatitude)) + latitudeReach;
+    if (polarLatitude >= ECHO_TOP_MAX_LATITUDE) return NULL;
+    const double longitudeReach = horizontalReach / ToRadians(WGS84_A * cos(ToRadians(polarLatitude)));
+    const double latitudePadding = ceil(latitudeReach / clipGrid->latitudeGap) + 1, longitudePadding = ceil(longitudeReach / clipGrid->longitudeGap) + 1;
+    if (latitudePadding > ECHO_TOP_MAX_PADDING || longitudePadding > ECHO_TOP_MAX_PADDING) return NULL;
+    const unsigned int padB = (unsigned int)latitudePadding, padL = (unsigned int)longitudePadding;
+    const unsigned int canvasB = clipGrid->latitudeCount + 2 * padB, canvasL = clipGrid->longitudeCount + 2 * padL;
+    float* canvas = (float*)malloc((size_t)canvasL * canvasB * sizeof(float)); // [canvasL][canvasB]
+    float* dilated = (float*)malloc((size_t)clipGrid->longitudeCount * canvasB * sizeof(float)); // [longitudeCount][canvasB]
+    float* columnTops = (float*)malloc((size_t)clipGrid->longitudeCount * clipGrid->latitudeCount * sizeof(float));
+    if (!canvas || !dilated || !columnTops){
+        fprintf(stderr, "Failed to allocate memory for the column tops of a clip\n");
+        free(canvas);
+        free(dilated);
+        free(columnTops);
+        return NULL;
+    }
+    for (size_t i = 0; i < (size_t)canvasL * canvasB; i++) canvas[i] = -INFINITY;
+    for (unsigned int footprint = firstLine * SCAN_ANGLE_COUNT; footprint < (lastLine + 1) * SCAN_ANGLE_COUNT; footprint++){
+        const float top = raster->topHeights[footprint];
+        if (top == -INFINITY) continue;
+        const float* bounds = &raster->bounds[(size_t)footprint * 4];
+        const double west = WrapLongitudeDifference(bounds[2] - clipGrid->minLongitude) / clipGrid->longitudeGap;
+        const double width = WrapLongitudeDifference(bounds[3] - bounds[2]) / clipGrid->longitudeGap;
+        int firstB, lastB, firstL, lastL;
+        CanvasRange((bounds[0] - clipGrid->minLatitude) / clipGrid->latitudeGap, (bounds[1] - clipGrid->minLatitude) / clipGrid->latitudeGap, padB, canvasB, &firstB, &lastB);
+        CanvasRange(west, west + width, padL, canvasL, &firstL, &lastL);
+        for (int l = firstL; l <= lastL; l++)
+            for (int b = firstB; b <= lastB; b++)
+                if (top > canvas[(size_t)l * canvasB + b]) canvas[(size_t)l * canvasB + b] = top;
+    }
+    // a source within the reach of a column is at most padL canvas columns and padB canvas rows away from it
+    for (unsigned int l = 0; l < clipGrid->longitudeCount; l++)
+        for (unsigned int b = 0; b < canvasB; b++){
+            float top = -INFINITY;
+            for (unsigned int window = l; window <= l + 2 * padL; window++)
+                if (canvas[(size_t)window * canvasB + b] > top) top = canvas[(size_t)window * canvasB + b];
+            dilated[(size_t)l * canvasB + b] = top;
+        }
+    for (unsigned int l = 0; l < clipGrid->longitudeCount; l++)
+        for (unsigned int b = 0; b < clipGrid->latitudeCount; b++){
+            float top = -INFINITY;
+            for (unsigned int window = b; window <= b + 2 * padB; window++)
+                if (dilated[(size_t)l * canvasB + window] > top) top = dilated[(size_t)l * canvasB + window];
+            columnTops[(size_t)l * clipGrid->latitudeCount + b] = top;
+        }
+    free(canvas);
+    free(dilated);
+    return columnTops;
+}
+
+void DestroyEchoTopRaster(EchoTopRaster* raster){
+    if (!raster) return;
+    free(raster->topHeights);
+    free(raster->bounds);
+    free(raster);
+}
@@ -0,0 +1,340 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "flatclip.h"
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "the flat clip container is written in the byte order of the host, which must be little endian"
+#endif
+_Static_assert(sizeof(FlatClipFileHeader) % 8 == 0, "the clip table must stay 8 byte aligned");
+
+static uint64_t AlignFlatOffset(const uint64_t offset){
+    return (offset + FLAT_CLIP_PAGE_SIZE - 1) / FLAT_CLIP_PAGE_SIZE * FLAT_CLIP_PAGE_SIZE;
+}
+
+static bool WriteAll(const int descriptor, const void* data, size_t size, off_t offset){
+    // pwrite may write less than asked, e.g. past 2 GB at once on Linux
+    const char* bytes = (const char*)data;
+    while (size > 0){
+        const ssize_t written = pwrite(descriptor, bytes, size, offset);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return false;
+        bytes += written;
+        size -= (size_t)written;
+        offset += written;
+    }
+    return true;
+}
+
+char* ConstructFlatClipFilename(const char* clipFileName, const unsigned int bandIndex){
+    /**
+    @brief The container of a band beside the HDF5 clip file, e.g. clip.HDF gives clip_Ka.flat
+    @param clipFileName: the HDF5 clip output file name
+    @param bandIndex: the band index
+    @return the file name, freed by the caller, NULL if failed
+    */
+    if (!clipFileName || bandIndex > 1) return NULL;
+    const char* pathEnd = strrchr(clipFileName, '/');
+    const char* nameStart = pathEnd ? pathEnd + 1 : clipFileName;
+    const char* dot = strrchr(nameStart, '.');
+    const size_t stemLength = dot && dot > nameStart ? (size_t)(dot - clipFileName) : strlen(clipFileName);
+    const size_t length = stemLength + 1 + strlen(BAND_NAMES[bandIndex]) + strlen(FLAT_CLIP_EXTENSION) + 1;
+    char* fileName = (char*)malloc(length);
+    if (!fileName) return NULL;
+    snprintf(fileName, length, "%.*s_%s%s", (int)stemLength, clipFileName, BAND_NAMES[bandIndex], FLAT_CLIP_EXTENSION);
+    return fileName;
+}
+
+FlatClipWriter* CreateFlatClipWriter(const unsigned int bandIndex, const char* fileName, const ClipGridResult* clipResult){
+    /**
+    @brief Lay out the container of a band from the clip lattices and size the file, the clips can then be written in any order
+    @param bandIndex: the band index
+    @param fileName: the container file, truncated
+    @param clipResult: the clips, only the lattices and the global attribute are read
+    @return the writer, NULL if failed
+    */
+    if (!fileName || !clipResult || strlen(fileName) >= sizeof(((FlatClipWriter*)0)->fileName)){
+        fprintf(stderr, "Invalid flat clip file name\n");
+        return NULL;
+    }
+    FlatClipWriter* writer = (FlatClipWriter*)calloc(1, sizeof(FlatClipWriter));
+    if (!writer){
+        fprintf(stderr, "Failed to allocate memory for FlatClipWriter\n");
+        return NULL;
+    }
+    strcpy(writer->fileName, fileName);
+    FlatClipFileHeader* header = &writer->header;
+    header->version = FLAT_CLIP_VERSION;
+    header->byteOrder = FLAT_CLIP_BYTE_ORDER;
+    header->pageSize = FLAT_CLIP_PAGE_SIZE;
+    header->bandIndex = bandIndex;
+    header->clipCount = clipResult->clipCount;
+    header->headerSize = sizeof(FlatClipFileHeader) + clipResult->clipCount * sizeof(FlatClipHeader);
+    header->variableCount = 1 + (clipResult->clipCount > 0 ? clipResult->clipGrids[0].extraCount : 0);
+    header->scanLineCount = clipResult->globalAttribute.scanLineCount;
+    header->ascending = clipResult->globalAttribute.ascending;
+    header->fillValue = FLAT_CLIP_FILL_VALUE;
+    header->startDateTime = clipResult->globalAttribute.startDateTime;
+    header->endDateTime = clipResult->globalAttribute.endDateTime;
+    strcpy(header->variableNames[0], "Value");
+    for (unsigned int v = 1; v < header->variableCount; v++){
+        if (g_config) strncpy(header->variableNames[v], g_config->extra_variables[v - 1], MAX_VARIABLE_NAME_LENGTH - 1);
+        else snprintf(header->variableNames[v], MAX_VARIABLE_NAME_LENGTH, "Extra_%u", v - 1);
+    }
+
+    writer->clips = (FlatClipHeader*)calloc(clipResult->clipCount > 0 ? clipResult->clipCount : 1, sizeof(FlatClipHeader));
+    writer->written = (bool*)calloc(clipResult->clipCount > 0 ? clipResult->clipCount : 1, sizeof(bool));
+    if (!writer->clips || !writer->written){
+        fprintf(stderr, "Failed to allocate memory for the flat clip table\n");
+        free(writer->clips);
+        free(writer->written);
+        free(writer);
+        return NULL;
+    }
+    uint64_t offset = AlignFlatOffset(header->headerSize);
+    for (unsigned int clipIndex = 0; clipIndex < clipResult->clipCount; clipIndex++){
+        const ClipGrid* clipGrid = &clipResult->clipGrids[clipIndex];
+        FlatClipHeader* clip = &writer->clips[clipIndex];
+        clip->longitudeCount = clipGrid->longitudeCount;
+        clip->latitudeCount = clipGrid->latitudeCount;
+        clip->heightCount = clipGrid->heightCount;
+        clip->minLatitude = clipGrid->minLatitude;
+        clip->maxLatitude = clipGrid->maxLatitude;
+        clip->minLongitude = clipGrid->minLongitude;
+        clip->maxLongitude = clipGrid->maxLongitude;
+        clip->minHeight = clipGrid->minHeight;
+        clip->latitudeGap = clipGrid->latitudeGap;
+        clip->longitudeGap = clipGrid->longitudeGap;
+        clip->heightGap = clipGrid->heightGap;
+        const size_t cellCount = (size_t)clipGrid->longitudeCount * clipGrid->latitudeCount * clipGrid->heightCount;
+        if (cellCount > writer->denseCount) writer->denseCount = cellCount;
+        clip->offset = offset;
+        clip->blockStride = AlignFlatOffset(cellCount * sizeof(float));
+        offset += clip->blockStride * header->variableCount;
+    }
+
+    writer->descriptor = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (writer->descriptor < 0){
+        fprintf(stderr, "Failed to create flat clip file: %s\n", fileName);
+        free(writer->clips);
+        free(writer->written);
+        free(writer);
+        return NULL;
+    }
+    // the blocks not written yet read as zeros, the magic is only written by CloseFlatClipWriter
+    if (ftruncate(writer->descriptor, (off_t)offset) != 0){
+        fprintf(stderr, "Failed to size flat clip file: %s\n", fileName);
+        close(writer->descriptor);
+        unlink(fileName);
+        free(writer->clips);
+        free(writer->written);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+bool WriteFlatClip(FlatClipWriter* writer, const unsigned int clipIndex, const ClipGrid* clipGrid){
+    /**
+    @brief Write the blocks of a clip at their place in the container
+    @param writer: the writer, used by one thread at a time
+    @param clipIndex: the clip index
+    @param clipGrid: the clip, dense or sparse, with the lattice it had at CreateFlatClipWriter
+    @return true if successful, false otherwise
+    */
+    if (clipIndex >= writer->header.clipCount) return false;
+    const FlatClipHeader* clip = &writer->clips[clipIndex];
+    if (clipGrid->longitudeCount != clip->longitudeCount || clipGrid->latitudeCount != clip->latitudeCount
+        || clipGrid->heightCount != clip->heightCount || 1 + clipGrid->extraCount != writer->header.variableCount){
+        fprintf(stderr, "The clip %u does not fit the flat clip layout\n", clipIndex);
+        return false;
+    }
+    const size_t cellCount = (size_t)clip->longitudeCount * clip->latitudeCount * clip->heightCount;
+    if (clipGrid->sparse && !writer->dense){
+        // a sparse clip is expanded one variable at a time as for the HDF5 datasets
+        writer->dense = (float*)malloc((writer->denseCount > 0 ? writer->denseCount : 1) * sizeof(float));
+        if (!writer->dense){
+            fprintf(stderr, "Failed to allocate memory to write sparse clip %u\n", clipIndex);
+            return false;
+        }
+    }
+    for (unsigned int variable = 0; variable < writer->header.variableCount; variable++){
+        const float* cells = NULL;
+        if (clipGrid->sparse)
+            cells = CopyClipVariable(clipGrid, variable, writer->dense) ? writer->dense : NULL;
+        else
+            cells = variable == 0 ? clipGrid->value : clipGrid->extraValue ? clipGrid->extraValue + (variable - 1) * cellCount : NULL;
+        if (!cells || !WriteAll(writer->descriptor, cells, cellCount * sizeof(float), (off_t)(clip->offset + variable * clip->blockStride))){
+            fprintf(stderr, "Failed to write %s of clip %u to %s\n", writer->header.variableNames[variable], clipIndex, writer->fileName);
+            return false;
+        }
+    }
+    writer->written[clipIndex] = true;
+    return true;
+}
+
+static bool WriteFlatClipIndex(const FlatClipWriter* writer){
+    // one line per block for tools that do not read the binary header
+    char indexFileName[sizeof(writer->fileName) + sizeof(FLAT_CLIP_INDEX_EXTENSION)];
+    snprintf(indexFileName, sizeof(indexFileName), "%s%s", writer->fileName, FLAT_CLIP_INDEX_EXTENSION);
+    FILE* file = fopen(indexFileName, "w");
+    if (!file){
+        fprintf(stderr, "Failed to create flat clip index: %s\n", indexFileName);
+        return false;
+    }
+    const FlatClipFileHeader* header = &writer->header;
+    fprintf(file, "# %.8s version %u band %s clips %u variables %u page %u fill %g little-endian float32\n", FLAT_CLIP_MAGIC,
+        header->version, BAND_NAMES[header->bandIndex], header->clipCount, header->variableCount, header->pageSize, header->fillValue);
+    fprintf(file, "# clip variable offset bytes longitude latitude height minLongitude minLatitude minHeight longitudeGap latitudeGap heightGap\n");
+    for (unsigned int clipIndex = 0; clipIndex < header->clipCount; clipIndex++){
+        const FlatClipHeader* clip = &writer->clips[clipIndex];
+        const uint64_t bytes = (uint64_t)clip->longitudeCount * clip->latitudeCount * clip->heightCount * sizeof(float);
+        for (unsigned int variable = 0; variable < header->variableCount; variable++)
+            fprintf(file, "%u %s %llu %llu %u %u %u %.6f %.6f %.2f %.6f %.6f %.2f\n", clipIndex, header->variableNames[variable],
+                (unsigned long long)(clip->offset + variable * clip->blockStride), (unsigned long long)bytes,
+                clip->longitudeCount, clip->latitudeCount, clip->heightCount, clip->minLongitude, clip->minLatitude, clip->minHeight,
+                clip->longitudeGap, clip->latitudeGap, clip->heightGap);
+    }
+    const bool success = fclose(file) == 0;
+    if (!success) fprintf(stderr, "Failed to write flat clip index: %s\n", indexFileName);
+    return success;
+}
+
+bool CloseFlatClipWriter(FlatClipWriter* writer){
+    /**
+    @brief Write the header, the clip table and the sidecar index once every clip is written, then close the file and free the writer, a container missing a clip is removed
+    @param writer: the writer, NULL does nothing
+    @return true if successful, false otherwise or if a clip was not written
+    */
+    if (!writer) return true;
+    FlatClipFileHeader* header = &writer->header;
+    bool complete = true;
+    for (unsigned int clipIndex = 0; clipIndex < header->clipCount; clipIndex++) complete = complete && writer->written[clipIndex];
+    bool success = complete;
+    if (complete){
+        // the magic goes last, a container cut short by a crash is not mistaken for a whole one
+        success = WriteAll(writer->descriptor, writer->clips, header->clipCount * sizeof(FlatClipHeader), sizeof(FlatClipFileHeader));
+        memcpy(header->magic, FLAT_CLIP_MAGIC, sizeof(header->magic));
+        success = success && WriteAll(writer->descriptor, header, sizeof(FlatClipFileHeader), 0);
+    }
+    success = close(writer->descriptor) == 0 && success;
+    if (!complete){
+        // the blocks of a clip never written would read as zeros instead of the fill value
+        fprintf(stderr, "Removing flat clip file %s, not every clip was written\n", writer->fileName);
+        char indexFileName[sizeof(writer->fileName) + sizeof(FLAT_CLIP_INDEX_EXTENSION)];
+        snprintf(indexFileName, sizeof(indexFileName), "%s%s", writer->fileName, FLAT_CLIP_INDEX_EXTENSION);
+        unlink(writer->fileName);
+        unlink(indexFileName);
+    }
+    else if (!success) fprintf(stderr, "Failed to write flat clip header: %s\n", writer->fileName);
+    success = success && WriteFlatClipIndex(writer);
+    free(writer->dense);
+    free(writer->clips);
+    free(writer->written);
+    free(writer);
+    return success;
+}
+
+bool WriteFlatClipResult(const unsigned int bandIndex, const char* clipFileName, const ClipGridResult* clipResult){
+    /**
+    @brief Write every clip of a band to its flat container, the counterpart of WriteClipResult
+    @param bandIndex: the band index
+    @param clipFileName: the HDF5 clip output file name, see ConstructFlatClipFilename
+    @param clipResult: the clips
+    @return true if successful, false otherwise
+    */
+    char* fileName = ConstructFlatClipFilename(clipFileName, bandIndex);
+    FlatClipWriter* writer = fileName ? CreateFlatClipWriter(bandIndex, fileName, clipResult) : NULL;
+    free(fileName);
+    if (!writer) return false;
+    bool success = true;
+    for (unsigned int clipIndex = 0; clipIndex < clipResult->clipCount; clipIndex++)
+        success = WriteFlatClip(writer, clipIndex, &clipResult->clipGrids[clipIndex]) && success;
+    return CloseFlatClipWriter(writer) && success;
+}
+
+static bool CheckFlatClip(const FlatClipHeader* clip, const uint32_t variableCount, const size_t fileSize){
+    // every block page aligned and inside the file, the counts can not overflow the offsets
+    if (clip->offset % FLAT_CLIP_PAGE_SIZE != 0 || clip->blockStride % FLAT_CLIP_PAGE_SIZE != 0) return false;
+    if ((uint64_t)clip->longitudeCount * clip->latitudeCount > UINT32_MAX) return false;
+    const uint64_t bytes = (uint64_t)clip->longitudeCount * clip->latitudeCount * clip->heightCount * sizeof(float);
+    if (clip->blockStride < bytes || clip->offset > fileSize) return false;
+    return clip->blockStride == 0 || (fileSize - clip->offset) / clip->blockStride >= variableCount;
+}
+
+FlatClipFile* OpenFlatClipFile(const char* fileName){
+    /**
+    @brief Map a flat clip container read only, the blocks are read in place
+    @param fileName: the container file
+    @return the file, NULL if it is missing or not a whole container of this version
+    */
+    if (!fileName) return NULL;
+    const int descriptor = open(fileName, O_RDONLY);
+    if (descriptor < 0){
+        fprintf(stderr, "Failed to open flat clip file: %s\n", fileName);
+        return NULL;
+    }
+    struct stat status;
+    void* mapping = MAP_FAILED;
+    size_t fileSize = 0;
+    if (fstat(descriptor, &status) == 0 && (size_t)status.st_size >= sizeof(FlatClipFileHeader)){
+        fileSize = status.st_size;
+        mapping = mmap(NULL, fileSize, PROT_READ, MAP_SHARED, descriptor, 0);
+    }
+    close(descriptor);
+    if (mapping == MAP_FAILED){
+        fprintf(stderr, "Failed to map flat clip file: %s\n", fileName);
+        return NULL;
+    }
+    const FlatClipFileHeader* header = (const FlatClipFileHeader*)mapping;
+    bool valid = false;
+    if (memcmp(header->magic, FLAT_CLIP_MAGIC, sizeof(header->magic)) != 0 || header->version != FLAT_CLIP_VERSION)
+        fprintf(stderr, "%s is not a flat clip file of this version\n", fileName);
+    else if (header->byteOrder != FLAT_CLIP_BYTE_ORDER || header->pageSize != FLAT_CLIP_PAGE_SIZE)
+        fprintf(stderr, "%s was written with another byte order or page size\n", fileName);
+    else if (header->variableCount < 1 || header->variableCount > FLAT_CLIP_MAX_VARIABLE_COUNT || header->bandIndex > 1
+        || header->headerSize != sizeof(FlatClipFileHeader) + (uint64_t)header->clipCount * sizeof(FlatClipHeader) || header->headerSize > fileSize)
+        fprintf(stderr, "The header of %s is damaged\n", fileName);
+    else
+        valid = true;
+    const FlatClipHeader* clips = (const FlatClipHeader*)(header + 1);
+    for (unsigned int clipIndex = 0; valid && clipIndex < header->clipCount; clipIndex++)
+        if (!CheckFlatClip(&clips[clipIndex], header->variableCount, fileSize)){
+            fprintf(stderr, "The clip %u of %s is out of the file\n", clipIndex, fileName);
+            valid = false;
+        }
+    FlatClipFile* file = valid ? (FlatClipFile*)calloc(1, sizeof(FlatClipFile)) : NULL;
+    if (!file){
+        munmap(mapping, fileSize);
+        return NULL;
+    }
+    file->mapping = mapping;
+    file->mappingSize = fileSize;
+    file->header = header;
+    file->clips = clips;
+    return file;
+}
+
+const float* GetFlatClipBlock(const FlatClipFile* file, const unsigned int clipIndex, const unsigned int variable){
+    /**
+    @brief The cells of a variable of a clip in the mapping, [longitudeCount][latitudeCount][heightCount]
+    @param file: the mapped file
+    @param clipIndex: the clip index
+    @param variable: 0 for Value, 1 + v for the extra variable v
+    @return the block, valid until CloseFlatClipFile, NULL if out of range
+    */
+    if (!file || clipIndex >= file->header->clipCount || variable >= file->header->variableCount) return NULL;
+    const FlatClipHeader* clip = &file->clips[clipIndex];
+    return (const float*)((const char*)file->mapping + clip->offset + variable * clip->blockStride);
+}
+
+void CloseFlatClipFile(FlatClipFile* file){
+    if (!file) return;
+    munmap(file->mapping, file->mappingSize);
+    free(file);
+}
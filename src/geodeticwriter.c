@@ -0,0 +1,148 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "geodeticwriter.h"
+#include "interface.h"
+
+static bool WriteUnsignedAttribute(hid_t objectID, const char* name, const unsigned int value){
+    hid_t spaceID = H5Screate(H5S_SCALAR);
+    hid_t attributeID = spaceID >= 0 ? H5Acreate(objectID, name, H5T_NATIVE_UINT, spaceID, H5P_DEFAULT, H5P_DEFAULT) : -1;
+    const bool success = attributeID >= 0 && H5Awrite(attributeID, H5T_NATIVE_UINT, &value) >= 0;
+    if (attributeID >= 0) H5Aclose(attributeID);
+    if (spaceID >= 0) H5Sclose(spaceID);
+    return success;
+}
+
+static void InitGeodeticLayout(const hsize_t* dims, const unsigned int lineBlock, ChunkLayout* layout){
+    // the chunks of the output parameters, a block of scan lines deep, chunked even when the output is not
+    InitChunkLayout(dims, layout);
+    if (dims[0] == 0 || dims[2] == 0) return;
+    layout->chunkDims[0] = dims[0] < lineBlock ? dims[0] : lineBlock;
+    if (layout->chunkDims[1] == 0) layout->chunkDims[1] = dims[1];
+    layout->chunkDims[2] = dims[2];
+}
+
+GeodeticWriter* CreateGeodeticWriter(const unsigned int bandIndex, const char* filename, const unsigned int lineCount, const unsigned int extraCount, const HDFGlobalAttribute* globalAttribute){
+    /**
+    @brief Create the datasets of a band in the geodetic output file, the first band creates it and the next ones add their group to it
+    @param bandIndex: the band index
+    @param filename: the name of the HDF5 file
+    @param lineCount: the scan lines of the band
+    @param extraCount: the extra variables geolocated with the value, named by EXTRA_VARIABLES
+    @param globalAttribute: the global attribute, written with the first band
+    @return the writer, NULL if failed
+    */
+    const unsigned int binBegin = g_config ? g_config->geodetic_bin_begin : DEFAULT_GEODETIC_BIN_BEGIN;
+    const unsigned int configuredEnd = g_config ? g_config->geodetic_bin_end : DEFAULT_GEODETIC_BIN_END;
+    const unsigned int binEnd = configuredEnd == 0 || configuredEnd > SCAN_HEIGHT_COUNT ? SCAN_HEIGHT_COUNT : configuredEnd;
+    if (binBegin >= binEnd){
+        fprintf(stderr, "Failed to write the geodetic product, the bins [%u, %u) are empty\n", binBegin, binEnd);
+        return NULL;
+    }
+    if (extraCount > MAX_EXTRA_VARIABLE_COUNT || (extraCount > 0 && !g_config)) return NULL;
+    GeodeticWriter* writer = (GeodeticWriter*)calloc(1, sizeof(GeodeticWriter));
+    if (!writer){
+        fprintf(stderr, "Failed to allocate memory for the geodetic writer\n");
+        return NULL;
+    }
+    writer->bandIndex = bandIndex;
+    writer->lineCount = lineCount;
+    writer->binBegin = binBegin;
+    writer->binCount = binEnd - binBegin;
+    writer->lineBlock = g_config && g_config->geodetic_line_block > 0 ? g_config->geodetic_line_block : DEFAULT_GEODETIC_LINE_BLOCK;
+    writer->datasetCount = GEODETIC_COORDINATE_COUNT + 1 + extraCount;
+    writer->globalAttribute = *globalAttribute;
+    writer->success = true;
+    for (unsigned int d = 0; d < GEODETIC_MAX_DATASET_COUNT; d++) writer->datasetIDs[d] = -1;
+    writer->window = (float*)malloc((size_t)writer->lineBlock * SCAN_ANGLE_COUNT * writer->binCount * sizeof(float));
+    writer->fileID = writer->window ? OpenClipOutputFile(bandIndex, filename) : -1;
+    if (writer->fileID < 0){
+        free(writer->window);
+        free(writer);
+        return NULL;
+    }
+    const char* bandName = BAND_NAMES[bandIndex];
+    char* bandPath = ConstructPath((const char*[]){bandName}, 1);
+    writer->bandGroupID = bandPath ? H5Gcreate(writer->fileID, bandPath, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT) : -1;
+    free(bandPath);
+    bool success = writer->bandGroupID >= 0;
+    if (!success)
+        fprintf(stderr, "Failed to create group: %s\n", bandName);
+
+    const hsize_t dims[3] = {lineCount, SCAN_ANGLE_COUNT, writer->binCount};
+    InitGeodeticLayout(dims, writer->lineBlock, &writer->valueLayout);
+    writer->coordinateLayout = writer->valueLayout;
+    writer->coordinateLayout.encoding = OUTPUT_ENCODING_FLOAT32;
+    const char* coordinateNames[GEODETIC_COORDINATE_COUNT] = {"Latitude", "Longitude", "Elevation"};
+    for (unsigned int d = 0; d < writer->datasetCount && success; d++){
+        const char* name = d < GEODETIC_COORDINATE_COUNT ? coordinateNames[d] : (d == GEODETIC_COORDINATE_COUNT ? "Value" : g_config->extra_variables[d - GEODETIC_COORDINATE_COUNT - 1]);
+        writer->datasetIDs[d] = CreateChunkedDataset(writer->bandGroupID, name, d < GEODETIC_COORDINATE_COUNT ? &writer->coordinateLayout : &writer->valueLayout);
+        success = writer->datasetIDs[d] >= 0;
+    }
+    // the bin of the first cell of every ray, to find the height index of a cell
+    if (success && (!WriteUnsignedAttribute(writer->bandGroupID, "Bin_Begin", writer->binBegin) || !WriteUnsignedAttribute(writer->bandGroupID, "Bin_Count", writer->binCount))){
+        fprintf(stderr, "Failed to write the bin window of %s\n", bandName);
+        success = false;
+    }
+    if (!success){
+        writer->success = false;
+        CloseGeodeticWriter(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+bool WriteGeodeticWindow(GeodeticWriter* writer, const GeodeticGrid* grid, const unsigned int firstLine, const unsigned int lineCount){
+    /**
+    @brief Write a window of geolocated scan lines, the bins of the window of every dataset are gathered then written chunk by chunk
+    @param writer: the writer
+    @param grid: the grid holding at least the lines of the window
+    @param firstLine: the first line, a multiple of the line block
+    @param lineCount: the lines, the line block unless the window reaches the last line
+    @return true if successful, false otherwise
+    */
+    if (!writer || !writer->success) return false;
+    if (lineCount > writer->lineBlock || writer->binBegin + writer->binCount > grid->heightCount || firstLine + lineCount > writer->lineCount || writer->datasetCount - GEODETIC_COORDINATE_COUNT - 1 > grid->extraCount){
+        fprintf(stderr, "Failed to write the geodetic lines %u to %u, out of the writer\n", firstLine, firstLine + lineCount);
+        writer->success = false;
+        return false;
+    }
+    const size_t rayCount = (size_t)lineCount * SCAN_ANGLE_COUNT;
+    const size_t firstRay = (size_t)firstLine * SCAN_ANGLE_COUNT;
+    for (unsigned int d = 0; d < writer->datasetCount && writer->success; d++){
+        const float* source = d == 0 ? grid->latitudeArray : (d == 1 ? grid->longitudeArray : (d == 2 ? grid->elevationArray : (d == GEODETIC_COORDINATE_COUNT ? grid->valueArray : grid->extraValueArrays[d - GEODETIC_COORDINATE_COUNT - 1])));
+        for (size_t ray = 0; ray < rayCount; ray++)
+            memcpy(writer->window + ray * writer->binCount, source + (firstRay + ray) * grid->heightCount + writer->binBegin, writer->binCount * sizeof(float));
+        if (!WriteChunkedRows(writer->datasetIDs[d], d < GEODETIC_COORDINATE_COUNT ? &writer->coordinateLayout : &writer->valueLayout, writer->window, firstLine, lineCount)){
+            fprintf(stderr, "Failed to write the geodetic lines %u to %u\n", firstLine, firstLine + lineCount);
+            writer->success = false;
+        }
+    }
+    writer->writtenLineCount += lineCount;
+    return writer->success;
+}
+
+bool CloseGeodeticWriter(GeodeticWriter* writer){
+    /**
+    @brief Close the datasets and the file, with the global attribute for the first band
+    @param writer: the writer, freed
+    @return true if every line was written, false otherwise
+    */
+    if (!writer) return false;
+    bool success = writer->success;
+    if (success && writer->writtenLineCount != writer->lineCount){
+        fprintf(stderr, "Only %u of %u scan lines of the geodetic product are written\n", writer->writtenLineCount, writer->lineCount);
+        success = false;
+    }
+    for (unsigned int d = 0; d < GEODETIC_MAX_DATASET_COUNT; d++)
+        if (writer->datasetIDs[d] >= 0) H5Dclose(writer->datasetIDs[d]);
+    if (writer->bandGroupID >= 0) H5Gclose(writer->bandGroupID);
+    if (writer->bandIndex == 0 && success && !WriteGlobalAttribute(writer->fileID, &writer->globalAttribute)){
+        fprintf(stderr, "Failed to write global attribute\n");
+        success = false;
+    }
+    if (H5Fclose(writer->fileID) < 0) success = false;
+    free(writer->window);
+    free(writer);
+    return success;
+}
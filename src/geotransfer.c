@@ -78,6 +78,29 @@ bool TransferGeodeticToCartesian(const double latitude, const double longitude,
     return true;
 }
 
+bool TransferGeodeticToScaledCartesian(const double latitude, const double longitude, const double height, const double verticalScale, double *x, double *y, double *z) {
+    /**
+     * @brief transfer geodetic to cartesian coordinates with the height stretched along the ellipsoid normal,
+     *        the euclidean distance of two results weights the height difference by verticalScale
+     * @param latitude, longitude, height: geodetic coordinates
+     * @param verticalScale: the stretch of the height, 1 gives TransferGeodeticToCartesian
+     * @param x, y, z: cartesian coordinates in the stretched space
+     * @return true if success, false if failed
+    */
+    if (!TransferGeodeticToCartesian(latitude, longitude, height, x, y, z))
+        return false;
+    if (verticalScale == 1)
+        return true;
+    // the horizontal distances grow by (N + verticalScale * height) / (N + height), below 1% for the heights of the scan
+    const double latitude_rad = ToRadians(latitude);
+    const double longitude_rad = ToRadians(longitude);
+    const double stretch = (verticalScale - 1) * height;
+    *x += stretch * cos(latitude_rad) * cos(longitude_rad);
+    *y += stretch * cos(latitude_rad) * sin(longitude_rad);
+    *z += stretch * sin(latitude_rad);
+    return true;
+}
+
 void TransferCartesianToGeodeticLagrange(const double x, const double y, const double z, double *latitude, double *height) {
     /**
      * @brief transfer cartesian to geodetic coordinates using lagrange method
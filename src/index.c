@@ -5,10 +5,12 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <time.h>
+#include <omp.h>
 #include "data.h"
 #include "index.h"
 #include "kdtree.h"
 #include "config.h"
+#include "profile.h"
 
 static unsigned int CalcExactHeightIndex(float height){
     if (height < g_config->minimal_height)
@@ -49,9 +51,42 @@ unsigned int CalcHeightIndex(float height, unsigned int** indices){
     return size;
 }
 
+typedef struct {
+    const RStarPoint* points;
+    unsigned int current, end; // next point to read and the end of the range
+    unsigned int count; // points handed to the bulk loader
+    double coordinate[3]; // scratch for both the min and max corner of the point region
+} RStarPointStream;
+
+static _Thread_local RStarPointStream g_pointStream; // the stream callback carries no user data, one cursor per building thread
+
+static int ReadNextRStarPoint(int64_t* id, double** pMin, double** pMax, uint32_t* nDimension, const uint8_t** pData, size_t* nDataLength){
+    /**
+    @brief Data stream callback of Index_CreateWithStream, hand the next valid point of the thread's cursor to the bulk loader
+    @return 0 if a point is read, 1 if the stream is exhausted
+    */
+    RStarPointStream* stream = &g_pointStream;
+    while (stream->current < stream->end && stream->points[stream->current].h == -1)
+        stream->current++;
+    if (stream->current >= stream->end)
+        return 1;
+    const RStarPoint* point = &stream->points[stream->current++];
+    stream->coordinate[0] = (double)point->x;
+    stream->coordinate[1] = (double)point->y;
+    stream->coordinate[2] = (double)point->z;
+    *id = point->id;
+    *pMin = stream->coordinate; // the loader copies the region, a point is a degenerate box
+    *pMax = stream->coordinate;
+    *nDimension = 3;
+    *pData = NULL;
+    *nDataLength = 0;
+    stream->count++;
+    return 0;
+}
+
 RStarIndex* CreateRStarIndexFromBatch(const PointBatch* batch, const unsigned int startIndex, const unsigned int endIndex, const BulkLoadConfig* config) {
     /**
-    @brief Create a RStar index from a batch of points
+    @brief Create a RStar index from a batch of points, streamed to the bulk loader without copying the coordinates
     @param batch: the batch of points
     @param startIndex: the start index of the batch
     @param endIndex: the end index of the batch
@@ -63,48 +98,17 @@ RStarIndex* CreateRStarIndexFromBatch(const PointBatch* batch, const unsigned in
         return NULL;
     }
 
-    unsigned int validPointCount = 0;
-    for (unsigned int i = startIndex; i < endIndex; i++)
-        if (batch->points[i].h != -1)
-            ++validPointCount;
-    
-    if (validPointCount == 0) {
+    unsigned int firstValidIndex = startIndex;
+    while (firstValidIndex < endIndex && batch->points[firstValidIndex].h == -1)
+        ++firstValidIndex;
+    if (firstValidIndex == endIndex) {
         fprintf(stderr, "No valid points for bulk loading\n");
         return NULL;
     }
 
-    int64_t* ids = (int64_t*)malloc(validPointCount * sizeof(int64_t));
-    double* mins = (double*)malloc(validPointCount * 3 * sizeof(double));
-    double* maxs = (double*)malloc(validPointCount * 3 * sizeof(double));
-    
-    if (!ids || !mins || !maxs) {
-        fprintf(stderr, "Failed to allocate arrays for bulk loading\n");
-        free(ids);
-        free(mins);
-        free(maxs);
-        return NULL;
-    }
-
-    unsigned int validIndex = 0;
-    for (unsigned int i = startIndex; i < endIndex; i++) {
-        RStarPoint* point = &batch->points[i];
-        if (point->h == -1) continue; // skip invalid point
-        ids[validIndex] = point->id;
-        mins[validIndex * 3 + 0] = (double)point->x;
-        mins[validIndex * 3 + 1] = (double)point->y;
-        mins[validIndex * 3 + 2] = (double)point->z;
-        maxs[validIndex * 3 + 0] = (double)point->x;
-        maxs[validIndex * 3 + 1] = (double)point->y;
-        maxs[validIndex * 3 + 2] = (double)point->z;
-        ++validIndex;
-    }
-
     IndexPropertyH properties = IndexProperty_Create();
     if (!properties) {
         fprintf(stderr, "Failed to create index properties for optimized bulk loading\n");
-        free(ids);
-        free(mins);
-        free(maxs);
         return NULL;
     }
 
@@ -116,11 +120,13 @@ RStarIndex* CreateRStarIndexFromBatch(const PointBatch* batch, const unsigned in
     IndexProperty_SetLeafCapacity(properties, config->nodeCapacity);
     IndexProperty_SetFillFactor(properties, config->fillFactor);
     
-    IndexH spatialIndex = Index_CreateWithArray(properties, validPointCount, 3, 1, 3,1, ids, mins, maxs);
-
-    free(ids);
-    free(mins);
-    free(maxs);
+    g_pointStream.points = batch->points;
+    g_pointStream.current = firstValidIndex;
+    g_pointStream.end = endIndex;
+    g_pointStream.count = 0;
+    IndexH spatialIndex = Index_CreateWithStream(properties, ReadNextRStarPoint);
+    const unsigned int validPointCount = g_pointStream.count;
+    g_pointStream.points = NULL;
 
     if (!spatialIndex) {
         fprintf(stderr, "Failed to create spatial index using bulk loading\n");
@@ -145,6 +151,36 @@ RStarIndex* CreateRStarIndexFromBatch(const PointBatch* batch, const unsigned in
     return index;
 }
 
+StaticKNNIndex* CreateKNNIndexFromBatch(const PointBatch* batch, const unsigned int startIndex, const unsigned int endIndex){
+    /**
+    @brief Create a static KNN index from a batch of points
+    @param batch: the batch of points
+    @param startIndex: the start index of the batch
+    @param endIndex: the end index of the batch
+    @return the KNN index
+    */
+    if (!batch || batch->capacity == 0 || startIndex >= endIndex) {
+        fprintf(stderr, "Invalid batch for KNN index\n");
+        return NULL;
+    }
+    return CreateStaticKNNIndex(batch->points, startIndex, endIndex, g_config->knn_leaf_size);
+}
+
+VoxelIndex* CreateVoxelIndexFromBatch(const PointBatch* batch, const unsigned int startIndex, const unsigned int endIndex){
+    /**
+    @brief Create a voxel hash from a batch of points, the search radius is the max neighbor distance of IDW
+    @param batch: the batch of points
+    @param startIndex: the start index of the batch
+    @param endIndex: the end index of the batch
+    @return the voxel index
+    */
+    if (!batch || batch->capacity == 0 || startIndex >= endIndex) {
+        fprintf(stderr, "Invalid batch for voxel index\n");
+        return NULL;
+    }
+    return CreateVoxelIndex(batch->points, startIndex, endIndex, g_config->max_neighbor_distance, g_config->voxel_ring_count);
+}
+
 AVLTree* CreateAVLTreeFromBatch(const PointBatch* pointBatch, const unsigned int startIndex, const unsigned int endIndex){
     if (!pointBatch || pointBatch->capacity == 0 || startIndex >= endIndex)
         return NULL;
@@ -160,9 +196,14 @@ AVLTree* CreateAVLTreeFromBatch(const PointBatch* pointBatch, const unsigned int
 
 void DestroyIndexForest(IndexForest* forest){
     if (!forest) return;
-    for (unsigned int treeIndex = 0; treeIndex < forest->RStarForestSize; treeIndex++)
-        if (forest->index[treeIndex])
+    for (unsigned int treeIndex = 0; treeIndex < forest->RStarForestSize; treeIndex++){
+        if (forest->index && forest->index[treeIndex])
             DestroyRStarIndex(forest->index[treeIndex]);
+        if (forest->knnIndex && forest->knnIndex[treeIndex])
+            DestroyStaticKNNIndex(forest->knnIndex[treeIndex]);
+        if (forest->voxelIndex && forest->voxelIndex[treeIndex])
+            DestroyVoxelIndex(forest->voxelIndex[treeIndex]);
+    }
 
     for (unsigned int treeIndex = 0; treeIndex < forest->KDTreeSize; treeIndex++)
         if (forest->flatindex[treeIndex])
@@ -170,8 +211,15 @@ void DestroyIndexForest(IndexForest* forest){
 
     if (forest->index)
         free(forest->index);
+    if (forest->knnIndex)
+        free(forest->knnIndex);
+    if (forest->voxelIndex)
+        free(forest->voxelIndex);
     if (forest->flatindex)
         free(forest->flatindex);
+    DestroyStructuredLocator(forest->locator);
+    DestroyEchoTopRaster(forest->echoTop);
+    DestroyResamplePlan(forest->plan);
 }
 
 PointBatch* CreateRStarPointBatch(unsigned int initialCapacity) {
@@ -228,7 +276,7 @@ bool CreateRStarForest(const PointBatch* pointBatch, ClipGridResult* finalGrid,
         fprintf(stderr, "Failed to allocate memory for RStar index\n");
         return false;
     }
-    #pragma omp parallel for shared(pointBatch, finalGrid, clipCount, bulkconfig) reduction(||:success) schedule(dynamic)
+    #pragma omp parallel for shared(pointBatch, finalGrid, clipCount, bulkconfig) reduction(&&:success) schedule(dynamic)
     for (unsigned int clipIndex = 0; clipIndex < clipCount; clipIndex++){
         const unsigned int startIndex = finalGrid->clipGrids[clipIndex].leftLineIndex * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
         const unsigned int endIndex = (finalGrid->clipGrids[clipIndex].rightLineIndex + 1) * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
@@ -242,6 +290,64 @@ bool CreateRStarForest(const PointBatch* pointBatch, ClipGridResult* finalGrid,
     return success;
 }
 
+bool CreateKNNForest(const PointBatch* pointBatch, ClipGridResult* finalGrid, IndexForest* forest){
+    /**
+    @brief Create a static KNN forest, one index per clip as the RStar forest
+    @param pointBatch: the point batch
+    @param finalGrid: the final grid
+    @param forest: the forest
+    @return true if the KNN forest is created successfully, false otherwise
+    */
+    bool success = true;
+    const unsigned int clipCount = finalGrid->clipCount;
+    forest->RStarForestSize = clipCount;
+    forest->knnIndex = (StaticKNNIndex**)calloc(clipCount, sizeof(StaticKNNIndex*));
+    if (!forest->knnIndex){
+        fprintf(stderr, "Failed to allocate memory for KNN index\n");
+        return false;
+    }
+    #pragma omp parallel for shared(pointBatch, finalGrid, clipCount) reduction(&&:success) schedule(dynamic)
+    for (unsigned int clipIndex = 0; clipIndex < clipCount; clipIndex++){
+        const unsigned int startIndex = finalGrid->clipGrids[clipIndex].leftLineIndex * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+        const unsigned int endIndex = (finalGrid->clipGrids[clipIndex].rightLineIndex + 1) * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+        forest->knnIndex[clipIndex] = CreateKNNIndexFromBatch(pointBatch, startIndex, endIndex);
+        if (!forest->knnIndex[clipIndex]){
+            fprintf(stderr, "Failed to create KNN index for clip %d\n", clipIndex);
+            success = false;
+        }
+    }
+    return success;
+}
+
+bool CreateVoxelForest(const PointBatch* pointBatch, ClipGridResult* finalGrid, IndexForest* forest){
+    /**
+    @brief Create a voxel hash forest, one index per clip as the RStar forest
+    @param pointBatch: the point batch
+    @param finalGrid: the final grid
+    @param forest: the forest
+    @return true if the voxel forest is created successfully, false otherwise
+    */
+    bool success = true;
+    const unsigned int clipCount = finalGrid->clipCount;
+    forest->RStarForestSize = clipCount;
+    forest->voxelIndex = (VoxelIndex**)calloc(clipCount, sizeof(VoxelIndex*));
+    if (!forest->voxelIndex){
+        fprintf(stderr, "Failed to allocate memory for voxel index\n");
+        return false;
+    }
+    #pragma omp parallel for shared(pointBatch, finalGrid, clipCount) reduction(&&:success) schedule(dynamic)
+    for (unsigned int clipIndex = 0; clipIndex < clipCount; clipIndex++){
+        const unsigned int startIndex = finalGrid->clipGrids[clipIndex].leftLineIndex * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+        const unsigned int endIndex = (finalGrid->clipGrids[clipIndex].rightLineIndex + 1) * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+        forest->voxelIndex[clipIndex] = CreateVoxelIndexFromBatch(pointBatch, startIndex, endIndex);
+        if (!forest->voxelIndex[clipIndex]){
+            fprintf(stderr, "Failed to create voxel index for clip %d\n", clipIndex);
+            success = false;
+        }
+    }
+    return success;
+}
+
 bool CreateKDTreeForest(const GeodeticGrid* geodeticGrid, IndexForest* forest){
     /**
     @brief Create a KDTree forest
@@ -253,23 +359,126 @@ bool CreateKDTreeForest(const GeodeticGrid* geodeticGrid, IndexForest* forest){
     bool success = true;
     KDCalcPointBatch *points = ConstructKDCalcPointFromPointBatch(geodeticGrid);
     forest->flatindex = (KDTree**)malloc(forest->KDTreeSize * sizeof(KDTree*));
-    #pragma omp parallel for shared(points, forest) reduction(||:success) schedule(dynamic)
+    #pragma omp parallel for shared(points, forest) reduction(&&:success) schedule(dynamic)
     for (unsigned int heightIndex = 0; heightIndex < forest->KDTreeSize; heightIndex++){
         forest->flatindex[heightIndex] = CreateKDTreeFromBatch(&points->value[heightIndex], heightIndex);
-        if (!forest->flatindex[heightIndex])
+        if (!forest->flatindex[heightIndex]){
             fprintf(stderr, "Failed to create KDTree for height %d\n", heightIndex);
-                success = false;
+            success = false;
+        }
     }
     DestroyKDCalcPointBatch(points);
     return success;
 }
 
-bool CreateIndexForest(const GeodeticGrid* geodeticGrid, const PointBatch* pointBatch, ClipGridResult* finalGrid, IndexForest* forest){
-    CreateKDTreeForest(geodeticGrid, forest);
-    CreateRStarForest(pointBatch, finalGrid, forest);
+bool CreateSharedIndex(const PointBatch* pointBatch, IndexForest* forest){
+    /**
+    @brief Create a single read-only index over the whole band, shared by every clip, so the points in the overlap of clips are indexed only once
+    @param pointBatch: the point batch of the whole band
+    @param forest: the forest, the index is stored in slot 0
+    @return true if the shared index is created successfully, false otherwise
+    */
+    forest->shared = true;
+    forest->RStarForestSize = 1;
+    if (forest->engine == INDEX_ENGINE_KNN){
+        forest->knnIndex = (StaticKNNIndex**)calloc(1, sizeof(StaticKNNIndex*));
+        if (!forest->knnIndex){
+            fprintf(stderr, "Failed to allocate memory for KNN index\n");
+            return false;
+        }
+        forest->knnIndex[0] = CreateKNNIndexFromBatch(pointBatch, 0, pointBatch->capacity);
+        if (!forest->knnIndex[0]){
+            fprintf(stderr, "Failed to create shared KNN index\n");
+            return false;
+        }
+        return true;
+    }
+    if (forest->engine == INDEX_ENGINE_VOXEL){
+        forest->voxelIndex = (VoxelIndex**)calloc(1, sizeof(VoxelIndex*));
+        if (!forest->voxelIndex){
+            fprintf(stderr, "Failed to allocate memory for voxel index\n");
+            return false;
+        }
+        forest->voxelIndex[0] = CreateVoxelIndexFromBatch(pointBatch, 0, pointBatch->capacity);
+        if (!forest->voxelIndex[0]){
+            fprintf(stderr, "Failed to create shared voxel index\n");
+            return false;
+        }
+        return true;
+    }
+    forest->index = (RStarIndex**)calloc(1, sizeof(RStarIndex*));
+    if (!forest->index){
+        fprintf(stderr, "Failed to allocate memory for RStar index\n");
+        return false;
+    }
+    BulkLoadConfig* bulkconfig = CreateDefaultBulkLoadConfig();
+    forest->index[0] = CreateRStarIndexFromBatch(pointBatch, 0, pointBatch->capacity, bulkconfig);
+    DestroyBulkLoadConfig(bulkconfig);
+    if (!forest->index[0]){
+        fprintf(stderr, "Failed to create shared RStar index\n");
+        return false;
+    }
     return true;
 }
 
+static const char* IndexEngineName(const IndexEngine engine){
+    switch (engine){
+        case INDEX_ENGINE_KNN: return "KNN";
+        case INDEX_ENGINE_STRUCTURED: return "structured";
+        case INDEX_ENGINE_VOXEL: return "voxel";
+        default: return "RStar";
+    }
+}
+
+bool CreateIndexForest(const GeodeticGrid* geodeticGrid, const PointBatch* pointBatch, ClipGridResult* finalGrid, IndexForest* forest){
+    forest->engine = g_config->index_engine;
+    forest->index = NULL;
+    forest->knnIndex = NULL;
+    forest->voxelIndex = NULL;
+    forest->locator = NULL;
+    forest->flatindex = NULL;
+    forest->RStarForestSize = forest->KDTreeSize = 0;
+    forest->shared = false;
+    forest->plan = NULL;
+    forest->echoTop = NULL;
+    if (g_config->resample_engine == RESAMPLE_ENGINE_SCATTER)
+        return true; // the bins are splatted onto the clips, nothing is searched
+    const bool separable = g_config->resample_engine == RESAMPLE_ENGINE_SEPARABLE;
+    if (separable)
+        forest->engine = INDEX_ENGINE_STRUCTURED; // the separable resampling only locates rays, no 3D or flat index is queried
+    else{
+        CreateKDTreeForest(geodeticGrid, forest);
+        if (g_config->echo_top_cutoff && !(forest->echoTop = CreateEchoTopRaster(geodeticGrid)))
+            fprintf(stderr, "Failed to create the echo top raster, every cell is queried\n");
+    }
+    const size_t memoryBefore = GetResidentMemory();
+    const bool peakReset = ResetPeakResidentMemory();
+    const double start = omp_get_wtime();
+    bool success;
+    if (forest->engine == INDEX_ENGINE_STRUCTURED){
+        forest->locator = CreateStructuredLocator(geodeticGrid, g_config->structured_cell_radius, g_config->structured_bin_radius, separable ? 1.0f : g_config->vertical_scale);
+        forest->shared = true;
+        success = forest->locator != NULL;
+    }
+    else if (g_config->shared_index)
+        success = CreateSharedIndex(pointBatch, forest);
+    else if (forest->engine == INDEX_ENGINE_KNN)
+        success = CreateKNNForest(pointBatch, finalGrid, forest);
+    else if (forest->engine == INDEX_ENGINE_VOXEL)
+        success = CreateVoxelForest(pointBatch, finalGrid, forest);
+    else
+        success = CreateRStarForest(pointBatch, finalGrid, forest);
+    const size_t memoryAfter = GetResidentMemory();
+    printf("Build %s %s index in %.3f s, resident memory +%.1f MB\n",
+           forest->shared ? "shared" : "per-clip",
+           IndexEngineName(forest->engine),
+           omp_get_wtime() - start,
+           memoryAfter > memoryBefore ? ToMegaBytes(memoryAfter - memoryBefore) : 0.0);
+    if (peakReset)
+        printf("Peak resident memory during index build: %.1f MB\n", ToMegaBytes(GetPeakResidentMemory()));
+    return success;
+}
+
 void DestroyKDCalcPointBatch(KDCalcPointBatch* batch){
     if (!batch) return;
     for (unsigned int h = 0; h < batch->heightCount; h++){
@@ -350,4 +559,57 @@ bool ProtentialToInterpolate(double latitude, double longitude, double height, K
     }
     free(indices);
     return hasProtential;
+}
+
+bool QueryNearestNeighborBatch(const IndexForest* forest, const unsigned int clipIndex, const unsigned int k, const unsigned int queryCount, double* queryPoints, const double* queryGeodetic, int64_t* ids, uint64_t* counts, double* distances){
+    /**
+    @brief Query the k nearest neighbors of a batch of points with the engine of the forest
+    @param forest: the index forest
+    @param clipIndex: the clip whose index is queried, ignored by a shared index
+    @param k: the number of neighbors
+    @param queryCount: the number of query points
+    @param queryPoints: the query points [queryCount][3]
+    @param queryGeodetic: latitude, longitude and height of the query points [queryCount][3], used by the structured locator
+    @param ids: output ids, results of each query packed one after another
+    @param counts: output result count of each query
+    @param distances: output distances, packed as ids
+    @return true if successful, false otherwise
+    */
+    if (forest->engine == INDEX_ENGINE_STRUCTURED)
+        return StructuredLocator_NearestNeighborBatchQuery(forest->locator, k, queryCount, queryGeodetic, ids, counts, distances);
+    const unsigned int treeIndex = forest->shared ? 0 : clipIndex;
+    if (forest->engine == INDEX_ENGINE_KNN){
+        if (!forest->knnIndex || !forest->knnIndex[treeIndex]) return false;
+        return StaticKNNIndex_NearestNeighborBatchQuery(forest->knnIndex[treeIndex], k, queryCount, queryPoints, ids, counts, distances);
+    }
+    if (forest->engine == INDEX_ENGINE_VOXEL){
+        if (!forest->voxelIndex || !forest->voxelIndex[treeIndex]) return false;
+        return VoxelIndex_NearestNeighborBatchQuery(forest->voxelIndex[treeIndex], k, queryCount, queryPoints, ids, counts, distances);
+    }
+    if (!forest->index || !forest->index[treeIndex]) return false;
+    // Perform batch nearest neighbor query using the new bulk API from PR #268
+    int64_t actualProcessed = 0;
+    RTError result = Index_NearestNeighbors_id_v(forest->index[treeIndex]->spatialIndex,
+                                                 k,                     // knn: number of nearest neighbors to find
+                                                 queryCount,            // n: number of query points
+                                                 3,                     // d: dimension (latitude, longitude, height)
+                                                 queryCount * k,        // idsz: total size of ids array
+                                                 3,                     // d_i_stri: stride between query points
+                                                 1,                     // d_j_stri: stride between dimensions
+                                                 queryPoints,           // mins: query point coordinates
+                                                 queryPoints,           // maxs: same as mins for point queries
+                                                 ids,                   // ids: output array for result ids
+                                                 counts,                // cnts: count of results per query point
+                                                 distances,             // dists: distances (optional)
+                                                 &actualProcessed);     // nr: actual number of processed queries
+    if (result != RT_None) {
+        fprintf(stderr, "Batch nearest neighbor query failed\n");
+        return false;
+    }
+    if (actualProcessed != queryCount){
+        fprintf(stderr, "Warning: Only %ld out of %u queries were processed in batch\n", actualProcessed, queryCount);
+        for (unsigned int i = (actualProcessed > 0 ? actualProcessed : 0); i < queryCount; i++)
+            counts[i] = 0;
+    }
+    return true;
 }
\ No newline at end of file
@@ -1,11 +1,15 @@
 #include "interface.h"
 #include "config.h"
 #include "data.h"
+#include "chunkwriter.h"
+#include "derived.h"
+#include "geodeticwriter.h"
 #include <H5Ipublic.h>
 #include <H5Tpublic.h>
 #include <H5public.h>
 #include <stdlib.h>
 #include <string.h>
+#include <math.h>
 #include <omp.h>
 
 struct Config *g_config = NULL;
@@ -66,6 +70,7 @@ bool ReadHDF5(const unsigned int bandIndex, const char* filename, HDFDataset* da
     }
 
     const char* bandName = BAND_NAMES[bandIndex];
+    dataset->extraCount = g_config ? g_config->extra_variable_count : 0;
     dataset->infoArray = (GridInfo**)malloc(dataset->globalAttribute.scanLineCount * sizeof(GridInfo*));
     if (!ReadBand(fileID, bandName, &dataset->globalAttribute, dataset->infoArray)){
         fprintf(stderr, "Failed to read band: %s\n", bandName);
@@ -220,6 +225,27 @@ bool GetRequiredDatasetID(hid_t fileID, const char* bandName, HDFBandRequired* r
         fprintf(stderr, "Failed to open dataset: %s\n", "binClutterFreeBottom");
         return false;
     }
+    required->extraCount = g_config ? g_config->extra_variable_count : 0;
+    for (unsigned int v = 0; v < required->extraCount; v++){
+        const char* name = g_config->extra_variables[v];
+        required->extraIDs[v] = GetDatasetID(fileID, ConstructPath((const char*[]){PRE_GROUP_NAME, bandName, name}, 3));
+        if (required->extraIDs[v] < 0){
+            fprintf(stderr, "Failed to open dataset: %s\n", name);
+            required->extraCount = v;
+            return false;
+        }
+        hid_t dataspaceID = H5Dget_space(required->extraIDs[v]);
+        hsize_t dims[3] = {0, 0, 0};
+        required->extraRanks[v] = H5Sget_simple_extent_ndims(dataspaceID);
+        if (required->extraRanks[v] == 2 || required->extraRanks[v] == 3)
+            H5Sget_simple_extent_dims(dataspaceID, dims, NULL);
+        H5Sclose(dataspaceID);
+        if (dims[1] != SCAN_ANGLE_COUNT || (required->extraRanks[v] == 3 && dims[2] != SCAN_HEIGHT_COUNT)){
+            fprintf(stderr, "Extra variable %s is neither [line][angle] nor [line][angle][bin]\n", name);
+            required->extraCount = v + 1;
+            return false;
+        }
+    }
     return true;
 }
 
@@ -329,6 +355,7 @@ bool ReadSingleScanLine(int lineIndex, const HDFBandRequired* required, GridInfo
                 success = false;
                 break;
             }
+            infoLine[angleIndex].extraArray = NULL; // extra variables are only read in batch
             memcpy(infoLine[angleIndex].measuredArray, value[angleIndex], SCAN_HEIGHT_COUNT * sizeof(float));
             memcpy(infoLine[angleIndex].heightArray, height[angleIndex], SCAN_HEIGHT_COUNT * sizeof(float));
         }
@@ -372,6 +399,8 @@ bool ReadBand(hid_t fileID, const char* bandName, HDFGlobalAttribute* globalAttr
     H5Dclose(required.groundHeightID);
     H5Dclose(required.valueID);
     H5Dclose(required.binClutterID);
+    for (unsigned int v = 0; v < required.extraCount; v++)
+        H5Dclose(required.extraIDs[v]);
     return success;
 }
 
@@ -447,277 +476,379 @@ bool WriteGlobalAttribute(hid_t fileID, const HDFGlobalAttribute* globalAttribut
 
 bool WriteTotalGeodetic(const unsigned int bandIndex, const char* filename, const GeodeticGrid* dataset, const HDFGlobalAttribute* globalAttribute){
     /**
-    @brief Write HDF5 file
+    @brief Write the geolocated grid of a band at once, window by window as ProcessDataset streams it with GEODETIC_OUTPUT
     @param bandIndex: the band index
     @param filename: the name of the HDF5 file
     @param dataset: the dataset to write
+    @param globalAttribute: the global attribute, written with the first band
     @return true if successful, false otherwise
     */
-    hid_t fileID = 0;
-    if (bandIndex == 0){
-        fileID = H5Fcreate(filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-        if (fileID < 0){
-            fprintf(stderr, "Failed to create file: %s\n", filename);
-            return false;
-        }
-    }
-    else{
-        fileID = H5Fopen(filename, H5F_ACC_RDWR, H5P_DEFAULT);    
-        if (fileID < 0) {
-            fprintf(stderr, "Failed to open file: %s\n", filename);
-            return false;
-        }
-    }
-
-    //write data
-    hsize_t dims[3] = {dataset->lineCount, SCAN_ANGLE_COUNT, dataset->heightCount};
-    bool success = true;
-    const char* bandName = BAND_NAMES[bandIndex];
-    hid_t bandGroupID = H5Gcreate(fileID, ConstructPath((const char*[]){bandName}, 1), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-    if (bandGroupID < 0){
-        fprintf(stderr, "Failed to create group: %s\n", bandName);
-        H5Gclose(bandGroupID);
-        H5Fclose(fileID);
-        return false;
-    }
-    hid_t dataspaceID = H5Screate_simple(3, dims, NULL);
-    if (dataspaceID < 0){
-        fprintf(stderr, "Failed to create dataspace: %s\n", bandName);
-        H5Sclose(dataspaceID);
-        H5Gclose(bandGroupID);
-        H5Fclose(fileID);
-        return false;
-    }
-    hid_t latitudeID = H5Dcreate(bandGroupID, "Latitude", H5T_NATIVE_FLOAT, dataspaceID, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-    hid_t longitudeID = H5Dcreate(bandGroupID, "Longitude", H5T_NATIVE_FLOAT, dataspaceID, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-    hid_t elevationID = H5Dcreate(bandGroupID, "Elevation", H5T_NATIVE_FLOAT, dataspaceID, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-    hid_t valueID = H5Dcreate(bandGroupID, "Value", H5T_NATIVE_FLOAT, dataspaceID, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-    if (latitudeID < 0 || longitudeID < 0 || elevationID < 0 || valueID < 0){
-        fprintf(stderr, "Failed to create dataset: %s\n", bandName);
-        success = false;
-    }
-    herr_t status = H5Dwrite(latitudeID, H5T_IEEE_F32LE, H5S_ALL, H5S_ALL, H5P_DEFAULT, dataset->latitudeArray);
-    if (status < 0){
-        fprintf(stderr, "Failed to write latitude\n");
-        success = false;
-    }
-    status = H5Dwrite(longitudeID, H5T_IEEE_F32LE, H5S_ALL, H5S_ALL, H5P_DEFAULT, dataset->longitudeArray);
-    if (status < 0){
-        fprintf(stderr, "Failed to write longitude\n");
-        success = false;
-    }
-    status = H5Dwrite(elevationID, H5T_IEEE_F32LE, H5S_ALL, H5S_ALL, H5P_DEFAULT, dataset->elevationArray);
-    if (status < 0){
-        fprintf(stderr, "Failed to write elevation\n");
-        success = false;
-    }
-    status = H5Dwrite(valueID, H5T_IEEE_F32LE, H5S_ALL, H5S_ALL, H5P_DEFAULT, dataset->valueArray);
-    if (status < 0){
-        fprintf(stderr, "Failed to write value\n");
-        success = false;
-    }
-    H5Sclose(dataspaceID);
-    H5Dclose(latitudeID);
-    H5Dclose(longitudeID);
-    H5Dclose(elevationID);
-    H5Dclose(valueID);
-    H5Gclose(bandGroupID);
-    if (!success)
-        return false;
-
-    if (!WriteGlobalAttribute(fileID, globalAttribute)){
-        fprintf(stderr, "Failed to write global attribute\n");
-        H5Fclose(fileID);
-        return false;
+    GeodeticWriter* writer = CreateGeodeticWriter(bandIndex, filename, dataset->lineCount, dataset->extraCount, globalAttribute);
+    if (!writer) return false;
+    for (unsigned int firstLine = 0; firstLine < dataset->lineCount; firstLine += writer->lineBlock){
+        const unsigned int lineCount = dataset->lineCount - firstLine < writer->lineBlock ? dataset->lineCount - firstLine : writer->lineBlock;
+        if (!WriteGeodeticWindow(writer, dataset, firstLine, lineCount)) break;
     }
-    H5Fclose(fileID);
-    return true;
+    return CloseGeodeticWriter(writer);
 }
 
-bool WriteClipResult(const unsigned int bandIndex, const char* filename, const ClipGridResult* clipResult){
+hid_t OpenClipOutputFile(const unsigned int bandIndex, const char* filename){
     /**
-    @brief Write clip result
+    @brief Open the clip output file, the first band creates it and the next ones add their group to it
     @param bandIndex: the band index
     @param filename: the name of the HDF5 file
-    @param clipResult: the clip result
-    @return true if successful, false otherwise
+    @return the file ID, negative if failed
     */
     hid_t fileID = 0;
     if (bandIndex == 0){
         fileID = H5Fcreate(filename, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
-        if (fileID < 0){
+        if (fileID < 0)
             fprintf(stderr, "Failed to create file: %s\n", filename);
-            return false;
-        }
     }
     else{
-        fileID = H5Fopen(filename, H5F_ACC_RDWR, H5P_DEFAULT);    
-        if (fileID < 0) {
+        fileID = H5Fopen(filename, H5F_ACC_RDWR, H5P_DEFAULT);
+        if (fileID < 0)
             fprintf(stderr, "Failed to open file: %s\n", filename);
-            return false;
+    }
+    return fileID;
+}
+
+static bool WriteClipProducts(hid_t clipGroupID, const ClipGrid* clipGrid, const ClipValidBox* box){
+    /**
+    @brief Write the derived products chosen by DERIVED_PRODUCTS, one 2D dataset over the columns of the box each, chunked, compressed and encoded as the value
+    @param clipGroupID: the slice group of the clip
+    @param clipGrid: the clip with its products
+    @param box: the box written, its height range is ignored
+    @return true if successful, false otherwise
+    */
+    const hsize_t dims[2] = {box->longitudeEnd - box->longitudeBegin, box->latitudeEnd - box->latitudeBegin};
+    const size_t columnCount = (size_t)clipGrid->longitudeCount * clipGrid->latitudeCount;
+    ChunkLayout layout;
+    InitPlaneChunkLayout(dims, &layout);
+    float* plane = (float*)malloc(dims[0] * dims[1] * sizeof(float));
+    hid_t scalarSpaceID = H5Screate(H5S_SCALAR);
+    hid_t strType = H5Tcopy(H5T_C_S1);
+    H5Tset_size(strType, 16);
+    bool success = plane && scalarSpaceID >= 0 && strType >= 0;
+    if (!success)
+        fprintf(stderr, "Failed to prepare the derived products\n");
+    for (unsigned int product = 0; success && product < DERIVED_PRODUCT_COUNT; product++){
+        if (!(g_config->derived_products & (1u << product))) continue;
+        // the rows of the box, the columns of a row are contiguous in the clip
+        for (hsize_t l = 0; l < dims[0]; l++)
+            memcpy(plane + l * dims[1], clipGrid->products + product * columnCount + (size_t)(box->longitudeBegin + l) * clipGrid->latitudeCount + box->latitudeBegin, dims[1] * sizeof(float));
+        const char* name = DERIVED_PRODUCT_NAMES[product];
+        ChunkLayout productLayout = layout;
+        if (DERIVED_PRODUCT_INT16_SCALES[product] > 0){
+            productLayout.scaleFactor = DERIVED_PRODUCT_INT16_SCALES[product];
+            productLayout.addOffset = 0.0f;
         }
+        hid_t datasetID = CreateChunkedDataset(clipGroupID, name, &productLayout);
+        if (datasetID < 0 || !WriteChunkedDataset(datasetID, &productLayout, plane)){
+            fprintf(stderr, "Failed to write %s\n", name);
+            success = false;
+        }else{
+            // the attribute holds 16 bytes, the units are shorter literals
+            char units[16] = {0};
+            strncpy(units, DERIVED_PRODUCT_UNITS[product], sizeof(units) - 1);
+            hid_t unitsID = H5Acreate(datasetID, "Units", strType, scalarSpaceID, H5P_DEFAULT, H5P_DEFAULT);
+            if (unitsID < 0 || H5Awrite(unitsID, strType, units) < 0){
+                fprintf(stderr, "Failed to write the units of %s\n", name);
+                success = false;
+            }
+            if (unitsID >= 0) H5Aclose(unitsID);
+        }
+        if (datasetID >= 0) H5Dclose(datasetID);
     }
+    if (strType >= 0) H5Tclose(strType);
+    if (scalarSpaceID >= 0) H5Sclose(scalarSpaceID);
+    free(plane);
+    return success;
+}
 
+bool WriteClipGroup(hid_t bandGroupID, const unsigned int clipIndex, const ClipGrid* clipGrid){
+    /**
+    @brief Write a clip to its slice group, value, the extra variables, the derived products and the lattice attributes
+    @param bandGroupID: the group of the band
+    @param clipIndex: the clip index, the group is named slice_<clipIndex>
+    @param clipGrid: the clip
+    @return true if successful, false otherwise
+    */
     bool success = true;
-    const char* bandName = BAND_NAMES[bandIndex];
-    hid_t bandGroupID = H5Gcreate(fileID, ConstructPath((const char*[]){bandName}, 1), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-    if (bandGroupID < 0){
-        fprintf(stderr, "Failed to create group: %s\n", bandName);
+    // a cropped clip keeps the box of its valid cells, the lattice attributes move to its first cell
+    ClipValidBox box;
+    GetClipWriteBox(clipGrid, &box);
+    hsize_t dims[3] = {box.longitudeEnd - box.longitudeBegin, box.latitudeEnd - box.latitudeBegin, box.heightEnd - box.heightBegin};
+    const bool whole = dims[0] == clipGrid->longitudeCount && dims[1] == clipGrid->latitudeCount && dims[2] == clipGrid->heightCount;
+    const float minLatitude = clipGrid->minLatitude + box.latitudeBegin * clipGrid->latitudeGap;
+    const float maxLatitude = whole ? clipGrid->maxLatitude : fminf(clipGrid->maxLatitude, clipGrid->minLatitude + box.latitudeEnd * clipGrid->latitudeGap);
+    const float minLongitude = clipGrid->minLongitude + box.longitudeBegin * clipGrid->longitudeGap;
+    const float maxLongitude = whole ? clipGrid->maxLongitude : fminf(clipGrid->maxLongitude, clipGrid->minLongitude + box.longitudeEnd * clipGrid->longitudeGap);
+    const float minHeight = clipGrid->minHeight + box.heightBegin * clipGrid->heightGap;
+    char clipName[10];
+    sprintf(clipName, "slice_%d", clipIndex);
+    hid_t clipGroupID = H5Gcreate(bandGroupID, clipName, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    if (clipGroupID < 0){
+        fprintf(stderr, "Failed to create group: %s\n", clipName);
         return false;
     }
-    for (unsigned int clipIndex = 0; clipIndex < clipResult->clipCount; clipIndex++){
-        ClipGrid *clipGrid = &clipResult->clipGrids[clipIndex];
-        hsize_t dims[3] = {clipGrid->longitudeCount, clipGrid->latitudeCount, clipGrid->heightCount};
-        char clipName[10];
-        sprintf(clipName, "slice_%d", clipIndex);
-        hid_t clipGroupID = H5Gcreate(bandGroupID, clipName, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        if (clipGroupID < 0){
-            fprintf(stderr, "Failed to create group: %s\n", clipName);
+    ChunkLayout layout;
+    InitChunkLayout(dims, &layout);
+    // a sparse or cropped clip is copied one variable at a time into a single box sized buffer
+    const size_t cellCount = (size_t)clipGrid->longitudeCount * clipGrid->latitudeCount * clipGrid->heightCount;
+    const bool copied = clipGrid->sparse || !whole;
+    float* block = copied ? (float*)malloc(dims[0] * dims[1] * dims[2] * sizeof(float)) : NULL;
+    if (copied && !block){
+        fprintf(stderr, "Failed to allocate memory to write clip: %s\n", clipName);
+        success = false;
+    }
+    // write value, then the extra variables beside it, one dataset named after each
+    const unsigned int variableCount = g_config ? 1 + clipGrid->extraCount : 1;
+    for (unsigned int variable = 0; variable < variableCount; variable++){
+        const char* name = variable == 0 ? "Value" : g_config->extra_variables[variable - 1];
+        hid_t datasetID = CreateChunkedDataset(clipGroupID, name, &layout);
+        if (datasetID < 0){
+            fprintf(stderr, "Failed to create dataset: %s of %s\n", name, clipName);
             success = false;
             continue;
         }
-        // write value
-        hid_t dataspaceID = H5Screate_simple(3, dims, NULL);
-        if (dataspaceID < 0){
-            fprintf(stderr, "Failed to create dataspace: %s\n", clipName);
-            H5Sclose(dataspaceID);
-            H5Gclose(clipGroupID);
+        bool written = false;
+        if (!copied)
+            written = WriteChunkedDataset(datasetID, &layout, variable == 0 ? clipGrid->value : clipGrid->extraValue + (variable - 1) * cellCount);
+        else if (block && CopyClipVariableBox(clipGrid, variable, &box, block))
+            written = WriteChunkedDataset(datasetID, &layout, block);
+        if (!written){
+            fprintf(stderr, "Failed to write %s\n", name);
             success = false;
-            continue;
         }
-        hid_t valueID = H5Dcreate(clipGroupID, "Value", H5T_NATIVE_FLOAT, dataspaceID, H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
-        if (valueID < 0){
-            fprintf(stderr, "Failed to create dataset: %s\n", clipName);
-            H5Dclose(valueID);
-            H5Sclose(dataspaceID);
-            H5Gclose(clipGroupID);
+        H5Dclose(datasetID);
+    }
+    free(block);
+    if (clipGrid->products && g_config && !WriteClipProducts(clipGroupID, clipGrid, &box)) success = false;
+
+    // write attributes for value
+    hid_t clipAttriSpaceID = H5Screate(H5S_SCALAR);
+    if (clipAttriSpaceID < 0){
+        fprintf(stderr, "Failed to create dataspace: %s\n", clipName);
+        H5Sclose(clipAttriSpaceID);
+        H5Gclose(clipGroupID);
+        return false;
+    }
+    herr_t status;
+    hid_t minLatID = H5Acreate(clipGroupID, "Min_Latitude", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
+    if (minLatID < 0){
+        fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+        success = false;
+    }else{
+        status = H5Awrite(minLatID, H5T_NATIVE_FLOAT, &minLatitude);
+        if (status < 0){
+            fprintf(stderr, "Failed to write dataset: %s\n", "minLatitude");
             success = false;
-            continue;
         }
-        herr_t status = H5Dwrite(valueID, H5T_IEEE_F32LE, H5S_ALL, H5S_ALL, H5P_DEFAULT, clipGrid->value);
+        H5Aclose(minLatID);
+    }
+
+    hid_t maxLatID = H5Acreate(clipGroupID, "Max_Latitude", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
+    if (maxLatID < 0){
+        fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+        success = false;
+    }else{
+        status = H5Awrite(maxLatID, H5T_NATIVE_FLOAT, &maxLatitude);
         if (status < 0){
-            fprintf(stderr, "Failed to write value\n");
+            fprintf(stderr, "Failed to write dataset: %s\n", "maxLatitude");
             success = false;
         }
-        H5Dclose(valueID);
-        H5Sclose(dataspaceID);
+        H5Aclose(maxLatID);
+    }
 
-        // write attributes for value
-        hid_t clipAttriSpaceID = H5Screate(H5S_SCALAR);
-        if (clipAttriSpaceID < 0){
-            fprintf(stderr, "Failed to create dataspace: %s\n", clipName);
-            H5Sclose(clipAttriSpaceID);
-            H5Gclose(clipGroupID);
+    hid_t minLongID = H5Acreate(clipGroupID, "Min_Longitude", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
+    if (minLongID < 0){
+        fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+        success = false;
+    }else{
+        status = H5Awrite(minLongID, H5T_NATIVE_FLOAT, &minLongitude);
+        if (status < 0){
+            fprintf(stderr, "Failed to write dataset: %s\n", "minLongitude");
             success = false;
-            continue;
         }
-        hid_t minLatID = H5Acreate(clipGroupID, "Min_Latitude", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
-        if (minLatID < 0){
-            fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+        H5Aclose(minLongID);
+    }
+    
+    hid_t maxLongID = H5Acreate(clipGroupID, "Max_Longitude", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
+    if (maxLongID < 0){
+        fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+        success = false;
+    }else{
+        status = H5Awrite(maxLongID, H5T_NATIVE_FLOAT, &maxLongitude);
+        if (status < 0){
+            fprintf(stderr, "Failed to write dataset: %s\n", "maxLongitude");
             success = false;
-        }else{
-            status = H5Awrite(minLatID, H5T_NATIVE_FLOAT, &clipGrid->minLatitude);
-            if (status < 0){
-                fprintf(stderr, "Failed to write dataset: %s\n", "minLatitude");
-                success = false;
-            }
-            H5Aclose(minLatID);
         }
+        H5Aclose(maxLongID);
+    }
 
-        hid_t maxLatID = H5Acreate(clipGroupID, "Max_Latitude", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
-        if (maxLatID < 0){
-            fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+    hid_t minHeightID = H5Acreate(clipGroupID, "Min_Height", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
+    if (minHeightID < 0){
+        fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+        success = false;
+    }else{
+        status = H5Awrite(minHeightID, H5T_NATIVE_FLOAT, &minHeight);
+        if (status < 0){
+            fprintf(stderr, "Failed to write dataset: %s\n", "minHeight");
             success = false;
-        }else{
-            status = H5Awrite(maxLatID, H5T_NATIVE_FLOAT, &clipGrid->maxLatitude);
-            if (status < 0){
-                fprintf(stderr, "Failed to write dataset: %s\n", "maxLatitude");
-                success = false;
-            }
-            H5Aclose(maxLatID);
         }
+        H5Aclose(minHeightID);
+    }
 
-        hid_t minLongID = H5Acreate(clipGroupID, "Min_Longitude", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
-        if (minLongID < 0){
-            fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+    hid_t latitudeGapID = H5Acreate(clipGroupID, "Latitude_Gap", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
+    if (latitudeGapID < 0){
+        fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+        success = false;
+    }else{
+        status = H5Awrite(latitudeGapID, H5T_NATIVE_FLOAT, &clipGrid->latitudeGap);
+        if (status < 0){
+            fprintf(stderr, "Failed to write dataset: %s\n", "latitudeGap");
             success = false;
-        }else{
-            status = H5Awrite(minLongID, H5T_NATIVE_FLOAT, &clipGrid->minLongitude);
-            if (status < 0){
-                fprintf(stderr, "Failed to write dataset: %s\n", "minLongitude");
-                success = false;
-            }
-            H5Aclose(minLongID);
-        }
-        
-        hid_t maxLongID = H5Acreate(clipGroupID, "Max_Longitude", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
-        if (maxLongID < 0){
-            fprintf(stderr, "Failed to create dataset: %s\n", clipName);
-            success = false;
-        }else{
-            status = H5Awrite(maxLongID, H5T_NATIVE_FLOAT, &clipGrid->maxLongitude);
-            if (status < 0){
-                fprintf(stderr, "Failed to write dataset: %s\n", "maxLongitude");
-                success = false;
-            }
-            H5Aclose(maxLongID);
         }
+        H5Aclose(latitudeGapID);
+    }
 
-        hid_t minHeightID = H5Acreate(clipGroupID, "Min_Height", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
-        if (minHeightID < 0){
-            fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+    hid_t longitudeGapID = H5Acreate(clipGroupID, "Longitude_Gap", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
+    if (longitudeGapID < 0){
+        fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+        success = false;
+    }else{
+        status = H5Awrite(longitudeGapID, H5T_NATIVE_FLOAT, &clipGrid->longitudeGap);
+        if (status < 0){
+            fprintf(stderr, "Failed to write dataset: %s\n", "longitudeGap");
             success = false;
-        }else{
-            status = H5Awrite(minHeightID, H5T_NATIVE_FLOAT, &clipGrid->minHeight);
-            if (status < 0){
-                fprintf(stderr, "Failed to write dataset: %s\n", "minHeight");
-                success = false;
-            }
-            H5Aclose(minHeightID);
         }
+        H5Aclose(longitudeGapID);
+    }
 
-        hid_t latitudeGapID = H5Acreate(clipGroupID, "Latitude_Gap", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
-        if (latitudeGapID < 0){
-            fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+    hid_t heightGapID = H5Acreate(clipGroupID, "Height_Gap", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
+    if (heightGapID < 0){
+        fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+        success = false;
+    }else{
+        status = H5Awrite(heightGapID, H5T_NATIVE_FLOAT, &clipGrid->heightGap);
+        if (status < 0){
+            fprintf(stderr, "Failed to write dataset: %s\n", "heightGap");
             success = false;
-        }else{
-            status = H5Awrite(latitudeGapID, H5T_NATIVE_FLOAT, &clipGrid->latitudeGap);
-            if (status < 0){
-                fprintf(stderr, "Failed to write dataset: %s\n", "latitudeGap");
-                success = false;
-            }
-            H5Aclose(latitudeGapID);
         }
+        H5Aclose(heightGapID);
+    }            
+    H5Sclose(clipAttriSpaceID);
 
-        hid_t longitudeGapID = H5Acreate(clipGroupID, "Longitude_Gap", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
-        if (longitudeGapID < 0){
-            fprintf(stderr, "Failed to create dataset: %s\n", clipName);
+    // the place of the box in the lattice of the clip, e.g. to paste it back
+    if (clipGrid->cropped){
+        const unsigned int offset[3] = {box.longitudeBegin, box.latitudeBegin, box.heightBegin};
+        const unsigned int count[3] = {clipGrid->longitudeCount, clipGrid->latitudeCount, clipGrid->heightCount};
+        const hsize_t attributeDims[1] = {3};
+        hid_t vectorSpaceID = H5Screate_simple(1, attributeDims, NULL);
+        hid_t offsetID = H5Acreate(clipGroupID, "Lattice_Offset", H5T_NATIVE_UINT, vectorSpaceID, H5P_DEFAULT, H5P_DEFAULT);
+        hid_t countID = H5Acreate(clipGroupID, "Lattice_Count", H5T_NATIVE_UINT, vectorSpaceID, H5P_DEFAULT, H5P_DEFAULT);
+        if (offsetID < 0 || countID < 0 || H5Awrite(offsetID, H5T_NATIVE_UINT, offset) < 0 || H5Awrite(countID, H5T_NATIVE_UINT, count) < 0){
+            fprintf(stderr, "Failed to write the lattice offset of %s\n", clipName);
             success = false;
-        }else{
-            status = H5Awrite(longitudeGapID, H5T_NATIVE_FLOAT, &clipGrid->longitudeGap);
-            if (status < 0){
-                fprintf(stderr, "Failed to write dataset: %s\n", "longitudeGap");
-                success = false;
-            }
-            H5Aclose(longitudeGapID);
         }
+        if (offsetID >= 0) H5Aclose(offsetID);
+        if (countID >= 0) H5Aclose(countID);
+        H5Sclose(vectorSpaceID);
+    }
 
-        hid_t heightGapID = H5Acreate(clipGroupID, "Height_Gap", H5T_NATIVE_FLOAT, clipAttriSpaceID, H5P_DEFAULT, H5P_DEFAULT);
-        if (heightGapID < 0){
-            fprintf(stderr, "Failed to create dataset: %s\n", clipName);
-            success = false;
-        }else{
-            status = H5Awrite(heightGapID, H5T_NATIVE_FLOAT, &clipGrid->heightGap);
-            if (status < 0){
-                fprintf(stderr, "Failed to write dataset: %s\n", "heightGap");
-                success = false;
-            }
-            H5Aclose(heightGapID);
-        }            
-        H5Sclose(clipAttriSpaceID);
+    H5Gclose(clipGroupID);
+    return success;
+}
 
-        H5Gclose(clipGroupID);
+char* ConstructClipFilename(const char* filename, const unsigned int bandIndex, const unsigned int clipIndex){
+    /**
+    @brief The file of a clip with OUTPUT_LAYOUT=PER_CLIP, e.g. clip.HDF gives clip_Ka_slice_3.HDF
+    @param filename: the name of the clip output file
+    @param bandIndex: the band index
+    @param clipIndex: the clip index
+    @return the file name, freed by the caller, NULL if failed
+    */
+    char suffix[32];
+    snprintf(suffix, sizeof(suffix), "_%s_slice_%u", BAND_NAMES[bandIndex], clipIndex);
+    return ConstructOutputFilename(filename, suffix);
+}
+
+bool WriteClipFile(const unsigned int bandIndex, const char* filename, const unsigned int clipIndex, const ClipGrid* clipGrid){
+    /**
+    @brief Write a clip to its own file, the slice group at the root as in the band group of the clip output file
+    @param bandIndex: the band index
+    @param filename: the name of the clip output file, see ConstructClipFilename
+    @param clipIndex: the clip index
+    @param clipGrid: the clip
+    @return true if successful, false otherwise
+    */
+    char* clipFileName = ConstructClipFilename(filename, bandIndex, clipIndex);
+    if (!clipFileName) return false;
+    hid_t fileID = H5Fcreate(clipFileName, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    if (fileID < 0){
+        fprintf(stderr, "Failed to create file: %s\n", clipFileName);
+        free(clipFileName);
+        return false;
     }
+    free(clipFileName);
+    const bool success = WriteClipGroup(fileID, clipIndex, clipGrid);
+    return H5Fclose(fileID) >= 0 && success;
+}
+
+bool LinkClipFile(hid_t bandGroupID, const unsigned int bandIndex, const char* filename, const unsigned int clipIndex){
+    /**
+    @brief Expose the slice group of a clip file as slice_<clipIndex> of the band group by an external link
+    @param bandGroupID: the group of the band in the clip output file
+    @param bandIndex: the band index
+    @param filename: the name of the clip output file
+    @param clipIndex: the clip index
+    @return true if successful, false otherwise
+    */
+    char* clipFileName = ConstructClipFilename(filename, bandIndex, clipIndex);
+    if (!clipFileName) return false;
+    // the name without its directory, HDF5 looks for it beside the clip output file
+    const char* pathEnd = strrchr(clipFileName, '/');
+    char clipName[32], clipPath[40];
+    snprintf(clipName, sizeof(clipName), "slice_%u", clipIndex);
+    snprintf(clipPath, sizeof(clipPath), "/%s", clipName);
+    const bool success = H5Lcreate_external(pathEnd ? pathEnd + 1 : clipFileName, clipPath, bandGroupID, clipName, H5P_DEFAULT, H5P_DEFAULT) >= 0;
+    if (!success)
+        fprintf(stderr, "Failed to link %s to %s\n", clipName, clipFileName);
+    free(clipFileName);
+    return success;
+}
+
+bool WriteClipResult(const unsigned int bandIndex, const char* filename, const ClipGridResult* clipResult){
+    /**
+    @brief Write clip result, with OUTPUT_LAYOUT=PER_CLIP every clip to its own file linked from the band group
+    @param bandIndex: the band index
+    @param filename: the name of the HDF5 file
+    @param clipResult: the clip result
+    @return true if successful, false otherwise
+    */
+    hid_t fileID = OpenClipOutputFile(bandIndex, filename);
+    if (fileID < 0) return false;
+
+    bool success = true;
+    const char* bandName = BAND_NAMES[bandIndex];
+    hid_t bandGroupID = H5Gcreate(fileID, ConstructPath((const char*[]){bandName}, 1), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+    if (bandGroupID < 0){
+        fprintf(stderr, "Failed to create group: %s\n", bandName);
+        H5Fclose(fileID);
+        return false;
+    }
+    if (g_config && g_config->output_layout == OUTPUT_LAYOUT_PER_CLIP){
+        // HDF5 serializes its calls, the clips are still expanded, encoded and compressed side by side
+        #pragma omp parallel for schedule(dynamic) reduction(&&:success)
+        for (unsigned int clipIndex = 0; clipIndex < clipResult->clipCount; clipIndex++)
+            success = WriteClipFile(bandIndex, filename, clipIndex, &clipResult->clipGrids[clipIndex]) && success;
+        for (unsigned int clipIndex = 0; clipIndex < clipResult->clipCount; clipIndex++)
+            success = LinkClipFile(bandGroupID, bandIndex, filename, clipIndex) && success;
+    }
+    else
+        for (unsigned int clipIndex = 0; clipIndex < clipResult->clipCount; clipIndex++)
+            success = WriteClipGroup(bandGroupID, clipIndex, &clipResult->clipGrids[clipIndex]) && success;
     H5Gclose(bandGroupID);
 
     if (bandIndex == 0 && !WriteGlobalAttribute(fileID, &clipResult->globalAttribute)){
@@ -818,6 +949,7 @@ bool ReadBatchScanLines(hsize_t startLine, hsize_t batchSize, const HDFBandRequi
     for (hsize_t i = 0; i < batchSize; i++) {
         hsize_t lineIdx = startLine + i;
         GridInfo* infoLine = (GridInfo*)malloc(SCAN_ANGLE_COUNT * sizeof(GridInfo));
+        infoArray[lineIdx] = infoLine;
         if (!infoLine) continue;
         
         for (int angleIndex = 0; angleIndex < SCAN_ANGLE_COUNT; angleIndex++) {
@@ -835,6 +967,7 @@ bool ReadBatchScanLines(hsize_t startLine, hsize_t batchSize, const HDFBandRequi
             infoLine[angleIndex].clutterFreeBottomIndex = binClutter_batch[base2D];
             infoLine[angleIndex].measuredArray = (float*)malloc(SCAN_HEIGHT_COUNT * sizeof(float));
             infoLine[angleIndex].heightArray = (float*)malloc(SCAN_HEIGHT_COUNT * sizeof(float));
+            infoLine[angleIndex].extraArray = required->extraCount ? (float*)malloc(required->extraCount * SCAN_HEIGHT_COUNT * sizeof(float)) : NULL;
             
             if (infoLine[angleIndex].measuredArray && infoLine[angleIndex].heightArray) {
                 memcpy(infoLine[angleIndex].measuredArray, &value_batch[base3D_500], 
@@ -845,6 +978,31 @@ bool ReadBatchScanLines(hsize_t startLine, hsize_t batchSize, const HDFBandRequi
         }
         infoArray[lineIdx] = infoLine;
     }
+
+    // the extra variables go one at a time through the value buffer, a value per ray is given to all its bins
+    bool success = true;
+    for (unsigned int v = 0; v < required->extraCount && success; v++) {
+        const bool perBin = required->extraRanks[v] == 3;
+        if (!ReadBatchDataset(required->extraIDs[v], required->extraRanks[v], perBin ? SCAN_HEIGHT_COUNT : 0, startLine, batchSize, perBin ? ctx->memspace3D_500 : ctx->memspace2D, value_batch)) {
+            fprintf(stderr, "Failed to read extra variable %u\n", v);
+            success = false;
+            break;
+        }
+        for (hsize_t i = 0; i < batchSize; i++) {
+            GridInfo* infoLine = infoArray[startLine + i];
+            if (!infoLine) continue;
+            for (int angleIndex = 0; angleIndex < SCAN_ANGLE_COUNT; angleIndex++) {
+                if (!infoLine[angleIndex].extraArray) continue;
+                const size_t base2D = i * SCAN_ANGLE_COUNT + angleIndex;
+                float* extra = infoLine[angleIndex].extraArray + (size_t)v * SCAN_HEIGHT_COUNT;
+                if (perBin)
+                    memcpy(extra, &value_batch[base2D * SCAN_HEIGHT_COUNT], SCAN_HEIGHT_COUNT * sizeof(float));
+                else
+                    for (int bin = 0; bin < SCAN_HEIGHT_COUNT; bin++)
+                        extra[bin] = value_batch[base2D];
+            }
+        }
+    }
     free(elevation_batch);
     free(latitude_batch);
     free(longitude_batch);
@@ -853,7 +1011,7 @@ bool ReadBatchScanLines(hsize_t startLine, hsize_t batchSize, const HDFBandRequi
     free(value_batch);
     free(binClutter_batch);
     free(height_batch);
-    return true;
+    return success;
 }
 
 char* ConstructOutputFilename(const char* filename, const char* suffix) {
@@ -885,6 +1043,10 @@ char* ConstructOutputFilename(const char* filename, const char* suffix) {
     return result;
 }
 
+static bool ParseBoolValue(const char* value){
+    return strcmp(value, "1") == 0 || strcmp(value, "true") == 0 || strcmp(value, "TRUE") == 0;
+}
+
 struct Config* ReadConfig(const char* filename){
     struct Config* config = (struct Config*)malloc(sizeof(struct Config));
     config->batch_size = DEFAULT_BATCH_SIZE;
@@ -898,15 +1060,52 @@ struct Config* ReadConfig(const char* filename){
     config->max_distance_tolerance = DEFAULT_MAX_DISTANCE_TOLERANCE;
     config->max_neighbor_distance = DEFAULT_MAX_NEIGHBOR_DISTANCE;
     config->min_neighbor_distance = DEFAULT_MIN_NEIGHBOR_DISTANCE;
+    config->vertical_scale = DEFAULT_VERTICAL_SCALE;
+    config->max_vertical_distance = DEFAULT_MAX_VERTICAL_DISTANCE;
+    config->max_longitude_width = DEFAULT_MAX_LONGITUDE_WIDTH;
+    config->resample_engine = DEFAULT_RESAMPLE_ENGINE;
+    config->scatter_radius = DEFAULT_SCATTER_RADIUS;
+    config->index_engine = DEFAULT_INDEX_ENGINE;
+    config->knn_leaf_size = DEFAULT_KNN_LEAF_SIZE;
+    config->shared_index = DEFAULT_SHARED_INDEX;
+    config->echo_top_cutoff = DEFAULT_ECHO_TOP_CUTOFF;
+    config->structured_cell_radius = DEFAULT_STRUCTURED_CELL_RADIUS;
+    config->structured_bin_radius = DEFAULT_STRUCTURED_BIN_RADIUS;
+    config->voxel_ring_count = DEFAULT_VOXEL_RING_COUNT;
+    config->query_order = DEFAULT_QUERY_ORDER;
+    config->query_chunk_size = DEFAULT_QUERY_CHUNK_SIZE;
+    config->idw_power = DEFAULT_IDW_POWER;
+    config->extra_variable_count = 0;
+    config->resample_plan_file[0] = '\0';
+    config->catalog_file[0] = '\0';
+    config->geodetic_output = DEFAULT_GEODETIC_OUTPUT;
+    config->geodetic_bin_begin = DEFAULT_GEODETIC_BIN_BEGIN;
+    config->geodetic_bin_end = DEFAULT_GEODETIC_BIN_END;
+    config->geodetic_line_block = DEFAULT_GEODETIC_LINE_BLOCK;
+    config->clip_storage = DEFAULT_CLIP_STORAGE;
+    config->output_compression = DEFAULT_OUTPUT_COMPRESSION;
+    config->output_chunk_size = DEFAULT_OUTPUT_CHUNK_SIZE;
+    config->output_deflate_level = DEFAULT_OUTPUT_DEFLATE_LEVEL;
+    config->output_encoding = DEFAULT_OUTPUT_ENCODING;
+    config->output_scale_factor = DEFAULT_OUTPUT_SCALE_FACTOR;
+    config->output_add_offset = DEFAULT_OUTPUT_ADD_OFFSET;
+    config->output_format = DEFAULT_OUTPUT_FORMAT;
+    config->output_layout = DEFAULT_OUTPUT_LAYOUT;
+    config->crop_empty_borders = DEFAULT_CROP_EMPTY_BORDERS;
+    config->derived_products = DEFAULT_DERIVED_PRODUCTS;
+    config->echo_top_threshold = DEFAULT_ECHO_TOP_THRESHOLD;
+    config->write_behind_depth = DEFAULT_WRITE_BEHIND_DEPTH;
+    config->write_threads = DEFAULT_WRITE_THREADS;
     
     FILE* file = fopen(filename, "r");
     if (!file) {
         fprintf(stderr, "Failed to open config file: %s\n", filename);
+        config->max_vertical_distance = config->height_gap * 2;
         return config;
     }
     
     char line[256];
-    char output_file_name[256];
+    char output_file_name[256] = "";
     
     while (fgets(line, sizeof(line), file)) {
         size_t len = strlen(line);
@@ -970,9 +1169,184 @@ struct Config* ReadConfig(const char* filename){
             float min_neighbor_distance = atof(value);
             if (min_neighbor_distance > 0)
                 config->min_neighbor_distance = min_neighbor_distance;
+        } else if (strcmp(key, "VERTICAL_SCALE") == 0) {
+            float vertical_scale = atof(value);
+            if (vertical_scale > 0)
+                config->vertical_scale = vertical_scale;
+        } else if (strcmp(key, "MAX_VERTICAL_DISTANCE") == 0) {
+            float max_vertical_distance = atof(value);
+            if (max_vertical_distance >= 0)
+                config->max_vertical_distance = max_vertical_distance;
+        } else if (strcmp(key, "RESAMPLE_ENGINE") == 0) {
+            if (strcmp(value, "POINT_CLOUD") == 0)
+                config->resample_engine = RESAMPLE_ENGINE_POINT_CLOUD;
+            else if (strcmp(value, "SEPARABLE") == 0)
+                config->resample_engine = RESAMPLE_ENGINE_SEPARABLE;
+            else if (strcmp(value, "SCATTER") == 0)
+                config->resample_engine = RESAMPLE_ENGINE_SCATTER;
+            else
+                fprintf(stderr, "Unknown RESAMPLE_ENGINE: %s, use default\n", value);
+        } else if (strcmp(key, "SCATTER_RADIUS") == 0) {
+            float scatter_radius = atof(value);
+            if (scatter_radius >= 0)
+                config->scatter_radius = scatter_radius;
+        } else if (strcmp(key, "INDEX_ENGINE") == 0) {
+            if (strcmp(value, "RSTAR") == 0)
+                config->index_engine = INDEX_ENGINE_RSTAR;
+            else if (strcmp(value, "KNN") == 0)
+                config->index_engine = INDEX_ENGINE_KNN;
+            else if (strcmp(value, "STRUCTURED") == 0)
+                config->index_engine = INDEX_ENGINE_STRUCTURED;
+            else if (strcmp(value, "VOXEL") == 0)
+                config->index_engine = INDEX_ENGINE_VOXEL;
+            else
+                fprintf(stderr, "Unknown INDEX_ENGINE: %s, use default\n", value);
+        } else if (strcmp(key, "KNN_LEAF_SIZE") == 0) {
+            int knn_leaf_size = atoi(value);
+            if (knn_leaf_size > 0)
+                config->knn_leaf_size = knn_leaf_size;
+        } else if (strcmp(key, "SHARED_INDEX") == 0) {
+            config->shared_index = ParseBoolValue(value);
+        } else if (strcmp(key, "ECHO_TOP_CUTOFF") == 0) {
+            config->echo_top_cutoff = ParseBoolValue(value);
+        } else if (strcmp(key, "STRUCTURED_CELL_RADIUS") == 0) {
+            int structured_cell_radius = atoi(value);
+            if (structured_cell_radius >= 0)
+                config->structured_cell_radius = structured_cell_radius;
+        } else if (strcmp(key, "STRUCTURED_BIN_RADIUS") == 0) {
+            int structured_bin_radius = atoi(value);
+            if (structured_bin_radius > 0)
+                config->structured_bin_radius = structured_bin_radius;
+        } else if (strcmp(key, "VOXEL_RING_COUNT") == 0) {
+            int voxel_ring_count = atoi(value);
+            if (voxel_ring_count > 0)
+                config->voxel_ring_count = voxel_ring_count;
+        } else if (strcmp(key, "QUERY_ORDER") == 0) {
+            if (strcmp(value, "LATTICE") == 0)
+                config->query_order = QUERY_ORDER_LATTICE;
+            else if (strcmp(value, "MORTON") == 0)
+                config->query_order = QUERY_ORDER_MORTON;
+            else
+                fprintf(stderr, "Unknown QUERY_ORDER: %s, use default\n", value);
+        } else if (strcmp(key, "QUERY_CHUNK_SIZE") == 0) {
+            int query_chunk_size = atoi(value);
+            if (query_chunk_size > 0)
+                config->query_chunk_size = query_chunk_size;
+        } else if (strcmp(key, "IDW_POWER") == 0) {
+            float idw_power = atof(value);
+            if (idw_power > 0)
+                config->idw_power = idw_power;
+        } else if (strcmp(key, "EXTRA_VARIABLES") == 0) {
+            // comma separated dataset names of the PRE group, e.g. zFactorCorrected,precipRate
+            config->extra_variable_count = 0;
+            for (char* name = strtok(value, ", "); name; name = strtok(NULL, ", ")) {
+                if (config->extra_variable_count == MAX_EXTRA_VARIABLE_COUNT || strlen(name) >= MAX_VARIABLE_NAME_LENGTH) {
+                    fprintf(stderr, "Skip extra variable: %s, at most %d names of %d characters\n", name, MAX_EXTRA_VARIABLE_COUNT, MAX_VARIABLE_NAME_LENGTH - 1);
+                    continue;
+                }
+                strcpy(config->extra_variables[config->extra_variable_count++], name);
+            }
+        } else if (strcmp(key, "CLIP_STORAGE") == 0) {
+            if (strcmp(value, "DENSE") == 0)
+                config->clip_storage = CLIP_STORAGE_DENSE;
+            else if (strcmp(value, "SPARSE") == 0)
+                config->clip_storage = CLIP_STORAGE_SPARSE;
+            else
+                fprintf(stderr, "Unknown CLIP_STORAGE: %s, use default\n", value);
+        } else if (strcmp(key, "OUTPUT_COMPRESSION") == 0) {
+            if (strcmp(value, "NONE") == 0)
+                config->output_compression = OUTPUT_COMPRESSION_NONE;
+            else if (strcmp(value, "DEFLATE") == 0)
+                config->output_compression = OUTPUT_COMPRESSION_DEFLATE;
+            else
+                fprintf(stderr, "Unknown OUTPUT_COMPRESSION: %s, use default\n", value);
+        } else if (strcmp(key, "OUTPUT_CHUNK_SIZE") == 0) {
+            int output_chunk_size = atoi(value);
+            if (output_chunk_size >= 0)
+                config->output_chunk_size = output_chunk_size;
+        } else if (strcmp(key, "OUTPUT_DEFLATE_LEVEL") == 0) {
+            int output_deflate_level = atoi(value);
+            if (output_deflate_level >= 1 && output_deflate_level <= 9)
+                config->output_deflate_level = output_deflate_level;
+        } else if (strcmp(key, "OUTPUT_ENCODING") == 0) {
+            if (strcmp(value, "FLOAT32") == 0)
+                config->output_encoding = OUTPUT_ENCODING_FLOAT32;
+            else if (strcmp(value, "INT16") == 0)
+                config->output_encoding = OUTPUT_ENCODING_INT16;
+            else if (strcmp(value, "FLOAT16") == 0)
+                config->output_encoding = OUTPUT_ENCODING_FLOAT16;
+            else
+                fprintf(stderr, "Unknown OUTPUT_ENCODING: %s, use default\n", value);
+        } else if (strcmp(key, "OUTPUT_SCALE_FACTOR") == 0) {
+            float output_scale_factor = atof(value);
+            if (output_scale_factor > 0)
+                config->output_scale_factor = output_scale_factor;
+        } else if (strcmp(key, "OUTPUT_ADD_OFFSET") == 0) {
+            config->output_add_offset = atof(value);
+        } else if (strcmp(key, "OUTPUT_FORMAT") == 0) {
+            if (strcmp(value, "HDF5") == 0)
+                config->output_format = OUTPUT_FORMAT_HDF5;
+            else if (strcmp(value, "FLAT") == 0)
+                config->output_format = OUTPUT_FORMAT_FLAT;
+            else
+                fprintf(stderr, "Unknown OUTPUT_FORMAT: %s, use default\n", value);
+        } else if (strcmp(key, "OUTPUT_LAYOUT") == 0) {
+            if (strcmp(value, "SINGLE") == 0)
+                config->output_layout = OUTPUT_LAYOUT_SINGLE;
+            else if (strcmp(value, "PER_CLIP") == 0)
+                config->output_layout = OUTPUT_LAYOUT_PER_CLIP;
+            else
+                fprintf(stderr, "Unknown OUTPUT_LAYOUT: %s, use default\n", value);
+        } else if (strcmp(key, "CROP_EMPTY_BORDERS") == 0) {
+            config->crop_empty_borders = ParseBoolValue(value);
+        } else if (strcmp(key, "DERIVED_PRODUCTS") == 0) {
+            // comma separated, e.g. COMPOSITE,ECHO_TOP,VIL
+            config->derived_products = 0;
+            for (char* name = strtok(value, ", "); name; name = strtok(NULL, ", ")) {
+                if (strcmp(name, "COMPOSITE") == 0)
+                    config->derived_products |= DERIVED_PRODUCT_COMPOSITE;
+                else if (strcmp(name, "ECHO_TOP") == 0)
+                    config->derived_products |= DERIVED_PRODUCT_ECHO_TOP;
+                else if (strcmp(name, "VIL") == 0)
+                    config->derived_products |= DERIVED_PRODUCT_VIL;
+                else if (strcmp(name, "NONE") != 0)
+                    fprintf(stderr, "Unknown derived product: %s, skip\n", name);
+            }
+        } else if (strcmp(key, "ECHO_TOP_THRESHOLD") == 0) {
+            config->echo_top_threshold = atof(value);
+        } else if (strcmp(key, "WRITE_BEHIND_DEPTH") == 0) {
+            int write_behind_depth = atoi(value);
+            if (write_behind_depth >= 0)
+                config->write_behind_depth = write_behind_depth;
+        } else if (strcmp(key, "WRITE_THREADS") == 0) {
+            int write_threads = atoi(value);
+            if (write_threads > 0)
+                config->write_threads = write_threads;
+        } else if (strcmp(key, "RESAMPLE_PLAN_FILE") == 0) {
+            strncpy(config->resample_plan_file, value, sizeof(config->resample_plan_file) - 1);
+            config->resample_plan_file[sizeof(config->resample_plan_file) - 1] = '\0';
+        } else if (strcmp(key, "CATALOG_FILE") == 0) {
+            strncpy(config->catalog_file, value, sizeof(config->catalog_file) - 1);
+            config->catalog_file[sizeof(config->catalog_file) - 1] = '\0';
+        } else if (strcmp(key, "GEODETIC_OUTPUT") == 0) {
+            config->geodetic_output = ParseBoolValue(value);
+        } else if (strcmp(key, "GEODETIC_BIN_BEGIN") == 0) {
+            int geodetic_bin_begin = atoi(value);
+            if (geodetic_bin_begin >= 0)
+                config->geodetic_bin_begin = geodetic_bin_begin;
+        } else if (strcmp(key, "GEODETIC_BIN_END") == 0) {
+            int geodetic_bin_end = atoi(value);
+            if (geodetic_bin_end >= 0)
+                config->geodetic_bin_end = geodetic_bin_end;
+        } else if (strcmp(key, "GEODETIC_LINE_BLOCK") == 0) {
+            int geodetic_line_block = atoi(value);
+            if (geodetic_line_block > 0)
+                config->geodetic_line_block = geodetic_line_block;
         }
     }
     config->maximal_height = config->minimal_height + config->height_count * config->height_gap;
+    if (config->max_vertical_distance < 0)
+        config->max_vertical_distance = config->height_gap * 2;
     
     strncpy(config->geo_output_file_name, ConstructOutputFilename(output_file_name, "_geo"), 
              sizeof(config->geo_output_file_name) - 1);
@@ -165,7 +165,13 @@ bool InitClipGridArray(const HDFDataset* dataset, int gridSize, int initHeight,
     float globalMaxLatitude, globalMinLatitude, globalMaxLongitude, globalMinLongitude; // longitude is wrapped
     GetGeodeticRange(dataset->infoArray, lineCount, &globalMaxLatitude, &globalMinLatitude, &globalMaxLongitude, &globalMinLongitude);
     finalGrid->clipCount = ceil((globalMaxLatitude - globalMinLatitude) / DEFAULT_MAX_LONGITUDE_WIDTH);
-    finalGrid->clipGrids = (ClipGrid*)malloc(finalGrid->clipCount * sizeof(ClipGrid));
+    // zeroed, so the clips not reached by a failure below hold no cells for DestroyClipGridResult
+    finalGrid->clipGrids = (ClipGrid*)calloc(finalGrid->clipCount, sizeof(ClipGrid));
+    if (!finalGrid->clipGrids){
+        fprintf(stderr, "Failed to allocate memory for %u clips\n", finalGrid->clipCount);
+        finalGrid->clipCount = 0;
+        return false;
+    }
     const float realClipLatitudeGap = (globalMaxLatitude - globalMinLatitude) / finalGrid->clipCount;
     const float realClipLatitudeCount = ceil(realClipLatitudeGap / latitudeGap);
     float minClipLongitude = globalMinLongitude;
@@ -183,11 +189,31 @@ bool InitClipGridArray(const HDFDataset* dataset, int gridSize, int initHeight,
         clipGrid->longitudeGap = (float)gridSize * 180.0f / (M_PI * WGS84_A * cos(ToRadians(centerClipLatitude)));
         minClipLongitude = QueryBoundingBox(clipGrid, dataset->infoArray, lineCount);
         clipGrid->longitudeCount = ceil((clipGrid->maxLongitude - clipGrid->minLongitude) / clipGrid->longitudeGap);
-        clipGrid->value = (float*)malloc(clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float));
+        clipGrid->extraCount = 0; // see InitClipGridExtra
+        clipGrid->extraValue = NULL;
+        clipGrid->sparse = NULL;
+        clipGrid->products = NULL;
+        clipGrid->cropped = false; // see FindClipValidBox
+        clipGrid->statistics = NULL;
+        // the write-behind queue holds a few clips at once, their cells are allocated as they are interpolated
+        const bool deferred = g_config && g_config->write_behind_depth > 0;
+        clipGrid->value = NULL;
+        if (!deferred && !AllocateClipGridCells(clipGrid, g_config && g_config->clip_storage == CLIP_STORAGE_SPARSE)){
+            fprintf(stderr, "Failed to allocate the cells of clip %u\n", clipIndex);
+            return false;
+        }
     }
     return true;
 }
 
+static inline double InverseDistanceWeight(const double distance, const float power){
+    // the common powers avoid pow()
+    if (power == 2.0f) return 1.0 / (distance * distance);
+    if (power == 1.0f) return 1.0 / distance;
+    if (power == 3.0f) return 1.0 / (distance * distance * distance);
+    return 1.0 / pow(distance, power);
+}
+
 double InterpolateValueIDW(const double queryPoint[3], const float queryHeight, const SpatialQueryResult* result, const float* valueArray, float power) {
     /**
      * @brief Calculate IDW (Inverse Distance Weighting) interpolated value
@@ -212,11 +238,12 @@ double InterpolateValueIDW(const double queryPoint[3], const float queryHeight,
             continue;
         }
         RStarPoint* point = &result->points[i];
-        if (point->h == -1 || fabs(point->h - queryHeight) > g_config->height_gap * 2) continue; // skip invalid height points
+        if (point->h == -1) continue; // skip invalid height points
+        if (g_config->max_vertical_distance > 0 && fabs(point->h - queryHeight) > g_config->max_vertical_distance) continue; // skip points too far in height
         double distance = sqrt((queryPoint[0] - point->x) * (queryPoint[0] - point->x) + (queryPoint[1] - point->y) * (queryPoint[1] - point->y) + (queryPoint[2] - point->z) * (queryPoint[2] - point->z));
         if (distance > g_config->max_neighbor_distance) continue; // skip points too far away
         if (distance < g_config->min_neighbor_distance) return valueArray[pointId]; // return exact value
-        double weight = 1.0 / pow(distance, power);
+        double weight = InverseDistanceWeight(distance, power);
         weightSum += weight;
         valueSum += weight * valueArray[pointId];
         validCount++;
@@ -231,10 +258,236 @@ double InterpolateValueIDW_v(const unsigned int neightborCount, const double* di
     for (unsigned int i = 0; i < neightborCount; i++){
         if (distances[i] > g_config->max_neighbor_distance) continue; // skip points too far away
         if (distances[i] < g_config->min_neighbor_distance) return valueArray[ids[i]]; // return exact value
-        double weight = 1.0 / pow(distances[i], power);
+        double weight = InverseDistanceWeight(distances[i], power);
         weightSum += weight;
         valueSum += weight * valueArray[ids[i]];
     }
     if (weightSum == 0.0) return -999;
     return (valueSum / weightSum);
-}
\ No newline at end of file
+}
+static inline float InverseDistanceWeightOf(const float distance, const int exponent, const float power){
+    // exponent is a constant in every caller, so each kernel keeps only its own branch
+    switch (exponent){
+        case 1: return 1.0f / distance;
+        case 2: return 1.0f / (distance * distance);
+        case 3: return 1.0f / (distance * distance * distance);
+        default: return powf(distance, -power);
+    }
+}
+
+static inline void InterpolateIDWBlock(const unsigned int queryCount, const unsigned int k, const unsigned int stride, const float* distances, const float* values, const int exponent, const float power, float* results){
+    /**
+     * @brief IDW of a block of queries in SoA form, vectorized across the queries for every neighbor slot
+     * @param queryCount: the number of queries, at most IDW_BATCH_BLOCK
+     * @param k: the number of neighbor slots
+     * @param stride: the distance between two neighbor slots in distances and values
+     * @param distances: neighbor distances [k][stride], empty slots are INFINITY
+     * @param values: neighbor values [k][stride]
+     * @param exponent: 1, 2 or 3 for the specialized weights, 0 for powf
+     * @param power: the IDW power, only used by the generic weight
+     * @param results: output values [queryCount], -999 when no neighbor is within the max neighbor distance
+     */
+    const float minDistance = g_config->min_neighbor_distance, maxDistance = g_config->max_neighbor_distance;
+    float weightSum[IDW_BATCH_BLOCK], valueSum[IDW_BATCH_BLOCK], exactValue[IDW_BATCH_BLOCK];
+    int hasExact[IDW_BATCH_BLOCK];
+    for (unsigned int i = 0; i < queryCount; i++){
+        weightSum[i] = valueSum[i] = exactValue[i] = 0.0f;
+        hasExact[i] = 0;
+    }
+    for (unsigned int j = 0; j < k; j++){
+        const float* distance = distances + (size_t)j * stride;
+        const float* value = values + (size_t)j * stride;
+        #pragma omp simd
+        for (unsigned int i = 0; i < queryCount; i++){
+            // branch free, the weight of an empty slot is 1 / INFINITY = 0 anyway
+            const float inverse = InverseDistanceWeightOf(distance[i], exponent, power);
+            const float weight = distance[i] <= maxDistance ? inverse : 0.0f;
+            weightSum[i] += weight;
+            valueSum[i] += weight * value[i];
+            // the nearest neighbor closer than the min distance gives the exact value, as InterpolateValueIDW_v returns at the first one
+            const int isExact = (distance[i] < minDistance) & (hasExact[i] == 0);
+            exactValue[i] = isExact ? value[i] : exactValue[i];
+            hasExact[i] |= isExact;
+        }
+    }
+    #pragma omp simd
+    for (unsigned int i = 0; i < queryCount; i++)
+        results[i] = hasExact[i] ? exactValue[i] : (weightSum[i] > 0.0f ? valueSum[i] / weightSum[i] : -999.0f);
+}
+
+static inline void InterpolateIDWBatch(const unsigned int queryCount, const unsigned int k, const unsigned int stride, const float* distances, const float* values, const int exponent, const float power, float* results){
+    for (unsigned int start = 0; start < queryCount; start += IDW_BATCH_BLOCK){
+        const unsigned int count = queryCount - start < IDW_BATCH_BLOCK ? queryCount - start : IDW_BATCH_BLOCK;
+        InterpolateIDWBlock(count, k, stride, distances + start, values + start, exponent, power, results + start);
+    }
+}
+
+static void InterpolateIDWBatchPower1(const unsigned int queryCount, const unsigned int k, const unsigned int stride, const float* distances, const float* values, const float power, float* results){InterpolateIDWBatch(queryCount, k, stride, distances, values, 1, power, results);}
+static void InterpolateIDWBatchPower2(const unsigned int queryCount, const unsigned int k, const unsigned int stride, const float* distances, const float* values, const float power, float* results){InterpolateIDWBatch(queryCount, k, stride, distances, values, 2, power, results);}
+static void InterpolateIDWBatchPower3(const unsigned int queryCount, const unsigned int k, const unsigned int stride, const float* distances, const float* values, const float power, float* results){InterpolateIDWBatch(queryCount, k, stride, distances, values, 3, power, results);}
+static void InterpolateIDWBatchGeneric(const unsigned int queryCount, const unsigned int k, const unsigned int stride, const float* distances, const float* values, const float power, float* results){InterpolateIDWBatch(queryCount, k, stride, distances, values, 0, power, results);}
+
+IDWBatchKernel SelectIDWBatchKernel(const float power){
+    /**
+     * @brief Select the batch IDW kernel of a power once, the powers 1, 2 and 3 have kernels without powf
+     * @param power: the IDW power
+     * @return the kernel, it is called with the same power
+     */
+    if (power == 1.0f) return InterpolateIDWBatchPower1;
+    if (power == 2.0f) return InterpolateIDWBatchPower2;
+    if (power == 3.0f) return InterpolateIDWBatchPower3;
+    return InterpolateIDWBatchGeneric;
+}
+
+void InterpolateValueIDWBatch(const IDWBatchKernel kernel, const float power, const unsigned int queryCount, const unsigned int k, const uint64_t* counts, const double* distances, const int64_t* ids, const float* valueArray,
+                              const float* heightArray, const double* queryGeodetic, float* neighborDistances, float* neighborValues, float* results){
+    /**
+     * @brief Batch version of InterpolateValueIDW_v, the packed results are unpacked block by block into SoA form for the kernel
+     * @param kernel: the kernel of the power, see SelectIDWBatchKernel
+     * @param power: the IDW power
+     * @param queryCount: the number of queries
+     * @param k: the max number of neighbors of a query
+     * @param counts: the neighbor count of each query
+     * @param distances: the packed neighbor distances, as Index_NearestNeighbors_id_v
+     * @param ids: the packed neighbor ids
+     * @param valueArray: the values of the points
+     * @param heightArray: the heights of the points, neighbors further than the max vertical distance from the query are dropped, can be NULL
+     * @param queryGeodetic: latitude, longitude and height of the queries [queryCount][3], only read with heightArray
+     * @param neighborDistances: buffer of [k][IDW_BATCH_BLOCK] floats, small enough to stay in cache between the unpacking and the kernel
+     * @param neighborValues: buffer of [k][IDW_BATCH_BLOCK] floats
+     * @param results: output values [queryCount], -999 when no neighbor is within the max neighbor distance
+     */
+    const float maxVerticalDistance = heightArray && queryGeodetic ? g_config->max_vertical_distance : 0.0f;
+    size_t offset = 0;
+    for (unsigned int start = 0; start < queryCount; start += IDW_BATCH_BLOCK){
+        const unsigned int count = queryCount - start < IDW_BATCH_BLOCK ? queryCount - start : IDW_BATCH_BLOCK;
+        for (unsigned int i = 0; i < count; i++){
+            const unsigned int neighborCount = counts[start + i];
+            for (unsigned int j = 0; j < k; j++){
+                neighborDistances[j * IDW_BATCH_BLOCK + i] = j < neighborCount ? (float)distances[offset + j] : INFINITY;
+                neighborValues[j * IDW_BATCH_BLOCK + i] = j < neighborCount ? valueArray[ids[offset + j]] : 0.0f;
+            }
+            // a neighbor too far in height becomes an empty slot, as InterpolateValueIDW skips it
+            if (maxVerticalDistance > 0){
+                const float queryHeight = (float)queryGeodetic[(size_t)(start + i) * 3 + 2];
+                for (unsigned int j = 0; j < neighborCount && j < k; j++)
+                    if (fabsf(heightArray[ids[offset + j]] - queryHeight) > maxVerticalDistance)
+                        neighborDistances[j * IDW_BATCH_BLOCK + i] = INFINITY;
+            }
+            offset += neighborCount;
+        }
+        kernel(count, k, IDW_BATCH_BLOCK, neighborDistances, neighborValues, power, results + start);
+    }
+}
+
+size_t CalculateIDWWeightsBatch(const float power, const unsigned int queryCount, const unsigned int k, const uint64_t* counts, const double* distances, const int64_t* ids,
+                                const float* heightArray, const double* queryGeodetic, const unsigned int stride, float* weights, int64_t* weightIds){
+    /**
+     * @brief The weights the batch IDW gives the neighbor slots of each query, to apply them to several value arrays or to keep them
+     * @param power: the IDW power
+     * @param queryCount: the number of queries, at most stride
+     * @param k: the max number of neighbors of a query
+     * @param counts: the neighbor count of each query
+     * @param distances: the packed neighbor distances, as Index_NearestNeighbors_id_v
+     * @param ids: the packed neighbor ids
+     * @param heightArray: the heights of the points, neighbors further than the max vertical distance from the query get no weight, can be NULL
+     * @param queryGeodetic: latitude, longitude and height of the queries [queryCount][3], only read with heightArray
+     * @param stride: the distance between two neighbor slots in weights and weightIds
+     * @param weights: output weights [k][stride], 0 for empty and dropped slots, the nearest slot closer than the min neighbor distance alone has weight 1 when there is one
+     * @param weightIds: output point ids [k][stride], a valid id for every slot
+     * @return the number of packed results consumed
+     */
+    const float maxVerticalDistance = heightArray && queryGeodetic ? g_config->max_vertical_distance : 0.0f;
+    const float minDistance = g_config->min_neighbor_distance, maxDistance = g_config->max_neighbor_distance;
+    const int exponent = power == 1.0f ? 1 : power == 2.0f ? 2 : power == 3.0f ? 3 : 0;
+    size_t offset = 0;
+    for (unsigned int i = 0; i < queryCount; i++){
+        const unsigned int neighborCount = counts[i];
+        const float queryHeight = maxVerticalDistance > 0 ? (float)queryGeodetic[(size_t)i * 3 + 2] : 0.0f;
+        int exact = -1;
+        for (unsigned int j = 0; j < k; j++){
+            float weight = 0.0f;
+            int64_t id = 0; // an empty slot keeps a zero weight on a valid id
+            if (j < neighborCount){
+                const float distance = (float)distances[offset + j];
+                id = ids[offset + j];
+                if (maxVerticalDistance <= 0 || fabsf(heightArray[id] - queryHeight) <= maxVerticalDistance){
+                    if (exact < 0 && distance < minDistance) exact = j;
+                    weight = distance <= maxDistance ? InverseDistanceWeightOf(distance, exponent, power) : 0.0f;
+                }
+            }
+            weights[(size_t)j * stride + i] = weight;
+            weightIds[(size_t)j * stride + i] = id;
+        }
+        // the nearest neighbor closer than the min distance gives the exact value, as the single variable kernels
+        if (exact >= 0)
+            for (unsigned int j = 0; j < k; j++)
+                weights[(size_t)j * stride + i] = j == (unsigned int)exact ? 1.0f : 0.0f;
+        offset += neighborCount;
+    }
+    return offset;
+}
+
+void InterpolateValuesIDWBatch(const float power, const unsigned int queryCount, const unsigned int k, const uint64_t* counts, const double* distances, const int64_t* ids,
+                               const unsigned int variableCount, const float* const* valueArrays, const float* heightArray, const double* queryGeodetic,
+                               float* neighborWeights, int64_t* neighborIds, float* results){
+    /**
+     * @brief Multi variable version of InterpolateValueIDWBatch, the weights of a block are computed once and applied to every value array
+     * @param power: the IDW power
+     * @param queryCount: the number of queries
+     * @param k: the max number of neighbors of a query
+     * @param counts: the neighbor count of each query
+     * @param distances: the packed neighbor distances, as Index_NearestNeighbors_id_v
+     * @param ids: the packed neighbor ids
+     * @param variableCount: the number of value arrays
+     * @param valueArrays: the values of the points of each variable, a neighbor at or below -999 is skipped for that variable only
+     * @param heightArray: the heights of the points, neighbors further than the max vertical distance from the query are dropped, can be NULL
+     * @param queryGeodetic: latitude, longitude and height of the queries [queryCount][3], only read with heightArray
+     * @param neighborWeights: buffer of [k][IDW_BATCH_BLOCK] floats
+     * @param neighborIds: buffer of [k][IDW_BATCH_BLOCK] ids
+     * @param results: output values [variableCount][queryCount], -999 when no neighbor has a value
+     */
+    float weightSum[IDW_BATCH_BLOCK], valueSum[IDW_BATCH_BLOCK];
+    size_t offset = 0;
+    for (unsigned int start = 0; start < queryCount; start += IDW_BATCH_BLOCK){
+        const unsigned int count = queryCount - start < IDW_BATCH_BLOCK ? queryCount - start : IDW_BATCH_BLOCK;
+        offset += CalculateIDWWeightsBatch(power, count, k, counts + start, distances + offset, ids + offset, heightArray, queryGeodetic ? queryGeodetic + (size_t)start * 3 : NULL,
+                                           IDW_BATCH_BLOCK, neighborWeights, neighborIds);
+        for (unsigned int v = 0; v < variableCount; v++){
+            const float* valueArray = valueArrays[v];
+            for (unsigned int i = 0; i < count; i++)
+                weightSum[i] = valueSum[i] = 0.0f;
+            for (unsigned int j = 0; j < k; j++){
+                const float* weight = neighborWeights + (size_t)j * IDW_BATCH_BLOCK;
+                const int64_t* id = neighborIds + (size_t)j * IDW_BATCH_BLOCK;
+                for (unsigned int i = 0; i < count; i++){
+                    const float value = valueArray[id[i]];
+                    const float w = value > -999 ? weight[i] : 0.0f;
+                    weightSum[i] += w;
+                    valueSum[i] += w * (value > -999 ? value : 0.0f);
+                }
+            }
+            float* result = results + (size_t)v * queryCount + start;
+            for (unsigned int i = 0; i < count; i++)
+                result[i] = weightSum[i] > 0.0f ? valueSum[i] / weightSum[i] : -999.0f;
+        }
+    }
+}
+
+void CalculateIDWWeights(const unsigned int neighborCount, const double* distances, const float power, double* weights){
+    /**
+     * @brief The weights InterpolateValueIDW_v gives its neighbors, to apply them to several value arrays
+     * @param neighborCount: the number of neighbors
+     * @param distances: the neighbor distances, ascending
+     * @param power: the IDW power
+     * @param weights: output weights [neighborCount], 0 beyond the max neighbor distance, only the first neighbor closer than the min distance is weighted when there is one
+     */
+    for (unsigned int i = 0; i < neighborCount; i++){
+        if (distances[i] < g_config->min_neighbor_distance){
+            for (unsigned int j = 0; j < neighborCount; j++)
+                weights[j] = j == i ? 1.0 : 0.0;
+            return;
+        }
+        weights[i] = distances[i] > g_config->max_neighbor_distance ? 0.0 : InverseDistanceWeight(distances[i], power);
+    }
+}
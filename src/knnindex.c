@@ -0,0 +1,290 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "knnindex.h"
+
+static void SwapKNNPoint(StaticKNNIndex* index, const long a, const long b){
+    float tx = index->x[a], ty = index->y[a], tz = index->z[a];
+    uint32_t tid = index->ids[a];
+    index->x[a] = index->x[b]; index->y[a] = index->y[b]; index->z[a] = index->z[b]; index->ids[a] = index->ids[b];
+    index->x[b] = tx; index->y[b] = ty; index->z[b] = tz; index->ids[b] = tid;
+}
+
+static void SelectKNNMedian(StaticKNNIndex* index, const float* axis, long left, long right, const long nth){
+    /**
+    @brief Partially sort [left, right] so that the nth point is in place along the given axis (quickselect)
+    @param index: the index whose point arrays are permuted together
+    @param axis: the coordinate array to select on (one of x, y, z)
+    @param left: the first point of the range
+    @param right: the last point of the range (inclusive)
+    @param nth: the position to place
+    */
+    while (right > left){
+        const float pivot = axis[left + (right - left) / 2];
+        long i = left, j = right;
+        while (i <= j){
+            while (axis[i] < pivot) i++;
+            while (axis[j] > pivot) j--;
+            if (i <= j){
+                SwapKNNPoint(index, i, j);
+                i++;
+                j--;
+            }
+        }
+        if (nth <= j) right = j;
+        else if (nth >= i) left = i;
+        else break;
+    }
+}
+
+static unsigned int AppendKNNNode(StaticKNNIndex* index){
+    if (index->nodeCount >= index->nodeCapacity){
+        const unsigned int capacity = index->nodeCapacity * 2;
+        KNNNode* nodes = (KNNNode*)realloc(index->nodes, capacity * sizeof(KNNNode));
+        if (!nodes) return 0;
+        index->nodes = nodes;
+        index->nodeCapacity = capacity;
+    }
+    return index->nodeCount++;
+}
+
+static bool BuildKNNNode(StaticKNNIndex* index, const unsigned int nodeIndex, const unsigned int start, const unsigned int count){
+    /**
+    @brief Build the subtree of a node by median split on the widest axis
+    @param index: the index to build
+    @param nodeIndex: the node to fill, already appended
+    @param start: the first point of the node
+    @param count: the point count of the node
+    @return true if successful, false otherwise
+    */
+    float min[3] = {FLT_MAX, FLT_MAX, FLT_MAX}, max[3] = {-FLT_MAX, -FLT_MAX, -FLT_MAX};
+    for (unsigned int i = start; i < start + count; i++){
+        min[0] = MinFloat(min[0], index->x[i]); max[0] = MaxFloat(max[0], index->x[i]);
+        min[1] = MinFloat(min[1], index->y[i]); max[1] = MaxFloat(max[1], index->y[i]);
+        min[2] = MinFloat(min[2], index->z[i]); max[2] = MaxFloat(max[2], index->z[i]);
+    }
+    KNNNode* node = &index->nodes[nodeIndex];
+    memcpy(node->min, min, sizeof(min));
+    memcpy(node->max, max, sizeof(max));
+    node->start = start;
+    node->count = count;
+    node->left = node->right = 0;
+    if (count <= index->leafSize)
+        return true;
+
+    unsigned int splitDim = 0;
+    for (unsigned int d = 1; d < 3; d++)
+        if (max[d] - min[d] > max[splitDim] - min[splitDim])
+            splitDim = d;
+    const float* axis = splitDim == 0 ? index->x : (splitDim == 1 ? index->y : index->z);
+    const unsigned int half = count / 2;
+    SelectKNNMedian(index, axis, start, start + count - 1, start + half);
+
+    const unsigned int left = AppendKNNNode(index);
+    const unsigned int right = AppendKNNNode(index);
+    if (!left || !right) return false;
+    index->nodes[nodeIndex].left = left; // nodes may have been reallocated
+    index->nodes[nodeIndex].right = right;
+    return BuildKNNNode(index, left, start, half) && BuildKNNNode(index, right, start + half, count - half);
+}
+
+static StaticKNNIndex* AllocateStaticKNNIndex(const unsigned int pointCount, const unsigned int leafSize, const double min[3], const double max[3]){
+    /**
+    @brief Allocate the arrays of a KNN index, the origin is the center of the bounding box
+    @param pointCount: the number of points to index
+    @param leafSize: the maximum point count of a leaf
+    @param min: the minimum corner of the points
+    @param max: the maximum corner of the points
+    @return the KNN index with empty arrays, NULL if failed
+    */
+    StaticKNNIndex* index = (StaticKNNIndex*)calloc(1, sizeof(StaticKNNIndex));
+    if (!index){
+        fprintf(stderr, "Failed to allocate memory for StaticKNNIndex\n");
+        return NULL;
+    }
+    index->leafSize = leafSize < 4 ? 4 : (leafSize > KNN_MAX_LEAF_SIZE ? KNN_MAX_LEAF_SIZE : leafSize);
+    index->pointCount = pointCount;
+    index->nodeCapacity = 2 * (pointCount / index->leafSize) + 16;
+    index->x = (float*)malloc(pointCount * sizeof(float));
+    index->y = (float*)malloc(pointCount * sizeof(float));
+    index->z = (float*)malloc(pointCount * sizeof(float));
+    index->ids = (uint32_t*)malloc(pointCount * sizeof(uint32_t));
+    index->nodes = (KNNNode*)malloc(index->nodeCapacity * sizeof(KNNNode));
+    if (!index->x || !index->y || !index->z || !index->ids || !index->nodes){
+        fprintf(stderr, "Failed to allocate arrays for KNN index\n");
+        DestroyStaticKNNIndex(index);
+        return NULL;
+    }
+    for (unsigned int d = 0; d < 3; d++)
+        index->origin[d] = (min[d] + max[d]) / 2;
+    return index;
+}
+
+static StaticKNNIndex* BuildStaticKNNIndex(StaticKNNIndex* index){
+    /**
+    @brief Build the nodes over the filled point arrays and release the unused node capacity
+    @param index: the allocated index, destroyed if the build fails
+    @return the index, NULL if failed
+    */
+    index->nodeCount = 1;
+    if (!BuildKNNNode(index, 0, 0, index->pointCount)){
+        fprintf(stderr, "Failed to build KNN index nodes\n");
+        DestroyStaticKNNIndex(index);
+        return NULL;
+    }
+    KNNNode* nodes = (KNNNode*)realloc(index->nodes, index->nodeCount * sizeof(KNNNode));
+    if (nodes){
+        index->nodes = nodes;
+        index->nodeCapacity = index->nodeCount;
+    }
+    return index;
+}
+
+StaticKNNIndex* CreateStaticKNNIndex(const RStarPoint* points, const unsigned int startIndex, const unsigned int endIndex, const unsigned int leafSize){
+    /**
+    @brief Create an immutable KNN index over the valid points of a point batch range
+    @param points: the point store, invalid points have h == -1
+    @param startIndex: the start index of the range
+    @param endIndex: the end index of the range (exclusive)
+    @param leafSize: the maximum point count of a leaf
+    @return the KNN index, NULL if failed or there is no valid point
+    */
+    if (!points || startIndex >= endIndex){
+        fprintf(stderr, "Invalid point range for KNN index\n");
+        return NULL;
+    }
+    unsigned int validPointCount = 0;
+    double min[3] = {DBL_MAX, DBL_MAX, DBL_MAX}, max[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+    for (unsigned int i = startIndex; i < endIndex; i++){
+        const RStarPoint* point = &points[i];
+        if (point->h == -1) continue;
+        min[0] = fmin(min[0], point->x); max[0] = fmax(max[0], point->x);
+        min[1] = fmin(min[1], point->y); max[1] = fmax(max[1], point->y);
+        min[2] = fmin(min[2], point->z); max[2] = fmax(max[2], point->z);
+        ++validPointCount;
+    }
+    if (validPointCount == 0){
+        fprintf(stderr, "No valid points for KNN index\n");
+        return NULL;
+    }
+
+    StaticKNNIndex* index = AllocateStaticKNNIndex(validPointCount, leafSize, min, max);
+    if (!index) return NULL;
+    unsigned int validIndex = 0;
+    for (unsigned int i = startIndex; i < endIndex; i++){
+        const RStarPoint* point = &points[i];
+        if (point->h == -1) continue;
+        index->x[validIndex] = (float)(point->x - index->origin[0]);
+        index->y[validIndex] = (float)(point->y - index->origin[1]);
+        index->z[validIndex] = (float)(point->z - index->origin[2]);
+        index->ids[validIndex] = (uint32_t)point->id;
+        ++validIndex;
+    }
+    return BuildStaticKNNIndex(index);
+}
+
+void DestroyStaticKNNIndex(StaticKNNIndex* index){
+    if (!index) return;
+    free(index->x);
+    free(index->y);
+    free(index->z);
+    free(index->ids);
+    free(index->nodes);
+    free(index);
+}
+
+size_t StaticKNNIndex_MemoryUsage(const StaticKNNIndex* index){
+    if (!index) return 0;
+    return sizeof(StaticKNNIndex) + (size_t)index->pointCount * (3 * sizeof(float) + sizeof(uint32_t)) + (size_t)index->nodeCapacity * sizeof(KNNNode);
+}
+
+unsigned int StaticKNNIndex_NearestNeighborQuery(const StaticKNNIndex* index, const double queryPoint[3], const unsigned int k, float* heapDistances, uint32_t* heapIds){
+    /**
+    @brief Query the k nearest neighbors of a point
+    @param index: the KNN index
+    @param queryPoint: the query point in cartesian coordinates
+    @param k: the number of neighbors
+    @param heapDistances: buffer of size k, receive the squared distances in ascending order
+    @param heapIds: buffer of size k, receive the point ids in the same order
+    @return the number of neighbors found, min(k, pointCount)
+    */
+    if (!index || !queryPoint || k == 0) return 0;
+    const float qx = (float)(queryPoint[0] - index->origin[0]);
+    const float qy = (float)(queryPoint[1] - index->origin[1]);
+    const float qz = (float)(queryPoint[2] - index->origin[2]);
+    unsigned int size = 0;
+    unsigned int stack[KNN_MAX_DEPTH * 2];
+    float stackBound[KNN_MAX_DEPTH * 2];
+    float scan[KNN_MAX_LEAF_SIZE];
+    unsigned int top = 0;
+    stack[top] = 0;
+    stackBound[top++] = BoxDistanceSquared(&index->nodes[0], qx, qy, qz);
+    while (top > 0){
+        --top;
+        if (size == k && stackBound[top] >= heapDistances[0]) continue;
+        const KNNNode* node = &index->nodes[stack[top]];
+        if (!node->left){ // leaf: distances are evaluated in one vectorized pass, then filtered into the heap
+            const float* x = index->x + node->start;
+            const float* y = index->y + node->start;
+            const float* z = index->z + node->start;
+            const unsigned int count = node->count;
+            #pragma omp simd
+            for (unsigned int i = 0; i < count; i++){
+                const float dx = x[i] - qx, dy = y[i] - qy, dz = z[i] - qz;
+                scan[i] = dx * dx + dy * dy + dz * dz;
+            }
+            for (unsigned int i = 0; i < count; i++)
+                if (size < k || scan[i] < heapDistances[0])
+                    PushBoundedHeap(heapDistances, heapIds, &size, k, scan[i], index->ids[node->start + i]);
+            continue;
+        }
+        const float leftBound = BoxDistanceSquared(&index->nodes[node->left], qx, qy, qz);
+        const float rightBound = BoxDistanceSquared(&index->nodes[node->right], qx, qy, qz);
+        const bool leftFirst = leftBound <= rightBound;
+        // push the farther child first so the nearer one is visited next
+        stack[top] = leftFirst ? node->right : node->left;
+        stackBound[top++] = leftFirst ? rightBound : leftBound;
+        stack[top] = leftFirst ? node->left : node->right;
+        stackBound[top++] = leftFirst ? leftBound : rightBound;
+    }
+    SortBoundedHeap(heapDistances, heapIds, size);
+    return size;
+}
+
+bool StaticKNNIndex_NearestNeighborBatchQuery(const StaticKNNIndex* index, const unsigned int k, const unsigned int queryCount, const double* queryPoints, int64_t* ids, uint64_t* counts, double* distances){
+    /**
+    @brief Query the k nearest neighbors of a batch of points, the output layout matches Index_NearestNeighbors_id_v
+    @param index: the KNN index
+    @param k: the number of neighbors
+    @param queryCount: the number of query points
+    @param queryPoints: the query points [queryCount][3]
+    @param ids: output ids, results of each query packed one after another
+    @param counts: output result count of each query
+    @param distances: output distances, packed as ids
+    @return true if successful, false otherwise
+    */
+    if (!index || !queryPoints || !ids || !counts || !distances || k == 0) return false;
+    float* heapDistances = (float*)malloc(k * sizeof(float));
+    uint32_t* heapIds = (uint32_t*)malloc(k * sizeof(uint32_t));
+    if (!heapDistances || !heapIds){
+        fprintf(stderr, "Failed to allocate heap for KNN batch query\n");
+        free(heapDistances);
+        free(heapIds);
+        return false;
+    }
+    size_t resultIndex = 0;
+    for (unsigned int i = 0; i < queryCount; i++){
+        const unsigned int count = StaticKNNIndex_NearestNeighborQuery(index, queryPoints + (size_t)i * 3, k, heapDistances, heapIds);
+        for (unsigned int j = 0; j < count; j++){
+            ids[resultIndex + j] = heapIds[j];
+            distances[resultIndex + j] = sqrt((double)heapDistances[j]);
+        }
+        counts[i] = count;
+        resultIndex += count;
+    }
+    free(heapDistances);
+    free(heapIds);
+    return true;
+}
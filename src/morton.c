@@ -0,0 +1,108 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "morton.h"
+
+MortonSortBuffer* CreateMortonSortBuffer(const unsigned int capacity){
+    /**
+    @brief Create the scratch of a radix sort and of the permutation that follows it, sized once and reused for every sort of up to capacity keys
+    @param capacity: the largest number of keys to sort
+    @return the buffer, NULL if failed
+    */
+    if (capacity == 0) return NULL;
+    MortonSortBuffer* buffer = (MortonSortBuffer*)calloc(1, sizeof(MortonSortBuffer));
+    if (!buffer){
+        fprintf(stderr, "Failed to allocate memory for Morton sort buffer\n");
+        return NULL;
+    }
+    buffer->capacity = capacity;
+    buffer->keys = (uint64_t*)malloc((size_t)capacity * sizeof(uint64_t));
+    buffer->keyBuffer = (uint64_t*)malloc((size_t)capacity * sizeof(uint64_t));
+    buffer->order = (uint32_t*)malloc((size_t)capacity * sizeof(uint32_t));
+    buffer->orderBuffer = (uint32_t*)malloc((size_t)capacity * sizeof(uint32_t));
+    buffer->histogram = (uint32_t*)malloc(MORTON_RADIX_SIZE * sizeof(uint32_t));
+    buffer->points = (double*)malloc((size_t)capacity * 3 * sizeof(double));
+    buffer->ids = (unsigned int*)malloc((size_t)capacity * sizeof(unsigned int));
+    if (!buffer->keys || !buffer->keyBuffer || !buffer->order || !buffer->orderBuffer || !buffer->histogram || !buffer->points || !buffer->ids){
+        fprintf(stderr, "Failed to allocate Morton sort buffer of %u keys\n", capacity);
+        DestroyMortonSortBuffer(buffer);
+        return NULL;
+    }
+    return buffer;
+}
+
+void DestroyMortonSortBuffer(MortonSortBuffer* buffer){
+    if (!buffer) return;
+    free(buffer->keys);
+    free(buffer->keyBuffer);
+    free(buffer->order);
+    free(buffer->orderBuffer);
+    free(buffer->histogram);
+    free(buffer->points);
+    free(buffer->ids);
+    free(buffer);
+}
+
+static void SortKeys(uint64_t* keys, uint32_t* order, const unsigned int count, const uint64_t maxKey, uint64_t* keyBuffer, uint32_t* orderBuffer, uint32_t* histogram){
+    // LSD passes ping-ponging between the keys and the buffers, the result ends in keys
+    uint64_t *sourceKeys = keys, *targetKeys = keyBuffer;
+    uint32_t *sourceOrder = order, *targetOrder = orderBuffer;
+    for (unsigned int shift = 0; shift < 64 && (maxKey >> shift) > 0; shift += MORTON_RADIX_BITS){
+        memset(histogram, 0, MORTON_RADIX_SIZE * sizeof(uint32_t));
+        for (unsigned int i = 0; i < count; i++)
+            histogram[(sourceKeys[i] >> shift) & (MORTON_RADIX_SIZE - 1)]++;
+        uint32_t offset = 0;
+        for (unsigned int digit = 0; digit < MORTON_RADIX_SIZE; digit++){
+            const uint32_t digitCount = histogram[digit];
+            histogram[digit] = offset;
+            offset += digitCount;
+        }
+        for (unsigned int i = 0; i < count; i++){
+            const uint32_t position = histogram[(sourceKeys[i] >> shift) & (MORTON_RADIX_SIZE - 1)]++;
+            targetKeys[position] = sourceKeys[i];
+            targetOrder[position] = sourceOrder[i];
+        }
+        uint64_t* swapKeys = sourceKeys; sourceKeys = targetKeys; targetKeys = swapKeys;
+        uint32_t* swapOrder = sourceOrder; sourceOrder = targetOrder; targetOrder = swapOrder;
+    }
+    if (sourceKeys != keys){
+        memcpy(keys, sourceKeys, (size_t)count * sizeof(uint64_t));
+        memcpy(order, sourceOrder, (size_t)count * sizeof(uint32_t));
+    }
+}
+
+bool RadixSortKeys(uint64_t* keys, uint32_t* order, const unsigned int count, const uint64_t maxKey){
+    /**
+    @brief Sort 64 bit keys in ascending order with a stable LSD radix sort, the order array is permuted together, the scratch is allocated for this sort
+    @param keys: the keys, such as voxel keys or Morton codes
+    @param order: the payload of every key
+    @param count: the number of keys
+    @param maxKey: the largest key, only the occupied digits are sorted
+    @return true if successful, false otherwise
+    */
+    uint64_t* keyBuffer = (uint64_t*)malloc((size_t)count * sizeof(uint64_t));
+    uint32_t* orderBuffer = (uint32_t*)malloc((size_t)count * sizeof(uint32_t));
+    uint32_t* histogram = (uint32_t*)malloc(MORTON_RADIX_SIZE * sizeof(uint32_t));
+    const bool success = keyBuffer && orderBuffer && histogram;
+    if (success)
+        SortKeys(keys, order, count, maxKey, keyBuffer, orderBuffer, histogram);
+    free(keyBuffer);
+    free(orderBuffer);
+    free(histogram);
+    return success;
+}
+
+bool RadixSortKeysInBuffer(uint64_t* keys, uint32_t* order, const unsigned int count, const uint64_t maxKey, MortonSortBuffer* buffer){
+    /**
+    @brief RadixSortKeys with the scratch of a sort buffer, nothing is allocated
+    @param keys: the keys, can be the keys of the buffer
+    @param order: the payload of every key, can be the order of the buffer
+    @param count: the number of keys, at most the capacity of the buffer
+    @param maxKey: the largest key
+    @param buffer: the sort buffer
+    @return true if successful, false otherwise
+    */
+    if (!buffer || count > buffer->capacity) return false;
+    SortKeys(keys, order, count, maxKey, buffer->keyBuffer, buffer->orderBuffer, buffer->histogram);
+    return true;
+}
@@ -0,0 +1,375 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "plan.h"
+#include "interpolate.h"
+#include "config.h"
+
+typedef struct {
+    char magic[8];
+    uint32_t version, clipCount;
+    ResamplePlanKey key;
+} ResamplePlanFileHeader;
+
+typedef struct {
+    uint32_t latitudeCount, longitudeCount, heightCount, k;
+    float minLatitude, minLongitude, minHeight, latitudeGap, longitudeGap, heightGap;
+    uint32_t cellCount, entryCount;
+    uint64_t offset; // of rowOffsets, sourceIds and weights in the file, 8 byte aligned
+} ResamplePlanClipHeader;
+
+static inline size_t AlignPlanOffset(const size_t offset){
+    return (offset + 7) & ~(size_t)7;
+}
+
+static inline size_t ClipPlanSize(const uint32_t cellCount, const uint32_t entryCount){
+    return ((size_t)cellCount + 1 + 2 * (size_t)entryCount) * sizeof(uint32_t);
+}
+
+static void InitClipPlanHeader(const ClipGrid* clipGrid, const ClipResamplePlan* clip, ResamplePlanClipHeader* header){
+    // the lattice of the clip, a plan only applies to the clips it was recorded on
+    memset(header, 0, sizeof(ResamplePlanClipHeader));
+    header->latitudeCount = clipGrid->latitudeCount;
+    header->longitudeCount = clipGrid->longitudeCount;
+    header->heightCount = clipGrid->heightCount;
+    header->minLatitude = clipGrid->minLatitude;
+    header->minLongitude = clipGrid->minLongitude;
+    header->minHeight = clipGrid->minHeight;
+    header->latitudeGap = clipGrid->latitudeGap;
+    header->longitudeGap = clipGrid->longitudeGap;
+    header->heightGap = clipGrid->heightGap;
+    if (clip){
+        header->k = clip->k;
+        header->cellCount = clip->cellCount;
+        header->entryCount = clip->rowOffsets[clip->cellCount];
+    }
+}
+
+void InitResamplePlanKey(const HDFGlobalAttribute* globalAttribute, ResamplePlanKey* key){
+    /**
+    @brief The granule and the parameters that decide the neighbors and weights of a plan
+    @param globalAttribute: the global attribute of the granule
+    @param key: the key to fill, zeroed first so it compares with memcmp
+    */
+    memset(key, 0, sizeof(ResamplePlanKey));
+    key->scanLineCount = globalAttribute->scanLineCount;
+    key->ascending = globalAttribute->ascending;
+    key->startDateTime = globalAttribute->startDateTime;
+    key->endDateTime = globalAttribute->endDateTime;
+    key->gridSize = g_config->grid_size;
+    key->heightCount = g_config->height_count;
+    key->k = g_config->k_neighbor;
+    key->indexEngine = g_config->index_engine; // STRUCTURED may find other neighbors than the exact engines
+    key->sharedIndex = g_config->shared_index; // a forest per clip holds only the lines of the clip
+    key->structuredCellRadius = g_config->structured_cell_radius;
+    key->structuredBinRadius = g_config->structured_bin_radius;
+    key->minimalHeight = g_config->minimal_height;
+    key->heightGap = g_config->height_gap;
+    key->maxDistanceTolerance = g_config->max_distance_tolerance;
+    key->idwPower = g_config->idw_power;
+    key->minNeighborDistance = g_config->min_neighbor_distance;
+    key->maxNeighborDistance = g_config->max_neighbor_distance;
+    key->maxVerticalDistance = g_config->max_vertical_distance;
+    key->verticalScale = g_config->vertical_scale;
+}
+
+ResamplePlan* CreateResamplePlan(const char* fileName, const ResamplePlanKey* key, const ClipGridResult* finalGrid, const unsigned int k){
+    /**
+    @brief Create an empty plan to record, see BeginClipResamplePlan
+    @param fileName: the file the plan is saved to
+    @param key: the key of the plan, see InitResamplePlanKey
+    @param finalGrid: the clips of the granule
+    @param k: the number of neighbors of a cell
+    @return the plan, NULL if failed
+    */
+    if (!fileName || !key || !finalGrid || k == 0 || strlen(fileName) >= sizeof(((ResamplePlan*)0)->fileName)) return NULL;
+    ResamplePlan* plan = (ResamplePlan*)calloc(1, sizeof(ResamplePlan));
+    if (!plan){
+        fprintf(stderr, "Failed to allocate memory for ResamplePlan\n");
+        return NULL;
+    }
+    plan->key = *key;
+    strcpy(plan->fileName, fileName);
+    plan->clipCount = finalGrid->clipCount;
+    plan->clips = (ClipResamplePlan*)calloc(plan->clipCount, sizeof(ClipResamplePlan));
+    bool success = plan->clips != NULL;
+    for (unsigned int clipIndex = 0; clipIndex < plan->clipCount && success; clipIndex++){
+        const ClipGrid* clipGrid = &finalGrid->clipGrids[clipIndex];
+        ClipResamplePlan* clip = &plan->clips[clipIndex];
+        clip->cellCount = clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+        clip->k = k;
+        clip->rowOffsets = (uint32_t*)calloc((size_t)clip->cellCount + 1, sizeof(uint32_t));
+        success = clip->rowOffsets != NULL;
+    }
+    if (!success){
+        fprintf(stderr, "Failed to allocate memory for the resample plan of %u clips\n", plan->clipCount);
+        DestroyResamplePlan(plan);
+        return NULL;
+    }
+    return plan;
+}
+
+bool BeginClipResamplePlan(ClipResamplePlan* clip){
+    /**
+    @brief Give a clip k entry slots per cell to record into, only the clips being interpolated hold them until FinishClipResamplePlan compacts them
+    @param clip: the clip plan of CreateResamplePlan
+    @return true if successful, false otherwise
+    */
+    if (!clip || !clip->rowOffsets) return false;
+    if (clip->cellCount == 0) return true;
+    clip->sourceIds = (uint32_t*)malloc((size_t)clip->cellCount * clip->k * sizeof(uint32_t));
+    clip->weights = (float*)malloc((size_t)clip->cellCount * clip->k * sizeof(float));
+    if (!clip->sourceIds || !clip->weights){
+        fprintf(stderr, "Failed to allocate memory to record the resample plan of %u cells\n", clip->cellCount);
+        return false;
+    }
+    return true;
+}
+
+void RecordClipPlanChunk(ClipResamplePlan* clip, const unsigned int queryCount, const unsigned int* queryIDs, const float power, const uint64_t* counts, const double* distances, const int64_t* ids,
+                         const float* heightArray, const double* queryGeodetic, float* neighborWeights, int64_t* neighborIds){
+    /**
+    @brief Record the weighted neighbors of a chunk of queries, with the weights of InterpolateValuesIDWBatch
+    @param clip: the clip plan being recorded, see BeginClipResamplePlan
+    @param queryCount: the number of queries
+    @param queryIDs: the cell of each query in the clip
+    @param power: the IDW power
+    @param counts: the neighbor count of each query
+    @param distances: the packed neighbor distances
+    @param ids: the packed neighbor ids
+    @param heightArray: the heights of the points, for the max vertical distance, can be NULL
+    @param queryGeodetic: latitude, longitude and height of the queries [queryCount][3]
+    @param neighborWeights: buffer of [k][IDW_BATCH_BLOCK] floats
+    @param neighborIds: buffer of [k][IDW_BATCH_BLOCK] ids
+    */
+    const unsigned int k = clip->k;
+    size_t offset = 0;
+    for (unsigned int start = 0; start < queryCount; start += IDW_BATCH_BLOCK){
+        const unsigned int count = queryCount - start < IDW_BATCH_BLOCK ? queryCount - start : IDW_BATCH_BLOCK;
+        offset += CalculateIDWWeightsBatch(power, count, k, counts + start, distances + offset, ids + offset, heightArray, queryGeodetic ? queryGeodetic + (size_t)start * 3 : NULL,
+                                           IDW_BATCH_BLOCK, neighborWeights, neighborIds);
+        for (unsigned int i = 0; i < count; i++){
+            // the slots of the cell stay apart until the clip is finished, the row keeps the neighbor order
+            const unsigned int cell = queryIDs[start + i];
+            uint32_t entryCount = 0;
+            for (unsigned int j = 0; j < k; j++){
+                const float weight = neighborWeights[j * IDW_BATCH_BLOCK + i];
+                if (weight <= 0.0f) continue;
+                clip->sourceIds[(size_t)cell * k + entryCount] = (uint32_t)neighborIds[j * IDW_BATCH_BLOCK + i];
+                clip->weights[(size_t)cell * k + entryCount] = weight;
+                entryCount++;
+            }
+            clip->rowOffsets[cell + 1] = entryCount;
+        }
+    }
+}
+
+void FinishClipResamplePlan(ClipResamplePlan* clip){
+    /**
+    @brief Compact the recorded slots of a clip into rows, the cells never recorded have no entry
+    @param clip: the clip plan, rowOffsets[c + 1] holds the entry count of cell c while recording
+    */
+    uint32_t total = 0;
+    for (unsigned int cell = 0; cell < clip->cellCount; cell++){
+        const uint32_t count = clip->rowOffsets[cell + 1];
+        // the rows only move towards the front, total never passes cell * k
+        memmove(clip->sourceIds + total, clip->sourceIds + (size_t)cell * clip->k, count * sizeof(uint32_t));
+        memmove(clip->weights + total, clip->weights + (size_t)cell * clip->k, count * sizeof(float));
+        total += count;
+        clip->rowOffsets[cell + 1] = total;
+    }
+    clip->rowOffsets[0] = 0;
+    if (total == 0){
+        free(clip->sourceIds);
+        free(clip->weights);
+        clip->sourceIds = NULL;
+        clip->weights = NULL;
+    }
+    else{
+        uint32_t* sourceIds = (uint32_t*)realloc(clip->sourceIds, total * sizeof(uint32_t));
+        float* weights = (float*)realloc(clip->weights, total * sizeof(float));
+        if (sourceIds) clip->sourceIds = sourceIds;
+        if (weights) clip->weights = weights;
+    }
+}
+
+static inline float ApplyPlanRow(const ClipResamplePlan* clip, const unsigned int cell, const float* valueArray){
+    // the weighted mean of the sources with a value, in the order and precision of InterpolateValuesIDWBatch
+    float weightSum = 0.0f, valueSum = 0.0f;
+    for (uint32_t entry = clip->rowOffsets[cell]; entry < clip->rowOffsets[cell + 1]; entry++){
+        const float value = valueArray[clip->sourceIds[entry]];
+        if (value <= -999) continue;
+        weightSum += clip->weights[entry];
+        valueSum += clip->weights[entry] * value;
+    }
+    return weightSum > 0.0f ? valueSum / weightSum : -999.0f;
+}
+
+bool ApplyClipResamplePlan(const ClipResamplePlan* clip, const float* valueArray, const float* const* extraValueArrays, ClipGrid* clipGrid){
+    /**
+    @brief Interpolate a clip as the sparse product of its plan with the values of the points, no index is queried
+    @param clip: the finished or loaded clip plan
+    @param valueArray: the values of the points
+    @param extraValueArrays: the extra variables of the points, one per extra variable of the clip, can be NULL when the clip has none
+    @param clipGrid: the clip grid to interpolate, its lattice must be the one of the plan
+    @return true if successful, false otherwise
+    */
+    if (!clip || !valueArray || !clipGrid || (!clipGrid->value && !clipGrid->sparse)) return false;
+    if (clip->cellCount != clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount || (clipGrid->extraCount > 0 && !extraValueArrays)){
+        fprintf(stderr, "The resample plan does not fit the clip grid\n");
+        return false;
+    }
+    for (unsigned int cell = 0; cell < clip->cellCount; cell++)
+        SetClipValue(clipGrid, 0, cell, ApplyPlanRow(clip, cell, valueArray));
+    for (unsigned int v = 0; v < clipGrid->extraCount; v++)
+        for (unsigned int cell = 0; cell < clip->cellCount; cell++)
+            SetClipValue(clipGrid, 1 + v, cell, ApplyPlanRow(clip, cell, extraValueArrays[v]));
+    return true;
+}
+
+bool SaveResamplePlan(const ResamplePlan* plan, const ClipGridResult* finalGrid){
+    /**
+    @brief Save a recorded plan, the header and the clip table are followed by the rows of every clip so the file can be mapped as is
+    @param plan: the plan, every clip finished
+    @param finalGrid: the clips the plan was recorded on
+    @return true if successful, false otherwise
+    */
+    if (!plan || !finalGrid || plan->clipCount != finalGrid->clipCount) return false;
+    FILE* file = fopen(plan->fileName, "wb");
+    if (!file){
+        fprintf(stderr, "Failed to create resample plan file: %s\n", plan->fileName);
+        return false;
+    }
+    ResamplePlanFileHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, RESAMPLE_PLAN_MAGIC, sizeof(header.magic));
+    header.version = RESAMPLE_PLAN_VERSION;
+    header.clipCount = plan->clipCount;
+    header.key = plan->key;
+    bool success = fwrite(&header, sizeof(header), 1, file) == 1;
+    size_t offset = AlignPlanOffset(sizeof(header) + (size_t)plan->clipCount * sizeof(ResamplePlanClipHeader));
+    for (unsigned int clipIndex = 0; clipIndex < plan->clipCount && success; clipIndex++){
+        ResamplePlanClipHeader clipHeader;
+        InitClipPlanHeader(&finalGrid->clipGrids[clipIndex], &plan->clips[clipIndex], &clipHeader);
+        clipHeader.offset = offset;
+        offset = AlignPlanOffset(offset + ClipPlanSize(clipHeader.cellCount, clipHeader.entryCount));
+        success = fwrite(&clipHeader, sizeof(clipHeader), 1, file) == 1;
+    }
+    const uint64_t padding = 0;
+    for (unsigned int clipIndex = 0; clipIndex < plan->clipCount && success; clipIndex++){
+        const ClipResamplePlan* clip = &plan->clips[clipIndex];
+        const uint32_t entryCount = clip->rowOffsets[clip->cellCount];
+        const long position = ftell(file);
+        success = position >= 0 && fwrite(&padding, 1, AlignPlanOffset(position) - position, file) == AlignPlanOffset(position) - position;
+        success = success && fwrite(clip->rowOffsets, sizeof(uint32_t), (size_t)clip->cellCount + 1, file) == (size_t)clip->cellCount + 1;
+        success = success && fwrite(clip->sourceIds, sizeof(uint32_t), entryCount, file) == entryCount;
+        success = success && fwrite(clip->weights, sizeof(float), entryCount, file) == entryCount;
+    }
+    if (fclose(file) != 0) success = false;
+    if (!success){
+        fprintf(stderr, "Failed to write resample plan file: %s\n", plan->fileName);
+        remove(plan->fileName);
+    }
+    return success;
+}
+
+static bool CheckClipPlan(const ResamplePlanClipHeader* clipHeader, const ClipGrid* clipGrid, const size_t fileSize, const uint32_t pointCount, const uint8_t* base, ClipResamplePlan* clip){
+    // the clip table entry must describe the same lattice and rows inside the file with sources inside the granule
+    ResamplePlanClipHeader expected;
+    InitClipPlanHeader(clipGrid, NULL, &expected);
+    if (clipHeader->latitudeCount != expected.latitudeCount || clipHeader->longitudeCount != expected.longitudeCount || clipHeader->heightCount != expected.heightCount ||
+        clipHeader->minLatitude != expected.minLatitude || clipHeader->minLongitude != expected.minLongitude || clipHeader->minHeight != expected.minHeight ||
+        clipHeader->latitudeGap != expected.latitudeGap || clipHeader->longitudeGap != expected.longitudeGap || clipHeader->heightGap != expected.heightGap)
+        return false;
+    if (clipHeader->cellCount != expected.latitudeCount * expected.longitudeCount * expected.heightCount || clipHeader->offset % 8 != 0 ||
+        clipHeader->offset > fileSize || ClipPlanSize(clipHeader->cellCount, clipHeader->entryCount) > fileSize - clipHeader->offset)
+        return false;
+    clip->cellCount = clipHeader->cellCount;
+    clip->k = clipHeader->k;
+    clip->rowOffsets = (uint32_t*)(base + clipHeader->offset);
+    clip->sourceIds = clip->rowOffsets + clip->cellCount + 1;
+    clip->weights = (float*)(clip->sourceIds + clipHeader->entryCount);
+    if (clip->rowOffsets[0] != 0 || clip->rowOffsets[clip->cellCount] != clipHeader->entryCount) return false;
+    for (unsigned int cell = 0; cell < clip->cellCount; cell++)
+        if (clip->rowOffsets[cell + 1] < clip->rowOffsets[cell]) return false;
+    for (uint32_t entry = 0; entry < clipHeader->entryCount; entry++)
+        if (clip->sourceIds[entry] >= pointCount) return false;
+    return true;
+}
+
+ResamplePlan* LoadResamplePlan(const char* fileName, const ResamplePlanKey* key, const ClipGridResult* finalGrid){
+    /**
+    @brief Map a saved plan, it is only used when its key and the lattice of every clip match
+    @param fileName: the plan file
+    @param key: the key of the current run, see InitResamplePlanKey
+    @param finalGrid: the clips of the current run
+    @return the plan pointing into the mapped file, NULL if there is no matching plan
+    */
+    if (!fileName || !key || !finalGrid) return NULL;
+    const int descriptor = open(fileName, O_RDONLY);
+    if (descriptor < 0){
+        printf("No resample plan at %s, it will be recorded\n", fileName);
+        return NULL;
+    }
+    struct stat status;
+    void* mapping = MAP_FAILED;
+    size_t fileSize = 0;
+    if (fstat(descriptor, &status) == 0 && (size_t)status.st_size >= sizeof(ResamplePlanFileHeader)){
+        fileSize = status.st_size;
+        mapping = mmap(NULL, fileSize, PROT_READ, MAP_PRIVATE, descriptor, 0);
+    }
+    close(descriptor);
+    if (mapping == MAP_FAILED){
+        fprintf(stderr, "Failed to map resample plan file: %s\n", fileName);
+        return NULL;
+    }
+    const ResamplePlanFileHeader* header = (const ResamplePlanFileHeader*)mapping;
+    ResamplePlan* plan = NULL;
+    if (memcmp(header->magic, RESAMPLE_PLAN_MAGIC, sizeof(header->magic)) != 0 || header->version != RESAMPLE_PLAN_VERSION)
+        fprintf(stderr, "%s is not a resample plan of this version\n", fileName);
+    else if (memcmp(&header->key, key, sizeof(ResamplePlanKey)) != 0)
+        fprintf(stderr, "The resample plan %s was recorded for another granule or other parameters\n", fileName);
+    else if (header->clipCount != finalGrid->clipCount || sizeof(ResamplePlanFileHeader) + (size_t)header->clipCount * sizeof(ResamplePlanClipHeader) > fileSize)
+        fprintf(stderr, "The resample plan %s has %u clips, the granule has %u\n", fileName, header->clipCount, finalGrid->clipCount);
+    else
+        plan = (ResamplePlan*)calloc(1, sizeof(ResamplePlan));
+    if (plan){
+        plan->key = *key;
+        strncpy(plan->fileName, fileName, sizeof(plan->fileName) - 1);
+        plan->clipCount = header->clipCount;
+        plan->mapping = mapping;
+        plan->mappingSize = fileSize;
+        plan->clips = (ClipResamplePlan*)calloc(plan->clipCount, sizeof(ClipResamplePlan));
+        const ResamplePlanClipHeader* clipHeaders = (const ResamplePlanClipHeader*)(header + 1);
+        const uint32_t pointCount = key->scanLineCount * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+        bool success = plan->clips != NULL;
+        for (unsigned int clipIndex = 0; clipIndex < plan->clipCount && success; clipIndex++)
+            success = CheckClipPlan(&clipHeaders[clipIndex], &finalGrid->clipGrids[clipIndex], fileSize, pointCount, (const uint8_t*)mapping, &plan->clips[clipIndex]);
+        if (!success){
+            fprintf(stderr, "The resample plan %s does not fit the clips of the granule\n", fileName);
+            DestroyResamplePlan(plan);
+            return NULL;
+        }
+        return plan;
+    }
+    munmap(mapping, fileSize);
+    return NULL;
+}
+
+void DestroyResamplePlan(ResamplePlan* plan){
+    if (!plan) return;
+    if (plan->mapping)
+        munmap(plan->mapping, plan->mappingSize); // the clips point into the mapping
+    else
+        for (unsigned int clipIndex = 0; plan->clips && clipIndex < plan->clipCount; clipIndex++){
+            free(plan->clips[clipIndex].rowOffsets);
+            free(plan->clips[clipIndex].sourceIds);
+            free(plan->clips[clipIndex].weights);
+        }
+    free(plan->clips);
+    free(plan);
+}
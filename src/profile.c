@@ -0,0 +1,90 @@
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#include "profile.h"
+
+size_t GetResidentMemory(void){
+    /**
+    @brief Get the resident set size of the process
+    @return the resident memory in bytes, 0 if not available
+    */
+    FILE* file = fopen("/proc/self/statm", "r");
+    if (!file) return 0;
+    unsigned long size = 0, resident = 0;
+    if (fscanf(file, "%lu %lu", &size, &resident) != 2)
+        resident = 0;
+    fclose(file);
+    return (size_t)resident * (size_t)sysconf(_SC_PAGESIZE);
+}
+
+size_t GetPeakResidentMemory(void){
+    /**
+    @brief Get the peak resident set size (VmHWM) of the process
+    @return the peak resident memory in bytes, 0 if not available
+    */
+    FILE* file = fopen("/proc/self/status", "r");
+    if (!file) return 0;
+    char line[256];
+    size_t peak = 0;
+    while (fgets(line, sizeof(line), file)){
+        unsigned long kiloBytes = 0;
+        if (strncmp(line, "VmHWM:", 6) == 0 && sscanf(line + 6, "%lu", &kiloBytes) == 1){
+            peak = (size_t)kiloBytes * 1024;
+            break;
+        }
+    }
+    fclose(file);
+    return peak;
+}
+
+bool ResetPeakResidentMemory(void){
+    /**
+    @brief Reset the peak resident set size so a later GetPeakResidentMemory measures one stage only
+    @return true if successful, false otherwise (e.g. kernel without clear_refs support)
+    */
+    FILE* file = fopen("/proc/self/clear_refs", "w");
+    if (!file) return false;
+    const bool success = fputs("5", file) >= 0;
+    fclose(file);
+    return success;
+}
+
+double ToMegaBytes(const size_t bytes){return (double)bytes / (1024.0 * 1024.0);}
+
+int StartCacheMissCounter(void){
+    /**
+    @brief Open and start a hardware cache miss counter for the calling thread, threads created before the start are not counted
+    @return the counter descriptor, -1 if not available (e.g. perf_event_paranoid or a virtual machine without a PMU)
+    */
+    struct perf_event_attr attribute;
+    memset(&attribute, 0, sizeof(attribute));
+    attribute.size = sizeof(attribute);
+    attribute.type = PERF_TYPE_HARDWARE;
+    attribute.config = PERF_COUNT_HW_CACHE_MISSES;
+    attribute.disabled = 1;
+    attribute.exclude_kernel = 1;
+    attribute.exclude_hv = 1;
+    const int counter = (int)syscall(SYS_perf_event_open, &attribute, 0, -1, -1, 0);
+    if (counter < 0) return -1;
+    ioctl(counter, PERF_EVENT_IOC_RESET, 0);
+    ioctl(counter, PERF_EVENT_IOC_ENABLE, 0);
+    return counter;
+}
+
+long long StopCacheMissCounter(const int counter){
+    /**
+    @brief Stop and close a counter opened by StartCacheMissCounter
+    @param counter: the counter descriptor
+    @return the number of cache misses, -1 if not available
+    */
+    if (counter < 0) return -1;
+    ioctl(counter, PERF_EVENT_IOC_DISABLE, 0);
+    long long count = -1;
+    if (read(counter, &count, sizeof(count)) != sizeof(count))
+        count = -1;
+    close(counter);
+    return count;
+}
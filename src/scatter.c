@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "scatter.h"
+#include "geotransfer.h"
+#include "config.h"
+
+static inline double ScatterWeight(const double squaredDistance, const double minSquaredDistance, const float power){
+    // IDW weight, a cell closer than the min neighbor distance takes the weight at that distance
+    const double distance2 = squaredDistance > minSquaredDistance ? squaredDistance : minSquaredDistance;
+    if (power == 2.0f) return 1.0 / distance2;
+    return pow(distance2, -0.5 * power);
+}
+
+typedef struct {
+    double b, l, h; // fractional lattice indices of the bin
+    double northGap, eastGap; // meters between two cells at the bin
+    unsigned int firstB, lastB, firstL, lastL, firstH, lastH; // the cells within reach
+} ScatterFootprint;
+
+static inline void ScatterRange(const double center, const double reach, const unsigned int count, unsigned int* first, unsigned int* last){
+    // the lattice indices within reach of a fractional index, first > last when there is none
+    const double low = ceil(center - reach), high = floor(center + reach);
+    *first = low < 0 ? 0 : (unsigned int)low;
+    *last = high >= count ? count - 1 : (high < 0 ? 0 : (unsigned int)high);
+    if (high < 0 || low >= count) *first = *last + 1;
+}
+
+static inline void ScatterMetric(const double latitude, const double height, double* metersPerLatitude, double* metersPerLongitude){
+    // the local metric at a bin, the kernel is small enough to be flat
+    const double e2 = WGS84_E * WGS84_E;
+    const double sinLatitude = sin(ToRadians(latitude));
+    const double w = sqrt(1 - e2 * sinLatitude * sinLatitude);
+    *metersPerLatitude = ToRadians(WGS84_A * (1 - e2) / (w * w * w) + height);
+    *metersPerLongitude = ToRadians((WGS84_A / w + height) * cos(ToRadians(latitude)));
+}
+
+static bool LocateScatterBin(const GeodeticGrid* grid, const ClipGrid* clipGrid, const size_t point, const double radius, const double verticalReach, ScatterFootprint* footprint){
+    // the lattice position of a bin and the cells within reach, false when none is
+    const double latitude = grid->latitudeArray[point], height = grid->elevationArray[point];
+    double metersPerLatitude, metersPerLongitude;
+    ScatterMetric(latitude, height, &metersPerLatitude, &metersPerLongitude);
+    footprint->northGap = clipGrid->latitudeGap * metersPerLatitude;
+    footprint->eastGap = clipGrid->longitudeGap * metersPerLongitude;
+    footprint->b = (latitude - clipGrid->minLatitude) / clipGrid->latitudeGap;
+    footprint->l = WrapLongitudeDifference(grid->longitudeArray[point] - clipGrid->minLongitude) / clipGrid->longitudeGap;
+    footprint->h = (height - clipGrid->minHeight) / clipGrid->heightGap;
+    ScatterRange(footprint->b, radius / footprint->northGap, clipGrid->latitudeCount, &footprint->firstB, &footprint->lastB);
+    ScatterRange(footprint->l, radius / footprint->eastGap, clipGrid->longitudeCount, &footprint->firstL, &footprint->lastL);
+    ScatterRange(footprint->h, verticalReach / clipGrid->heightGap, clipGrid->heightCount, &footprint->firstH, &footprint->lastH);
+    return footprint->firstB <= footprint->lastB && footprint->firstL <= footprint->lastL && footprint->firstH <= footprint->lastH;
+}
+
+static void LocateScatterRay(const GeodeticGrid* grid, const ClipGrid* clipGrid, const size_t ray, const double radius, unsigned int* firstL, unsigned int* lastL){
+    /**
+    @brief Bound the longitude columns reached by any bin of a ray from its two end bins, the footprint moves monotonically along the ray
+    @param grid: the geodetic grid
+    @param clipGrid: the clip grid
+    @param ray: the first bin of the ray
+    @param radius: the kernel radius in meters
+    @param firstL: output first column, firstL > lastL when the ray reaches none
+    @param lastL: output last column
+    */
+    const size_t ends[2] = {ray, ray + grid->heightCount - 1};
+    double low = INFINITY, high = -INFINITY, reach = 0;
+    for (unsigned int e = 0; e < 2; e++){
+        const double latitude = grid->latitudeArray[ends[e]];
+        double metersPerLatitude, metersPerLongitude;
+        // the lowest height of the ray and the latitude of the end give the shortest east gap, so the widest reach
+        ScatterMetric(latitude, fmin(fmin(grid->elevationArray[ends[0]], grid->elevationArray[ends[1]]), 0.0), &metersPerLatitude, &metersPerLongitude);
+        reach = fmax(reach, radius / (clipGrid->longitudeGap * metersPerLongitude) + 1);
+        const double l = WrapLongitudeDifference(grid->longitudeArray[ends[e]] - clipGrid->minLongitude) / clipGrid->longitudeGap;
+        low = fmin(low, l);
+        high = fmax(high, l);
+    }
+    ScatterRange(low, reach, clipGrid->longitudeCount, firstL, lastL);
+    unsigned int first, last;
+    ScatterRange(high, reach, clipGrid->longitudeCount, &first, &last);
+    if (*firstL > *lastL){
+        *firstL = first;
+        *lastL = last;
+    }
+    else if (first <= last)
+        *lastL = last;
+}
+
+bool InterpolateClipGridScatter(const GeodeticGrid* grid, const float radius, const float power, ClipGrid* clipGrid){
+    /**
+    @brief Interpolate a clip by splatting every valid bin of its scan lines onto the cells within the kernel radius, then normalizing the weighted sums of every cell
+    @note the sums are kept for SCATTER_TILE_WIDTH longitude columns at a time, and only the rays that reach a tile are splatted onto it, so the scratch does not grow with the clip and CLIP_STORAGE=SPARSE never holds a dense clip
+    @param grid: the processed geodetic grid, only the valid bins are splatted
+    @param radius: the kernel radius in meters, the vertical offset is scaled by the vertical scale and limited by the max vertical distance
+    @param power: the IDW power of the kernel
+    @param clipGrid: the clip grid to interpolate, it is only written by the calling thread so no accumulation is shared between threads
+    @return true if successful, false otherwise
+    */
+    if (!grid || !clipGrid || (!clipGrid->value && !clipGrid->sparse) || radius <= 0) return false;
+    if (clipGrid->rightLineIndex >= grid->lineCount || clipGrid->extraCount > grid->extraCount){
+        fprintf(stderr, "The clip grid does not fit the geodetic grid\n");
+        return false;
+    }
+    const size_t columnCells = (size_t)clipGrid->latitudeCount * clipGrid->heightCount;
+    const size_t tileCells = SCATTER_TILE_WIDTH * columnCells;
+    const unsigned int variableCount = 1 + clipGrid->extraCount;
+    const unsigned int rayCount = (clipGrid->rightLineIndex - clipGrid->leftLineIndex + 1) * SCAN_ANGLE_COUNT;
+    double* weightSums = (double*)malloc(variableCount * tileCells * sizeof(double)); // [variableCount][tileCells]
+    double* valueSums = (double*)malloc(variableCount * tileCells * sizeof(double));
+    unsigned int* rayColumns = (unsigned int*)malloc((size_t)rayCount * 2 * sizeof(unsigned int)); // [rayCount][first, last]
+    if (!weightSums || !valueSums || !rayColumns){
+        fprintf(stderr, "Failed to allocate memory for the scatter sums of %zu cells\n", tileCells);
+        free(weightSums);
+        free(valueSums);
+        free(rayColumns);
+        return false;
+    }
+    const double verticalScale = g_config->vertical_scale > 0 ? g_config->vertical_scale : 1.0;
+    const double verticalReach = g_config->max_vertical_distance > 0 && g_config->max_vertical_distance < radius / verticalScale ? g_config->max_vertical_distance : radius / verticalScale;
+    const double minDistance = g_config->min_neighbor_distance > 1 ? g_config->min_neighbor_distance : 1.0;
+    const double squaredRadius = (double)radius * radius, minSquaredDistance = minDistance * minDistance;
+    const size_t firstRay = (size_t)clipGrid->leftLineIndex * SCAN_ANGLE_COUNT;
+    for (unsigned int r = 0; r < rayCount; r++)
+        LocateScatterRay(grid, clipGrid, (firstRay + r) * grid->heightCount, radius, &rayColumns[r * 2], &rayColumns[r * 2 + 1]);
+
+    for (unsigned int tileL = 0; tileL < clipGrid->longitudeCount; tileL += SCATTER_TILE_WIDTH){
+        const unsigned int tileEnd = tileL + SCATTER_TILE_WIDTH < clipGrid->longitudeCount ? tileL + SCATTER_TILE_WIDTH : clipGrid->longitudeCount;
+        const size_t cellCount = (tileEnd - tileL) * columnCells;
+        for (unsigned int v = 0; v < variableCount; v++){
+            memset(weightSums + v * tileCells, 0, cellCount * sizeof(double));
+            memset(valueSums + v * tileCells, 0, cellCount * sizeof(double));
+        }
+        for (unsigned int r = 0; r < rayCount; r++){
+            if (rayColumns[r * 2] > rayColumns[r * 2 + 1] || rayColumns[r * 2] >= tileEnd || rayColumns[r * 2 + 1] < tileL) continue;
+            for (unsigned int bin = 0; bin < grid->heightCount; bin++){
+                const size_t point = (firstRay + r) * grid->heightCount + bin;
+                ScatterFootprint footprint;
+                if (!grid->validArray[point] || !LocateScatterBin(grid, clipGrid, point, radius, verticalReach, &footprint)) continue;
+                const unsigned int firstL = footprint.firstL > tileL ? footprint.firstL : tileL;
+                const unsigned int lastL = footprint.lastL < tileEnd - 1 ? footprint.lastL : tileEnd - 1;
+                for (unsigned int cellL = firstL; cellL <= lastL; cellL++){
+                    const double east = (cellL - footprint.l) * footprint.eastGap;
+                    for (unsigned int cellB = footprint.firstB; cellB <= footprint.lastB; cellB++){
+                        const double north = (cellB - footprint.b) * footprint.northGap;
+                        const double horizontal2 = east * east + north * north;
+                        if (horizontal2 > squaredRadius) continue;
+                        const size_t columnBase = (size_t)(cellL - tileL) * columnCells + (size_t)cellB * clipGrid->heightCount;
+                        for (unsigned int cellH = footprint.firstH; cellH <= footprint.lastH; cellH++){
+                            const double up = (cellH - footprint.h) * clipGrid->heightGap * verticalScale;
+                            const double distance2 = horizontal2 + up * up;
+                            if (distance2 > squaredRadius) continue;
+                            const double weight = ScatterWeight(distance2, minSquaredDistance, power);
+                            const size_t index = columnBase + cellH;
+                            weightSums[index] += weight;
+                            valueSums[index] += weight * grid->valueArray[point];
+                            for (unsigned int v = 0; v < clipGrid->extraCount; v++){
+                                const float extra = grid->extraValueArrays[v][point];
+                                if (extra <= -999) continue;
+                                weightSums[(1 + v) * tileCells + index] += weight;
+                                valueSums[(1 + v) * tileCells + index] += weight * extra;
+                            }
+                        }
+                    }
+                }
+            }
+        }
+        // the cells of the tile are contiguous in the clip, longitude is the outermost axis
+        const size_t tileBase = (size_t)tileL * columnCells;
+        for (unsigned int v = 0; v < variableCount; v++)
+            for (size_t index = 0; index < cellCount; index++){
+                const size_t sum = v * tileCells + index;
+                SetClipValue(clipGrid, v, tileBase + index, weightSums[sum] > 0 ? (float)(valueSums[sum] / weightSums[sum]) : -999.0f);
+            }
+    }
+    free(weightSums);
+    free(valueSums);
+    free(rayColumns);
+    return true;
+}
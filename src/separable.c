@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <limits.h>
+#include "separable.h"
+#include "geotransfer.h"
+#include "interpolate.h"
+#include "config.h"
+
+static inline float LevelHeight(const RayLevelProfile* profile, const unsigned int level){
+    return profile->minHeight + level * profile->heightGap;
+}
+
+static inline float LevelExtraValue(const float lowerValue, const float upperValue, const float weight){
+    // an extra variable takes the weights of value, a bin without its own value leaves the other one alone
+    if (lowerValue > -999 && upperValue > -999) return lowerValue + weight * (upperValue - lowerValue);
+    if (lowerValue > -999) return lowerValue;
+    return upperValue > -999 ? upperValue : -999;
+}
+
+static void SetRayLevel(const GeodeticGrid* grid, const int lower, const int upper, const float reach, const unsigned int level, const unsigned int ray, RayLevelProfile* profile){
+    /**
+    @brief Interpolate a ray linearly between the valid bins around a level, a single bin is used alone when the other is out of reach
+    @param lower: the nearest valid bin below the level, -1 if none
+    @param upper: the nearest valid bin above the level, -1 if none
+    @param reach: the max height difference between the level and a bin it takes
+    */
+    const float height = LevelHeight(profile, level);
+    const bool hasLower = lower >= 0 && height - grid->elevationArray[lower] <= reach;
+    const bool hasUpper = upper >= 0 && grid->elevationArray[upper] - height <= reach;
+    const size_t index = (size_t)level * profile->rayCount + ray, variableStride = (size_t)profile->levelCount * profile->rayCount;
+    if (hasLower && hasUpper){
+        const float span = grid->elevationArray[upper] - grid->elevationArray[lower];
+        const float weight = span > 0 ? (height - grid->elevationArray[lower]) / span : 0.0f;
+        profile->latitude[index] = grid->latitudeArray[lower] + weight * (grid->latitudeArray[upper] - grid->latitudeArray[lower]);
+        profile->longitude[index] = grid->longitudeArray[lower] + weight * (grid->longitudeArray[upper] - grid->longitudeArray[lower]);
+        profile->value[index] = grid->valueArray[lower] + weight * (grid->valueArray[upper] - grid->valueArray[lower]);
+        for (unsigned int v = 0; v < profile->extraCount; v++)
+            profile->extraValue[v * variableStride + index] = LevelExtraValue(grid->extraValueArrays[v][lower], grid->extraValueArrays[v][upper], weight);
+    }
+    else if (hasLower || hasUpper){
+        const int bin = hasLower ? lower : upper;
+        profile->latitude[index] = grid->latitudeArray[bin];
+        profile->longitude[index] = grid->longitudeArray[bin];
+        profile->value[index] = grid->valueArray[bin];
+        for (unsigned int v = 0; v < profile->extraCount; v++)
+            profile->extraValue[v * variableStride + index] = grid->extraValueArrays[v][bin];
+    }
+    else{
+        profile->latitude[index] = profile->longitude[index] = 0;
+        profile->value[index] = -999;
+        for (unsigned int v = 0; v < profile->extraCount; v++)
+            profile->extraValue[v * variableStride + index] = -999;
+    }
+}
+
+static void ResampleRay(const GeodeticGrid* grid, const unsigned int ray, const float reach, RayLevelProfile* profile){
+    /**
+    @brief Resample the valid bins of a ray onto the target levels in one sweep from the bottom up
+    @param grid: the geodetic grid
+    @param ray: line * SCAN_ANGLE_COUNT + angle
+    @param reach: the max height difference between a level and a bin it takes
+    @param profile: the profile, the levels of the ray are written
+    */
+    const unsigned int heightCount = grid->heightCount, base = ray * heightCount;
+    int first = -1, last = -1;
+    for (unsigned int bin = 0; bin < heightCount; bin++)
+        if (grid->validArray[base + bin]){
+            if (first < 0) first = bin;
+            last = bin;
+        }
+    // bins are stored from the top of the ray in the scan, walk them by ascending height
+    const bool descending = first >= 0 && grid->elevationArray[base + first] > grid->elevationArray[base + last];
+    int lower = -1;
+    unsigned int level = 0;
+    for (unsigned int i = 0; i < heightCount && level < profile->levelCount; i++){
+        const int index = base + (descending ? heightCount - 1 - i : i);
+        if (!grid->validArray[index]) continue;
+        for (; level < profile->levelCount && LevelHeight(profile, level) <= grid->elevationArray[index]; level++)
+            SetRayLevel(grid, lower, index, reach, level, ray, profile);
+        lower = index;
+    }
+    for (; level < profile->levelCount; level++)
+        SetRayLevel(grid, lower, -1, reach, level, ray, profile);
+}
+
+RayLevelProfile* CreateRayLevelProfile(const GeodeticGrid* grid, const float minHeight, const float heightGap, const unsigned int levelCount, const float maxVerticalDistance){
+    /**
+    @brief First stage of the separable resampling, every ray is interpolated in 1D onto the target heights
+    @param grid: the geodetic grid, its extra variables are resampled along
+    @param minHeight: the height of the first level
+    @param heightGap: the height step of the levels
+    @param levelCount: the number of levels
+    @param maxVerticalDistance: the max height difference between a level and a bin it takes, 0 for the max neighbor distance
+    @return the profile, NULL if failed
+    */
+    if (!grid || !grid->validArray || grid->lineCount == 0 || levelCount == 0){
+        fprintf(stderr, "Invalid geodetic grid for ray level profile\n");
+        return NULL;
+    }
+    RayLevelProfile* profile = (RayLevelProfile*)calloc(1, sizeof(RayLevelProfile));
+    if (!profile){
+        fprintf(stderr, "Failed to allocate memory for RayLevelProfile\n");
+        return NULL;
+    }
+    profile->rayCount = grid->lineCount * SCAN_ANGLE_COUNT;
+    profile->levelCount = levelCount;
+    profile->minHeight = minHeight;
+    profile->heightGap = heightGap;
+    const size_t count = (size_t)levelCount * profile->rayCount;
+    profile->latitude = (float*)malloc(count * sizeof(float));
+    profile->longitude = (float*)malloc(count * sizeof(float));
+    profile->value = (float*)malloc(count * sizeof(float));
+    if (grid->extraCount > 0 && grid->extraValueArrays){
+        profile->extraCount = grid->extraCount;
+        profile->extraValue = (float*)malloc(profile->extraCount * count * sizeof(float));
+    }
+    if (!profile->latitude || !profile->longitude || !profile->value || (profile->extraCount > 0 && !profile->extraValue)){
+        fprintf(stderr, "Failed to allocate memory for %u rays x %u levels\n", profile->rayCount, levelCount);
+        DestroyRayLevelProfile(profile);
+        return NULL;
+    }
+    const float reach = maxVerticalDistance > 0 ? maxVerticalDistance : g_config->max_neighbor_distance;
+    #pragma omp parallel for schedule(static)
+    for (unsigned int ray = 0; ray < profile->rayCount; ray++)
+        ResampleRay(grid, ray, reach, profile);
+    return profile;
+}
+
+void DestroyRayLevelProfile(RayLevelProfile* profile){
+    if (!profile) return;
+    free(profile->latitude);
+    free(profile->longitude);
+    free(profile->value);
+    free(profile->extraValue);
+    free(profile);
+}
+
+static inline void InsertNeighbor(const double distance, const int64_t id, const unsigned int k, unsigned int* count, double* distances, int64_t* ids){
+    // keep the k nearest in ascending order
+    if (*count == k && distance >= distances[k - 1]) return;
+    unsigned int position = *count < k ? (*count)++ : k - 1;
+    while (position > 0 && distances[position - 1] > distance){
+        distances[position] = distances[position - 1];
+        ids[position] = ids[position - 1];
+        position--;
+    }
+    distances[position] = distance;
+    ids[position] = id;
+}
+
+static unsigned int GatherLevelRays(const StructuredLocator* locator, const RayLevelProfile* profile, const unsigned int level, const unsigned int lineIndex, const unsigned int angleIndex, const int radius,
+                                    const double latitude, const double longitude, const double metersPerLatitude, const double metersPerLongitude, const unsigned int k, double* distances, int64_t* ids){
+    // k nearest footprints with data at the level among the rays within radius of the located ray, ids are rays
+    const unsigned int firstLine = lineIndex > (unsigned int)radius ? lineIndex - radius : 0;
+    const unsigned int lastLine = lineIndex + radius < locator->lineCount ? lineIndex + radius : locator->lineCount - 1;
+    const unsigned int firstAngle = angleIndex > (unsigned int)radius ? angleIndex - radius : 0;
+    const unsigned int lastAngle = angleIndex + radius < SCAN_ANGLE_COUNT ? angleIndex + radius : SCAN_ANGLE_COUNT - 1;
+    const size_t levelBase = (size_t)level * profile->rayCount;
+    const double maxDistance = g_config->max_neighbor_distance;
+    unsigned int count = 0;
+    for (unsigned int l = firstLine; l <= lastLine; l++)
+        for (unsigned int a = firstAngle; a <= lastAngle; a++){
+            const unsigned int ray = l * SCAN_ANGLE_COUNT + a;
+            if (profile->value[levelBase + ray] <= -999) continue;
+            const double north = (profile->latitude[levelBase + ray] - latitude) * metersPerLatitude;
+            const double east = WrapLongitudeDifference(profile->longitude[levelBase + ray] - longitude) * metersPerLongitude;
+            const double distance = sqrt(north * north + east * east);
+            if (distance <= maxDistance)
+                InsertNeighbor(distance, ray, k, &count, distances, ids);
+        }
+    return count;
+}
+
+static inline float LevelValue(const unsigned int count, const double* weights, const int64_t* ids, const float* levelValue){
+    // the weighted mean of the rays with a value at the level
+    double weightSum = 0.0, valueSum = 0.0;
+    for (unsigned int i = 0; i < count; i++){
+        const float value = levelValue[ids[i]];
+        if (value <= -999) continue;
+        weightSum += weights[i];
+        valueSum += weights[i] * value;
+    }
+    return weightSum > 0.0 ? (float)(valueSum / weightSum) : -999.0f;
+}
+
+bool InterpolateClipGridSeparable(const StructuredLocator* locator, const RayLevelProfile* profile, const unsigned int k, const float power, ClipGrid* clipGrid){
+    /**
+    @brief Second stage of the separable resampling, every level of the clip is interpolated in 2D from the ray footprints at that level
+    @param locator: the structured locator over the same geodetic grid, shared by every level
+    @param profile: the rays resampled onto the levels, see CreateRayLevelProfile
+    @param k: the number of rays of a cell, at most SEPARABLE_MAX_NEIGHBOR
+    @param power: the IDW power
+    @param clipGrid: the clip grid to interpolate, its heights must be levels of the profile, its extra variables take the weights of value
+    @return true if successful, false otherwise
+    */
+    if (!locator || !profile || !clipGrid || (!clipGrid->value && !clipGrid->sparse) || k == 0) return false;
+    if (clipGrid->extraCount > profile->extraCount){
+        fprintf(stderr, "The profile has %u extra variables, the clip needs %u\n", profile->extraCount, clipGrid->extraCount);
+        return false;
+    }
+    const size_t variableStride = (size_t)profile->levelCount * profile->rayCount;
+    const unsigned int neighborCount = k < SEPARABLE_MAX_NEIGHBOR ? k : SEPARABLE_MAX_NEIGHBOR;
+    const double e2 = WGS84_E * WGS84_E;
+    double distances[SEPARABLE_MAX_NEIGHBOR], weights[SEPARABLE_MAX_NEIGHBOR];
+    int64_t ids[SEPARABLE_MAX_NEIGHBOR];
+    unsigned int lineIndex = UINT_MAX, angleIndex = UINT_MAX;
+    for (unsigned int l = 0; l < clipGrid->longitudeCount; l++)
+        for (unsigned int b = 0; b < clipGrid->latitudeCount; b++){
+            const double latitude = clipGrid->minLatitude + b * clipGrid->latitudeGap;
+            const double longitude = clipGrid->minLongitude + l * clipGrid->longitudeGap;
+            // the local metric of the column, taken at the height of each level as the structured locator does
+            const double sinLatitude = sin(ToRadians(latitude));
+            const double w = sqrt(1 - e2 * sinLatitude * sinLatitude);
+            const double meridianRadius = WGS84_A * (1 - e2) / (w * w * w), primeVerticalRadius = WGS84_A / w;
+            for (unsigned int h = 0; h < clipGrid->heightCount; h++){
+                const double height = clipGrid->minHeight + h * clipGrid->heightGap;
+                const unsigned int index = l * clipGrid->latitudeCount * clipGrid->heightCount + b * clipGrid->heightCount + h;
+                const double level = round((height - profile->minHeight) / profile->heightGap);
+                SetClipValue(clipGrid, 0, index, -999);
+                for (unsigned int v = 0; v < clipGrid->extraCount; v++)
+                    SetClipValue(clipGrid, 1 + v, index, -999);
+                if (level < 0 || level >= profile->levelCount) continue;
+                // footprints move little between levels, the located ray warm starts the next level
+                if (!StructuredLocator_LocateColumn(locator, latitude, longitude, height, &lineIndex, &angleIndex)) continue;
+                const double metersPerLatitude = ToRadians(meridianRadius + height);
+                const double metersPerLongitude = ToRadians((primeVerticalRadius + height) * cos(ToRadians(latitude)));
+                unsigned int count = 0;
+                // grow the stencil while fewer than k rays have data at the level, e.g. at the echo top
+                for (int radius = locator->cellRadius > 0 ? locator->cellRadius : 1; count < neighborCount && radius <= STRUCTURED_MAX_CELL_RADIUS; radius++)
+                    count = GatherLevelRays(locator, profile, (unsigned int)level, lineIndex, angleIndex, radius, latitude, longitude, metersPerLatitude, metersPerLongitude, neighborCount, distances, ids);
+                if (count == 0) continue;
+                // the weights of the rays are computed once for value and every extra variable
+                const size_t levelBase = (size_t)level * profile->rayCount;
+                CalculateIDWWeights(count, distances, power, weights);
+                SetClipValue(clipGrid, 0, index, LevelValue(count, weights, ids, profile->value + levelBase));
+                for (unsigned int v = 0; v < clipGrid->extraCount; v++)
+                    SetClipValue(clipGrid, 1 + v, index, LevelValue(count, weights, ids, profile->extraValue + v * variableStride + levelBase));
+            }
+        }
+    return true;
+}
@@ -0,0 +1,354 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <float.h>
+#include <limits.h>
+#include "structured.h"
+#include "geotransfer.h"
+
+typedef struct {
+    double latitude, longitude, height;
+    double metersPerLatitude, metersPerLongitude; // local metric of the query, meter per degree
+} QueryFrame;
+
+static QueryFrame CreateQueryFrame(const double latitude, const double longitude, const double height){
+    const double e2 = WGS84_E * WGS84_E;
+    const double sinLatitude = sin(ToRadians(latitude));
+    const double w = sqrt(1 - e2 * sinLatitude * sinLatitude);
+    const double meridianRadius = WGS84_A * (1 - e2) / (w * w * w);
+    const double primeVerticalRadius = WGS84_A / w;
+    QueryFrame frame = {latitude, longitude, height, 0, 0};
+    // the metric is taken at the query height, bins far above the ellipsoid are otherwise pulled in by height / radius
+    frame.metersPerLatitude = ToRadians(meridianRadius + height);
+    frame.metersPerLongitude = ToRadians((primeVerticalRadius + height) * cos(ToRadians(latitude)));
+    return frame;
+}
+
+static inline void FootprintOffset(const ScanColumn* column, const QueryFrame* frame, double* north, double* east){
+    // offset in meter from the query to the footprint of the column at the query height
+    *north = (column->latitude + frame->height * column->latitudeSlope - frame->latitude) * frame->metersPerLatitude;
+    *east = WrapLongitudeDifference(column->longitude + frame->height * column->longitudeSlope - frame->longitude) * frame->metersPerLongitude;
+}
+
+static inline double FootprintDistanceSquared(const ScanColumn* column, const QueryFrame* frame){
+    double north, east;
+    FootprintOffset(column, frame, &north, &east);
+    return north * north + east * east;
+}
+
+static inline bool IsPlausibleBin(const GeodeticGrid* grid, const unsigned int index){
+    // geolocation of every bin is stored, but fill heights give meaningless coordinates
+    return fabsf(grid->latitudeArray[index]) <= 90 && fabsf(grid->elevationArray[index]) < 1e5f;
+}
+
+static void FitScanColumn(const GeodeticGrid* grid, const unsigned int columnIndex, ScanColumn* column){
+    /**
+    @brief Fit the straight ray of a column from its first and last plausible bins
+    @param grid: the geodetic grid
+    @param columnIndex: line * SCAN_ANGLE_COUNT + angle
+    @param column: output ray model
+    */
+    const unsigned int base = columnIndex * grid->heightCount;
+    int first = 0, last = grid->heightCount - 1;
+    while (first < last && !IsPlausibleBin(grid, base + first)) first++;
+    while (last > first && !IsPlausibleBin(grid, base + last)) last--;
+    const float heightDifference = grid->elevationArray[base + last] - grid->elevationArray[base + first];
+    column->latitudeSlope = column->longitudeSlope = column->binHeightStep = 0;
+    if (last > first && fabsf(heightDifference) > 1e-3f){
+        column->latitudeSlope = (grid->latitudeArray[base + last] - grid->latitudeArray[base + first]) / heightDifference;
+        column->longitudeSlope = WrapLongitudeDifference(grid->longitudeArray[base + last] - grid->longitudeArray[base + first]) / heightDifference;
+        column->binHeightStep = heightDifference / (last - first);
+    }
+    column->latitude = grid->latitudeArray[base + first] - grid->elevationArray[base + first] * column->latitudeSlope;
+    column->longitude = grid->longitudeArray[base + first] - grid->elevationArray[base + first] * column->longitudeSlope;
+    column->firstHeight = grid->elevationArray[base + first] - first * column->binHeightStep;
+}
+
+StructuredLocator* CreateStructuredLocator(const GeodeticGrid* grid, const unsigned int cellRadius, const unsigned int binRadius, const float verticalScale){
+    /**
+    @brief Create a locator over the line x angle x bin layout of the scan, no tree is built
+    @param grid: the geodetic grid, borrowed by the locator
+    @param cellRadius: half size of the stencil in line and angle
+    @param binRadius: half size of the stencil along the ray
+    @param verticalScale: weight of the height difference in the neighbor distance, as VERTICAL_SCALE
+    @return the locator, NULL if failed
+    */
+    if (!grid || grid->lineCount == 0 || grid->heightCount < 2 || !grid->latitudeArray){
+        fprintf(stderr, "Invalid geodetic grid for structured locator\n");
+        return NULL;
+    }
+    StructuredLocator* locator = (StructuredLocator*)malloc(sizeof(StructuredLocator));
+    if (!locator){
+        fprintf(stderr, "Failed to allocate memory for StructuredLocator\n");
+        return NULL;
+    }
+    const unsigned int columnCount = grid->lineCount * SCAN_ANGLE_COUNT;
+    locator->columns = (ScanColumn*)malloc(columnCount * sizeof(ScanColumn));
+    if (!locator->columns){
+        fprintf(stderr, "Failed to allocate memory for scan columns\n");
+        free(locator);
+        return NULL;
+    }
+    locator->grid = grid;
+    locator->lineCount = grid->lineCount;
+    locator->heightCount = grid->heightCount;
+    locator->cellRadius = cellRadius > STRUCTURED_MAX_CELL_RADIUS ? STRUCTURED_MAX_CELL_RADIUS : cellRadius;
+    locator->binRadius = binRadius > 0 ? binRadius : 1;
+    locator->verticalScale = verticalScale > 0 ? verticalScale : 1;
+    #pragma omp parallel for
+    for (unsigned int columnIndex = 0; columnIndex < columnCount; columnIndex++)
+        FitScanColumn(grid, columnIndex, &locator->columns[columnIndex]);
+    return locator;
+}
+
+void DestroyStructuredLocator(StructuredLocator* locator){
+    if (!locator) return;
+    free(locator->columns);
+    free(locator);
+}
+
+static inline const ScanColumn* GetScanColumn(const StructuredLocator* locator, const unsigned int lineIndex, const unsigned int angleIndex){
+    return &locator->columns[lineIndex * SCAN_ANGLE_COUNT + angleIndex];
+}
+
+static void CoarseLocate(const StructuredLocator* locator, const QueryFrame* frame, unsigned int* lineIndex, unsigned int* angleIndex){
+    // sparse scan of the whole swath, only used when there is no warm start
+    double best = DBL_MAX;
+    for (unsigned int l = 0; l < locator->lineCount; l += STRUCTURED_COARSE_LINE_STRIDE)
+        for (unsigned int a = 0; a < SCAN_ANGLE_COUNT; a += 4){
+            const double distance = FootprintDistanceSquared(GetScanColumn(locator, l, a), frame);
+            if (distance < best){
+                best = distance;
+                *lineIndex = l;
+                *angleIndex = a;
+            }
+        }
+}
+
+static void NewtonLocate(const StructuredLocator* locator, const QueryFrame* frame, unsigned int* lineIndex, unsigned int* angleIndex){
+    // Newton steps on the footprint, the jacobian is the finite difference to the next line and angle
+    for (unsigned int step = 0; step < STRUCTURED_MAX_NEWTON_STEP; step++){
+        const int l = *lineIndex, a = *angleIndex;
+        const int nextLine = l + 1 < (int)locator->lineCount ? l + 1 : l - 1;
+        const int nextAngle = a + 1 < SCAN_ANGLE_COUNT ? a + 1 : a - 1;
+        if (nextLine < 0 || nextAngle < 0) return;
+        double north, east, lineNorth, lineEast, angleNorth, angleEast;
+        FootprintOffset(GetScanColumn(locator, l, a), frame, &north, &east);
+        FootprintOffset(GetScanColumn(locator, nextLine, a), frame, &lineNorth, &lineEast);
+        FootprintOffset(GetScanColumn(locator, l, nextAngle), frame, &angleNorth, &angleEast);
+        lineNorth = (lineNorth - north) / (nextLine - l);
+        lineEast = (lineEast - east) / (nextLine - l);
+        angleNorth = (angleNorth - north) / (nextAngle - a);
+        angleEast = (angleEast - east) / (nextAngle - a);
+        const double determinant = lineNorth * angleEast - angleNorth * lineEast;
+        if (fabs(determinant) < 1e-6) return;
+        const double lineStep = round((-north * angleEast + angleNorth * east) / determinant);
+        const double angleStep = round((-lineNorth * east + north * lineEast) / determinant);
+        if (lineStep == 0 && angleStep == 0) return;
+        *lineIndex = (unsigned int)fmin(fmax(l + lineStep, 0), locator->lineCount - 1);
+        *angleIndex = (unsigned int)fmin(fmax(a + angleStep, 0), SCAN_ANGLE_COUNT - 1);
+    }
+}
+
+static double WalkLocate(const StructuredLocator* locator, const QueryFrame* frame, unsigned int* lineIndex, unsigned int* angleIndex){
+    // descend to the column whose footprint is nearest, fixes the rounding of the Newton steps
+    double best = FootprintDistanceSquared(GetScanColumn(locator, *lineIndex, *angleIndex), frame);
+    for (unsigned int step = 0; step < STRUCTURED_MAX_WALK_STEP; step++){
+        const unsigned int l = *lineIndex, a = *angleIndex;
+        bool moved = false;
+        for (int dl = -1; dl <= 1; dl++)
+            for (int da = -1; da <= 1; da++){
+                const int line = (int)l + dl, angle = (int)a + da;
+                if ((dl == 0 && da == 0) || line < 0 || angle < 0 || line >= (int)locator->lineCount || angle >= SCAN_ANGLE_COUNT) continue;
+                const double distance = FootprintDistanceSquared(GetScanColumn(locator, line, angle), frame);
+                if (distance < best){
+                    best = distance;
+                    *lineIndex = line;
+                    *angleIndex = angle;
+                    moved = true;
+                }
+            }
+        if (!moved) break;
+    }
+    return best;
+}
+
+static bool LocateColumn(const StructuredLocator* locator, const QueryFrame* frame, unsigned int* lineIndex, unsigned int* angleIndex){
+    bool warmStart = *lineIndex < locator->lineCount && *angleIndex < SCAN_ANGLE_COUNT;
+    if (!warmStart)
+        CoarseLocate(locator, frame, lineIndex, angleIndex);
+    NewtonLocate(locator, frame, lineIndex, angleIndex);
+    const double distance = WalkLocate(locator, frame, lineIndex, angleIndex);
+    if (!warmStart || locator->lineCount < 2) return true;
+    // a warm start far from the query may end on a local minimum at the swath edge, restart from the coarse scan
+    const unsigned int l = *lineIndex + 1 < locator->lineCount ? *lineIndex + 1 : *lineIndex - 1;
+    const unsigned int a = *angleIndex + 1 < SCAN_ANGLE_COUNT ? *angleIndex + 1 : *angleIndex - 1;
+    double north, east, cellNorth, cellEast;
+    FootprintOffset(GetScanColumn(locator, *lineIndex, *angleIndex), frame, &north, &east);
+    FootprintOffset(GetScanColumn(locator, l, a), frame, &cellNorth, &cellEast);
+    const double cellSize = (cellNorth - north) * (cellNorth - north) + (cellEast - east) * (cellEast - east);
+    if (distance <= 4 * cellSize) return true;
+    *lineIndex = *angleIndex = UINT_MAX;
+    return LocateColumn(locator, frame, lineIndex, angleIndex);
+}
+
+bool StructuredLocator_LocateColumn(const StructuredLocator* locator, const double latitude, const double longitude, const double height, unsigned int* lineIndex, unsigned int* angleIndex){
+    /**
+    @brief Find the column whose footprint at the given height is nearest to the point
+    @param locator: the structured locator
+    @param latitude: the latitude of the point
+    @param longitude: the longitude of the point
+    @param height: the height of the point
+    @param lineIndex: in: warm start line (UINT_MAX for none), out: the located line
+    @param angleIndex: in: warm start angle, out: the located angle
+    @return true if successful, false otherwise
+    */
+    if (!locator || !lineIndex || !angleIndex) return false;
+    const QueryFrame frame = CreateQueryFrame(latitude, longitude, height);
+    return LocateColumn(locator, &frame, lineIndex, angleIndex);
+}
+
+static inline unsigned int BinIndexAtHeight(const StructuredLocator* locator, const ScanColumn* column, const double height){
+    if (column->binHeightStep == 0) return 0;
+    const double bin = round((height - column->firstHeight) / column->binHeightStep);
+    return (unsigned int)fmin(fmax(bin, 0), locator->heightCount - 1);
+}
+
+typedef struct {
+    unsigned int base, centerBin; // first bin of the column in the grid, bin nearest to the query height
+    double binHeightStep; // scaled by the vertical scale, as the distances
+    double footprint; // squared horizontal distance from the query to the ray at the query height
+} StencilColumn;
+
+static void ScanStencilBins(const StructuredLocator* locator, const QueryFrame* frame, const unsigned int base, int firstBin, int lastBin, const unsigned int k, unsigned int* count, double* distances, int64_t* ids){
+    // insert the valid bins of [firstBin, lastBin] of a column into the k nearest, distances are squared
+    const GeodeticGrid* grid = locator->grid;
+    if (firstBin < 0) firstBin = 0;
+    if (lastBin >= (int)locator->heightCount) lastBin = locator->heightCount - 1;
+    for (int bin = firstBin; bin <= lastBin; bin++){
+        const unsigned int index = base + bin;
+        if (!grid->validArray[index]) continue;
+        const double north = (grid->latitudeArray[index] - frame->latitude) * frame->metersPerLatitude;
+        const double east = WrapLongitudeDifference(grid->longitudeArray[index] - frame->longitude) * frame->metersPerLongitude;
+        const double up = (grid->elevationArray[index] - frame->height) * locator->verticalScale;
+        const double distance = north * north + east * east + up * up;
+        if (*count == k && distance >= distances[k - 1]) continue;
+        unsigned int position = *count < k ? (*count)++ : k - 1;
+        while (position > 0 && distances[position - 1] > distance){
+            distances[position] = distances[position - 1];
+            ids[position] = ids[position - 1];
+            position--;
+        }
+        distances[position] = distance;
+        ids[position] = index;
+    }
+}
+
+static unsigned int GatherStencil(const StructuredLocator* locator, const QueryFrame* frame, const unsigned int lineIndex, const unsigned int angleIndex, const int radius, const unsigned int k, double* distances, int64_t* ids){
+    // k nearest valid bins of the columns within radius of the located column, distances are squared
+    const unsigned int firstLine = lineIndex > (unsigned int)radius ? lineIndex - radius : 0;
+    const unsigned int lastLine = lineIndex + radius < locator->lineCount ? lineIndex + radius : locator->lineCount - 1;
+    const unsigned int firstAngle = angleIndex > (unsigned int)radius ? angleIndex - radius : 0;
+    const unsigned int lastAngle = angleIndex + radius < SCAN_ANGLE_COUNT ? angleIndex + radius : SCAN_ANGLE_COUNT - 1;
+    StencilColumn stencil[STRUCTURED_MAX_STENCIL_COLUMN];
+    unsigned int columnCount = 0;
+    for (unsigned int l = firstLine; l <= lastLine; l++)
+        for (unsigned int a = firstAngle; a <= lastAngle; a++){
+            const ScanColumn* column = GetScanColumn(locator, l, a);
+            StencilColumn* stencilColumn = &stencil[columnCount++];
+            stencilColumn->base = (l * SCAN_ANGLE_COUNT + a) * locator->heightCount;
+            stencilColumn->centerBin = BinIndexAtHeight(locator, column, frame->height);
+            stencilColumn->binHeightStep = fabs(column->binHeightStep) * locator->verticalScale;
+            stencilColumn->footprint = FootprintDistanceSquared(column, frame);
+        }
+
+    // widen the window of every column until k valid bins are found, e.g. above the echo top, each round only scans the added bins
+    unsigned int count = 0, binRadius = locator->binRadius;
+    for (unsigned int previousRadius = 0; ; previousRadius = binRadius, binRadius *= 2){
+        for (unsigned int i = 0; i < columnCount; i++){
+            const int center = stencil[i].centerBin;
+            if (previousRadius == 0)
+                ScanStencilBins(locator, frame, stencil[i].base, center - (int)binRadius, center + (int)binRadius, k, &count, distances, ids);
+            else{
+                ScanStencilBins(locator, frame, stencil[i].base, center - (int)binRadius, center - (int)previousRadius - 1, k, &count, distances, ids);
+                ScanStencilBins(locator, frame, stencil[i].base, center + (int)previousRadius + 1, center + (int)binRadius, k, &count, distances, ids);
+            }
+        }
+        if (count == k || binRadius >= locator->heightCount) break;
+    }
+    // a bin outside the window is at least the footprint distance plus the window half height away, extend the columns that may still hold a nearer bin
+    if (count == k)
+        for (unsigned int i = 0; i < columnCount; i++){
+            const double verticalReach = distances[k - 1] - stencil[i].footprint;
+            if (verticalReach <= 0) continue;
+            const double reachRadius = stencil[i].binHeightStep > 0 ? ceil(sqrt(verticalReach) / stencil[i].binHeightStep) : locator->heightCount;
+            const int needRadius = (int)fmin(reachRadius, locator->heightCount);
+            if (needRadius <= (int)binRadius) continue;
+            const int center = stencil[i].centerBin;
+            ScanStencilBins(locator, frame, stencil[i].base, center - needRadius, center - (int)binRadius - 1, k, &count, distances, ids);
+            ScanStencilBins(locator, frame, stencil[i].base, center + (int)binRadius + 1, center + needRadius, k, &count, distances, ids);
+        }
+    return count;
+}
+
+static double RingFootprintDistanceSquared(const StructuredLocator* locator, const QueryFrame* frame, const unsigned int lineIndex, const unsigned int angleIndex, const int radius){
+    // nearest footprint among the columns exactly radius away from the located column
+    double best = DBL_MAX;
+    for (int dl = -radius; dl <= radius; dl++)
+        for (int da = -radius; da <= radius; da++){
+            if (abs(dl) != radius && abs(da) != radius) continue;
+            const int line = (int)lineIndex + dl, angle = (int)angleIndex + da;
+            if (line < 0 || angle < 0 || line >= (int)locator->lineCount || angle >= SCAN_ANGLE_COUNT) continue;
+            best = fmin(best, FootprintDistanceSquared(GetScanColumn(locator, line, angle), frame));
+        }
+    return best;
+}
+
+unsigned int StructuredLocator_NearestNeighborQuery(const StructuredLocator* locator, const double queryGeodetic[3], const unsigned int k, unsigned int* lineIndex, unsigned int* angleIndex, double* distances, int64_t* ids){
+    /**
+    @brief Query the k nearest valid bins inside the line x angle x bin stencil around the located column
+    @param locator: the structured locator
+    @param queryGeodetic: latitude, longitude and height of the query
+    @param k: the number of neighbors
+    @param lineIndex: in/out warm start, see StructuredLocator_LocateColumn
+    @param angleIndex: in/out warm start
+    @param distances: output distances in meter in ascending order [k]
+    @param ids: output ids in the geodetic grid [k]
+    @return the number of neighbors found
+    */
+    const QueryFrame frame = CreateQueryFrame(queryGeodetic[0], queryGeodetic[1], queryGeodetic[2]);
+    if (!LocateColumn(locator, &frame, lineIndex, angleIndex)) return 0;
+    unsigned int count = 0;
+    // grow the stencil by one ring while the next ring of rays passes nearer than the k-th neighbor
+    for (int radius = locator->cellRadius; ; radius++){
+        count = GatherStencil(locator, &frame, *lineIndex, *angleIndex, radius, k, distances, ids);
+        if (radius >= STRUCTURED_MAX_CELL_RADIUS) break;
+        const double kthDistance = count == k ? distances[k - 1] : DBL_MAX;
+        if (kthDistance <= RingFootprintDistanceSquared(locator, &frame, *lineIndex, *angleIndex, radius + 1)) break;
+    }
+    for (unsigned int i = 0; i < count; i++)
+        distances[i] = sqrt(distances[i]);
+    return count;
+}
+
+bool StructuredLocator_NearestNeighborBatchQuery(const StructuredLocator* locator, const unsigned int k, const unsigned int queryCount, const double* queryGeodetic, int64_t* ids, uint64_t* counts, double* distances){
+    /**
+    @brief Query a batch of points in order, each query is warm started from the previous one
+    @param locator: the structured locator
+    @param k: the number of neighbors
+    @param queryCount: the number of query points
+    @param queryGeodetic: latitude, longitude and height of the queries [queryCount][3]
+    @param ids: output ids, results of each query packed one after another
+    @param counts: output result count of each query
+    @param distances: output distances, packed as ids
+    @return true if successful, false otherwise
+    */
+    if (!locator || !queryGeodetic || !ids || !counts || !distances || k == 0) return false;
+    unsigned int lineIndex = UINT_MAX, angleIndex = UINT_MAX;
+    size_t resultIndex = 0;
+    for (unsigned int i = 0; i < queryCount; i++){
+        counts[i] = StructuredLocator_NearestNeighborQuery(locator, &queryGeodetic[i * 3], k, &lineIndex, &angleIndex, distances + resultIndex, ids + resultIndex);
+        resultIndex += counts[i];
+    }
+    return true;
+}
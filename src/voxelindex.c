@@ -0,0 +1,311 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <float.h>
+#include "voxelindex.h"
+#include "knnindex.h"
+#include "morton.h"
+
+static inline uint64_t VoxelKey(const VoxelIndex* index, const uint64_t cx, const uint64_t cy, const uint64_t cz){
+    return (cz * index->cellCountY + cy) * index->cellCountX + cx;
+}
+
+static inline unsigned int VoxelSlot(const VoxelIndex* index, const uint64_t key){
+    // fibonacci hashing, the top bits are well mixed
+    return (unsigned int)((key * 0x9E3779B97F4A7C15ull) >> index->slotShift);
+}
+
+static int CompareVoxelOffset(const void* a, const void* b){
+    const float da = ((const VoxelOffset*)a)->minDistance, db = ((const VoxelOffset*)b)->minDistance;
+    return (da > db) - (da < db);
+}
+
+static bool BuildVoxelOffsets(VoxelIndex* index){
+    /**
+    @brief List the voxels within ringCount rings of the center voxel, nearest first
+    @param index: the index, ringCount must be set
+    @return true if successful, false otherwise
+    */
+    const int ring = (int)index->ringCount;
+    const unsigned int side = 2 * ring + 1;
+    index->offsets = (VoxelOffset*)malloc(side * side * side * sizeof(VoxelOffset));
+    if (!index->offsets) return false;
+    index->offsetCount = 0;
+    for (int dz = -ring; dz <= ring; dz++)
+        for (int dy = -ring; dy <= ring; dy++)
+            for (int dx = -ring; dx <= ring; dx++){
+                // a query anywhere in the center voxel is at least |d| - 1 cells away on each axis
+                const float gx = abs(dx) > 0 ? abs(dx) - 1 : 0;
+                const float gy = abs(dy) > 0 ? abs(dy) - 1 : 0;
+                const float gz = abs(dz) > 0 ? abs(dz) - 1 : 0;
+                VoxelOffset* offset = &index->offsets[index->offsetCount++];
+                offset->dx = dx;
+                offset->dy = dy;
+                offset->dz = dz;
+                offset->minDistance = gx * gx + gy * gy + gz * gz;
+            }
+    qsort(index->offsets, index->offsetCount, sizeof(VoxelOffset), CompareVoxelOffset);
+    return true;
+}
+
+static bool BuildVoxelHash(VoxelIndex* index){
+    /**
+    @brief Build the open addressing table from voxel key to cell, at most half full
+    @param index: the index, cellKeys must be filled
+    @return true if successful, false otherwise
+    */
+    unsigned int slotBits = 4;
+    while ((1u << slotBits) < 2 * index->cellCount) slotBits++;
+    index->slotMask = (1u << slotBits) - 1;
+    index->slotShift = 64 - slotBits;
+    index->slots = (uint32_t*)malloc(((size_t)index->slotMask + 1) * sizeof(uint32_t));
+    if (!index->slots) return false;
+    memset(index->slots, 0xFF, ((size_t)index->slotMask + 1) * sizeof(uint32_t));
+    for (unsigned int cell = 0; cell < index->cellCount; cell++){
+        unsigned int slot = VoxelSlot(index, index->cellKeys[cell]);
+        while (index->slots[slot] != VOXEL_EMPTY_SLOT)
+            slot = (slot + 1) & index->slotMask;
+        index->slots[slot] = cell;
+    }
+    return true;
+}
+
+static inline unsigned int FindVoxelCell(const VoxelIndex* index, const uint64_t key){
+    unsigned int slot = VoxelSlot(index, key);
+    while (true){
+        const uint32_t cell = index->slots[slot];
+        if (cell == VOXEL_EMPTY_SLOT || index->cellKeys[cell] == key) return cell;
+        slot = (slot + 1) & index->slotMask;
+    }
+}
+
+VoxelIndex* CreateVoxelIndex(const RStarPoint* points, const unsigned int startIndex, const unsigned int endIndex, const float radius, const unsigned int ringCount){
+    /**
+    @brief Create an immutable voxel hash over the valid points of a point batch range, for fixed radius neighbor gathering
+    @param points: the point store, invalid points have h == -1
+    @param startIndex: the start index of the range
+    @param endIndex: the end index of the range (exclusive)
+    @param radius: the search radius, neighbors farther than it are never returned
+    @param ringCount: the number of voxel rings covering the radius, the cell edge is radius / ringCount
+    @return the voxel index, NULL if failed or there is no valid point
+    */
+    if (!points || startIndex >= endIndex || radius <= 0){
+        fprintf(stderr, "Invalid point range for voxel index\n");
+        return NULL;
+    }
+    unsigned int validPointCount = 0;
+    double min[3] = {DBL_MAX, DBL_MAX, DBL_MAX}, max[3] = {-DBL_MAX, -DBL_MAX, -DBL_MAX};
+    for (unsigned int i = startIndex; i < endIndex; i++){
+        const RStarPoint* point = &points[i];
+        if (point->h == -1) continue;
+        min[0] = fmin(min[0], point->x); max[0] = fmax(max[0], point->x);
+        min[1] = fmin(min[1], point->y); max[1] = fmax(max[1], point->y);
+        min[2] = fmin(min[2], point->z); max[2] = fmax(max[2], point->z);
+        ++validPointCount;
+    }
+    if (validPointCount == 0){
+        fprintf(stderr, "No valid points for voxel index\n");
+        return NULL;
+    }
+
+    VoxelIndex* index = (VoxelIndex*)calloc(1, sizeof(VoxelIndex));
+    if (!index){
+        fprintf(stderr, "Failed to allocate memory for VoxelIndex\n");
+        return NULL;
+    }
+    index->ringCount = ringCount < 1 ? 1 : (ringCount > VOXEL_MAX_RING_COUNT ? VOXEL_MAX_RING_COUNT : ringCount);
+    index->radius = radius;
+    index->cellSize = radius / index->ringCount;
+    index->pointCount = validPointCount;
+    memcpy(index->origin, min, sizeof(min));
+    unsigned int* cellCounts[3] = {&index->cellCountX, &index->cellCountY, &index->cellCountZ};
+    for (unsigned int d = 0; d < 3; d++){
+        const double cellCount = floor((max[d] - min[d]) / index->cellSize) + 1;
+        if (cellCount >= VOXEL_MAX_AXIS_CELL){
+            fprintf(stderr, "Voxel grid is too fine for the point extent, increase the search radius\n");
+            DestroyVoxelIndex(index);
+            return NULL;
+        }
+        *cellCounts[d] = (unsigned int)cellCount;
+    }
+
+    uint64_t* keys = (uint64_t*)malloc((size_t)validPointCount * sizeof(uint64_t));
+    uint32_t* order = (uint32_t*)malloc((size_t)validPointCount * sizeof(uint32_t));
+    if (!keys || !order){
+        fprintf(stderr, "Failed to allocate voxel keys\n");
+        free(keys);
+        free(order);
+        DestroyVoxelIndex(index);
+        return NULL;
+    }
+    unsigned int validIndex = 0;
+    for (unsigned int i = startIndex; i < endIndex; i++){
+        const RStarPoint* point = &points[i];
+        if (point->h == -1) continue;
+        const uint64_t cx = (uint64_t)((point->x - min[0]) / index->cellSize);
+        const uint64_t cy = (uint64_t)((point->y - min[1]) / index->cellSize);
+        const uint64_t cz = (uint64_t)((point->z - min[2]) / index->cellSize);
+        keys[validIndex] = VoxelKey(index, cx, cy, cz);
+        order[validIndex++] = i;
+    }
+    const uint64_t maxKey = VoxelKey(index, index->cellCountX - 1, index->cellCountY - 1, index->cellCountZ - 1);
+    if (!RadixSortKeys(keys, order, validPointCount, maxKey)){
+        fprintf(stderr, "Failed to sort voxel keys\n");
+        free(keys);
+        free(order);
+        DestroyVoxelIndex(index);
+        return NULL;
+    }
+
+    index->cellCount = 1;
+    for (unsigned int i = 1; i < validPointCount; i++)
+        if (keys[i] != keys[i - 1]) index->cellCount++;
+    index->x = (float*)malloc(validPointCount * sizeof(float));
+    index->y = (float*)malloc(validPointCount * sizeof(float));
+    index->z = (float*)malloc(validPointCount * sizeof(float));
+    index->ids = (uint32_t*)malloc(validPointCount * sizeof(uint32_t));
+    index->cellKeys = (uint64_t*)malloc(index->cellCount * sizeof(uint64_t));
+    index->cellStarts = (uint32_t*)malloc((index->cellCount + 1) * sizeof(uint32_t));
+    if (!index->x || !index->y || !index->z || !index->ids || !index->cellKeys || !index->cellStarts){
+        fprintf(stderr, "Failed to allocate arrays for voxel index\n");
+        free(keys);
+        free(order);
+        DestroyVoxelIndex(index);
+        return NULL;
+    }
+    unsigned int cell = 0;
+    for (unsigned int i = 0; i < validPointCount; i++){
+        const RStarPoint* point = &points[order[i]];
+        index->x[i] = (float)(point->x - min[0]);
+        index->y[i] = (float)(point->y - min[1]);
+        index->z[i] = (float)(point->z - min[2]);
+        index->ids[i] = (uint32_t)point->id;
+        if (i == 0 || keys[i] != keys[i - 1]){
+            index->cellKeys[cell] = keys[i];
+            index->cellStarts[cell++] = i;
+        }
+    }
+    index->cellStarts[index->cellCount] = validPointCount;
+    free(keys);
+    free(order);
+
+    if (!BuildVoxelHash(index) || !BuildVoxelOffsets(index)){
+        fprintf(stderr, "Failed to build voxel hash\n");
+        DestroyVoxelIndex(index);
+        return NULL;
+    }
+    return index;
+}
+
+void DestroyVoxelIndex(VoxelIndex* index){
+    if (!index) return;
+    free(index->x);
+    free(index->y);
+    free(index->z);
+    free(index->ids);
+    free(index->cellKeys);
+    free(index->cellStarts);
+    free(index->slots);
+    free(index->offsets);
+    free(index);
+}
+
+size_t VoxelIndex_MemoryUsage(const VoxelIndex* index){
+    if (!index) return 0;
+    return sizeof(VoxelIndex) + (size_t)index->pointCount * (3 * sizeof(float) + sizeof(uint32_t))
+         + (size_t)index->cellCount * (sizeof(uint64_t) + sizeof(uint32_t))
+         + ((size_t)index->slotMask + 1) * sizeof(uint32_t) + (size_t)index->offsetCount * sizeof(VoxelOffset);
+}
+
+static inline float CellAxisDistance(const VoxelIndex* index, const int64_t cell, const float q){
+    // distance along one axis from the query to the slab of a voxel, zero inside
+    const float low = cell * index->cellSize;
+    return MaxFloat(MaxFloat(low - q, q - low - index->cellSize), 0.0f);
+}
+
+unsigned int VoxelIndex_NearestNeighborQuery(const VoxelIndex* index, const double queryPoint[3], const unsigned int k, float* heapDistances, uint32_t* heapIds){
+    /**
+    @brief Query the k nearest neighbors of a point within the search radius of the index
+    @param index: the voxel index
+    @param queryPoint: the query point in cartesian coordinates
+    @param k: the number of neighbors
+    @param heapDistances: buffer of size k, receive the squared distances in ascending order
+    @param heapIds: buffer of size k, receive the point ids in the same order
+    @return the number of neighbors found, less than k if the radius holds fewer points
+    */
+    if (!index || !queryPoint || k == 0) return 0;
+    const float qx = (float)(queryPoint[0] - index->origin[0]);
+    const float qy = (float)(queryPoint[1] - index->origin[1]);
+    const float qz = (float)(queryPoint[2] - index->origin[2]);
+    const int64_t cx = (int64_t)floorf(qx / index->cellSize);
+    const int64_t cy = (int64_t)floorf(qy / index->cellSize);
+    const int64_t cz = (int64_t)floorf(qz / index->cellSize);
+    const float radiusSquared = index->radius * index->radius;
+    const float cellSizeSquared = index->cellSize * index->cellSize;
+    float scan[VOXEL_SCAN_CHUNK];
+    unsigned int size = 0;
+    for (unsigned int o = 0; o < index->offsetCount; o++){
+        const VoxelOffset* offset = &index->offsets[o];
+        const float bound = size == k ? MinFloat(heapDistances[0], radiusSquared) : radiusSquared;
+        if (offset->minDistance * cellSizeSquared > bound) break; // offsets are sorted, the rest are farther
+        const int64_t x = cx + offset->dx, y = cy + offset->dy, z = cz + offset->dz;
+        if (x < 0 || y < 0 || z < 0 || x >= index->cellCountX || y >= index->cellCountY || z >= index->cellCountZ) continue;
+        const float gx = CellAxisDistance(index, x, qx), gy = CellAxisDistance(index, y, qy), gz = CellAxisDistance(index, z, qz);
+        if (gx * gx + gy * gy + gz * gz > bound) continue;
+        const unsigned int cell = FindVoxelCell(index, VoxelKey(index, x, y, z));
+        if (cell == VOXEL_EMPTY_SLOT) continue;
+        for (unsigned int start = index->cellStarts[cell]; start < index->cellStarts[cell + 1]; start += VOXEL_SCAN_CHUNK){
+            const unsigned int count = index->cellStarts[cell + 1] - start < VOXEL_SCAN_CHUNK ? index->cellStarts[cell + 1] - start : VOXEL_SCAN_CHUNK;
+            const float* px = index->x + start;
+            const float* py = index->y + start;
+            const float* pz = index->z + start;
+            #pragma omp simd
+            for (unsigned int i = 0; i < count; i++){
+                const float dx = px[i] - qx, dy = py[i] - qy, dz = pz[i] - qz;
+                scan[i] = dx * dx + dy * dy + dz * dz;
+            }
+            for (unsigned int i = 0; i < count; i++)
+                if (scan[i] <= radiusSquared && (size < k || scan[i] < heapDistances[0]))
+                    PushBoundedHeap(heapDistances, heapIds, &size, k, scan[i], index->ids[start + i]);
+        }
+    }
+    SortBoundedHeap(heapDistances, heapIds, size);
+    return size;
+}
+
+bool VoxelIndex_NearestNeighborBatchQuery(const VoxelIndex* index, const unsigned int k, const unsigned int queryCount, const double* queryPoints, int64_t* ids, uint64_t* counts, double* distances){
+    /**
+    @brief Query the k nearest neighbors within the search radius of a batch of points, the output layout matches Index_NearestNeighbors_id_v
+    @param index: the voxel index
+    @param k: the number of neighbors
+    @param queryCount: the number of query points
+    @param queryPoints: the query points [queryCount][3]
+    @param ids: output ids, results of each query packed one after another
+    @param counts: output result count of each query, may be less than k
+    @param distances: output distances, packed as ids
+    @return true if successful, false otherwise
+    */
+    if (!index || !queryPoints || !ids || !counts || !distances || k == 0) return false;
+    float* heapDistances = (float*)malloc(k * sizeof(float));
+    uint32_t* heapIds = (uint32_t*)malloc(k * sizeof(uint32_t));
+    if (!heapDistances || !heapIds){
+        fprintf(stderr, "Failed to allocate heap for voxel batch query\n");
+        free(heapDistances);
+        free(heapIds);
+        return false;
+    }
+    size_t resultIndex = 0;
+    for (unsigned int i = 0; i < queryCount; i++){
+        const unsigned int count = VoxelIndex_NearestNeighborQuery(index, queryPoints + (size_t)i * 3, k, heapDistances, heapIds);
+        for (unsigned int j = 0; j < count; j++){
+            ids[resultIndex + j] = heapIds[j];
+            distances[resultIndex + j] = sqrt((double)heapDistances[j]);
+        }
+        counts[i] = count;
+        resultIndex += count;
+    }
+    free(heapDistances);
+    free(heapIds);
+    return true;
+}
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "writebehind.h"
+#include "interface.h"
+#include "config.h"
+
+static void* WriteClipsBehind(void* argument){
+    // the only thread in HDF5 until CloseClipWriter joins it
+    ClipWriter* writer = (ClipWriter*)argument;
+    // a team of its own packs the chunks, kept small beside the interpolation team
+    omp_set_num_threads(g_config && g_config->write_threads > 0 ? (int)g_config->write_threads : DEFAULT_WRITE_THREADS);
+    pthread_mutex_lock(&writer->mutex);
+    while (true){
+        while (writer->writtenCount == writer->submittedCount && !writer->closing)
+            pthread_cond_wait(&writer->submitted, &writer->mutex);
+        if (writer->writtenCount == writer->submittedCount) break; // closing and drained
+        const unsigned int clipIndex = writer->queue[writer->writtenCount];
+        pthread_mutex_unlock(&writer->mutex);
+
+        ClipGrid* clipGrid = &writer->clipResult->clipGrids[clipIndex];
+        bool written = false;
+        if (writer->flat)
+            written = WriteFlatClip(writer->flat, clipIndex, clipGrid);
+        else if (writer->perClip)
+            written = WriteClipFile(writer->bandIndex, writer->filename, clipIndex, clipGrid) && LinkClipFile(writer->bandGroupID, writer->bandIndex, writer->filename, clipIndex);
+        else
+            written = WriteClipGroup(writer->bandGroupID, clipIndex, clipGrid);
+        ReleaseClipGridCells(clipGrid);
+
+        pthread_mutex_lock(&writer->mutex);
+        writer->success = writer->success && written;
+        writer->writtenCount++;
+        pthread_cond_broadcast(&writer->written);
+    }
+    pthread_mutex_unlock(&writer->mutex);
+    return NULL;
+}
+
+ClipWriter* CreateClipWriter(const unsigned int bandIndex, const char* filename, ClipGridResult* clipResult, const unsigned int depth){
+    /**
+    @brief Open the band group of the clip output file, or the flat container of the band, and start a thread writing the clips as they are submitted
+    @param bandIndex: the band index
+    @param filename: the name of the HDF5 file, created by the first band, see ConstructFlatClipFilename for OUTPUT_FORMAT=FLAT
+    @param clipResult: the clips, their cells are freed as they are written
+    @param depth: the submitted clips waiting to be written at most, at least 1
+    @return the writer, NULL if failed
+    */
+    ClipWriter* writer = (ClipWriter*)calloc(1, sizeof(ClipWriter));
+    if (!writer){
+        fprintf(stderr, "Failed to allocate memory for ClipWriter\n");
+        return NULL;
+    }
+    writer->clipResult = clipResult;
+    writer->bandIndex = bandIndex;
+    writer->depth = depth > 0 ? depth : 1;
+    writer->success = true;
+    writer->queue = (unsigned int*)malloc((clipResult->clipCount > 0 ? clipResult->clipCount : 1) * sizeof(unsigned int));
+    writer->filename = strdup(filename);
+    writer->perClip = g_config && g_config->output_layout == OUTPUT_LAYOUT_PER_CLIP;
+    if (!writer->queue || !writer->filename){
+        fprintf(stderr, "Failed to allocate memory for the write-behind queue\n");
+        free(writer->queue);
+        free(writer->filename);
+        free(writer);
+        return NULL;
+    }
+    writer->fileID = writer->bandGroupID = H5I_INVALID_HID;
+    if (g_config && g_config->output_format == OUTPUT_FORMAT_FLAT){
+        char* flatFileName = ConstructFlatClipFilename(filename, bandIndex);
+        writer->flat = flatFileName ? CreateFlatClipWriter(bandIndex, flatFileName, clipResult) : NULL;
+        free(flatFileName);
+        if (!writer->flat){
+            free(writer->queue);
+            free(writer->filename);
+            free(writer);
+            return NULL;
+        }
+    }
+    else{
+        writer->fileID = OpenClipOutputFile(bandIndex, filename);
+        if (writer->fileID < 0){
+            free(writer->queue);
+            free(writer->filename);
+            free(writer);
+            return NULL;
+        }
+        const char* bandName = BAND_NAMES[bandIndex];
+        writer->bandGroupID = H5Gcreate(writer->fileID, ConstructPath((const char*[]){bandName}, 1), H5P_DEFAULT, H5P_DEFAULT, H5P_DEFAULT);
+        if (writer->bandGroupID < 0){
+            fprintf(stderr, "Failed to create group: %s\n", bandName);
+            H5Fclose(writer->fileID);
+            free(writer->queue);
+            free(writer->filename);
+            free(writer);
+            return NULL;
+        }
+    }
+    pthread_mutex_init(&writer->mutex, NULL);
+    pthread_cond_init(&writer->submitted, NULL);
+    pthread_cond_init(&writer->written, NULL);
+    if (pthread_create(&writer->thread, NULL, WriteClipsBehind, writer) != 0){
+        fprintf(stderr, "Failed to start the clip writer thread\n");
+        pthread_cond_destroy(&writer->written);
+        pthread_cond_destroy(&writer->submitted);
+        pthread_mutex_destroy(&writer->mutex);
+        if (writer->flat) CloseFlatClipWriter(writer->flat);
+        else{
+            H5Gclose(writer->bandGroupID);
+            H5Fclose(writer->fileID);
+        }
+        free(writer->queue);
+        free(writer->filename);
+        free(writer);
+        return NULL;
+    }
+    return writer;
+}
+
+bool SubmitClip(ClipWriter* writer, const unsigned int clipIndex){
+    /**
+    @brief Queue a finished clip for the writer thread, wait while depth clips are already waiting
+    @param writer: the writer, called by any thread
+    @param clipIndex: the clip, submitted once and untouched after, the writer frees its cells
+    @return true if successful, false otherwise
+    */
+    if (clipIndex >= writer->clipResult->clipCount) return false;
+    pthread_mutex_lock(&writer->mutex);
+    while (writer->submittedCount - writer->writtenCount >= writer->depth)
+        pthread_cond_wait(&writer->written, &writer->mutex);
+    writer->queue[writer->submittedCount++] = clipIndex;
+    const unsigned int pendingCount = writer->submittedCount - writer->writtenCount;
+    if (pendingCount > writer->peakPendingCount) writer->peakPendingCount = pendingCount;
+    pthread_cond_signal(&writer->submitted);
+    pthread_mutex_unlock(&writer->mutex);
+    return true;
+}
+
+bool CloseClipWriter(ClipWriter* writer){
+    /**
+    @brief Wait for the submitted clips to be written, write the global attribute with the first band, then close the file and free the writer; a flat container gets its header instead
+    @param writer: the writer, NULL does nothing
+    @return true if every submitted clip is written, false otherwise
+    */
+    if (!writer) return true;
+    pthread_mutex_lock(&writer->mutex);
+    writer->closing = true;
+    pthread_cond_signal(&writer->submitted);
+    pthread_mutex_unlock(&writer->mutex);
+    pthread_join(writer->thread, NULL);
+
+    bool success = writer->success;
+    if (writer->flat)
+        success = CloseFlatClipWriter(writer->flat) && success;
+    else{
+        H5Gclose(writer->bandGroupID);
+        if (writer->bandIndex == 0 && !WriteGlobalAttribute(writer->fileID, &writer->clipResult->globalAttribute)){
+            fprintf(stderr, "Failed to write global attribute\n");
+            success = false;
+        }
+        H5Fclose(writer->fileID);
+    }
+    pthread_cond_destroy(&writer->written);
+    pthread_cond_destroy(&writer->submitted);
+    pthread_mutex_destroy(&writer->mutex);
+    free(writer->queue);
+    free(writer->filename);
+    free(writer);
+    return success;
+}
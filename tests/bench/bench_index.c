@@ -0,0 +1,435 @@
+#include <math.h>
+#include <malloc.h>
+#include <omp.h>
+#include "bench_suites.h"
+#include "profile.h"
+#include "config.h"
+#include "interpolate.h"
+#include "core.h"
+
+#define BENCH_QUERY_COUNT 200000
+#define BENCH_CLIP_QUERY_COUNT 20000
+
+typedef struct {
+    double buildSeconds, querySeconds;
+    size_t memoryBytes; // resident memory kept by the index
+    size_t peakBytes; // peak resident memory above the baseline during the build
+} IndexBenchResult;
+
+static void StartBuildMeasure(size_t* memoryBefore){
+    malloc_trim(0);
+    ResetPeakResidentMemory();
+    *memoryBefore = GetResidentMemory();
+}
+
+static void StopBuildMeasure(const size_t memoryBefore, IndexBenchResult* result){
+    const size_t memoryAfter = GetResidentMemory(), peak = GetPeakResidentMemory();
+    result->memoryBytes = memoryAfter > memoryBefore ? memoryAfter - memoryBefore : 0;
+    result->peakBytes = peak > memoryBefore ? peak - memoryBefore : 0;
+}
+
+static void PrintIndexBenchResult(const char* name, const IndexBenchResult* result, unsigned int queryCount){
+    printf("%-8s build %8.3f s  memory %9.1f MB  peak %9.1f MB  query %10.0f q/s\n", name, result->buildSeconds, ToMegaBytes(result->memoryBytes), ToMegaBytes(result->peakBytes), queryCount / result->querySeconds);
+}
+
+void bench_index(const SyntheticGranule* granule){
+    /**
+    @brief Compare build time, memory and query throughput of the R* tree and the static KNN index on identical inputs
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("R* tree vs static KNN index");
+    const unsigned int endIndex = granule->lineCount * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+    const unsigned int k = g_config->k_neighbor;
+    double* queryPoints = CreateSyntheticQueries(granule, 0, granule->lineCount, BENCH_QUERY_COUNT, NULL);
+    int64_t* rstarIds = (int64_t*)malloc((size_t)BENCH_QUERY_COUNT * k * sizeof(int64_t));
+    double* rstarDistances = (double*)malloc((size_t)BENCH_QUERY_COUNT * k * sizeof(double));
+    uint64_t* rstarCounts = (uint64_t*)malloc(BENCH_QUERY_COUNT * sizeof(uint64_t));
+    int64_t* knnIds = (int64_t*)malloc((size_t)BENCH_QUERY_COUNT * k * sizeof(int64_t));
+    double* knnDistances = (double*)malloc((size_t)BENCH_QUERY_COUNT * k * sizeof(double));
+    uint64_t* knnCounts = (uint64_t*)malloc(BENCH_QUERY_COUNT * sizeof(uint64_t));
+    if (!queryPoints || !rstarIds || !rstarDistances || !rstarCounts || !knnIds || !knnDistances || !knnCounts){
+        fprintf(stderr, "Failed to allocate benchmark buffers\n");
+        return;
+    }
+
+    IndexBenchResult rstarResult, knnResult;
+    IndexForest forest = {0};
+    forest.RStarForestSize = 1;
+
+    // R* tree through libspatialindex, same bulk load parameters as CreateRStarForest
+    size_t memoryBefore;
+    StartBuildMeasure(&memoryBefore);
+    double start = omp_get_wtime();
+    BulkLoadConfig* bulkconfig = CreateDefaultBulkLoadConfig();
+    RStarIndex* rstarIndex = CreateRStarIndexFromBatch(granule->pointBatch, 0, endIndex, bulkconfig);
+    DestroyBulkLoadConfig(bulkconfig);
+    rstarResult.buildSeconds = omp_get_wtime() - start;
+    StopBuildMeasure(memoryBefore, &rstarResult);
+    forest.engine = INDEX_ENGINE_RSTAR;
+    forest.index = &rstarIndex;
+    start = omp_get_wtime();
+    QueryNearestNeighborBatch(&forest, 0, k, BENCH_QUERY_COUNT, queryPoints, NULL, rstarIds, rstarCounts, rstarDistances);
+    rstarResult.querySeconds = omp_get_wtime() - start;
+    DestroyRStarIndex(rstarIndex);
+    free(rstarIndex);
+    forest.index = NULL;
+
+    // static KNN index
+    StartBuildMeasure(&memoryBefore);
+    start = omp_get_wtime();
+    StaticKNNIndex* knnIndex = CreateKNNIndexFromBatch(granule->pointBatch, 0, endIndex);
+    knnResult.buildSeconds = omp_get_wtime() - start;
+    StopBuildMeasure(memoryBefore, &knnResult);
+    forest.engine = INDEX_ENGINE_KNN;
+    forest.knnIndex = &knnIndex;
+    start = omp_get_wtime();
+    QueryNearestNeighborBatch(&forest, 0, k, BENCH_QUERY_COUNT, queryPoints, NULL, knnIds, knnCounts, knnDistances);
+    knnResult.querySeconds = omp_get_wtime() - start;
+    printf("KNN index: %u points, %u nodes, %.1f MB allocated\n", knnIndex->pointCount, knnIndex->nodeCount, ToMegaBytes(StaticKNNIndex_MemoryUsage(knnIndex)));
+    DestroyStaticKNNIndex(knnIndex);
+
+    PrintIndexBenchResult("R*", &rstarResult, BENCH_QUERY_COUNT);
+    PrintIndexBenchResult("KNN", &knnResult, BENCH_QUERY_COUNT);
+
+    // both engines must find the same neighbor distances
+    size_t rstarOffset = 0, knnOffset = 0;
+    unsigned int mismatch = 0;
+    double maxDifference = 0;
+    for (unsigned int i = 0; i < BENCH_QUERY_COUNT; i++){
+        if (rstarCounts[i] != knnCounts[i]) mismatch++;
+        const uint64_t count = rstarCounts[i] < knnCounts[i] ? rstarCounts[i] : knnCounts[i];
+        for (uint64_t j = 0; j < count; j++)
+            maxDifference = fmax(maxDifference, fabs(rstarDistances[rstarOffset + j] - knnDistances[knnOffset + j]));
+        rstarOffset += rstarCounts[i];
+        knnOffset += knnCounts[i];
+    }
+    printf("Result check: %u count mismatches, max distance difference %.3f m\n", mismatch, maxDifference);
+
+    free(queryPoints);
+    free(rstarIds);
+    free(rstarDistances);
+    free(rstarCounts);
+    free(knnIds);
+    free(knnDistances);
+    free(knnCounts);
+}
+
+static IndexBenchResult RunForestBench(const SyntheticGranule* granule, ClipGridResult* finalGrid, IndexEngine engine, bool shared, double* const* clipQueries){
+    /**
+    @brief Build the per-clip forest or the shared index of an engine and query every clip in parallel
+    @return the build time, resident memory delta and total query time
+    */
+    IndexBenchResult result = {0};
+    IndexForest forest = {0};
+    forest.engine = engine;
+    const unsigned int k = g_config->k_neighbor;
+    size_t memoryBefore;
+    StartBuildMeasure(&memoryBefore);
+    double start = omp_get_wtime();
+    if (shared)
+        CreateSharedIndex(granule->pointBatch, &forest);
+    else if (engine == INDEX_ENGINE_KNN)
+        CreateKNNForest(granule->pointBatch, finalGrid, &forest);
+    else if (engine == INDEX_ENGINE_VOXEL)
+        CreateVoxelForest(granule->pointBatch, finalGrid, &forest);
+    else
+        CreateRStarForest(granule->pointBatch, finalGrid, &forest);
+    result.buildSeconds = omp_get_wtime() - start;
+    StopBuildMeasure(memoryBefore, &result);
+
+    start = omp_get_wtime();
+    #pragma omp parallel for schedule(dynamic)
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid->clipCount; clipIndex++){
+        int64_t* ids = (int64_t*)malloc((size_t)BENCH_CLIP_QUERY_COUNT * k * sizeof(int64_t));
+        double* distances = (double*)malloc((size_t)BENCH_CLIP_QUERY_COUNT * k * sizeof(double));
+        uint64_t* counts = (uint64_t*)malloc(BENCH_CLIP_QUERY_COUNT * sizeof(uint64_t));
+        if (ids && distances && counts)
+            QueryNearestNeighborBatch(&forest, clipIndex, k, BENCH_CLIP_QUERY_COUNT, clipQueries[clipIndex], NULL, ids, counts, distances);
+        free(ids);
+        free(distances);
+        free(counts);
+    }
+    result.querySeconds = omp_get_wtime() - start;
+    DestroyIndexForest(&forest);
+    return result;
+}
+
+void bench_shared_index(const SyntheticGranule* granule){
+    /**
+    @brief Compare one shared index over the whole band against the per-clip forest with overlapping line ranges
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("shared index vs per-clip forest");
+    ClipGridResult finalGrid;
+    if (!CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)){
+        fprintf(stderr, "Failed to create synthetic clips\n");
+        return;
+    }
+    double** clipQueries = (double**)calloc(finalGrid.clipCount, sizeof(double*));
+    if (!clipQueries){
+        free(finalGrid.clipGrids);
+        return;
+    }
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++){
+        const unsigned int startLine = clipIndex * BENCH_CLIP_LINE_COUNT;
+        const unsigned int endLine = fmin(startLine + BENCH_CLIP_LINE_COUNT, granule->lineCount);
+        clipQueries[clipIndex] = CreateSyntheticQueries(granule, startLine, endLine, BENCH_CLIP_QUERY_COUNT, NULL);
+    }
+    printf("%u clips of %d lines\n", finalGrid.clipCount, BENCH_CLIP_LINE_COUNT);
+    const unsigned int queryCount = finalGrid.clipCount * BENCH_CLIP_QUERY_COUNT;
+    IndexBenchResult result = RunForestBench(granule, &finalGrid, INDEX_ENGINE_RSTAR, false, clipQueries);
+    PrintIndexBenchResult("R* clip", &result, queryCount);
+    result = RunForestBench(granule, &finalGrid, INDEX_ENGINE_RSTAR, true, clipQueries);
+    PrintIndexBenchResult("R* band", &result, queryCount);
+    result = RunForestBench(granule, &finalGrid, INDEX_ENGINE_KNN, false, clipQueries);
+    PrintIndexBenchResult("KNN clip", &result, queryCount);
+    result = RunForestBench(granule, &finalGrid, INDEX_ENGINE_KNN, true, clipQueries);
+    PrintIndexBenchResult("KNN band", &result, queryCount);
+    result = RunForestBench(granule, &finalGrid, INDEX_ENGINE_VOXEL, false, clipQueries);
+    PrintIndexBenchResult("Voxel clip", &result, queryCount);
+    result = RunForestBench(granule, &finalGrid, INDEX_ENGINE_VOXEL, true, clipQueries);
+    PrintIndexBenchResult("Voxel band", &result, queryCount);
+
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++)
+        free(clipQueries[clipIndex]);
+    free(clipQueries);
+    free(finalGrid.clipGrids);
+}
+
+void bench_structured(const SyntheticGranule* granule){
+    /**
+    @brief Compare the structured stencil lookup against the exact KNN index, both in speed and in the interpolated values
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("structured locator vs exact KNN");
+    const unsigned int endIndex = granule->lineCount * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+    const unsigned int k = g_config->k_neighbor;
+    double* queryGeodetic = NULL;
+    double* queryPoints = CreateSyntheticQueries(granule, 0, granule->lineCount, BENCH_QUERY_COUNT, &queryGeodetic);
+    int64_t* exactIds = (int64_t*)malloc((size_t)BENCH_QUERY_COUNT * k * sizeof(int64_t));
+    double* exactDistances = (double*)malloc((size_t)BENCH_QUERY_COUNT * k * sizeof(double));
+    uint64_t* exactCounts = (uint64_t*)malloc(BENCH_QUERY_COUNT * sizeof(uint64_t));
+    int64_t* ids = (int64_t*)malloc((size_t)BENCH_QUERY_COUNT * k * sizeof(int64_t));
+    double* distances = (double*)malloc((size_t)BENCH_QUERY_COUNT * k * sizeof(double));
+    uint64_t* counts = (uint64_t*)malloc(BENCH_QUERY_COUNT * sizeof(uint64_t));
+    if (!queryPoints || !exactIds || !exactDistances || !exactCounts || !ids || !distances || !counts){
+        fprintf(stderr, "Failed to allocate benchmark buffers\n");
+        return;
+    }
+
+    IndexBenchResult exactResult, structuredResult;
+    size_t memoryBefore;
+    StartBuildMeasure(&memoryBefore);
+    double start = omp_get_wtime();
+    StaticKNNIndex* knnIndex = CreateKNNIndexFromBatch(granule->pointBatch, 0, endIndex);
+    exactResult.buildSeconds = omp_get_wtime() - start;
+    StopBuildMeasure(memoryBefore, &exactResult);
+    start = omp_get_wtime();
+    StaticKNNIndex_NearestNeighborBatchQuery(knnIndex, k, BENCH_QUERY_COUNT, queryPoints, exactIds, exactCounts, exactDistances);
+    exactResult.querySeconds = omp_get_wtime() - start;
+    DestroyStaticKNNIndex(knnIndex);
+
+    StartBuildMeasure(&memoryBefore);
+    start = omp_get_wtime();
+    StructuredLocator* locator = CreateStructuredLocator(&granule->geodeticGrid, g_config->structured_cell_radius, g_config->structured_bin_radius, g_config->vertical_scale);
+    structuredResult.buildSeconds = omp_get_wtime() - start;
+    StopBuildMeasure(memoryBefore, &structuredResult);
+    start = omp_get_wtime();
+    StructuredLocator_NearestNeighborBatchQuery(locator, k, BENCH_QUERY_COUNT, queryGeodetic, ids, counts, distances);
+    structuredResult.querySeconds = omp_get_wtime() - start;
+    DestroyStructuredLocator(locator);
+
+    PrintIndexBenchResult("KNN", &exactResult, BENCH_QUERY_COUNT);
+    PrintIndexBenchResult("stencil", &structuredResult, BENCH_QUERY_COUNT);
+
+    size_t exactOffset = 0, offset = 0;
+    unsigned int sameNearest = 0, valueCount = 0;
+    double valueDifference = 0;
+    for (unsigned int i = 0; i < BENCH_QUERY_COUNT; i++){
+        if (exactCounts[i] && counts[i] && exactIds[exactOffset] == ids[offset]) sameNearest++;
+        const double exactValue = InterpolateValueIDW_v(exactCounts[i], exactDistances + exactOffset, exactIds + exactOffset, granule->geodeticGrid.valueArray, g_config->idw_power);
+        const double value = InterpolateValueIDW_v(counts[i], distances + offset, ids + offset, granule->geodeticGrid.valueArray, g_config->idw_power);
+        if (exactValue != -999 && value != -999){
+            valueDifference += fabs(exactValue - value);
+            valueCount++;
+        }
+        exactOffset += exactCounts[i];
+        offset += counts[i];
+    }
+    printf("Result check: same nearest neighbor %.2f%%, mean interpolated value difference %.4f over %u values\n", 100.0 * sameNearest / BENCH_QUERY_COUNT, valueCount ? valueDifference / valueCount : 0.0, valueCount);
+
+    free(queryPoints);
+    free(queryGeodetic);
+    free(exactIds);
+    free(exactDistances);
+    free(exactCounts);
+    free(ids);
+    free(distances);
+    free(counts);
+}
+
+void bench_voxel(const SyntheticGranule* granule){
+    /**
+    @brief Compare the voxel hash against the R* tree, the R* results beyond the max neighbor distance are dropped as IDW does
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("R* tree vs voxel hash");
+    const unsigned int endIndex = granule->lineCount * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+    const unsigned int k = g_config->k_neighbor;
+    double* queryPoints = CreateSyntheticQueries(granule, 0, granule->lineCount, BENCH_QUERY_COUNT, NULL);
+    int64_t* rstarIds = (int64_t*)malloc((size_t)BENCH_QUERY_COUNT * k * sizeof(int64_t));
+    double* rstarDistances = (double*)malloc((size_t)BENCH_QUERY_COUNT * k * sizeof(double));
+    uint64_t* rstarCounts = (uint64_t*)malloc(BENCH_QUERY_COUNT * sizeof(uint64_t));
+    int64_t* voxelIds = (int64_t*)malloc((size_t)BENCH_QUERY_COUNT * k * sizeof(int64_t));
+    double* voxelDistances = (double*)malloc((size_t)BENCH_QUERY_COUNT * k * sizeof(double));
+    uint64_t* voxelCounts = (uint64_t*)malloc(BENCH_QUERY_COUNT * sizeof(uint64_t));
+    if (!queryPoints || !rstarIds || !rstarDistances || !rstarCounts || !voxelIds || !voxelDistances || !voxelCounts){
+        fprintf(stderr, "Failed to allocate benchmark buffers\n");
+        return;
+    }
+
+    IndexBenchResult rstarResult, voxelResult;
+    IndexForest forest = {0};
+    forest.RStarForestSize = 1;
+
+    size_t memoryBefore;
+    StartBuildMeasure(&memoryBefore);
+    double start = omp_get_wtime();
+    BulkLoadConfig* bulkconfig = CreateDefaultBulkLoadConfig();
+    RStarIndex* rstarIndex = CreateRStarIndexFromBatch(granule->pointBatch, 0, endIndex, bulkconfig);
+    DestroyBulkLoadConfig(bulkconfig);
+    rstarResult.buildSeconds = omp_get_wtime() - start;
+    StopBuildMeasure(memoryBefore, &rstarResult);
+    forest.engine = INDEX_ENGINE_RSTAR;
+    forest.index = &rstarIndex;
+    start = omp_get_wtime();
+    QueryNearestNeighborBatch(&forest, 0, k, BENCH_QUERY_COUNT, queryPoints, NULL, rstarIds, rstarCounts, rstarDistances);
+    rstarResult.querySeconds = omp_get_wtime() - start;
+    DestroyRStarIndex(rstarIndex);
+    free(rstarIndex);
+    forest.index = NULL;
+
+    StartBuildMeasure(&memoryBefore);
+    start = omp_get_wtime();
+    VoxelIndex* voxelIndex = CreateVoxelIndexFromBatch(granule->pointBatch, 0, endIndex);
+    voxelResult.buildSeconds = omp_get_wtime() - start;
+    StopBuildMeasure(memoryBefore, &voxelResult);
+    forest.engine = INDEX_ENGINE_VOXEL;
+    forest.voxelIndex = &voxelIndex;
+    start = omp_get_wtime();
+    QueryNearestNeighborBatch(&forest, 0, k, BENCH_QUERY_COUNT, queryPoints, NULL, voxelIds, voxelCounts, voxelDistances);
+    voxelResult.querySeconds = omp_get_wtime() - start;
+    printf("Voxel hash: %u points, %u occupied voxels of %.0f m, %u voxels scanned at most\n", voxelIndex->pointCount, voxelIndex->cellCount, voxelIndex->cellSize, voxelIndex->offsetCount);
+    printf("Voxel hash: %.1f MB allocated\n", ToMegaBytes(VoxelIndex_MemoryUsage(voxelIndex)));
+    DestroyVoxelIndex(voxelIndex);
+
+    PrintIndexBenchResult("R*", &rstarResult, BENCH_QUERY_COUNT);
+    PrintIndexBenchResult("Voxel", &voxelResult, BENCH_QUERY_COUNT);
+
+    // the voxel hash returns exactly the R* neighbors that IDW keeps
+    size_t rstarOffset = 0, voxelOffset = 0;
+    unsigned int mismatch = 0;
+    double maxDifference = 0;
+    for (unsigned int i = 0; i < BENCH_QUERY_COUNT; i++){
+        uint64_t inRadius = 0;
+        while (inRadius < rstarCounts[i] && rstarDistances[rstarOffset + inRadius] <= g_config->max_neighbor_distance) inRadius++;
+        if (inRadius != voxelCounts[i]) mismatch++;
+        const uint64_t count = inRadius < voxelCounts[i] ? inRadius : voxelCounts[i];
+        for (uint64_t j = 0; j < count; j++)
+            maxDifference = fmax(maxDifference, fabs(rstarDistances[rstarOffset + j] - voxelDistances[voxelOffset + j]));
+        rstarOffset += rstarCounts[i];
+        voxelOffset += voxelCounts[i];
+    }
+    printf("Result check: %u count mismatches, max distance difference %.3f m\n", mismatch, maxDifference);
+
+    free(queryPoints);
+    free(rstarIds);
+    free(rstarDistances);
+    free(rstarCounts);
+    free(voxelIds);
+    free(voxelDistances);
+    free(voxelCounts);
+}
+
+static double RunOrderedQueries(IndexForest* forest, const unsigned int clipIndex, const unsigned int queryCount, double* queryPoints, int64_t* ids, uint64_t* counts, double* distances, long long* cacheMisses){
+    // query a clip on the calling thread, the cache misses are -1 when the counter is not available
+    const int counter = StartCacheMissCounter();
+    const double start = omp_get_wtime();
+    QueryNearestNeighborBatch(forest, clipIndex, g_config->k_neighbor, queryCount, queryPoints, NULL, ids, counts, distances);
+    const double seconds = omp_get_wtime() - start;
+    *cacheMisses = StopCacheMissCounter(counter);
+    return seconds;
+}
+
+void bench_query_order(const SyntheticGranule* granule){
+    /**
+    @brief Compare the lattice order of the clip queries with the Morton order, per clip with the configured engine
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("lattice vs Morton query order");
+    ClipGridResult finalGrid = {0};
+    if (!CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)) return;
+    IndexForest forest = {0};
+    // the structured engine needs the geodetic queries, the KNN forest stands in for it
+    forest.engine = g_config->index_engine == INDEX_ENGINE_STRUCTURED ? INDEX_ENGINE_KNN : g_config->index_engine;
+    if (forest.engine == INDEX_ENGINE_KNN)
+        CreateKNNForest(granule->pointBatch, &finalGrid, &forest);
+    else if (forest.engine == INDEX_ENGINE_VOXEL)
+        CreateVoxelForest(granule->pointBatch, &finalGrid, &forest);
+    else
+        CreateRStarForest(granule->pointBatch, &finalGrid, &forest);
+    static const char* engineNames[] = {"R*", "KNN", "structured", "voxel"};
+    printf("Engine: %s, cache misses of the query thread (-1 if the counter is not available)\n", engineNames[forest.engine]);
+    printf("%5s %9s %12s %12s %9s %14s %14s %8s\n", "clip", "queries", "lattice q/s", "Morton q/s", "sort ms", "lattice miss", "Morton miss", "speedup");
+
+    const unsigned int k = g_config->k_neighbor;
+    double latticeTotal = 0, mortonTotal = 0;
+    unsigned int queryTotal = 0, mismatch = 0;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++){
+        const ClipGrid* clip = &finalGrid.clipGrids[clipIndex];
+        ClipGrid lattice = {0};
+        unsigned int queryCount = 0;
+        double* queryPoints = CreateSyntheticLattice(granule, clip->leftLineIndex, clip->rightLineIndex + 1, &queryCount, &lattice);
+        unsigned int* queryIDs = (unsigned int*)malloc(queryCount * sizeof(unsigned int));
+        int64_t* ids = (int64_t*)malloc((size_t)queryCount * k * sizeof(int64_t));
+        double* distances = (double*)malloc((size_t)queryCount * k * sizeof(double));
+        uint64_t* latticeCounts = (uint64_t*)malloc(queryCount * sizeof(uint64_t));
+        uint64_t* mortonCounts = (uint64_t*)malloc(queryCount * sizeof(uint64_t));
+        if (!queryPoints || !queryIDs || !ids || !distances || !latticeCounts || !mortonCounts){
+            fprintf(stderr, "Failed to allocate benchmark buffers\n");
+            free(queryPoints);
+            free(queryIDs);
+            free(ids);
+            free(distances);
+            free(latticeCounts);
+            free(mortonCounts);
+            break;
+        }
+        for (unsigned int i = 0; i < queryCount; i++)
+            queryIDs[i] = i;
+
+        long long latticeMisses, mortonMisses;
+        const double latticeSeconds = RunOrderedQueries(&forest, clipIndex, queryCount, queryPoints, ids, latticeCounts, distances, &latticeMisses);
+        double start = omp_get_wtime();
+        SortQueriesByMorton(&lattice, queryCount, queryPoints, NULL, queryIDs, NULL);
+        const double sortSeconds = omp_get_wtime() - start;
+        const double mortonSeconds = RunOrderedQueries(&forest, clipIndex, queryCount, queryPoints, ids, mortonCounts, distances, &mortonMisses);
+        for (unsigned int i = 0; i < queryCount; i++) // the results scatter back to the same lattice nodes
+            if (mortonCounts[i] != latticeCounts[queryIDs[i]]) mismatch++;
+
+        printf("%5u %9u %12.0f %12.0f %9.2f %14lld %14lld %7.2fx\n", clipIndex, queryCount, queryCount / latticeSeconds, queryCount / (mortonSeconds + sortSeconds),
+               sortSeconds * 1e3, latticeMisses, mortonMisses, latticeSeconds / (mortonSeconds + sortSeconds));
+        latticeTotal += latticeSeconds;
+        mortonTotal += mortonSeconds + sortSeconds;
+        queryTotal += queryCount;
+        free(queryPoints);
+        free(queryIDs);
+        free(ids);
+        free(distances);
+        free(latticeCounts);
+        free(mortonCounts);
+    }
+    printf("Total: lattice %.0f q/s, Morton (sort included) %.0f q/s, %u count mismatches\n", queryTotal / latticeTotal, queryTotal / mortonTotal, mismatch);
+    DestroyIndexForest(&forest);
+    free(finalGrid.clipGrids);
+}
@@ -0,0 +1,1193 @@
+#include <malloc.h>
+#include <string.h>
+#include <omp.h>
+#include <sys/stat.h>
+#include "bench_suites.h"
+#include "profile.h"
+#include "config.h"
+#include "core.h"
+#include "interpolate.h"
+#include "plan.h"
+#include "interface.h"
+#include "flatclip.h"
+#include "derived.h"
+#include "catalog.h"
+
+#define BENCH_SMALL_CHUNK_SIZE 4096
+#define BENCH_IDW_QUERY_COUNT (1u << 20)
+#define BENCH_IDW_VALUE_COUNT 100000
+#define BENCH_VERTICAL_QUERY_COUNT 20000
+#define BENCH_FIELD_PERIOD 0.36 // degree, about 40 km
+
+static void RunInterpolateChunk(IndexForest* forest, const GeodeticGrid* geodeticGrid, ClipGridResult* finalGrid, const char* name, const unsigned int chunkSize){
+    /**
+    @brief Interpolate every clip on the calling thread with one workspace, as one thread of InterpolateGrid does
+    @param chunkSize: the query chunk capacity of the workspace
+    */
+    const unsigned int k = g_config->k_neighbor;
+    malloc_trim(0);
+    ResetPeakResidentMemory();
+    const size_t memoryBefore = GetResidentMemory();
+    const double start = omp_get_wtime();
+    InterpolateWorkspace* workspace = CreateInterpolateWorkspace(chunkSize, k, g_config->idw_power, 0);
+    unsigned int cellCount = 0, validCount = 0;
+    double checksum = 0;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid->clipCount && workspace; clipIndex++){
+        ClipGrid* clipGrid = &finalGrid->clipGrids[clipIndex];
+        InterpolateClipGridBatch(forest, clipIndex, geodeticGrid->valueArray, geodeticGrid->elevationArray, NULL, clipGrid, workspace, NULL);
+        const unsigned int count = clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+        for (unsigned int i = 0; i < count; i++)
+            if (clipGrid->value[i] > -999){
+                validCount++;
+                checksum += clipGrid->value[i];
+            }
+        cellCount += count;
+    }
+    DestroyInterpolateWorkspace(workspace);
+    const double seconds = omp_get_wtime() - start;
+    const size_t peak = GetPeakResidentMemory();
+    printf("%-12s %10u %12.1f %10.1f %9.3f %12.0f %10u %14.3f\n", name, chunkSize, ToMegaBytes((size_t)chunkSize * (64 + 16 * k)), peak > memoryBefore ? ToMegaBytes(peak - memoryBefore) : 0.0, seconds, cellCount / seconds, validCount, checksum);
+}
+
+void bench_interpolate_chunk(const SyntheticGranule* granule){
+    /**
+    @brief Compare the peak memory and time of the batch interpolation with small, default and whole-clip query chunks
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("chunked batch interpolation");
+    ClipGridResult finalGrid = {0};
+    if (!CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)) return;
+    unsigned int maxCellCount = 0;
+    bool success = true;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++){
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        const unsigned int count = clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+        clipGrid->value = (float*)malloc(count * sizeof(float));
+        success &= clipGrid->value != NULL;
+        if (count > maxCellCount) maxCellCount = count;
+    }
+    IndexForest forest = {0};
+    if (success && CreateIndexForest(&granule->geodeticGrid, granule->pointBatch, &finalGrid, &forest)){
+        // the whole clip chunk holds every cell at once, as the batch path did before chunking
+        printf("%-12s %10s %12s %10s %9s %12s %10s %14s\n", "chunk", "queries", "buffer MB", "peak MB", "seconds", "cells/s", "valid", "checksum");
+        RunInterpolateChunk(&forest, &granule->geodeticGrid, &finalGrid, "small", BENCH_SMALL_CHUNK_SIZE);
+        RunInterpolateChunk(&forest, &granule->geodeticGrid, &finalGrid, "default", g_config->query_chunk_size);
+        RunInterpolateChunk(&forest, &granule->geodeticGrid, &finalGrid, "whole clip", maxCellCount);
+    }
+    DestroyIndexForest(&forest);
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++)
+        free(finalGrid.clipGrids[clipIndex].value);
+    free(finalGrid.clipGrids);
+}
+
+static double ReferenceIDW(const unsigned int neighborCount, const double* distances, const int64_t* ids, const float* valueArray, const float power){
+    // InterpolateValueIDW_v before the specialized weights, one pow() per neighbor
+    double weightSum = 0.0, valueSum = 0.0;
+    for (unsigned int i = 0; i < neighborCount; i++){
+        if (distances[i] > g_config->max_neighbor_distance) continue;
+        if (distances[i] < g_config->min_neighbor_distance) return valueArray[ids[i]];
+        const double weight = 1.0 / pow(distances[i], power);
+        weightSum += weight;
+        valueSum += weight * valueArray[ids[i]];
+    }
+    if (weightSum == 0.0) return -999;
+    return valueSum / weightSum;
+}
+
+static void GatherNeighbors(const unsigned int queryCount, const unsigned int k, const uint64_t* counts, const double* distances, const int64_t* ids, const float* valueArray, float* neighborDistances, float* neighborValues){
+    // the packed to SoA unpacking of InterpolateClipGridBatch
+    size_t offset = 0;
+    for (unsigned int i = 0; i < queryCount; i++){
+        for (unsigned int j = 0; j < k; j++){
+            neighborDistances[(size_t)j * queryCount + i] = j < counts[i] ? (float)distances[offset + j] : INFINITY;
+            neighborValues[(size_t)j * queryCount + i] = j < counts[i] ? valueArray[ids[offset + j]] : 0.0f;
+        }
+        offset += counts[i];
+    }
+}
+
+void bench_idw(void){
+    /**
+    @brief Compare the pow() based IDW with the specialized scalar weight and the batch SoA kernels on packed neighbor results
+    */
+    PrintBenchHeader("IDW kernels");
+    const unsigned int queryCount = BENCH_IDW_QUERY_COUNT, k = g_config->k_neighbor;
+    uint64_t* counts = (uint64_t*)malloc(queryCount * sizeof(uint64_t));
+    double* distances = (double*)malloc((size_t)queryCount * k * sizeof(double));
+    int64_t* ids = (int64_t*)malloc((size_t)queryCount * k * sizeof(int64_t));
+    float* valueArray = (float*)malloc(BENCH_IDW_VALUE_COUNT * sizeof(float));
+    float* neighborDistances = (float*)malloc((size_t)queryCount * k * sizeof(float));
+    float* neighborValues = (float*)malloc((size_t)queryCount * k * sizeof(float));
+    float* results = (float*)malloc(queryCount * sizeof(float));
+    double* reference = (double*)malloc(queryCount * sizeof(double));
+    if (!counts || !distances || !ids || !valueArray || !neighborDistances || !neighborValues || !results || !reference){
+        fprintf(stderr, "Failed to allocate benchmark buffers\n");
+        free(counts);
+        free(distances);
+        free(ids);
+        free(valueArray);
+        free(neighborDistances);
+        free(neighborValues);
+        free(results);
+        free(reference);
+        return;
+    }
+    for (unsigned int i = 0; i < BENCH_IDW_VALUE_COUNT; i++)
+        valueArray[i] = 10.0f + 30.0f * (float)rand() / RAND_MAX;
+    // mostly full neighbor lists with ascending distances up to beyond the max neighbor distance
+    size_t offset = 0;
+    for (unsigned int i = 0; i < queryCount; i++){
+        counts[i] = rand() % 8 == 0 ? rand() % (k + 1) : k;
+        double distance = g_config->min_neighbor_distance * (rand() % 50 == 0 ? 0.5 : 1.5);
+        for (unsigned int j = 0; j < counts[i]; j++){
+            distance += (double)rand() / RAND_MAX * g_config->max_neighbor_distance / k * 1.2;
+            distances[offset + j] = distance;
+            ids[offset + j] = rand() % BENCH_IDW_VALUE_COUNT;
+        }
+        offset += counts[i];
+    }
+
+    printf("%u queries, k = %u, single thread\n", queryCount, k);
+    printf("%-7s %14s %14s %14s %14s %12s\n", "power", "pow Mq/s", "scalar Mq/s", "batch Mq/s", "kernel Mq/s", "max diff");
+    const float powers[] = {1.0f, 2.0f, 3.0f, 2.5f};
+    for (unsigned int p = 0; p < sizeof(powers) / sizeof(powers[0]); p++){
+        const float power = powers[p];
+        double start = omp_get_wtime();
+        offset = 0;
+        for (unsigned int i = 0; i < queryCount; i++){
+            reference[i] = ReferenceIDW(counts[i], distances + offset, ids + offset, valueArray, power);
+            offset += counts[i];
+        }
+        const double powSeconds = omp_get_wtime() - start;
+
+        start = omp_get_wtime();
+        offset = 0;
+        for (unsigned int i = 0; i < queryCount; i++){
+            results[i] = (float)InterpolateValueIDW_v(counts[i], distances + offset, ids + offset, valueArray, power);
+            offset += counts[i];
+        }
+        const double scalarSeconds = omp_get_wtime() - start;
+
+        const IDWBatchKernel kernel = SelectIDWBatchKernel(power);
+        start = omp_get_wtime();
+        InterpolateValueIDWBatch(kernel, power, queryCount, k, counts, distances, ids, valueArray, NULL, NULL, neighborDistances, neighborValues, results);
+        const double batchSeconds = omp_get_wtime() - start;
+        // the kernel alone on neighbors already in SoA form
+        GatherNeighbors(queryCount, k, counts, distances, ids, valueArray, neighborDistances, neighborValues);
+        start = omp_get_wtime();
+        kernel(queryCount, k, queryCount, neighborDistances, neighborValues, power, results);
+        const double kernelSeconds = omp_get_wtime() - start;
+
+        double maxDifference = 0;
+        for (unsigned int i = 0; i < queryCount; i++)
+            maxDifference = fmax(maxDifference, fabs(reference[i] - results[i]));
+        printf("%-7.1f %14.1f %14.1f %14.1f %14.1f %12.2e\n", power, queryCount / powSeconds * 1e-6, queryCount / scalarSeconds * 1e-6,
+               queryCount / batchSeconds * 1e-6, queryCount / kernelSeconds * 1e-6, maxDifference);
+    }
+    free(counts);
+    free(distances);
+    free(ids);
+    free(valueArray);
+    free(neighborDistances);
+    free(neighborValues);
+    free(results);
+    free(reference);
+}
+
+static float SmoothField(const double latitude, const double longitude, const double height){
+    // a reflectivity-like field, 40 km cells horizontally and 3 dBZ per km vertically
+    return 35.0f + 8.0f * sin(latitude * 2 * M_PI / BENCH_FIELD_PERIOD) * cos(longitude * 2 * M_PI / BENCH_FIELD_PERIOD) - 3.0f * height / 1000.0;
+}
+
+static void RunVerticalScale(const SyntheticGranule* granule, const unsigned int endIndex, const float* fieldArray, const double verticalScale, const unsigned int k,
+                             const unsigned int queryCount, const double* queryGeodetic){
+    /**
+    @brief Query and interpolate the field with the points and queries stretched by the vertical scale
+    @param endIndex: the points of the index, from the first line
+    @param fieldArray: the field at the points
+    @param queryGeodetic: latitude, longitude and height of the queries [queryCount][3]
+    */
+    const GeodeticGrid* grid = &granule->geodeticGrid;
+    RStarPoint* points = (RStarPoint*)malloc((size_t)endIndex * sizeof(RStarPoint));
+    double* queryPoints = (double*)malloc((size_t)queryCount * 3 * sizeof(double));
+    int64_t* ids = (int64_t*)malloc((size_t)queryCount * k * sizeof(int64_t));
+    double* distances = (double*)malloc((size_t)queryCount * k * sizeof(double));
+    uint64_t* counts = (uint64_t*)malloc(queryCount * sizeof(uint64_t));
+    float* neighborDistances = (float*)malloc((size_t)IDW_BATCH_BLOCK * k * sizeof(float));
+    float* neighborValues = (float*)malloc((size_t)IDW_BATCH_BLOCK * k * sizeof(float));
+    float* results = (float*)malloc(queryCount * sizeof(float));
+    StaticKNNIndex* knnIndex = NULL;
+    if (points && queryPoints && ids && distances && counts && neighborDistances && neighborValues && results){
+        memcpy(points, granule->pointBatch->points, (size_t)endIndex * sizeof(RStarPoint));
+        for (unsigned int i = 0; i < endIndex; i++){
+            if (points[i].h == -1) continue;
+            double x, y, z;
+            TransferGeodeticToScaledCartesian(grid->latitudeArray[i], grid->longitudeArray[i], grid->elevationArray[i], verticalScale, &x, &y, &z);
+            points[i].x = x;
+            points[i].y = y;
+            points[i].z = z;
+        }
+        for (unsigned int i = 0; i < queryCount; i++)
+            TransferGeodeticToScaledCartesian(queryGeodetic[i * 3 + 0], queryGeodetic[i * 3 + 1], queryGeodetic[i * 3 + 2], verticalScale, &queryPoints[i * 3 + 0], &queryPoints[i * 3 + 1], &queryPoints[i * 3 + 2]);
+        knnIndex = CreateStaticKNNIndex(points, 0, endIndex, g_config->knn_leaf_size);
+    }
+    else
+        fprintf(stderr, "Failed to allocate benchmark buffers\n");
+    if (knnIndex){
+        const double start = omp_get_wtime();
+        StaticKNNIndex_NearestNeighborBatchQuery(knnIndex, k, queryCount, queryPoints, ids, counts, distances);
+        const double querySeconds = omp_get_wtime() - start;
+        InterpolateValueIDWBatch(SelectIDWBatchKernel(g_config->idw_power), g_config->idw_power, queryCount, k, counts, distances, ids, fieldArray,
+                                 grid->elevationArray, queryGeodetic, neighborDistances, neighborValues, results);
+        // neighbors on distinct rays, and the error against the field at the query
+        size_t offset = 0, rayCount = 0;
+        unsigned int validCount = 0;
+        double squaredError = 0;
+        for (unsigned int i = 0; i < queryCount; i++){
+            for (unsigned int j = 0; j < counts[i]; j++){
+                bool seen = false;
+                for (unsigned int m = 0; m < j && !seen; m++)
+                    seen = ids[offset + m] / SCAN_HEIGHT_COUNT == ids[offset + j] / SCAN_HEIGHT_COUNT;
+                rayCount += !seen;
+            }
+            offset += counts[i];
+            if (results[i] <= -999) continue;
+            const double error = results[i] - SmoothField(queryGeodetic[i * 3 + 0], queryGeodetic[i * 3 + 1], queryGeodetic[i * 3 + 2]);
+            squaredError += error * error;
+            validCount++;
+        }
+        printf("%-7.1f %4u %12.0f %10.2f %9.1f %10.3f\n", verticalScale, k, queryCount / querySeconds, (double)rayCount / queryCount,
+               100.0 * validCount / queryCount, validCount ? sqrt(squaredError / validCount) : 0.0);
+    }
+    DestroyStaticKNNIndex(knnIndex);
+    free(points);
+    free(queryPoints);
+    free(ids);
+    free(distances);
+    free(counts);
+    free(neighborDistances);
+    free(neighborValues);
+    free(results);
+}
+
+void bench_vertical_scale(const SyntheticGranule* granule){
+    /**
+    @brief Compare the neighbor balance, query time and IDW error of a small k with a stretched vertical metric against a large isotropic k
+    @param granule: the synthetic granule, the values are replaced by a smooth field
+    */
+    PrintBenchHeader("vertical scale of the neighbor metric");
+    const unsigned int endLine = granule->lineCount < BENCH_CLIP_LINE_COUNT ? granule->lineCount : BENCH_CLIP_LINE_COUNT;
+    const unsigned int endIndex = endLine * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+    const unsigned int queryCount = BENCH_VERTICAL_QUERY_COUNT;
+    const GeodeticGrid* grid = &granule->geodeticGrid;
+    float* fieldArray = (float*)malloc((size_t)endIndex * sizeof(float));
+    double* queryGeodetic = (double*)malloc((size_t)queryCount * 3 * sizeof(double));
+    if (!fieldArray || !queryGeodetic){
+        fprintf(stderr, "Failed to allocate benchmark buffers\n");
+        free(fieldArray);
+        free(queryGeodetic);
+        return;
+    }
+    for (unsigned int i = 0; i < endIndex; i++)
+        fieldArray[i] = SmoothField(grid->latitudeArray[i], grid->longitudeArray[i], grid->elevationArray[i]);
+    // below the lowest echo top and inside the swath, so every query has data around
+    const double longitudeMargin = (granule->maxLongitude - granule->minLongitude) * 0.1;
+    for (unsigned int i = 0; i < queryCount; i++){
+        queryGeodetic[i * 3 + 0] = granule->minLatitude + (1 + (double)rand() / RAND_MAX * (endLine - 2)) * (granule->maxLatitude - granule->minLatitude) / granule->lineCount;
+        queryGeodetic[i * 3 + 1] = granule->minLongitude + longitudeMargin + (double)rand() / RAND_MAX * (granule->maxLongitude - granule->minLongitude - 2 * longitudeMargin);
+        queryGeodetic[i * 3 + 2] = 200.0 + (double)rand() / RAND_MAX * 1600.0;
+    }
+    printf("MAX_VERTICAL_DISTANCE %.0f m, MAX_NEIGHBOR_DISTANCE %.0f m\n", g_config->max_vertical_distance, g_config->max_neighbor_distance);
+    printf("%-7s %4s %12s %10s %9s %10s\n", "scale", "k", "queries/s", "rays", "valid %", "RMSE");
+    const double scales[] = {1, 16, 64, 128};
+    const unsigned int neighborCounts[] = {5, 10, 20};
+    for (unsigned int s = 0; s < sizeof(scales) / sizeof(scales[0]); s++)
+        for (unsigned int n = 0; n < sizeof(neighborCounts) / sizeof(neighborCounts[0]); n++)
+            RunVerticalScale(granule, endIndex, fieldArray, scales[s], neighborCounts[n], queryCount, queryGeodetic);
+    free(fieldArray);
+    free(queryGeodetic);
+}
+
+static void PrintResampleResult(const char* name, const ClipGridResult* finalGrid, const double buildSeconds, const double interpolateSeconds){
+    // time, coverage and error against the smooth field of the interpolated clips
+    unsigned int cellCount = 0, validCount = 0;
+    double squaredError = 0;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid->clipCount; clipIndex++){
+        const ClipGrid* clipGrid = &finalGrid->clipGrids[clipIndex];
+        for (unsigned int l = 0; l < clipGrid->longitudeCount; l++)
+            for (unsigned int b = 0; b < clipGrid->latitudeCount; b++)
+                for (unsigned int h = 0; h < clipGrid->heightCount; h++){
+                    const float value = clipGrid->value[l * clipGrid->latitudeCount * clipGrid->heightCount + b * clipGrid->heightCount + h];
+                    cellCount++;
+                    if (value <= -999) continue;
+                    const double error = value - SmoothField(clipGrid->minLatitude + b * clipGrid->latitudeGap, clipGrid->minLongitude + l * clipGrid->longitudeGap, clipGrid->minHeight + h * clipGrid->heightGap);
+                    squaredError += error * error;
+                    validCount++;
+                }
+    }
+    printf("%-12s %10.3f %12.3f %12.0f %10u %10.3f\n", name, buildSeconds, interpolateSeconds, cellCount / interpolateSeconds, validCount, validCount ? sqrt(squaredError / validCount) : 0.0);
+}
+
+void bench_separable(const SyntheticGranule* granule){
+    /**
+    @brief Compare the point cloud resampling (KNN index, batch IDW) with the separable and the scatter resampling on the clips of the granule, the values are replaced by a smooth field
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("point cloud vs separable vs scatter resampling");
+    ClipGridResult finalGrid = {0};
+    if (!CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)) return;
+    const unsigned int pointCount = granule->lineCount * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+    GeodeticGrid grid = granule->geodeticGrid; // the geometry of the granule with the field as values
+    grid.valueArray = (float*)malloc((size_t)pointCount * sizeof(float));
+    bool success = grid.valueArray != NULL;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++){
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        clipGrid->value = (float*)malloc((size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float));
+        success &= clipGrid->value != NULL;
+    }
+    if (success){
+        for (unsigned int i = 0; i < pointCount; i++)
+            grid.valueArray[i] = grid.validArray[i] ? SmoothField(grid.latitudeArray[i], grid.longitudeArray[i], grid.elevationArray[i]) : -999;
+        const ClipGrid* lattice = &finalGrid.clipGrids[0];
+        printf("%-12s %10s %12s %12s %10s %10s\n", "engine", "build s", "interpolate s", "cells/s", "valid", "RMSE");
+
+        // the 3D nearest bins of every cell, one thread as RunInterpolateChunk
+        const IndexEngine previousEngine = g_config->index_engine;
+        const ResampleEngine previousResample = g_config->resample_engine;
+        g_config->index_engine = INDEX_ENGINE_KNN;
+        g_config->resample_engine = RESAMPLE_ENGINE_POINT_CLOUD;
+        IndexForest forest = {0};
+        double start = omp_get_wtime();
+        if (CreateIndexForest(&grid, granule->pointBatch, &finalGrid, &forest)){
+            const double buildSeconds = omp_get_wtime() - start;
+            InterpolateWorkspace* workspace = CreateInterpolateWorkspace(g_config->query_chunk_size, g_config->k_neighbor, g_config->idw_power, 0);
+            start = omp_get_wtime();
+            for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && workspace; clipIndex++)
+                InterpolateClipGridBatch(&forest, clipIndex, grid.valueArray, grid.elevationArray, NULL, &finalGrid.clipGrids[clipIndex], workspace, NULL);
+            PrintResampleResult("point cloud", &finalGrid, buildSeconds, omp_get_wtime() - start);
+            DestroyInterpolateWorkspace(workspace);
+        }
+        DestroyIndexForest(&forest);
+
+        // the rays onto the levels, then every level across the located rays
+        start = omp_get_wtime();
+        StructuredLocator* locator = CreateStructuredLocator(&grid, g_config->structured_cell_radius, g_config->structured_bin_radius, 1.0f);
+        RayLevelProfile* profile = CreateRayLevelProfile(&grid, lattice->minHeight, lattice->heightGap, lattice->heightCount, g_config->max_vertical_distance);
+        if (locator && profile){
+            const double buildSeconds = omp_get_wtime() - start;
+            start = omp_get_wtime();
+            for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++)
+                InterpolateClipGridSeparable(locator, profile, g_config->k_neighbor, g_config->idw_power, &finalGrid.clipGrids[clipIndex]);
+            PrintResampleResult("separable", &finalGrid, buildSeconds, omp_get_wtime() - start);
+        }
+        DestroyRayLevelProfile(profile);
+        DestroyStructuredLocator(locator);
+
+        // every valid bin splatted once onto the cells within a lattice spacing, nothing to build
+        const float radius = g_config->scatter_radius > 0 ? g_config->scatter_radius : (float)(lattice->latitudeGap * M_PI * WGS84_B / 180.0);
+        start = omp_get_wtime();
+        for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++)
+            InterpolateClipGridScatter(&grid, radius, g_config->idw_power, &finalGrid.clipGrids[clipIndex]);
+        PrintResampleResult("scatter", &finalGrid, 0.0, omp_get_wtime() - start);
+        g_config->index_engine = previousEngine;
+        g_config->resample_engine = previousResample;
+    }
+    free(grid.valueArray);
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++)
+        free(finalGrid.clipGrids[clipIndex].value);
+    free(finalGrid.clipGrids);
+}
+
+#define BENCH_EXTRA_VARIABLE_COUNT 3
+
+void bench_extra_variables(const SyntheticGranule* granule){
+    /**
+    @brief Compare the interpolation of the value and three extra variables in one sweep that shares the neighbors and weights with one sweep per variable
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("multi variable interpolation");
+    ClipGridResult finalGrid = {0};
+    if (!CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)) return;
+    const size_t pointCount = (size_t)granule->lineCount * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+    GeodeticGrid grid = granule->geodeticGrid; // the geometry of the granule with extra variables derived from the value
+    bool success = InitGeodeticGridExtra(&grid, BENCH_EXTRA_VARIABLE_COUNT);
+    for (unsigned int v = 0; v < grid.extraCount && success; v++)
+        for (size_t i = 0; i < pointCount; i++)
+            grid.extraValueArrays[v][i] = grid.valueArray[i] > -999 ? grid.valueArray[i] * (v + 2) : -999;
+    success = success && InitClipGridExtra(&finalGrid, BENCH_EXTRA_VARIABLE_COUNT);
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++){
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        clipGrid->value = (float*)malloc((size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float));
+        success &= clipGrid->value != NULL;
+    }
+    IndexForest forest = {0};
+    const IndexEngine previousEngine = g_config->index_engine;
+    g_config->index_engine = INDEX_ENGINE_KNN;
+    if (success && CreateIndexForest(&grid, granule->pointBatch, &finalGrid, &forest)){
+        printf("%-28s %10s %12s %14s\n", "sweep", "variables", "seconds", "checksum");
+        // one sweep per variable, as re-running the interpolation for every dataset
+        InterpolateWorkspace* workspace = CreateInterpolateWorkspace(g_config->query_chunk_size, g_config->k_neighbor, g_config->idw_power, BENCH_EXTRA_VARIABLE_COUNT);
+        double checksum = 0, start = omp_get_wtime();
+        for (unsigned int v = 0; v <= BENCH_EXTRA_VARIABLE_COUNT && workspace; v++){
+            const float* valueArray = v == 0 ? grid.valueArray : grid.extraValueArrays[v - 1];
+            for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++){
+                ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+                const unsigned int extraCount = clipGrid->extraCount;
+                clipGrid->extraCount = 0;
+                InterpolateClipGridBatch(&forest, clipIndex, valueArray, grid.elevationArray, NULL, clipGrid, workspace, NULL);
+                clipGrid->extraCount = extraCount;
+                const unsigned int count = clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+                for (unsigned int i = 0; i < count; i++)
+                    if (clipGrid->value[i] > -999) checksum += clipGrid->value[i];
+            }
+        }
+        printf("%-28s %10u %12.3f %14.1f\n", "one per variable", 1 + BENCH_EXTRA_VARIABLE_COUNT, omp_get_wtime() - start, checksum);
+
+        checksum = 0;
+        start = omp_get_wtime();
+        for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && workspace; clipIndex++){
+            ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+            InterpolateClipGridBatch(&forest, clipIndex, grid.valueArray, grid.elevationArray, (const float* const*)grid.extraValueArrays, clipGrid, workspace, NULL);
+            const unsigned int count = clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+            for (unsigned int i = 0; i < count; i++)
+                if (clipGrid->value[i] > -999) checksum += clipGrid->value[i];
+            for (unsigned int i = 0; i < clipGrid->extraCount * count; i++)
+                if (clipGrid->extraValue[i] > -999) checksum += clipGrid->extraValue[i];
+        }
+        printf("%-28s %10u %12.3f %14.1f\n", "shared neighbors and weights", 1 + BENCH_EXTRA_VARIABLE_COUNT, omp_get_wtime() - start, checksum);
+        DestroyInterpolateWorkspace(workspace);
+    }
+    g_config->index_engine = previousEngine;
+    DestroyIndexForest(&forest);
+    for (unsigned int v = 0; v < grid.extraCount; v++)
+        free(grid.extraValueArrays[v]);
+    free(grid.extraValueArrays);
+    DestroyClipGridResult(&finalGrid);
+}
+
+#define BENCH_PLAN_FILE_NAME "/tmp/FY3G_bench_plan.bin"
+
+static double ClipChecksum(const ClipGridResult* finalGrid){
+    double checksum = 0;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid->clipCount; clipIndex++){
+        const ClipGrid* clipGrid = &finalGrid->clipGrids[clipIndex];
+        const unsigned int count = clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+        for (unsigned int i = 0; i < count; i++)
+            if (clipGrid->value[i] > -999) checksum += clipGrid->value[i];
+    }
+    return checksum;
+}
+
+void bench_resample_plan(const SyntheticGranule* granule){
+    /**
+    @brief Compare the first run that builds the index and records the resample plan with a later run that only maps the plan and applies it
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("recorded vs loaded resample plan");
+    ClipGridResult finalGrid = {0};
+    if (!CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)) return;
+    bool success = true;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++){
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        clipGrid->value = (float*)malloc((size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float));
+        success &= clipGrid->value != NULL;
+    }
+    const IndexEngine previousEngine = g_config->index_engine;
+    g_config->index_engine = INDEX_ENGINE_KNN;
+    HDFGlobalAttribute globalAttribute = {0};
+    globalAttribute.scanLineCount = granule->lineCount;
+    ResamplePlanKey key;
+    InitResamplePlanKey(&globalAttribute, &key);
+    remove(BENCH_PLAN_FILE_NAME);
+    printf("%-24s %12s %12s %12s %14s\n", "run", "index s", "resample s", "file MB", "checksum");
+
+    // the first run, the plan is recorded while interpolating
+    IndexForest forest = {0};
+    double start = omp_get_wtime();
+    success = success && CreateIndexForest(&granule->geodeticGrid, granule->pointBatch, &finalGrid, &forest);
+    const double indexSeconds = omp_get_wtime() - start;
+    ResamplePlan* plan = success ? CreateResamplePlan(BENCH_PLAN_FILE_NAME, &key, &finalGrid, g_config->k_neighbor) : NULL;
+    InterpolateWorkspace* workspace = CreateInterpolateWorkspace(g_config->query_chunk_size, g_config->k_neighbor, g_config->idw_power, 0);
+    start = omp_get_wtime();
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && plan && workspace; clipIndex++)
+        success &= InterpolateClipGridBatch(&forest, clipIndex, granule->geodeticGrid.valueArray, granule->geodeticGrid.elevationArray, NULL, &finalGrid.clipGrids[clipIndex], workspace, &plan->clips[clipIndex]);
+    success = success && plan && workspace && SaveResamplePlan(plan, &finalGrid);
+    const double recordSeconds = omp_get_wtime() - start;
+    DestroyInterpolateWorkspace(workspace);
+    DestroyResamplePlan(plan);
+    DestroyIndexForest(&forest);
+    struct stat status;
+    const double fileSize = success && stat(BENCH_PLAN_FILE_NAME, &status) == 0 ? ToMegaBytes(status.st_size) : 0.0;
+    if (success)
+        printf("%-24s %12.3f %12.3f %12.1f %14.1f\n", "index, search and record", indexSeconds, recordSeconds, fileSize, ClipChecksum(&finalGrid));
+
+    // a later run, no index and no neighbor search
+    start = omp_get_wtime();
+    plan = success ? LoadResamplePlan(BENCH_PLAN_FILE_NAME, &key, &finalGrid) : NULL;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && plan; clipIndex++)
+        ApplyClipResamplePlan(&plan->clips[clipIndex], granule->geodeticGrid.valueArray, NULL, &finalGrid.clipGrids[clipIndex]);
+    if (plan)
+        printf("%-24s %12s %12.3f %12.1f %14.1f\n", "load and apply", "-", omp_get_wtime() - start, fileSize, ClipChecksum(&finalGrid));
+    DestroyResamplePlan(plan);
+    remove(BENCH_PLAN_FILE_NAME);
+    g_config->index_engine = previousEngine;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++)
+        free(finalGrid.clipGrids[clipIndex].value);
+    free(finalGrid.clipGrids);
+}
+
+static double ClipStorageChecksum(const ClipGridResult* finalGrid, unsigned int* validCount){
+    // reads through GetClipValue so both storages are summed alike
+    double checksum = 0;
+    *validCount = 0;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid->clipCount; clipIndex++){
+        const ClipGrid* clipGrid = &finalGrid->clipGrids[clipIndex];
+        const size_t count = (size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+        for (size_t i = 0; i < count; i++){
+            const float value = GetClipValue(clipGrid, 0, i);
+            if (value <= -999) continue;
+            checksum += value;
+            (*validCount)++;
+        }
+    }
+    return checksum;
+}
+
+static bool* CreateEchoMask(const SyntheticGranule* granule){
+    // the bins above 30 dBZ of the smooth field, echo tops between 0 and 4.3 km as a precipitation scene
+    const GeodeticGrid* grid = &granule->geodeticGrid;
+    const unsigned int pointCount = granule->lineCount * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+    bool* echoArray = (bool*)malloc((size_t)pointCount * sizeof(bool));
+    if (!echoArray) return NULL;
+    for (unsigned int i = 0; i < pointCount; i++)
+        echoArray[i] = grid->validArray[i] && SmoothField(grid->latitudeArray[i], grid->longitudeArray[i], grid->elevationArray[i]) >= 30.0f;
+    return echoArray;
+}
+
+void bench_clip_storage(const SyntheticGranule* granule){
+    /**
+    @brief Compare the memory and time of dense and sparse clip storage on the whole granule and on an echo-like scene, the clips are interpolated by the scatter engine
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("dense vs sparse clip storage");
+    GeodeticGrid grid = granule->geodeticGrid;
+    bool* echoArray = CreateEchoMask(granule);
+    if (!echoArray) return;
+    printf("%-8s %-8s %12s %12s %10s %14s\n", "scene", "storage", "clip MB", "seconds", "valid", "checksum");
+    for (unsigned int scene = 0; scene < 2; scene++){
+        grid.validArray = scene ? echoArray : granule->geodeticGrid.validArray;
+        for (unsigned int sparse = 0; sparse < 2; sparse++){
+            ClipGridResult finalGrid = {0};
+            if (!CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)) break;
+            bool success = true;
+            for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++){
+                ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+                if (sparse)
+                    success &= InitClipGridSparse(clipGrid);
+                else{
+                    clipGrid->value = (float*)malloc((size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float));
+                    success &= clipGrid->value != NULL;
+                }
+            }
+            const float radius = g_config->scatter_radius > 0 ? g_config->scatter_radius : (float)(finalGrid.clipGrids[0].latitudeGap * M_PI * WGS84_B / 180.0);
+            const double start = omp_get_wtime();
+            for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && success; clipIndex++)
+                success &= InterpolateClipGridScatter(&grid, radius, g_config->idw_power, &finalGrid.clipGrids[clipIndex]);
+            const double seconds = omp_get_wtime() - start;
+            unsigned int validCount;
+            const double checksum = ClipStorageChecksum(&finalGrid, &validCount);
+            if (success)
+                printf("%-8s %-8s %12.1f %12.3f %10u %14.1f\n", scene ? "echo" : "granule", sparse ? "sparse" : "dense", ToMegaBytes(ClipGridResultBytes(&finalGrid)), seconds, validCount, checksum);
+            DestroyClipGridResult(&finalGrid);
+        }
+    }
+    free(echoArray);
+}
+
+static void RunEchoTopCutoff(const char* scene, const GeodeticGrid* grid, IndexForest* forest, ClipGridResult* finalGrid, const bool cutoff){
+    // one thread as RunInterpolateChunk, the echo top raster is built inside the timing
+    const double start = omp_get_wtime();
+    if (cutoff && !(forest->echoTop = CreateEchoTopRaster(grid))) return;
+    InterpolateWorkspace* workspace = CreateInterpolateWorkspace(g_config->query_chunk_size, g_config->k_neighbor, g_config->idw_power, 0);
+    bool success = workspace != NULL;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid->clipCount && success; clipIndex++)
+        success = InterpolateClipGridBatch(forest, clipIndex, grid->valueArray, grid->elevationArray, NULL, &finalGrid->clipGrids[clipIndex], workspace, NULL);
+    const double seconds = omp_get_wtime() - start;
+    unsigned int validCount;
+    const double checksum = ClipStorageChecksum(finalGrid, &validCount);
+    if (success)
+        printf("%-8s %-8s %10.3f %10.1f%% %10u %14.1f\n", scene, cutoff ? "on" : "off", seconds, 100.0 * workspace->skippedCount / workspace->cellCount, validCount, checksum);
+    DestroyInterpolateWorkspace(workspace);
+    DestroyEchoTopRaster(forest->echoTop);
+    forest->echoTop = NULL;
+}
+
+void bench_echo_top(const SyntheticGranule* granule){
+    /**
+    @brief Compare the point cloud interpolation with and without the echo top cutoff on the whole granule and on an echo-like scene, the checksums must match
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("echo top cutoff");
+    const unsigned int pointCount = granule->lineCount * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+    bool* echoArray = CreateEchoMask(granule);
+    float* heights = (float*)malloc((size_t)pointCount * sizeof(float)); // the point heights the echo scene hides
+    ClipGridResult finalGrid = {0};
+    if (!echoArray || !heights || !CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)){
+        free(echoArray);
+        free(heights);
+        return;
+    }
+    bool success = true;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++){
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        clipGrid->value = (float*)malloc((size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float));
+        success &= clipGrid->value != NULL;
+    }
+    const IndexEngine previousEngine = g_config->index_engine;
+    const ResampleEngine previousResample = g_config->resample_engine;
+    const bool previousCutoff = g_config->echo_top_cutoff;
+    g_config->index_engine = INDEX_ENGINE_KNN;
+    g_config->resample_engine = RESAMPLE_ENGINE_POINT_CLOUD;
+    g_config->echo_top_cutoff = false; // the raster is attached by RunEchoTopCutoff
+    printf("%-8s %-8s %10s %11s %10s %14s\n", "scene", "cutoff", "seconds", "skipped", "valid", "checksum");
+    for (unsigned int scene = 0; scene < 2 && success; scene++){
+        GeodeticGrid grid = granule->geodeticGrid;
+        RStarPoint* points = granule->pointBatch->points;
+        if (scene){
+            // the bins out of the echo leave the index as the invalid bins of ProcessDataset
+            grid.validArray = echoArray;
+            for (unsigned int i = 0; i < pointCount; i++){
+                heights[i] = points[i].h;
+                if (!echoArray[i]) points[i].h = -1;
+            }
+        }
+        IndexForest forest = {0};
+        if (CreateIndexForest(&grid, granule->pointBatch, &finalGrid, &forest)){
+            RunEchoTopCutoff(scene ? "echo" : "granule", &grid, &forest, &finalGrid, false);
+            RunEchoTopCutoff(scene ? "echo" : "granule", &grid, &forest, &finalGrid, true);
+        }
+        DestroyIndexForest(&forest);
+        if (scene)
+            for (unsigned int i = 0; i < pointCount; i++) points[i].h = heights[i];
+    }
+    g_config->index_engine = previousEngine;
+    g_config->resample_engine = previousResample;
+    g_config->echo_top_cutoff = previousCutoff;
+    DestroyClipGridResult(&finalGrid);
+    free(echoArray);
+    free(heights);
+}
+
+#define BENCH_OUTPUT_FILE_NAME "/tmp/FY3G_bench_output.HDF"
+
+void bench_output_write(const SyntheticGranule* granule){
+    /**
+    @brief Compare the time and the size of the clip output file with contiguous, raw chunked and deflated datasets, in single precision and quantized, the clips of the echo-like scene are interpolated by the scatter engine
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("contiguous vs chunked vs deflated vs quantized output");
+    GeodeticGrid grid = granule->geodeticGrid;
+    bool* echoArray = CreateEchoMask(granule);
+    ClipGridResult finalGrid = {0};
+    if (!echoArray || !CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)){
+        free(echoArray);
+        return;
+    }
+    grid.validArray = echoArray;
+    bool success = true;
+    const float radius = g_config->scatter_radius > 0 ? g_config->scatter_radius : (float)(finalGrid.clipGrids[0].latitudeGap * M_PI * WGS84_B / 180.0);
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && success; clipIndex++){
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        clipGrid->value = (float*)malloc((size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float));
+        success = clipGrid->value && InterpolateClipGridScatter(&grid, radius, g_config->idw_power, clipGrid);
+    }
+    const OutputCompression previousCompression = g_config->output_compression;
+    const unsigned int previousChunkSize = g_config->output_chunk_size, previousLevel = g_config->output_deflate_level;
+    const OutputEncoding previousEncoding = g_config->output_encoding;
+    const struct { const char* name; OutputCompression compression; unsigned int chunkSize, level; OutputEncoding encoding; } runs[] = {
+        {"contiguous", OUTPUT_COMPRESSION_NONE, 0, 0, OUTPUT_ENCODING_FLOAT32},
+        {"chunked", OUTPUT_COMPRESSION_NONE, DEFAULT_OUTPUT_CHUNK_SIZE, 0, OUTPUT_ENCODING_FLOAT32},
+        {"deflate 1", OUTPUT_COMPRESSION_DEFLATE, DEFAULT_OUTPUT_CHUNK_SIZE, 1, OUTPUT_ENCODING_FLOAT32},
+        {"deflate 4", OUTPUT_COMPRESSION_DEFLATE, DEFAULT_OUTPUT_CHUNK_SIZE, 4, OUTPUT_ENCODING_FLOAT32},
+        {"deflate 9", OUTPUT_COMPRESSION_DEFLATE, DEFAULT_OUTPUT_CHUNK_SIZE, 9, OUTPUT_ENCODING_FLOAT32},
+        {"int16", OUTPUT_COMPRESSION_NONE, 0, 0, OUTPUT_ENCODING_INT16},
+        {"int16 def 4", OUTPUT_COMPRESSION_DEFLATE, DEFAULT_OUTPUT_CHUNK_SIZE, 4, OUTPUT_ENCODING_INT16},
+        {"float16", OUTPUT_COMPRESSION_NONE, 0, 0, OUTPUT_ENCODING_FLOAT16},
+        {"fp16 def 4", OUTPUT_COMPRESSION_DEFLATE, DEFAULT_OUTPUT_CHUNK_SIZE, 4, OUTPUT_ENCODING_FLOAT16},
+    };
+    printf("%-12s %10s %12s\n", "output", "seconds", "file MB");
+    for (unsigned int r = 0; r < sizeof(runs) / sizeof(runs[0]) && success; r++){
+        g_config->output_compression = runs[r].compression;
+        g_config->output_chunk_size = runs[r].chunkSize;
+        g_config->output_deflate_level = runs[r].level;
+        g_config->output_encoding = runs[r].encoding;
+        const double start = omp_get_wtime();
+        success = WriteClipResult(0, BENCH_OUTPUT_FILE_NAME, &finalGrid);
+        const double seconds = omp_get_wtime() - start;
+        struct stat status;
+        if (success && stat(BENCH_OUTPUT_FILE_NAME, &status) == 0)
+            printf("%-12s %10.3f %12.1f\n", runs[r].name, seconds, ToMegaBytes(status.st_size));
+    }
+    g_config->output_compression = previousCompression;
+    g_config->output_chunk_size = previousChunkSize;
+    g_config->output_deflate_level = previousLevel;
+    g_config->output_encoding = previousEncoding;
+    remove(BENCH_OUTPUT_FILE_NAME);
+    DestroyClipGridResult(&finalGrid);
+    free(echoArray);
+}
+
+void bench_write_behind(const SyntheticGranule* granule){
+    /**
+    @brief Compare the clips written after the interpolation with the clips written behind it, the time of both and the clip memory held at once, the clips of the echo-like scene are interpolated by the scatter engine
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("write after vs write behind the interpolation");
+    GeodeticGrid grid = granule->geodeticGrid;
+    bool* echoArray = CreateEchoMask(granule);
+    if (!echoArray) return;
+    grid.validArray = echoArray;
+    const ResampleEngine previousEngine = g_config->resample_engine;
+    const unsigned int previousDepth = g_config->write_behind_depth;
+    g_config->resample_engine = RESAMPLE_ENGINE_SCATTER;
+    IndexForest forest = {0};
+    const unsigned int depths[] = {0, 1, DEFAULT_WRITE_BEHIND_DEPTH, 8};
+    printf("%-12s %10s %12s %10s %12s\n", "depth", "seconds", "peak clips", "peak MB", "file MB");
+    bool success = true;
+    for (unsigned int r = 0; r < sizeof(depths) / sizeof(depths[0]) && success; r++){
+        g_config->write_behind_depth = depths[r];
+        ClipGridResult finalGrid = {0};
+        if (!CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)) break;
+        size_t clipBytes = 0;
+        for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++){
+            const ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+            const size_t bytes = (size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float);
+            if (bytes > clipBytes) clipBytes = bytes;
+        }
+        const double start = omp_get_wtime();
+        unsigned int peakClipCount = finalGrid.clipCount;
+        if (depths[r] == 0){
+            for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && success; clipIndex++)
+                success = AllocateClipGridCells(&finalGrid.clipGrids[clipIndex], false);
+            success = success && InterpolateGrid(&grid, &forest, &finalGrid, NULL) && WriteClipResult(0, BENCH_OUTPUT_FILE_NAME, &finalGrid);
+        }
+        else{
+            // a clip per thread being interpolated, the waiting ones and the one being written
+            ClipWriter* writer = CreateClipWriter(0, BENCH_OUTPUT_FILE_NAME, &finalGrid, depths[r]);
+            success = writer && InterpolateGrid(&grid, &forest, &finalGrid, writer);
+            const unsigned int heldCount = writer ? (unsigned int)omp_get_max_threads() + writer->peakPendingCount : 0;
+            if (heldCount < peakClipCount) peakClipCount = heldCount;
+            success = CloseClipWriter(writer) && success;
+        }
+        const double seconds = omp_get_wtime() - start;
+        struct stat status;
+        if (success && stat(BENCH_OUTPUT_FILE_NAME, &status) == 0)
+            printf("%-12u %10.3f %12u %10.1f %12.1f\n", depths[r], seconds, peakClipCount, ToMegaBytes(peakClipCount * clipBytes), ToMegaBytes(status.st_size));
+        DestroyClipGridResult(&finalGrid);
+    }
+    g_config->resample_engine = previousEngine;
+    g_config->write_behind_depth = previousDepth;
+    remove(BENCH_OUTPUT_FILE_NAME);
+    free(echoArray);
+}
+
+static double ReadHDFClips(const ClipGridResult* finalGrid, float* buffer){
+    // every Value dataset of the band read back through HDF5 and its filters
+    double sum = 0;
+    hid_t fileID = H5Fopen(BENCH_OUTPUT_FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+    if (fileID < 0) return 0;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid->clipCount; clipIndex++){
+        const ClipGrid* clipGrid = &finalGrid->clipGrids[clipIndex];
+        const size_t cellCount = (size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+        char path[64];
+        snprintf(path, sizeof(path), "/%s/slice_%u/Value", BAND_NAMES[0], clipIndex);
+        hid_t datasetID = H5Dopen(fileID, path, H5P_DEFAULT);
+        if (datasetID < 0) continue;
+        if (H5Dread(datasetID, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, buffer) >= 0)
+            for (size_t i = 0; i < cellCount; i++) sum += buffer[i];
+        H5Dclose(datasetID);
+    }
+    H5Fclose(fileID);
+    return sum;
+}
+
+static double ReadFlatClips(const char* fileName){
+    // the blocks are summed in place in the mapping, nothing is copied
+    double sum = 0;
+    FlatClipFile* file = OpenFlatClipFile(fileName);
+    if (!file) return 0;
+    for (unsigned int clipIndex = 0; clipIndex < file->header->clipCount; clipIndex++){
+        const FlatClipHeader* clip = &file->clips[clipIndex];
+        const size_t cellCount = (size_t)clip->longitudeCount * clip->latitudeCount * clip->heightCount;
+        const float* block = GetFlatClipBlock(file, clipIndex, 0);
+        for (size_t i = 0; i < cellCount; i++) sum += block[i];
+    }
+    CloseFlatClipFile(file);
+    return sum;
+}
+
+void bench_flat_output(const SyntheticGranule* granule){
+    /**
+    @brief Compare writing and reading back the clips of the HDF5 output with the flat container, the clips of the echo-like scene are interpolated by the scatter engine
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("HDF5 vs flat clip output");
+    GeodeticGrid grid = granule->geodeticGrid;
+    bool* echoArray = CreateEchoMask(granule);
+    ClipGridResult finalGrid = {0};
+    if (!echoArray || !CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)){
+        free(echoArray);
+        return;
+    }
+    grid.validArray = echoArray;
+    bool success = true;
+    size_t maxCellCount = 0;
+    const float radius = g_config->scatter_radius > 0 ? g_config->scatter_radius : (float)(finalGrid.clipGrids[0].latitudeGap * M_PI * WGS84_B / 180.0);
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && success; clipIndex++){
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        const size_t cellCount = (size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+        if (cellCount > maxCellCount) maxCellCount = cellCount;
+        clipGrid->value = (float*)malloc(cellCount * sizeof(float));
+        success = clipGrid->value && InterpolateClipGridScatter(&grid, radius, g_config->idw_power, clipGrid);
+    }
+    float* buffer = (float*)malloc((maxCellCount > 0 ? maxCellCount : 1) * sizeof(float));
+    char* flatFileName = ConstructFlatClipFilename(BENCH_OUTPUT_FILE_NAME, 0);
+    const OutputCompression previousCompression = g_config->output_compression;
+    const unsigned int previousChunkSize = g_config->output_chunk_size, previousLevel = g_config->output_deflate_level;
+    const OutputEncoding previousEncoding = g_config->output_encoding;
+    const struct { const char* name; OutputFormat format; OutputCompression compression; unsigned int chunkSize; } runs[] = {
+        {"hdf5 contig", OUTPUT_FORMAT_HDF5, OUTPUT_COMPRESSION_NONE, 0},
+        {"hdf5 def 4", OUTPUT_FORMAT_HDF5, OUTPUT_COMPRESSION_DEFLATE, DEFAULT_OUTPUT_CHUNK_SIZE},
+        {"flat", OUTPUT_FORMAT_FLAT, OUTPUT_COMPRESSION_NONE, 0},
+    };
+    g_config->output_deflate_level = 4;
+    g_config->output_encoding = OUTPUT_ENCODING_FLOAT32;
+    printf("%-12s %12s %12s %12s %14s\n", "output", "write s", "read s", "file MB", "checksum");
+    for (unsigned int r = 0; r < sizeof(runs) / sizeof(runs[0]) && success && buffer && flatFileName; r++){
+        g_config->output_compression = runs[r].compression;
+        g_config->output_chunk_size = runs[r].chunkSize;
+        const bool flat = runs[r].format == OUTPUT_FORMAT_FLAT;
+        double start = omp_get_wtime();
+        success = flat ? WriteFlatClipResult(0, BENCH_OUTPUT_FILE_NAME, &finalGrid) : WriteClipResult(0, BENCH_OUTPUT_FILE_NAME, &finalGrid);
+        const double writeSeconds = omp_get_wtime() - start;
+        start = omp_get_wtime();
+        const double checksum = flat ? ReadFlatClips(flatFileName) : ReadHDFClips(&finalGrid, buffer);
+        const double readSeconds = omp_get_wtime() - start;
+        struct stat status;
+        if (success && stat(flat ? flatFileName : BENCH_OUTPUT_FILE_NAME, &status) == 0)
+            printf("%-12s %12.4f %12.4f %12.1f %14.1f\n", runs[r].name, writeSeconds, readSeconds, ToMegaBytes(status.st_size), checksum);
+    }
+    g_config->output_compression = previousCompression;
+    g_config->output_chunk_size = previousChunkSize;
+    g_config->output_deflate_level = previousLevel;
+    g_config->output_encoding = previousEncoding;
+    remove(BENCH_OUTPUT_FILE_NAME);
+    if (flatFileName){
+        char indexFileName[512];
+        snprintf(indexFileName, sizeof(indexFileName), "%s%s", flatFileName, FLAT_CLIP_INDEX_EXTENSION);
+        remove(indexFileName);
+        remove(flatFileName);
+    }
+    free(flatFileName);
+    free(buffer);
+    DestroyClipGridResult(&finalGrid);
+    free(echoArray);
+}
+
+void bench_output_layout(const SyntheticGranule* granule){
+    /**
+    @brief Compare writing the clips into the clip output file with writing every clip to its own file linked from it, the clips of the echo-like scene are interpolated by the scatter engine
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("single file vs per-clip files");
+    GeodeticGrid grid = granule->geodeticGrid;
+    bool* echoArray = CreateEchoMask(granule);
+    ClipGridResult finalGrid = {0};
+    if (!echoArray || !CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)){
+        free(echoArray);
+        return;
+    }
+    grid.validArray = echoArray;
+    bool success = true;
+    const float radius = g_config->scatter_radius > 0 ? g_config->scatter_radius : (float)(finalGrid.clipGrids[0].latitudeGap * M_PI * WGS84_B / 180.0);
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && success; clipIndex++){
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        clipGrid->value = (float*)malloc((size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float));
+        success = clipGrid->value && InterpolateClipGridScatter(&grid, radius, g_config->idw_power, clipGrid);
+    }
+    const OutputCompression previousCompression = g_config->output_compression;
+    const unsigned int previousChunkSize = g_config->output_chunk_size, previousLevel = g_config->output_deflate_level;
+    const OutputLayout previousLayout = g_config->output_layout;
+    const struct { const char* name; OutputLayout layout; OutputCompression compression; } runs[] = {
+        {"single raw", OUTPUT_LAYOUT_SINGLE, OUTPUT_COMPRESSION_NONE},
+        {"per-clip raw", OUTPUT_LAYOUT_PER_CLIP, OUTPUT_COMPRESSION_NONE},
+        {"single def 4", OUTPUT_LAYOUT_SINGLE, OUTPUT_COMPRESSION_DEFLATE},
+        {"per-clip def 4", OUTPUT_LAYOUT_PER_CLIP, OUTPUT_COMPRESSION_DEFLATE},
+    };
+    g_config->output_chunk_size = DEFAULT_OUTPUT_CHUNK_SIZE;
+    g_config->output_deflate_level = 4;
+    printf("%-16s %10s %8s %12s (%d threads)\n", "layout", "seconds", "files", "total MB", omp_get_max_threads());
+    for (unsigned int r = 0; r < sizeof(runs) / sizeof(runs[0]) && success; r++){
+        g_config->output_layout = runs[r].layout;
+        g_config->output_compression = runs[r].compression;
+        const double start = omp_get_wtime();
+        success = WriteClipResult(0, BENCH_OUTPUT_FILE_NAME, &finalGrid);
+        const double seconds = omp_get_wtime() - start;
+        // the clip files are counted and removed so the next run starts from the same directory
+        struct stat status;
+        size_t totalBytes = stat(BENCH_OUTPUT_FILE_NAME, &status) == 0 ? (size_t)status.st_size : 0;
+        unsigned int fileCount = 1;
+        for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++){
+            char* clipFileName = ConstructClipFilename(BENCH_OUTPUT_FILE_NAME, 0, clipIndex);
+            if (clipFileName && stat(clipFileName, &status) == 0){
+                totalBytes += status.st_size;
+                fileCount++;
+                remove(clipFileName);
+            }
+            free(clipFileName);
+        }
+        if (success)
+            printf("%-16s %10.3f %8u %12.1f\n", runs[r].name, seconds, fileCount, ToMegaBytes(totalBytes));
+    }
+    g_config->output_compression = previousCompression;
+    g_config->output_chunk_size = previousChunkSize;
+    g_config->output_deflate_level = previousLevel;
+    g_config->output_layout = previousLayout;
+    remove(BENCH_OUTPUT_FILE_NAME);
+    DestroyClipGridResult(&finalGrid);
+    free(echoArray);
+}
+
+void bench_crop_borders(const SyntheticGranule* granule){
+    /**
+    @brief Compare the clip output with and without cropping the empty borders, the time to find the valid boxes, the cells written, the time and the size of the file, the clips of the echo-like scene are interpolated by the scatter engine
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("whole vs cropped clips");
+    GeodeticGrid grid = granule->geodeticGrid;
+    bool* echoArray = CreateEchoMask(granule);
+    ClipGridResult finalGrid = {0};
+    if (!echoArray || !CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)){
+        free(echoArray);
+        return;
+    }
+    grid.validArray = echoArray;
+    bool success = true;
+    const float radius = g_config->scatter_radius > 0 ? g_config->scatter_radius : (float)(finalGrid.clipGrids[0].latitudeGap * M_PI * WGS84_B / 180.0);
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && success; clipIndex++){
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        clipGrid->value = (float*)malloc((size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float));
+        success = clipGrid->value && InterpolateClipGridScatter(&grid, radius, g_config->idw_power, clipGrid);
+    }
+    const OutputCompression previousCompression = g_config->output_compression;
+    printf("%-10s %-10s %10s %12s %10s %10s\n", "clips", "output", "find s", "cells", "write s", "file MB");
+    for (unsigned int cropped = 0; cropped < 2 && success; cropped++){
+        double findSeconds = 0;
+        if (cropped){
+            const double start = omp_get_wtime();
+            for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++)
+                FindClipValidBox(&finalGrid.clipGrids[clipIndex]);
+            findSeconds = omp_get_wtime() - start;
+        }
+        size_t cellCount = 0;
+        for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++){
+            ClipValidBox box;
+            GetClipWriteBox(&finalGrid.clipGrids[clipIndex], &box);
+            cellCount += (size_t)(box.longitudeEnd - box.longitudeBegin) * (box.latitudeEnd - box.latitudeBegin) * (box.heightEnd - box.heightBegin);
+        }
+        for (unsigned int compression = 0; compression < 2 && success; compression++){
+            g_config->output_compression = compression ? OUTPUT_COMPRESSION_DEFLATE : OUTPUT_COMPRESSION_NONE;
+            const double start = omp_get_wtime();
+            success = WriteClipResult(0, BENCH_OUTPUT_FILE_NAME, &finalGrid);
+            const double seconds = omp_get_wtime() - start;
+            struct stat status;
+            if (success && stat(BENCH_OUTPUT_FILE_NAME, &status) == 0)
+                printf("%-10s %-10s %10.4f %12zu %10.3f %10.1f\n", cropped ? "cropped" : "whole", compression ? "deflate" : "raw", findSeconds, cellCount, seconds, ToMegaBytes(status.st_size));
+        }
+    }
+    g_config->output_compression = previousCompression;
+    remove(BENCH_OUTPUT_FILE_NAME);
+    DestroyClipGridResult(&finalGrid);
+    free(echoArray);
+}
+
+void bench_derived_products(const SyntheticGranule* granule){
+    /**
+    @brief Compare the derived products computed on the clips in memory with a downstream pass reading Value back from the clip output file, the clips of the echo-like scene are interpolated by the scatter engine
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("in-pass vs downstream derived products");
+    GeodeticGrid grid = granule->geodeticGrid;
+    bool* echoArray = CreateEchoMask(granule);
+    ClipGridResult finalGrid = {0};
+    if (!echoArray || !CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)){
+        free(echoArray);
+        return;
+    }
+    grid.validArray = echoArray;
+    bool success = true;
+    const float radius = g_config->scatter_radius > 0 ? g_config->scatter_radius : (float)(finalGrid.clipGrids[0].latitudeGap * M_PI * WGS84_B / 180.0);
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && success; clipIndex++){
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        clipGrid->value = (float*)malloc((size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float));
+        success = clipGrid->value && InterpolateClipGridScatter(&grid, radius, g_config->idw_power, clipGrid);
+    }
+    const unsigned int previousProducts = g_config->derived_products;
+    g_config->derived_products = 0;
+    printf("%-12s %12s %12s\n", "products", "columns", "seconds");
+    size_t columnCount = 0;
+    double start = omp_get_wtime();
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && success; clipIndex++){
+        success = ComputeClipProducts(&finalGrid.clipGrids[clipIndex], g_config->echo_top_threshold);
+        columnCount += (size_t)finalGrid.clipGrids[clipIndex].longitudeCount * finalGrid.clipGrids[clipIndex].latitudeCount;
+    }
+    if (success) printf("%-12s %12zu %12.4f\n", "in-pass", columnCount, omp_get_wtime() - start);
+
+    // downstream the clips are read back from the file, then reduced column by column
+    success = success && WriteClipResult(0, BENCH_OUTPUT_FILE_NAME, &finalGrid);
+    start = omp_get_wtime();
+    hid_t fileID = success ? H5Fopen(BENCH_OUTPUT_FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT) : -1;
+    float checksum = 0;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && fileID >= 0; clipIndex++){
+        const ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        char path[64];
+        snprintf(path, sizeof(path), "/%s/slice_%u/Value", BAND_NAMES[0], clipIndex);
+        const size_t cellCount = (size_t)clipGrid->longitudeCount * clipGrid->latitudeCount * clipGrid->heightCount;
+        float* cells = (float*)malloc(cellCount * sizeof(float));
+        hid_t datasetID = H5Dopen(fileID, path, H5P_DEFAULT);
+        if (cells && datasetID >= 0 && H5Dread(datasetID, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, cells) >= 0)
+            for (size_t column = 0; column < cellCount / clipGrid->heightCount; column++){
+                float products[DERIVED_PRODUCT_COUNT];
+                AccumulateColumnProducts(cells + column * clipGrid->heightCount, clipGrid->heightCount, clipGrid->minHeight, clipGrid->heightGap, g_config->echo_top_threshold, products);
+                checksum += products[0] > -999 ? 1.0f : 0.0f;
+            }
+        if (datasetID >= 0) H5Dclose(datasetID);
+        free(cells);
+    }
+    if (fileID >= 0){
+        H5Fclose(fileID);
+        printf("%-12s %12zu %12.4f (%.0f columns with a value)\n", "downstream", columnCount, omp_get_wtime() - start, checksum);
+    }
+    g_config->derived_products = previousProducts;
+    remove(BENCH_OUTPUT_FILE_NAME);
+    DestroyClipGridResult(&finalGrid);
+    free(echoArray);
+}
+
+void bench_catalog_query(const SyntheticGranule* granule){
+    /**
+    @brief Compare finding the clips with strong echoes through the catalog with reading Value of every clip from the clip output file, with the time to compute the statistics and to append them, the clips of the echo-like scene are interpolated by the scatter engine
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("catalog vs clip file query");
+    GeodeticGrid grid = granule->geodeticGrid;
+    bool* echoArray = CreateEchoMask(granule);
+    ClipGridResult finalGrid = {0};
+    if (!echoArray || !CreateSyntheticClips(granule, BENCH_CLIP_LINE_COUNT, &finalGrid)){
+        free(echoArray);
+        return;
+    }
+    grid.validArray = echoArray;
+    bool success = true;
+    const float radius = g_config->scatter_radius > 0 ? g_config->scatter_radius : (float)(finalGrid.clipGrids[0].latitudeGap * M_PI * WGS84_B / 180.0);
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && success; clipIndex++){
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        clipGrid->value = (float*)malloc((size_t)clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount * sizeof(float));
+        success = clipGrid->value && InterpolateClipGridScatter(&grid, radius, g_config->idw_power, clipGrid);
+    }
+    const char* catalogFileName = "/tmp/FY3G_bench_catalog.cat";
+    remove(catalogFileName);
+    double start = omp_get_wtime();
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && success; clipIndex++)
+        success = ComputeClipStatistics(&finalGrid.clipGrids[clipIndex]);
+    const double statisticsSeconds = omp_get_wtime() - start;
+    start = omp_get_wtime();
+    success = success && AppendCatalog(catalogFileName, 0, BENCH_OUTPUT_FILE_NAME, &finalGrid);
+    const double appendSeconds = omp_get_wtime() - start;
+    success = success && WriteClipResult(0, BENCH_OUTPUT_FILE_NAME, &finalGrid);
+    if (success) printf("%u clips, statistics %.4f s, append %.4f s\n", finalGrid.clipCount, statisticsSeconds, appendSeconds);
+
+    // the clips with an echo of 30 dBZ, from the catalog and from the cells
+    printf("%-10s %10s %10s\n", "query", "matches", "seconds");
+    CatalogQuery query;
+    InitCatalogQuery(&query);
+    query.minValue = 30.0f;
+    start = omp_get_wtime();
+    CatalogFile* file = success ? OpenCatalogFile(catalogFileName) : NULL;
+    if (file){
+        unsigned int matchCount = 0;
+        for (const CatalogRecord* record = NextCatalogRecord(file, NULL); record; record = NextCatalogRecord(file, record))
+            if (MatchCatalogRecord(file, record, &query)) matchCount++;
+        CloseCatalogFile(file);
+        printf("%-10s %10u %10.4f\n", "catalog", matchCount, omp_get_wtime() - start);
+    }
+    start = omp_get_wtime();
+    hid_t fileID = success ? H5Fopen(BENCH_OUTPUT_FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT) : -1;
+    unsigned int matchCount = 0;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount && fileID >= 0; clipIndex++){
+        const ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        char path[64];
+        snprintf(path, sizeof(path), "/%s/slice_%u/Value", BAND_NAMES[0], clipIndex);
+        const size_t cellCount = (size_t)clipGrid->longitudeCount * clipGrid->latitudeCount * clipGrid->heightCount;
+        float* cells = (float*)malloc(cellCount * sizeof(float));
+        hid_t datasetID = H5Dopen(fileID, path, H5P_DEFAULT);
+        if (cells && datasetID >= 0 && H5Dread(datasetID, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, cells) >= 0){
+            size_t index = 0;
+            while (index < cellCount && cells[index] < query.minValue) index++;
+            if (index < cellCount) matchCount++;
+        }
+        if (datasetID >= 0) H5Dclose(datasetID);
+        free(cells);
+    }
+    if (fileID >= 0){
+        H5Fclose(fileID);
+        printf("%-10s %10u %10.4f\n", "cells", matchCount, omp_get_wtime() - start);
+    }
+    remove(catalogFileName);
+    remove(BENCH_OUTPUT_FILE_NAME);
+    DestroyClipGridResult(&finalGrid);
+    free(echoArray);
+}
+
+void bench_geodetic_output(const SyntheticGranule* granule){
+    /**
+    @brief Compare the geodetic product of every bin written raw with the bin window written deflated, the time and the size of the file, and the time to read a block of scan lines back
+    @param granule: the synthetic granule
+    */
+    PrintBenchHeader("full vs windowed geodetic product");
+    const struct Config previousConfig = *g_config;
+    const HDFGlobalAttribute globalAttribute = {granule->lineCount, {2024, 5, 6, 7, 0, 0}, {2024, 5, 6, 7, 10, 0}, true};
+    printf("%-10s %-10s %8s %10s %10s %12s\n", "bins", "output", "lines", "write s", "file MB", "read 16 s");
+    for (unsigned int variant = 0; variant < 3; variant++){
+        // every bin raw, every bin deflated, then the lower three fifths of the bins deflated
+        g_config->output_compression = variant == 0 ? OUTPUT_COMPRESSION_NONE : OUTPUT_COMPRESSION_DEFLATE;
+        g_config->geodetic_bin_begin = variant == 2 ? SCAN_HEIGHT_COUNT * 2 / 5 : 0;
+        g_config->geodetic_bin_end = 0;
+        double start = omp_get_wtime();
+        if (!WriteTotalGeodetic(0, BENCH_OUTPUT_FILE_NAME, &granule->geodeticGrid, &globalAttribute)) break;
+        const double writeSeconds = omp_get_wtime() - start;
+        struct stat status;
+        if (stat(BENCH_OUTPUT_FILE_NAME, &status) != 0) break;
+        // a block of lines in the middle of the granule through a hyperslab
+        start = omp_get_wtime();
+        hid_t fileID = H5Fopen(BENCH_OUTPUT_FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+        hid_t datasetID = H5Dopen(fileID, "/Ka/Value", H5P_DEFAULT);
+        hid_t fileSpaceID = H5Dget_space(datasetID);
+        hsize_t dims[3];
+        H5Sget_simple_extent_dims(fileSpaceID, dims, NULL);
+        const hsize_t offset[3] = {dims[0] / 2 / g_config->geodetic_line_block * g_config->geodetic_line_block, 0, 0}, count[3] = {dims[0] < 16 ? dims[0] : 16, dims[1], dims[2]};
+        float* block = (float*)malloc(count[0] * count[1] * count[2] * sizeof(float));
+        hid_t memorySpaceID = H5Screate_simple(3, count, NULL);
+        H5Sselect_hyperslab(fileSpaceID, H5S_SELECT_SET, offset, NULL, count, NULL);
+        const bool read = block && H5Dread(datasetID, H5T_NATIVE_FLOAT, memorySpaceID, fileSpaceID, H5P_DEFAULT, block) >= 0;
+        H5Sclose(memorySpaceID);
+        H5Sclose(fileSpaceID);
+        H5Dclose(datasetID);
+        H5Fclose(fileID);
+        free(block);
+        const double readSeconds = omp_get_wtime() - start;
+        printf("%-10llu %-10s %8u %10.3f %10.1f %12.4f%s\n", (unsigned long long)dims[2], variant == 0 ? "raw" : "deflate", granule->lineCount, writeSeconds, ToMegaBytes(status.st_size), readSeconds, read ? "" : " (failed)");
+    }
+    *g_config = previousConfig;
+    remove(BENCH_OUTPUT_FILE_NAME);
+}
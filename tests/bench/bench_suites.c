@@ -0,0 +1,218 @@
+#include <string.h>
+#include <omp.h>
+#include "bench_suites.h"
+#include "geotransfer.h"
+#include "interface.h"
+#include "config.h"
+
+#define BENCH_LATITUDE_STEP 0.045f // ~5km along track
+#define BENCH_BIN_HEIGHT_STEP 40.0f // 500 bins over 20km
+#define BENCH_ANGLE_STEP 0.3 // degree of incidence between neighboring scan angles
+#define BENCH_LATTICE_HEIGHT_COUNT 60 // target levels, as DEFAULT_HEIGHT_COUNT
+#define BENCH_LATTICE_HEIGHT_GAP 200.0 // as DEFAULT_HEIGHT_GAP
+
+SyntheticGranule* CreateSyntheticGranule(unsigned int lineCount){
+    /**
+    @brief Create a synthetic granule with the scan geometry (line x angle x bin) of the real data
+    @param lineCount: the number of scan lines
+    @return the granule, the point batch and geodetic grid are laid out as ProcessDataset does, rays are slanted by the scan angle
+    */
+    SyntheticGranule* granule = (SyntheticGranule*)malloc(sizeof(SyntheticGranule));
+    if (!granule) return NULL;
+    granule->lineCount = lineCount;
+    granule->validCount = 0;
+    granule->pointBatch = CreateRStarPointBatch(lineCount * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT);
+    if (!granule->pointBatch || !InitGeodeticGrid(&granule->geodeticGrid, lineCount, SCAN_HEIGHT_COUNT)){
+        DestroyRStarPointBatch(granule->pointBatch);
+        free(granule);
+        return NULL;
+    }
+    granule->minLatitude = 20.0f;
+    granule->maxLatitude = granule->minLatitude + lineCount * BENCH_LATITUDE_STEP;
+    const float longitudeStep = BENCH_LATITUDE_STEP / cos(ToRadians(granule->minLatitude));
+    granule->minLongitude = 110.0f - SCAN_ANGLE_COUNT / 2 * longitudeStep;
+    granule->maxLongitude = 110.0f + SCAN_ANGLE_COUNT / 2 * longitudeStep;
+    for (unsigned int lineIndex = 0; lineIndex < lineCount; lineIndex++)
+        for (unsigned int angleIndex = 0; angleIndex < SCAN_ANGLE_COUNT; angleIndex++){
+            const double latitude = granule->minLatitude + lineIndex * BENCH_LATITUDE_STEP;
+            const double longitude = granule->minLongitude + angleIndex * longitudeStep;
+            const double slope = tan(ToRadians(((int)angleIndex - SCAN_ANGLE_COUNT / 2) * BENCH_ANGLE_STEP)) / (111320.0 * cos(ToRadians(latitude)));
+            const float echoTop = 2000.0f + (float)rand() / RAND_MAX * 10000.0f;
+            for (unsigned int binIndex = 0; binIndex < SCAN_HEIGHT_COUNT; binIndex++){
+                const unsigned int index = lineIndex * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT + angleIndex * SCAN_HEIGHT_COUNT + binIndex;
+                RStarPoint* point = &granule->pointBatch->points[index];
+                const float height = 20000.0f - binIndex * BENCH_BIN_HEIGHT_STEP;
+                const double binLongitude = longitude + height * slope;
+                granule->geodeticGrid.latitudeArray[index] = latitude;
+                granule->geodeticGrid.longitudeArray[index] = binLongitude;
+                granule->geodeticGrid.elevationArray[index] = height;
+                granule->geodeticGrid.valueArray[index] = 10.0f + 30.0f * (float)rand() / RAND_MAX;
+                if (height > echoTop || height < 0 || rand() % 10 < 3){
+                    point->h = -1;
+                    granule->geodeticGrid.validArray[index] = false;
+                    granule->geodeticGrid.valueArray[index] = -999;
+                    continue;
+                }
+                double x, y, z;
+                TransferGeodeticToCartesian(latitude, binLongitude, height, &x, &y, &z);
+                point->x = x;
+                point->y = y;
+                point->z = z;
+                point->h = height;
+                point->id = index;
+                granule->validCount++;
+            }
+        }
+    return granule;
+}
+
+void DestroySyntheticGranule(SyntheticGranule* granule){
+    if (!granule) return;
+    DestroyRStarPointBatch(granule->pointBatch);
+    DestroyGeodeticGrid(&granule->geodeticGrid);
+    free(granule);
+}
+
+double* CreateSyntheticQueries(const SyntheticGranule* granule, unsigned int startLine, unsigned int endLine, unsigned int queryCount, double** queryGeodetic){
+    /**
+    @brief Create random query points between two scan lines of the granule, below the maximal echo top
+    @param granule: the synthetic granule
+    @param startLine: the first scan line
+    @param endLine: the last scan line (exclusive)
+    @param queryCount: the number of query points
+    @param queryGeodetic: (optional) output latitude, longitude and height of the queries [queryCount][3]
+    @return the query points [queryCount][3]
+    */
+    double* queryPoints = (double*)malloc(queryCount * 3 * sizeof(double));
+    if (!queryPoints) return NULL;
+    if (queryGeodetic){
+        *queryGeodetic = (double*)malloc(queryCount * 3 * sizeof(double));
+        if (!*queryGeodetic){
+            free(queryPoints);
+            return NULL;
+        }
+    }
+    for (unsigned int i = 0; i < queryCount; i++){
+        const double latitude = granule->minLatitude + (startLine + (double)rand() / RAND_MAX * (endLine - startLine)) * BENCH_LATITUDE_STEP;
+        const double longitude = granule->minLongitude + (double)rand() / RAND_MAX * (granule->maxLongitude - granule->minLongitude);
+        const double height = 100.0 + (double)rand() / RAND_MAX * 11900.0;
+        TransferGeodeticToCartesian(latitude, longitude, height, &queryPoints[i * 3 + 0], &queryPoints[i * 3 + 1], &queryPoints[i * 3 + 2]);
+        if (queryGeodetic){
+            (*queryGeodetic)[i * 3 + 0] = latitude;
+            (*queryGeodetic)[i * 3 + 1] = longitude;
+            (*queryGeodetic)[i * 3 + 2] = height;
+        }
+    }
+    return queryPoints;
+}
+
+static void CreateSyntheticLatticeGrid(const SyntheticGranule* granule, unsigned int startLine, unsigned int endLine, ClipGrid* clipGrid){
+    // the lattice spacing is the along track line step, heights follow the default config
+    clipGrid->latitudeGap = BENCH_LATITUDE_STEP;
+    clipGrid->longitudeGap = BENCH_LATITUDE_STEP / cos(ToRadians(granule->minLatitude));
+    clipGrid->latitudeCount = endLine > startLine ? endLine - startLine : 1;
+    clipGrid->longitudeCount = (unsigned int)((granule->maxLongitude - granule->minLongitude) / clipGrid->longitudeGap) + 1;
+    clipGrid->heightCount = BENCH_LATTICE_HEIGHT_COUNT;
+    clipGrid->minLatitude = granule->minLatitude + startLine * BENCH_LATITUDE_STEP;
+    clipGrid->maxLatitude = clipGrid->minLatitude + (clipGrid->latitudeCount - 1) * clipGrid->latitudeGap;
+    clipGrid->minLongitude = granule->minLongitude;
+    clipGrid->maxLongitude = clipGrid->minLongitude + (clipGrid->longitudeCount - 1) * clipGrid->longitudeGap;
+    clipGrid->minHeight = 100.0f;
+    clipGrid->heightGap = BENCH_LATTICE_HEIGHT_GAP;
+}
+
+double* CreateSyntheticLattice(const SyntheticGranule* granule, unsigned int startLine, unsigned int endLine, unsigned int* queryCount, ClipGrid* lattice){
+    /**
+    @brief Create the target lattice of the lines as InterpolateClipGridBatch does, longitude outermost and height innermost
+    @param granule: the synthetic granule
+    @param startLine: the first scan line
+    @param endLine: the last scan line (exclusive)
+    @param queryCount: output number of query points
+    @param lattice: output lattice geometry, the query i has the lattice index i, can be NULL
+    @return the query points [queryCount][3]
+    */
+    ClipGrid grid = {0};
+    CreateSyntheticLatticeGrid(granule, startLine, endLine, &grid);
+    if (lattice) *lattice = grid;
+    *queryCount = grid.longitudeCount * grid.latitudeCount * grid.heightCount;
+    double* queryPoints = (double*)malloc((size_t)*queryCount * 3 * sizeof(double));
+    if (!queryPoints) return NULL;
+    unsigned int queryIndex = 0;
+    for (unsigned int l = 0; l < grid.longitudeCount; l++)
+        for (unsigned int b = 0; b < grid.latitudeCount; b++)
+            for (unsigned int h = 0; h < grid.heightCount; h++){
+                const double latitude = grid.minLatitude + b * grid.latitudeGap;
+                const double longitude = grid.minLongitude + l * grid.longitudeGap;
+                const double height = grid.minHeight + h * grid.heightGap;
+                TransferGeodeticToCartesian(latitude, longitude, height, &queryPoints[queryIndex * 3 + 0], &queryPoints[queryIndex * 3 + 1], &queryPoints[queryIndex * 3 + 2]);
+                queryIndex++;
+            }
+    return queryPoints;
+}
+
+bool CreateSyntheticClips(const SyntheticGranule* granule, unsigned int clipLineCount, ClipGridResult* finalGrid){
+    /**
+    @brief Split the granule into clips of clipLineCount lines, padded by two lines on each side as QueryBoundingBox does
+    @param granule: the synthetic granule
+    @param clipLineCount: the line count of a clip before padding
+    @param finalGrid: output clips, the line ranges and the target lattice of CreateSyntheticLattice are filled, values are not allocated
+    @return true if successful, false otherwise
+    */
+    finalGrid->clipCount = (granule->lineCount + clipLineCount - 1) / clipLineCount;
+    finalGrid->clipGrids = (ClipGrid*)calloc(finalGrid->clipCount, sizeof(ClipGrid));
+    if (!finalGrid->clipGrids) return false;
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid->clipCount; clipIndex++){
+        const unsigned int left = clipIndex * clipLineCount;
+        const unsigned int right = left + clipLineCount - 1;
+        ClipGrid* clipGrid = &finalGrid->clipGrids[clipIndex];
+        clipGrid->leftLineIndex = left < 2 ? 0 : left - 2;
+        clipGrid->rightLineIndex = right + 2 >= granule->lineCount ? granule->lineCount - 1 : right + 2;
+        CreateSyntheticLatticeGrid(granule, clipGrid->leftLineIndex, clipGrid->rightLineIndex + 1, clipGrid);
+    }
+    return true;
+}
+
+void PrintBenchHeader(const char* title){
+    printf("\n================ %s ================\n", title);
+}
+
+int main(int argc, char *argv[]){
+    /**
+     * @brief benchmark the spatial engines on a synthetic granule
+     * @param argv[1]: (optional) number of scan lines, default 200
+     * @param argv[2]: (optional) config file, default values are used if absent
+     */
+    const unsigned int lineCount = argc > 1 ? (unsigned int)atoi(argv[1]) : 200;
+    g_config = ReadConfig(argc > 2 ? argv[2] : "/dev/null");
+    srand(42);
+    printf("Synthetic granule: %u lines x %d angles x %d bins, %d threads\n", lineCount, SCAN_ANGLE_COUNT, SCAN_HEIGHT_COUNT, omp_get_max_threads());
+    SyntheticGranule* granule = CreateSyntheticGranule(lineCount);
+    if (!granule){
+        fprintf(stderr, "Failed to create synthetic granule\n");
+        return -1;
+    }
+    printf("Valid points: %u\n", granule->validCount);
+    bench_index(granule);
+    bench_shared_index(granule);
+    bench_structured(granule);
+    bench_voxel(granule);
+    bench_query_order(granule);
+    bench_interpolate_chunk(granule);
+    bench_idw();
+    bench_vertical_scale(granule);
+    bench_separable(granule);
+    bench_extra_variables(granule);
+    bench_resample_plan(granule);
+    bench_clip_storage(granule);
+    bench_echo_top(granule);
+    bench_output_write(granule);
+    bench_write_behind(granule);
+    bench_flat_output(granule);
+    bench_output_layout(granule);
+    bench_crop_borders(granule);
+    bench_derived_products(granule);
+    bench_catalog_query(granule);
+    bench_geodetic_output(granule);
+    DestroySyntheticGranule(granule);
+    return 0;
+}
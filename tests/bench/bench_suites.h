@@ -0,0 +1,46 @@
+#ifndef BENCH_SUITES_H
+#define BENCH_SUITES_H
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "index.h"
+
+#define BENCH_CLIP_LINE_COUNT 50
+
+typedef struct {
+    unsigned int lineCount;
+    PointBatch* pointBatch; // [lineCount][SCAN_ANGLE_COUNT][SCAN_HEIGHT_COUNT]
+    GeodeticGrid geodeticGrid; // same layout and validity as the point batch
+    unsigned int validCount;
+    float minLatitude, maxLatitude, minLongitude, maxLongitude;
+} SyntheticGranule;
+
+SyntheticGranule* CreateSyntheticGranule(unsigned int lineCount);
+void DestroySyntheticGranule(SyntheticGranule* granule);
+double* CreateSyntheticQueries(const SyntheticGranule* granule, unsigned int startLine, unsigned int endLine, unsigned int queryCount, double** queryGeodetic);
+double* CreateSyntheticLattice(const SyntheticGranule* granule, unsigned int startLine, unsigned int endLine, unsigned int* queryCount, ClipGrid* lattice);
+bool CreateSyntheticClips(const SyntheticGranule* granule, unsigned int clipLineCount, ClipGridResult* finalGrid);
+void PrintBenchHeader(const char* title);
+
+void bench_index(const SyntheticGranule* granule);
+void bench_shared_index(const SyntheticGranule* granule);
+void bench_structured(const SyntheticGranule* granule);
+void bench_voxel(const SyntheticGranule* granule);
+void bench_query_order(const SyntheticGranule* granule);
+void bench_interpolate_chunk(const SyntheticGranule* granule);
+void bench_idw(void);
+void bench_vertical_scale(const SyntheticGranule* granule);
+void bench_separable(const SyntheticGranule* granule);
+void bench_extra_variables(const SyntheticGranule* granule);
+void bench_resample_plan(const SyntheticGranule* granule);
+void bench_clip_storage(const SyntheticGranule* granule);
+void bench_echo_top(const SyntheticGranule* granule);
+void bench_output_write(const SyntheticGranule* granule);
+void bench_write_behind(const SyntheticGranule* granule);
+void bench_flat_output(const SyntheticGranule* granule);
+void bench_output_layout(const SyntheticGranule* granule);
+void bench_crop_borders(const SyntheticGranule* granule);
+void bench_derived_products(const SyntheticGranule* granule);
+void bench_catalog_query(const SyntheticGranule* granule);
+void bench_geodetic_output(const SyntheticGranule* granule);
+#endif
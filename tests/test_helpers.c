@@ -0,0 +1,58 @@
+#include "test_suites.h"
+#include "test_helpers.h"
+
+RStarPoint* CreateTestPoints(unsigned int count, float extent) {
+    RStarPoint* points = (RStarPoint*)malloc(count * sizeof(RStarPoint));
+    if (!points) return NULL;
+    for (unsigned int i = 0; i < count; i++) {
+        points[i].x = 6378137.0f + (float)rand() / RAND_MAX * extent; // ECEF-like magnitude
+        points[i].y = (float)rand() / RAND_MAX * extent;
+        points[i].z = (float)rand() / RAND_MAX * extent;
+        points[i].h = (rand() % 4 == 0) ? -1 : 1; // a quarter of the points are invalid
+        points[i].id = i;
+    }
+    return points;
+}
+
+double SquaredDistance(const RStarPoint* point, const double queryPoint[3]) {
+    const double dx = point->x - queryPoint[0], dy = point->y - queryPoint[1], dz = point->z - queryPoint[2];
+    return dx * dx + dy * dy + dz * dz;
+}
+
+void InitTestClip(ClipGrid* clipGrid, const unsigned int clipIndex, const TestClipLattice* lattice, const bool sparse, TestClipFill fill, const void* context) {
+    // the lattice and the extra variables, then the cells when a fill is given, as InitClipGridArray and BeginClip would
+    *clipGrid = (ClipGrid){0};
+    clipGrid->longitudeCount = lattice->longitudeCount + clipIndex * lattice->longitudeCountStep;
+    clipGrid->latitudeCount = lattice->latitudeCount;
+    clipGrid->heightCount = lattice->heightCount;
+    clipGrid->minLatitude = lattice->minLatitude + clipIndex * lattice->minLatitudeStep;
+    clipGrid->maxLatitude = clipGrid->minLatitude + (clipGrid->latitudeCount - 1) * lattice->gap;
+    clipGrid->minLongitude = lattice->minLongitude + clipIndex * lattice->minLongitudeStep;
+    clipGrid->maxLongitude = clipGrid->minLongitude + (clipGrid->longitudeCount - 1) * lattice->gap;
+    clipGrid->minHeight = lattice->minHeight;
+    clipGrid->latitudeGap = clipGrid->longitudeGap = lattice->gap;
+    clipGrid->heightGap = lattice->heightGap;
+    ClipGridResult single = {1, clipGrid, {0}};
+    TEST_ASSERT_TRUE(InitClipGridExtra(&single, lattice->extraCount));
+    if (!fill) return;
+    TEST_ASSERT_TRUE(AllocateClipGridCells(clipGrid, sparse));
+    FillTestClip(clipGrid, clipIndex, fill, context);
+}
+
+void CreateTestClips(ClipGridResult* result, const unsigned int clipCount, const TestClipLattice* lattice, const bool sparse, TestClipFill fill, const void* context) {
+    result->clipCount = clipCount;
+    result->clipGrids = (ClipGrid*)calloc(clipCount, sizeof(ClipGrid));
+    TEST_ASSERT_NOT_NULL(result->clipGrids);
+    for (unsigned int clipIndex = 0; clipIndex < clipCount; clipIndex++)
+        InitTestClip(&result->clipGrids[clipIndex], clipIndex, lattice, sparse, fill, context);
+}
+
+void FillTestClip(ClipGrid* clipGrid, const unsigned int clipIndex, TestClipFill fill, const void* context) {
+    for (unsigned int l = 0; l < clipGrid->longitudeCount; l++)
+        for (unsigned int b = 0; b < clipGrid->latitudeCount; b++)
+            for (unsigned int h = 0; h < clipGrid->heightCount; h++) {
+                const size_t index = ((size_t)l * clipGrid->latitudeCount + b) * clipGrid->heightCount + h;
+                for (unsigned int variable = 0; variable <= clipGrid->extraCount; variable++)
+                    SetClipValue(clipGrid, variable, index, fill(context, clipIndex, variable, l, b, h, index));
+            }
+}
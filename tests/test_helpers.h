@@ -0,0 +1,28 @@
+#ifndef TEST_HELPERS_H
+#define TEST_HELPERS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "rstartree.h"
+#include "data.h"
+
+// ================ Shared Test Fixtures ================
+RStarPoint* CreateTestPoints(unsigned int count, float extent);
+double SquaredDistance(const RStarPoint* point, const double queryPoint[3]);
+
+// clip c of a fixture has longitudeCount + c * longitudeCountStep longitudes and starts at
+// minLatitude + c * minLatitudeStep, minLongitude + c * minLongitudeStep, its max is at the last cell
+typedef struct {
+    unsigned int longitudeCount, latitudeCount, heightCount, longitudeCountStep;
+    float minLatitude, minLongitude, minHeight, minLatitudeStep, minLongitudeStep;
+    float gap, heightGap; // the latitude and longitude gap, the height gap
+    unsigned int extraCount;
+} TestClipLattice;
+
+// the value of a cell of variable 0 (Value) or 1 + v (the extra variable v), index is the lattice index of (l, b, h)
+typedef float (*TestClipFill)(const void* context, const unsigned int clipIndex, const unsigned int variable, const unsigned int l, const unsigned int b, const unsigned int h, const size_t index);
+
+void InitTestClip(ClipGrid* clipGrid, const unsigned int clipIndex, const TestClipLattice* lattice, const bool sparse, TestClipFill fill, const void* context);
+void CreateTestClips(ClipGridResult* result, const unsigned int clipCount, const TestClipLattice* lattice, const bool sparse, TestClipFill fill, const void* context);
+void FillTestClip(ClipGrid* clipGrid, const unsigned int clipIndex, TestClipFill fill, const void* context);
+#endif // TEST_HELPERS_H
@@ -12,6 +12,24 @@ int main(void) {
     RUN_TEST(test_index);
     RUN_TEST(test_rstar3d);
     RUN_TEST(test_kdtree2d);
+    RUN_TEST(test_knnindex);
+    RUN_TEST(test_structured);
+    RUN_TEST(test_voxelindex);
+    RUN_TEST(test_morton);
+    RUN_TEST(test_separable);
+    RUN_TEST(test_plan);
+    RUN_TEST(test_scatter);
+    RUN_TEST(test_clip_storage);
+    RUN_TEST(test_echo_top);
+    RUN_TEST(test_chunk_writer);
+    RUN_TEST(test_write_behind);
+    RUN_TEST(test_flat_clip);
+    RUN_TEST(test_clip_layout);
+    RUN_TEST(test_clip_crop);
+    RUN_TEST(test_derived_products);
+    RUN_TEST(test_catalog);
+    RUN_TEST(test_geodetic_writer);
+    RUN_TEST(test_idw);
     RUN_TEST(test_interpolate);
     RUN_TEST(test_geotransfer);
     RUN_TEST(test_readHDF5);
@@ -6,6 +6,24 @@
 void test_geotransfer(void);
 void test_readHDF5(void);
 void test_interpolate(void);
+void test_idw(void);
 void test_index(void);
 void test_rstar3d(void);
-void test_kdtree2d(void);
\ No newline at end of file
+void test_kdtree2d(void);
+void test_knnindex(void);
+void test_structured(void);
+void test_voxelindex(void);
+void test_morton(void);
+void test_separable(void);
+void test_plan(void);
+void test_scatter(void);
+void test_clip_storage(void);
+void test_echo_top(void);
+void test_chunk_writer(void);
+void test_write_behind(void);
+void test_flat_clip(void);
+void test_clip_layout(void);
+void test_clip_crop(void);
+void test_derived_products(void);
+void test_catalog(void);
+void test_geodetic_writer(void);
\ No newline at end of file
@@ -0,0 +1,174 @@
+#include "test_suites.h"
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "catalog.h"
+#include "test_helpers.h"
+
+#define TEST_CATALOG_FILE_NAME "/tmp/FY3G_unit_catalog.cat"
+#define TEST_CATALOG_DATA_NAME "/tmp/FY3G_unit_catalog_clip.HDF"
+
+static const TestClipLattice TEST_CATALOG_LATTICE = {12, 9, 16, 0, 20.0f, 110.0f, 0.0f, 5.0f, 0.0f, 0.05f, 500.0f, 0};
+
+static float FillTestCell(const void* context, const unsigned int clipIndex, const unsigned int variable, const unsigned int l, const unsigned int b, const unsigned int h, const size_t index) {
+    // an echo growing with the height in the first clip, the second clip empty
+    const bool echo = clipIndex == 0 && l >= 2 && l < 6 && b >= 3 && b < 7 && h < 8;
+    return echo ? 10.0f + 5.0f * h : -999.0f;
+}
+
+static void InitTestClips(ClipGridResult* result, const bool sparse) {
+    // the statistics kept, the cells released as behind a writer
+    CreateTestClips(result, 2, &TEST_CATALOG_LATTICE, sparse, FillTestCell, NULL);
+    result->globalAttribute.scanLineCount = 601;
+    result->globalAttribute.startDateTime = (DateTime){2024, 5, 6, 7, 0, 0};
+    result->globalAttribute.endDateTime = (DateTime){2024, 5, 6, 7, 10, 0};
+    for (unsigned int clipIndex = 0; clipIndex < result->clipCount; clipIndex++) {
+        ClipGrid* clipGrid = &result->clipGrids[clipIndex];
+        clipGrid->leftLineIndex = 300 * clipIndex;
+        clipGrid->rightLineIndex = 300 * clipIndex + 100;
+        TEST_ASSERT_TRUE(ComputeClipStatistics(clipGrid));
+        ReleaseClipGridCells(clipGrid);
+    }
+}
+
+static unsigned int CountMatches(const CatalogFile* file, const CatalogQuery* query) {
+    unsigned int count = 0;
+    for (const CatalogRecord* record = NextCatalogRecord(file, NULL); record; record = NextCatalogRecord(file, record))
+        if (MatchCatalogRecord(file, record, query)) count++;
+    return count;
+}
+
+void test_catalog_date_time(void) {
+    TEST_MESSAGE("Start catalog date time test");
+    const DateTime dateTimes[3] = {{2024, 5, 6, 7, 8, 9}, {2024, 2, 29, 23, 59, 59}, {1969, 12, 31, 23, 0, 0}};
+    const int64_t seconds[3] = {1714979289, 1709251199, -3600};
+    for (unsigned int i = 0; i < 3; i++) {
+        TEST_ASSERT_EQUAL_INT64(seconds[i], DateTimeToSeconds(&dateTimes[i]));
+        const DateTime dateTime = SecondsToDateTime(seconds[i]);
+        TEST_ASSERT_EQUAL_INT(0, memcmp(&dateTimes[i], &dateTime, sizeof(DateTime)));
+    }
+    TEST_MESSAGE("Catalog date time test completed");
+}
+
+void test_catalog_statistics(void) {
+    TEST_MESSAGE("Start clip statistics test");
+    for (unsigned int storage = 0; storage < 2; storage++) {
+        ClipGridResult result = {0};
+        InitTestClips(&result, storage == 1);
+        // the statistics outlive the cells
+        const ClipStatistics* statistics = result.clipGrids[0].statistics;
+        TEST_ASSERT_NOT_NULL(statistics);
+        TEST_ASSERT_EQUAL_UINT(4 * 4 * 8, statistics->total.validCount);
+        TEST_ASSERT_EQUAL_FLOAT(10.0f, statistics->total.minValue);
+        TEST_ASSERT_EQUAL_FLOAT(45.0f, statistics->total.maxValue);
+        TEST_ASSERT_EQUAL_FLOAT(27.5f, statistics->total.meanValue);
+        TEST_ASSERT_EQUAL_UINT(2, statistics->box.longitudeBegin);
+        TEST_ASSERT_EQUAL_UINT(6, statistics->box.longitudeEnd);
+        TEST_ASSERT_EQUAL_UINT(3, statistics->box.latitudeBegin);
+        TEST_ASSERT_EQUAL_UINT(7, statistics->box.latitudeEnd);
+        TEST_ASSERT_EQUAL_UINT(16, statistics->levels[7].validCount);
+        TEST_ASSERT_EQUAL_FLOAT(45.0f, statistics->levels[7].meanValue);
+        TEST_ASSERT_EQUAL_UINT(0, statistics->levels[8].validCount);
+        TEST_ASSERT_EQUAL_FLOAT(-999.0f, statistics->levels[8].maxValue);
+        statistics = result.clipGrids[1].statistics;
+        TEST_ASSERT_EQUAL_UINT(0, statistics->total.validCount);
+        TEST_ASSERT_EQUAL_FLOAT(-999.0f, statistics->total.meanValue);
+        DestroyClipGridResult(&result);
+    }
+    TEST_MESSAGE("Clip statistics test completed");
+}
+
+void test_catalog_query(void) {
+    TEST_MESSAGE("Start catalog query test");
+    remove(TEST_CATALOG_FILE_NAME);
+    // two runs append to the same catalog
+    for (unsigned int bandIndex = 0; bandIndex < 2; bandIndex++) {
+        ClipGridResult result = {0};
+        InitTestClips(&result, bandIndex == 1);
+        TEST_ASSERT_TRUE(AppendCatalog(TEST_CATALOG_FILE_NAME, bandIndex, TEST_CATALOG_DATA_NAME, &result));
+        DestroyClipGridResult(&result);
+    }
+    CatalogFile* file = OpenCatalogFile(TEST_CATALOG_FILE_NAME);
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL_UINT(4, file->recordCount);
+    const CatalogRecord* record = NextCatalogRecord(file, NULL);
+    TEST_ASSERT_EQUAL_STRING(TEST_CATALOG_DATA_NAME, record->fileName);
+    TEST_ASSERT_EQUAL_UINT(16, record->levelCount);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f + 3 * 0.05f, record->minLatitude);
+    TEST_ASSERT_EQUAL_FLOAT(110.0f + 5 * 0.05f, record->maxLongitude);
+    TEST_ASSERT_EQUAL_FLOAT(40.0f, GetCatalogLevels(file, record)[6].maxValue);
+    TEST_ASSERT_EQUAL_INT64(1714978800 + 100, record->endTime);
+    record = NextCatalogRecord(file, NextCatalogRecord(file, record));
+    TEST_ASSERT_EQUAL_UINT(1, record->bandIndex);
+
+    CatalogQuery query;
+    InitCatalogQuery(&query);
+    TEST_ASSERT_EQUAL_UINT(4, CountMatches(file, &query));
+    // echoes of 40 dBZ, then only below 2500 m where they stay under it
+    query.minValue = 40.0f;
+    TEST_ASSERT_EQUAL_UINT(2, CountMatches(file, &query));
+    query.maxHeight = 2500.0f;
+    TEST_ASSERT_EQUAL_UINT(0, CountMatches(file, &query));
+    // the height range on its own, the echo reaches 3500 m
+    InitCatalogQuery(&query);
+    query.minHeight = 3000.0f;
+    TEST_ASSERT_EQUAL_UINT(2, CountMatches(file, &query));
+    query.minHeight = 4000.0f;
+    TEST_ASSERT_EQUAL_UINT(0, CountMatches(file, &query));
+    InitCatalogQuery(&query);
+    // a box beside the echo, then the echo by its longitude shifted by 360 degrees
+    query.minLatitude = 20.0f;
+    query.maxLatitude = 20.1f;
+    TEST_ASSERT_EQUAL_UINT(0, CountMatches(file, &query));
+    query.maxLatitude = 21.0f;
+    query.minLongitude = -250.0f;
+    query.maxLongitude = -249.85f;
+    TEST_ASSERT_EQUAL_UINT(2, CountMatches(file, &query));
+    InitCatalogQuery(&query);
+    const DateTime start = {2024, 5, 6, 7, 5, 0}, end = {2024, 5, 6, 7, 6, 0};
+    query.startTime = DateTimeToSeconds(&start);
+    query.endTime = DateTimeToSeconds(&end);
+    TEST_ASSERT_EQUAL_UINT(2, CountMatches(file, &query));
+    CloseCatalogFile(file);
+
+    // a record cut short by a failed run is dropped, a file of another kind is refused
+    struct stat status;
+    TEST_ASSERT_EQUAL_INT(0, stat(TEST_CATALOG_FILE_NAME, &status));
+    TEST_ASSERT_EQUAL_INT(0, truncate(TEST_CATALOG_FILE_NAME, status.st_size - 7));
+    file = OpenCatalogFile(TEST_CATALOG_FILE_NAME);
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL_UINT(3, file->recordCount);
+    CloseCatalogFile(file);
+    // the next run writes over the record cut short
+    ClipGridResult appended = {0};
+    InitTestClips(&appended, false);
+    TEST_ASSERT_TRUE(AppendCatalog(TEST_CATALOG_FILE_NAME, 2, TEST_CATALOG_DATA_NAME, &appended));
+    DestroyClipGridResult(&appended);
+    file = OpenCatalogFile(TEST_CATALOG_FILE_NAME);
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL_UINT(5, file->recordCount);
+    InitCatalogQuery(&query);
+    query.minValue = 40.0f;
+    TEST_ASSERT_EQUAL_UINT(3, CountMatches(file, &query));
+    CloseCatalogFile(file);
+    FILE* other = fopen(TEST_CATALOG_FILE_NAME, "w");
+    TEST_ASSERT_NOT_NULL(other);
+    fputs("not a catalog, but long enough for a header\n", other);
+    fclose(other);
+    ClipGridResult result = {0};
+    InitTestClips(&result, false);
+    TEST_ASSERT_FALSE(AppendCatalog(TEST_CATALOG_FILE_NAME, 0, TEST_CATALOG_DATA_NAME, &result));
+    TEST_ASSERT_NULL(OpenCatalogFile(TEST_CATALOG_FILE_NAME));
+    DestroyClipGridResult(&result);
+    remove(TEST_CATALOG_FILE_NAME);
+    TEST_MESSAGE("Catalog query test completed");
+}
+
+void test_catalog(void) {
+    TEST_MESSAGE("Start catalog test");
+    RUN_TEST(test_catalog_date_time);
+    RUN_TEST(test_catalog_statistics);
+    RUN_TEST(test_catalog_query);
+    TEST_MESSAGE("Catalog test completed");
+}
@@ -0,0 +1,183 @@
+#include "test_suites.h"
+#include "chunkwriter.h"
+#include "config.h"
+
+#define TEST_CHUNK_FILE_NAME "/tmp/FY3G_unit_chunk.HDF"
+
+static void WriteReadChunked(const hsize_t* dims, const float* data, float* read, ChunkLayout* layout, hsize_t* storageSize, hsize_t* chunkCount) {
+    // a dataset written by the layout of the config, then read back by HDF5 with its filters
+    hid_t fileID = H5Fcreate(TEST_CHUNK_FILE_NAME, H5F_ACC_TRUNC, H5P_DEFAULT, H5P_DEFAULT);
+    TEST_ASSERT_TRUE(fileID >= 0);
+    InitChunkLayout(dims, layout);
+    hid_t datasetID = CreateChunkedDataset(fileID, "Value", layout);
+    TEST_ASSERT_TRUE(datasetID >= 0);
+    TEST_ASSERT_TRUE(WriteChunkedDataset(datasetID, layout, data));
+    H5Dclose(datasetID);
+    H5Fclose(fileID);
+
+    fileID = H5Fopen(TEST_CHUNK_FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+    datasetID = H5Dopen(fileID, "Value", H5P_DEFAULT);
+    TEST_ASSERT_TRUE(H5Dread(datasetID, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, read) >= 0);
+    *storageSize = H5Dget_storage_size(datasetID);
+    *chunkCount = 0;
+    if (layout->chunkDims[0] > 0) {
+        hid_t dataspaceID = H5Dget_space(datasetID);
+        H5Dget_num_chunks(datasetID, dataspaceID, chunkCount);
+        H5Sclose(dataspaceID);
+    }
+    H5Dclose(datasetID);
+    H5Fclose(fileID);
+}
+
+void test_chunk_writer_round_trip(void) {
+    TEST_MESSAGE("Start chunk writer round trip test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.output_compression = OUTPUT_COMPRESSION_DEFLATE;
+    config.output_chunk_size = 4;
+    config.output_deflate_level = 4;
+    g_config = &config;
+
+    // 3 x 2 chunks of 4 x 4 x 13, the chunks past the edges are partial, the first chunk is fill only
+    const hsize_t dims[3] = {10, 7, 13};
+    const size_t cellCount = dims[0] * dims[1] * dims[2];
+    float* data = (float*)malloc(cellCount * sizeof(float));
+    float* read = (float*)malloc(cellCount * sizeof(float));
+    for (hsize_t x = 0; x < dims[0]; x++)
+        for (hsize_t y = 0; y < dims[1]; y++)
+            for (hsize_t z = 0; z < dims[2]; z++) {
+                const size_t index = (x * dims[1] + y) * dims[2] + z;
+                data[index] = (x < 4 && y < 4) || z > 8 ? OUTPUT_FILL_VALUE : 10.0f + (float)rand() / RAND_MAX * 30.0f;
+            }
+    ChunkLayout layout;
+    hsize_t storageSize, chunkCount;
+    WriteReadChunked(dims, data, read, &layout, &storageSize, &chunkCount);
+    TEST_ASSERT_EQUAL_UINT64(4, layout.chunkDims[0]);
+    TEST_ASSERT_EQUAL_UINT64(4, layout.chunkDims[1]);
+    TEST_ASSERT_EQUAL_UINT64(13, layout.chunkDims[2]);
+    for (size_t i = 0; i < cellCount; i++)
+        TEST_ASSERT_EQUAL_FLOAT(data[i], read[i]);
+    TEST_ASSERT_EQUAL_UINT64(5, chunkCount); // the fill chunk is left to the fill value
+    TEST_ASSERT_TRUE(storageSize < cellCount * sizeof(float));
+
+    // raw chunks without filters
+    config.output_compression = OUTPUT_COMPRESSION_NONE;
+    WriteReadChunked(dims, data, read, &layout, &storageSize, &chunkCount);
+    for (size_t i = 0; i < cellCount; i++)
+        TEST_ASSERT_EQUAL_FLOAT(data[i], read[i]);
+    TEST_ASSERT_EQUAL_UINT64(5, chunkCount);
+    TEST_ASSERT_EQUAL_UINT64(5 * 4 * 4 * 13 * sizeof(float), storageSize);
+
+    // a contiguous dataset as before the chunks, deflate alone turns the chunks back on
+    config.output_chunk_size = 0;
+    WriteReadChunked(dims, data, read, &layout, &storageSize, &chunkCount);
+    TEST_ASSERT_EQUAL_UINT64(0, layout.chunkDims[0]);
+    for (size_t i = 0; i < cellCount; i++)
+        TEST_ASSERT_EQUAL_FLOAT(data[i], read[i]);
+    TEST_ASSERT_EQUAL_UINT64(cellCount * sizeof(float), storageSize);
+    config.output_compression = OUTPUT_COMPRESSION_DEFLATE;
+    InitChunkLayout(dims, &layout);
+    TEST_ASSERT_EQUAL_UINT64(dims[0] < DEFAULT_OUTPUT_CHUNK_SIZE ? dims[0] : DEFAULT_OUTPUT_CHUNK_SIZE, layout.chunkDims[0]);
+
+    remove(TEST_CHUNK_FILE_NAME);
+    free(data);
+    free(read);
+    g_config = previousConfig;
+    TEST_MESSAGE("Chunk writer round trip test completed");
+}
+
+static void ReadFloatAttribute(hid_t objectID, const char* name, float* value) {
+    hid_t attributeID = H5Aopen(objectID, name, H5P_DEFAULT);
+    TEST_ASSERT_TRUE(attributeID >= 0);
+    TEST_ASSERT_TRUE(H5Aread(attributeID, H5T_NATIVE_FLOAT, value) >= 0);
+    H5Aclose(attributeID);
+}
+
+void test_chunk_writer_encoding(void) {
+    TEST_MESSAGE("Start chunk writer encoding test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.output_compression = OUTPUT_COMPRESSION_NONE;
+    config.output_chunk_size = 4;
+    config.output_encoding = OUTPUT_ENCODING_INT16;
+    config.output_scale_factor = 0.01f;
+    config.output_add_offset = 20.0f;
+    g_config = &config;
+
+    // the conversions of single cells, half precision rounds to nearest even
+    ChunkLayout layout;
+    const hsize_t dims[3] = {10, 7, 13};
+    InitChunkLayout(dims, &layout);
+    const float cells[6] = {OUTPUT_FILL_VALUE, 20.0f, 32.345f, 1e6f, -1e6f, 1.0f};
+    int16_t counts[6];
+    EncodeOutputCells(&layout, cells, 6, counts);
+    TEST_ASSERT_EQUAL_INT(OUTPUT_INT16_FILL_VALUE, counts[0]);
+    TEST_ASSERT_EQUAL_INT(0, counts[1]);
+    TEST_ASSERT_EQUAL_INT(1235, counts[2]);
+    TEST_ASSERT_EQUAL_INT(INT16_MAX, counts[3]);
+    TEST_ASSERT_EQUAL_INT(-INT16_MAX, counts[4]);
+    layout.encoding = OUTPUT_ENCODING_FLOAT16;
+    uint16_t halves[6];
+    EncodeOutputCells(&layout, cells, 6, halves);
+    TEST_ASSERT_EQUAL_HEX16(0xe3ce, halves[0]); // -999 is exact
+    TEST_ASSERT_EQUAL_HEX16(0x4d00, halves[1]);
+    TEST_ASSERT_EQUAL_HEX16(0x7c00, halves[3]);
+    TEST_ASSERT_EQUAL_HEX16(0xfc00, halves[4]);
+    TEST_ASSERT_EQUAL_HEX16(0x3c00, halves[5]);
+
+    const size_t cellCount = dims[0] * dims[1] * dims[2];
+    float* data = (float*)malloc(cellCount * sizeof(float));
+    float* read = (float*)malloc(cellCount * sizeof(float));
+    for (size_t i = 0; i < cellCount; i++)
+        data[i] = i % 5 == 0 || i < 4 * 7 * 13 ? OUTPUT_FILL_VALUE : 10.0f + (float)rand() / RAND_MAX * 40.0f;
+    const OutputEncoding encodings[2] = {OUTPUT_ENCODING_INT16, OUTPUT_ENCODING_FLOAT16};
+    const unsigned int chunkSizes[2] = {4, 0};
+    for (unsigned int e = 0; e < 2; e++)
+        for (unsigned int c = 0; c < 2; c++) {
+            // raw chunks then a contiguous dataset, both half the size of float cells, the first line of chunks is fill only
+            config.output_encoding = encodings[e];
+            config.output_chunk_size = chunkSizes[c];
+            hsize_t storageSize, chunkCount;
+            WriteReadChunked(dims, data, read, &layout, &storageSize, &chunkCount);
+            if (c == 0)
+                TEST_ASSERT_EQUAL_UINT64(4 * 4 * 4 * 13 * sizeof(int16_t), storageSize);
+            else
+                TEST_ASSERT_EQUAL_UINT64(cellCount * sizeof(int16_t), storageSize);
+            hid_t fileID = H5Fopen(TEST_CHUNK_FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+            hid_t datasetID = H5Dopen(fileID, "Value", H5P_DEFAULT);
+            float scaleFactor = 1.0f, addOffset = 0.0f, fill = OUTPUT_FILL_VALUE;
+            if (e == 0) {
+                ReadFloatAttribute(datasetID, "scale_factor", &scaleFactor);
+                ReadFloatAttribute(datasetID, "add_offset", &addOffset);
+                ReadFloatAttribute(datasetID, "_FillValue", &fill);
+                TEST_ASSERT_EQUAL_FLOAT(0.01f, scaleFactor);
+                TEST_ASSERT_EQUAL_FLOAT(20.0f, addOffset);
+                TEST_ASSERT_EQUAL_FLOAT(OUTPUT_INT16_FILL_VALUE, fill);
+            }
+            H5Dclose(datasetID);
+            H5Fclose(fileID);
+            for (size_t i = 0; i < cellCount; i++) {
+                // HDF5 converts the stored cells to float, the packing is undone by the reader
+                if (data[i] == OUTPUT_FILL_VALUE) {
+                    TEST_ASSERT_EQUAL_FLOAT(fill, read[i]);
+                    continue;
+                }
+                const float value = read[i] * scaleFactor + addOffset;
+                const float tolerance = e == 0 ? 0.005f + 1e-4f : data[i] / 1024.0f;
+                TEST_ASSERT_FLOAT_WITHIN(tolerance, data[i], value);
+            }
+        }
+
+    remove(TEST_CHUNK_FILE_NAME);
+    free(data);
+    free(read);
+    g_config = previousConfig;
+    TEST_MESSAGE("Chunk writer encoding test completed");
+}
+
+void test_chunk_writer(void) {
+    TEST_MESSAGE("Start chunk writer test");
+    RUN_TEST(test_chunk_writer_round_trip);
+    RUN_TEST(test_chunk_writer_encoding);
+    TEST_MESSAGE("Chunk writer test completed");
+}
@@ -0,0 +1,155 @@
+#include "test_suites.h"
+#include <string.h>
+#include "interface.h"
+#include "config.h"
+#include "test_helpers.h"
+
+#define TEST_CLIP_CROP_FILE_NAME "/tmp/FY3G_unit_clip_crop.HDF"
+
+static bool InBlob(const unsigned int l, const unsigned int b, const unsigned int h) {
+    return l >= 3 && l < 7 && b >= 2 && b < 9 && h >= 5 && h < 12;
+}
+
+static const TestClipLattice TEST_CLIP_CROP_LATTICE = {13, 11, 20, 0, 20.0f, 110.0f, 0.0f, 0.0f, 0.0f, 0.05f, 250.0f, 1};
+
+static float FillTestCell(const void* context, const unsigned int clipIndex, const unsigned int variable, const unsigned int l, const unsigned int b, const unsigned int h, const size_t index) {
+    // a blob of echo, and one cell of the extra variable alone out of it
+    const bool valid = InBlob(l, b, h);
+    if (variable == 0) return valid ? (float)(l * 100 + b * 10 + h) : -999.0f;
+    return valid || (l == 9 && b == 1 && h == 14) ? 5.0f : -999.0f;
+}
+
+static float FillEmptyCell(const void* context, const unsigned int clipIndex, const unsigned int variable, const unsigned int l, const unsigned int b, const unsigned int h, const size_t index) {
+    return -999.0f;
+}
+
+static void CheckBox(const ClipValidBox* box, const unsigned int* expected) {
+    TEST_ASSERT_EQUAL_UINT(expected[0], box->longitudeBegin);
+    TEST_ASSERT_EQUAL_UINT(expected[1], box->longitudeEnd);
+    TEST_ASSERT_EQUAL_UINT(expected[2], box->latitudeBegin);
+    TEST_ASSERT_EQUAL_UINT(expected[3], box->latitudeEnd);
+    TEST_ASSERT_EQUAL_UINT(expected[4], box->heightBegin);
+    TEST_ASSERT_EQUAL_UINT(expected[5], box->heightEnd);
+}
+
+void test_clip_crop_box(void) {
+    TEST_MESSAGE("Start clip valid box test");
+    const unsigned int expected[6] = {3, 10, 1, 9, 5, 15};
+    const unsigned int none[6] = {0, 0, 0, 0, 0, 0};
+    for (unsigned int storage = 0; storage < 2; storage++) {
+        ClipGrid clipGrid = {0};
+        InitTestClip(&clipGrid, 0, &TEST_CLIP_CROP_LATTICE, storage == 1, FillTestCell, NULL);
+        ClipValidBox box;
+        GetClipWriteBox(&clipGrid, &box);
+        TEST_ASSERT_EQUAL_UINT(13, box.longitudeEnd);
+        FindClipValidBox(&clipGrid);
+        TEST_ASSERT_TRUE(clipGrid.cropped);
+        CheckBox(&clipGrid.validBox, expected);
+
+        // the copied box holds the cells at their place in the lattice
+        const size_t blockCount = 7 * 8 * 10;
+        float* block = (float*)malloc(blockCount * sizeof(float));
+        TEST_ASSERT_TRUE(CopyClipVariableBox(&clipGrid, 0, &clipGrid.validBox, block));
+        TEST_ASSERT_EQUAL_FLOAT(3 * 100 + 2 * 10 + 5, block[(0 * 8 + 1) * 10 + 0]);
+        TEST_ASSERT_EQUAL_FLOAT(-999.0f, block[(6 * 8 + 0) * 10 + 9]);
+        TEST_ASSERT_TRUE(CopyClipVariableBox(&clipGrid, 1, &clipGrid.validBox, block));
+        TEST_ASSERT_EQUAL_FLOAT(5.0f, block[(6 * 8 + 0) * 10 + 9]);
+        free(block);
+        ReleaseClipGridCells(&clipGrid);
+
+        // a clip without any value keeps its first cell
+        InitTestClip(&clipGrid, 0, &TEST_CLIP_CROP_LATTICE, storage == 1, FillEmptyCell, NULL);
+        FindClipValidBox(&clipGrid);
+        CheckBox(&clipGrid.validBox, none);
+        GetClipWriteBox(&clipGrid, &box);
+        TEST_ASSERT_EQUAL_UINT(1, box.longitudeEnd);
+        TEST_ASSERT_EQUAL_UINT(1, box.heightEnd);
+        ReleaseClipGridCells(&clipGrid);
+    }
+    TEST_MESSAGE("Clip valid box test completed");
+}
+
+static void ReadFloatAttribute(hid_t groupID, const char* name, float* value) {
+    hid_t attributeID = H5Aopen(groupID, name, H5P_DEFAULT);
+    TEST_ASSERT_TRUE(attributeID >= 0);
+    TEST_ASSERT_TRUE(H5Aread(attributeID, H5T_NATIVE_FLOAT, value) >= 0);
+    H5Aclose(attributeID);
+}
+
+void test_clip_crop_write(void) {
+    TEST_MESSAGE("Start cropped clip write test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.output_compression = OUTPUT_COMPRESSION_DEFLATE;
+    config.output_chunk_size = 4;
+    config.output_deflate_level = 1;
+    config.crop_empty_borders = true;
+    strcpy(config.extra_variables[0], "Extra");
+    config.extra_variable_count = 1;
+    g_config = &config;
+
+    ClipGridResult result = {0};
+    CreateTestClips(&result, 1, &TEST_CLIP_CROP_LATTICE, true, FillTestCell, NULL);
+    FindClipValidBox(&result.clipGrids[0]);
+    TEST_ASSERT_TRUE(WriteClipResult(0, TEST_CLIP_CROP_FILE_NAME, &result));
+
+    hid_t fileID = H5Fopen(TEST_CLIP_CROP_FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+    TEST_ASSERT_TRUE(fileID >= 0);
+    hid_t groupID = H5Gopen(fileID, "/Ka/slice_0", H5P_DEFAULT);
+    TEST_ASSERT_TRUE(groupID >= 0);
+    float minLatitude, minLongitude, minHeight, maxLatitude;
+    ReadFloatAttribute(groupID, "Min_Latitude", &minLatitude);
+    ReadFloatAttribute(groupID, "Min_Longitude", &minLongitude);
+    ReadFloatAttribute(groupID, "Min_Height", &minHeight);
+    ReadFloatAttribute(groupID, "Max_Latitude", &maxLatitude);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f + 1 * 0.05f, minLatitude);
+    TEST_ASSERT_EQUAL_FLOAT(110.0f + 3 * 0.05f, minLongitude);
+    TEST_ASSERT_EQUAL_FLOAT(5 * 250.0f, minHeight);
+    TEST_ASSERT_EQUAL_FLOAT(20.0f + 9 * 0.05f, maxLatitude);
+    unsigned int offset[3], count[3];
+    hid_t attributeID = H5Aopen(groupID, "Lattice_Offset", H5P_DEFAULT);
+    TEST_ASSERT_TRUE(H5Aread(attributeID, H5T_NATIVE_UINT, offset) >= 0);
+    H5Aclose(attributeID);
+    attributeID = H5Aopen(groupID, "Lattice_Count", H5P_DEFAULT);
+    TEST_ASSERT_TRUE(H5Aread(attributeID, H5T_NATIVE_UINT, count) >= 0);
+    H5Aclose(attributeID);
+    TEST_ASSERT_EQUAL_UINT(3, offset[0]);
+    TEST_ASSERT_EQUAL_UINT(1, offset[1]);
+    TEST_ASSERT_EQUAL_UINT(5, offset[2]);
+    TEST_ASSERT_EQUAL_UINT(13, count[0]);
+    TEST_ASSERT_EQUAL_UINT(20, count[2]);
+
+    // every cell of the box at the place given by the offset
+    hid_t datasetID = H5Dopen(groupID, "Value", H5P_DEFAULT);
+    hid_t dataspaceID = H5Dget_space(datasetID);
+    hsize_t dims[3];
+    H5Sget_simple_extent_dims(dataspaceID, dims, NULL);
+    H5Sclose(dataspaceID);
+    TEST_ASSERT_EQUAL_UINT64(7, dims[0]);
+    TEST_ASSERT_EQUAL_UINT64(8, dims[1]);
+    TEST_ASSERT_EQUAL_UINT64(10, dims[2]);
+    float read[7 * 8 * 10];
+    TEST_ASSERT_TRUE(H5Dread(datasetID, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, read) >= 0);
+    H5Dclose(datasetID);
+    for (unsigned int l = 0; l < 7; l++)
+        for (unsigned int b = 0; b < 8; b++)
+            for (unsigned int h = 0; h < 10; h++) {
+                const unsigned int gl = l + offset[0], gb = b + offset[1], gh = h + offset[2];
+                const float expected = InBlob(gl, gb, gh) ? (float)(gl * 100 + gb * 10 + gh) : -999.0f;
+                TEST_ASSERT_EQUAL_FLOAT(expected, read[(l * 8 + b) * 10 + h]);
+            }
+    H5Gclose(groupID);
+    H5Fclose(fileID);
+
+    remove(TEST_CLIP_CROP_FILE_NAME);
+    DestroyClipGridResult(&result);
+    g_config = previousConfig;
+    TEST_MESSAGE("Cropped clip write test completed");
+}
+
+void test_clip_crop(void) {
+    TEST_MESSAGE("Start clip crop test");
+    RUN_TEST(test_clip_crop_box);
+    RUN_TEST(test_clip_crop_write);
+    TEST_MESSAGE("Clip crop test completed");
+}
@@ -0,0 +1,136 @@
+#include "test_suites.h"
+#include <string.h>
+#include "interface.h"
+#include "writebehind.h"
+#include "config.h"
+#include "test_helpers.h"
+
+#define TEST_CLIP_LAYOUT_FILE_NAME "/tmp/FY3G_unit_clip_layout.HDF"
+#define TEST_CLIP_LAYOUT_CLIP_COUNT 7
+
+static float TestClipCell(const unsigned int bandIndex, const unsigned int clipIndex, const unsigned int variable, const size_t index) {
+    if (index % 29 >= 9) return -999.0f;
+    return (float)(bandIndex * 5000 + clipIndex * 300 + variable * 100) + (float)(index % 53) * 0.5f;
+}
+
+static const TestClipLattice TEST_CLIP_LAYOUT_LATTICE = {9, 14, 29, 1, -40.0f, 0.0f, 0.0f, 9.0f, 0.0f, 0.05f, 125.0f, 1};
+
+static float FillTestCell(const void* context, const unsigned int clipIndex, const unsigned int variable, const unsigned int l, const unsigned int b, const unsigned int h, const size_t index) {
+    return TestClipCell(*(const unsigned int*)context, clipIndex, variable, index);
+}
+
+static void InitTestClips(ClipGridResult* result, const unsigned int bandIndex) {
+    CreateTestClips(result, TEST_CLIP_LAYOUT_CLIP_COUNT, &TEST_CLIP_LAYOUT_LATTICE, false, FillTestCell, &bandIndex);
+    result->globalAttribute.scanLineCount = 42;
+}
+
+static void CheckLinkedClips(const unsigned int bandIndex, const unsigned int clipCount) {
+    // the clips read through the clip output file as if they were inside it
+    hid_t fileID = H5Fopen(TEST_CLIP_LAYOUT_FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+    TEST_ASSERT_TRUE(fileID >= 0);
+    const char* datasetNames[2] = {"Value", "Extra"};
+    for (unsigned int clipIndex = 0; clipIndex < clipCount; clipIndex++) {
+        char path[64];
+        snprintf(path, sizeof(path), "/%s/slice_%u", BAND_NAMES[bandIndex], clipIndex);
+        H5L_info_t linkInfo;
+        TEST_ASSERT_TRUE(H5Lget_info(fileID, path, &linkInfo, H5P_DEFAULT) >= 0);
+        TEST_ASSERT_EQUAL_INT(H5L_TYPE_EXTERNAL, linkInfo.type);
+        hid_t groupID = H5Gopen(fileID, path, H5P_DEFAULT);
+        TEST_ASSERT_TRUE(groupID >= 0);
+        float minLatitude = 0;
+        hid_t attributeID = H5Aopen(groupID, "Min_Latitude", H5P_DEFAULT);
+        TEST_ASSERT_TRUE(attributeID >= 0);
+        TEST_ASSERT_TRUE(H5Aread(attributeID, H5T_NATIVE_FLOAT, &minLatitude) >= 0);
+        H5Aclose(attributeID);
+        TEST_ASSERT_EQUAL_FLOAT(-40.0f + 9.0f * clipIndex, minLatitude);
+
+        const size_t cellCount = (size_t)(9 + clipIndex) * 14 * 29;
+        float* read = (float*)malloc(cellCount * sizeof(float));
+        for (unsigned int variable = 0; variable < 2; variable++) {
+            hid_t datasetID = H5Dopen(groupID, datasetNames[variable], H5P_DEFAULT);
+            TEST_ASSERT_TRUE(datasetID >= 0);
+            TEST_ASSERT_TRUE(H5Dread(datasetID, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, read) >= 0);
+            H5Dclose(datasetID);
+            for (size_t index = 0; index < cellCount; index++)
+                TEST_ASSERT_EQUAL_FLOAT(TestClipCell(bandIndex, clipIndex, variable, index), read[index]);
+        }
+        free(read);
+        H5Gclose(groupID);
+    }
+    H5Fclose(fileID);
+}
+
+static void RemoveClipFiles(void) {
+    for (unsigned int bandIndex = 0; bandIndex < 2; bandIndex++)
+        for (unsigned int clipIndex = 0; clipIndex < TEST_CLIP_LAYOUT_CLIP_COUNT; clipIndex++) {
+            char* clipFileName = ConstructClipFilename(TEST_CLIP_LAYOUT_FILE_NAME, bandIndex, clipIndex);
+            remove(clipFileName);
+            free(clipFileName);
+        }
+    remove(TEST_CLIP_LAYOUT_FILE_NAME);
+}
+
+void test_clip_layout_per_clip(void) {
+    TEST_MESSAGE("Start per-clip layout test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.output_compression = OUTPUT_COMPRESSION_DEFLATE;
+    config.output_chunk_size = 4;
+    config.output_deflate_level = 1;
+    config.output_layout = OUTPUT_LAYOUT_PER_CLIP;
+    strcpy(config.extra_variables[0], "Extra");
+    config.extra_variable_count = 1;
+    g_config = &config;
+
+    char* clipFileName = ConstructClipFilename(TEST_CLIP_LAYOUT_FILE_NAME, 1, 12);
+    TEST_ASSERT_EQUAL_STRING("/tmp/FY3G_unit_clip_layout_Ku_slice_12.HDF", clipFileName);
+    free(clipFileName);
+
+    // the first band written at once, the second one behind the interpolation into the same clip output file
+    ClipGridResult result = {0};
+    InitTestClips(&result, 0);
+    TEST_ASSERT_TRUE(WriteClipResult(0, TEST_CLIP_LAYOUT_FILE_NAME, &result));
+    DestroyClipGridResult(&result);
+    InitTestClips(&result, 1);
+    ClipWriter* writer = CreateClipWriter(1, TEST_CLIP_LAYOUT_FILE_NAME, &result, 2);
+    TEST_ASSERT_NOT_NULL(writer);
+    for (unsigned int clipIndex = 0; clipIndex < result.clipCount; clipIndex++)
+        TEST_ASSERT_TRUE(SubmitClip(writer, clipIndex));
+    TEST_ASSERT_TRUE(CloseClipWriter(writer));
+    DestroyClipGridResult(&result);
+    CheckLinkedClips(0, TEST_CLIP_LAYOUT_CLIP_COUNT);
+    CheckLinkedClips(1, TEST_CLIP_LAYOUT_CLIP_COUNT);
+
+    // every clip file stands alone with its slice group at the root
+    clipFileName = ConstructClipFilename(TEST_CLIP_LAYOUT_FILE_NAME, 0, 3);
+    hid_t fileID = H5Fopen(clipFileName, H5F_ACC_RDONLY, H5P_DEFAULT);
+    free(clipFileName);
+    TEST_ASSERT_TRUE(fileID >= 0);
+    TEST_ASSERT_TRUE(H5Lexists(fileID, "slice_3", H5P_DEFAULT) > 0);
+    H5Fclose(fileID);
+
+    // a missing clip file fails only the read of that clip
+    clipFileName = ConstructClipFilename(TEST_CLIP_LAYOUT_FILE_NAME, 0, 2);
+    remove(clipFileName);
+    free(clipFileName);
+    fileID = H5Fopen(TEST_CLIP_LAYOUT_FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+    hid_t groupID = -1;
+    H5E_BEGIN_TRY {
+        groupID = H5Gopen(fileID, "/Ka/slice_2", H5P_DEFAULT);
+    } H5E_END_TRY;
+    TEST_ASSERT_TRUE(groupID < 0);
+    groupID = H5Gopen(fileID, "/Ka/slice_1", H5P_DEFAULT);
+    TEST_ASSERT_TRUE(groupID >= 0);
+    H5Gclose(groupID);
+    H5Fclose(fileID);
+
+    RemoveClipFiles();
+    g_config = previousConfig;
+    TEST_MESSAGE("Per-clip layout test completed");
+}
+
+void test_clip_layout(void) {
+    TEST_MESSAGE("Start clip layout test");
+    RUN_TEST(test_clip_layout_per_clip);
+    TEST_MESSAGE("Clip layout test completed");
+}
@@ -0,0 +1,73 @@
+#include "test_suites.h"
+#include "data.h"
+
+static void InitTestClipLattice(ClipGrid* clipGrid) {
+    // not a multiple of the brick edge along any axis
+    clipGrid->latitudeCount = 21;
+    clipGrid->longitudeCount = 30;
+    clipGrid->heightCount = 60;
+}
+
+void test_clip_storage_sparse(void) {
+    TEST_MESSAGE("Start sparse clip storage test");
+    ClipGridResult result = {0};
+    result.clipCount = 2;
+    result.clipGrids = (ClipGrid*)calloc(result.clipCount, sizeof(ClipGrid));
+    ClipGrid* dense = &result.clipGrids[0];
+    ClipGrid* sparse = &result.clipGrids[1];
+    InitTestClipLattice(dense);
+    InitTestClipLattice(sparse);
+    const size_t cellCount = (size_t)dense->latitudeCount * dense->longitudeCount * dense->heightCount;
+    dense->value = (float*)malloc(cellCount * sizeof(float));
+    sparse->value = (float*)malloc(cellCount * sizeof(float));
+    TEST_ASSERT_TRUE(InitClipGridSparse(sparse));
+    TEST_ASSERT_NULL(sparse->value);
+    TEST_ASSERT_EQUAL_UINT(4, sparse->sparse->longitudeBrickCount);
+    TEST_ASSERT_EQUAL_UINT(3, sparse->sparse->latitudeBrickCount);
+    TEST_ASSERT_EQUAL_UINT(8, sparse->sparse->heightBrickCount);
+    TEST_ASSERT_TRUE(InitClipGridExtra(&result, 1));
+    TEST_ASSERT_EQUAL_UINT(1, sparse->extraCount);
+    TEST_ASSERT_NULL(sparse->extraValue);
+
+    // values in a low layer of a few columns, as echoes below the storm top
+    for (size_t index = 0; index < cellCount; index++) {
+        const unsigned int h = index % dense->heightCount;
+        const unsigned int l = index / ((size_t)dense->heightCount * dense->latitudeCount);
+        const float value = h < 10 && l < 12 ? 10.0f + (float)rand() / RAND_MAX * 30.0f : -999.0f;
+        const float extra = value > -999 && rand() % 2 ? 2.0f * value : -999.0f;
+        SetClipValue(dense, 0, index, value);
+        SetClipValue(dense, 1, index, extra);
+        SetClipValue(sparse, 0, index, value);
+        SetClipValue(sparse, 1, index, extra);
+    }
+    TEST_ASSERT_EQUAL_UINT(2 * 3 * 2, sparse->sparse->allocatedCount); // longitude bricks 0-1, every latitude brick, height bricks 0-1
+    for (size_t index = 0; index < cellCount; index++) {
+        TEST_ASSERT_EQUAL_FLOAT(dense->value[index], GetClipValue(sparse, 0, index));
+        TEST_ASSERT_EQUAL_FLOAT(dense->extraValue[index], GetClipValue(sparse, 1, index));
+    }
+    float* copy = (float*)malloc(cellCount * sizeof(float));
+    TEST_ASSERT_TRUE(CopyClipVariable(sparse, 1, copy));
+    for (size_t index = 0; index < cellCount; index++)
+        TEST_ASSERT_EQUAL_FLOAT(GetClipValue(dense, 1, index), copy[index]);
+    TEST_ASSERT_FALSE(CopyClipVariable(sparse, 2, copy));
+
+    const size_t denseBytes = 2 * cellCount * sizeof(float);
+    TEST_ASSERT_TRUE(ClipGridResultBytes(&result) - denseBytes < denseBytes / 4);
+
+    ClearClipGridExtra(sparse);
+    ClearClipGridExtra(dense);
+    TEST_ASSERT_TRUE(CopyClipVariable(sparse, 0, copy));
+    for (size_t index = 0; index < cellCount; index++) {
+        TEST_ASSERT_EQUAL_FLOAT(-999.0f, GetClipValue(sparse, 1, index));
+        TEST_ASSERT_EQUAL_FLOAT(dense->value[index], copy[index]); // value is kept
+    }
+    free(copy);
+    DestroyClipGridResult(&result);
+    TEST_MESSAGE("Sparse clip storage test completed");
+}
+
+void test_clip_storage(void) {
+    TEST_MESSAGE("Start clip storage test");
+    RUN_TEST(test_clip_storage_sparse);
+    TEST_MESSAGE("Clip storage test completed");
+}
@@ -0,0 +1,160 @@
+#include "test_suites.h"
+#include <string.h>
+#include <math.h>
+#include "interface.h"
+#include "derived.h"
+#include "config.h"
+#include "test_helpers.h"
+
+#define TEST_DERIVED_FILE_NAME "/tmp/FY3G_unit_derived.HDF"
+#define TEST_DERIVED_THRESHOLD 18.0f
+
+static const float TEST_COLUMN[10] = {20.0f, 30.0f, 40.0f, 35.0f, 25.0f, 15.0f, 10.0f, -999.0f, 5.0f, -999.0f};
+
+static const TestClipLattice TEST_DERIVED_LATTICE = {4, 3, 10, 0, 30.0f, 120.0f, 1000.0f, 0.0f, 0.0f, 0.05f, 500.0f, 0};
+
+static float FillTestCell(const void* context, const unsigned int clipIndex, const unsigned int variable, const unsigned int l, const unsigned int b, const unsigned int h, const size_t index) {
+    // one known column, a weak echo beside it, the others empty
+    if (l == 1 && b == 2) return TEST_COLUMN[h];
+    if (l == 2 && b == 2 && h < 3) return 12.0f;
+    return -999.0f;
+}
+
+static double TestVIL(const float* column, const unsigned int count, const double gap) {
+    double vil = 0;
+    for (unsigned int h = 0; h + 1 < count; h++) {
+        if (column[h] <= -999 || column[h + 1] <= -999) continue;
+        const double lower = pow(10.0, fmin(column[h], VIL_MAX_REFLECTIVITY) / 10.0), upper = pow(10.0, fmin(column[h + 1], VIL_MAX_REFLECTIVITY) / 10.0);
+        vil += 3.44e-6 * pow(0.5 * (lower + upper), 4.0 / 7.0) * gap;
+    }
+    return vil;
+}
+
+static float Product(const ClipGrid* clipGrid, const unsigned int product, const unsigned int l, const unsigned int b) {
+    return clipGrid->products[((size_t)product * clipGrid->longitudeCount + l) * clipGrid->latitudeCount + b];
+}
+
+void test_derived_column(void) {
+    TEST_MESSAGE("Start derived column test");
+    // two cells of 40 dBZ one kilometre apart hold 3.44e-6 * 10^(16/7) * 1000 kg/m^2
+    const float pair[2] = {40.0f, 40.0f};
+    float products[DERIVED_PRODUCT_COUNT];
+    AccumulateColumnProducts(pair, 2, 0.0f, 1000.0f, TEST_DERIVED_THRESHOLD, products);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, 3.44e-3f * powf(10.0f, 16.0f / 7.0f), products[2]);
+    TEST_ASSERT_EQUAL_FLOAT(1000.0f, products[1]);
+
+    // hail is capped, a column without a value has no product
+    const float hail[2] = {70.0f, 56.0f};
+    AccumulateColumnProducts(hail, 2, 0.0f, 1000.0f, TEST_DERIVED_THRESHOLD, products);
+    TEST_ASSERT_EQUAL_FLOAT(70.0f, products[0]);
+    TEST_ASSERT_FLOAT_WITHIN(1e-4f, (float)TestVIL(hail, 2, 1000.0), products[2]);
+    const float empty[3] = {-999.0f, -999.0f, -999.0f};
+    AccumulateColumnProducts(empty, 3, 0.0f, 1000.0f, TEST_DERIVED_THRESHOLD, products);
+    for (unsigned int product = 0; product < DERIVED_PRODUCT_COUNT; product++)
+        TEST_ASSERT_EQUAL_FLOAT(-999.0f, products[product]);
+    TEST_MESSAGE("Derived column test completed");
+}
+
+void test_derived_clip(void) {
+    TEST_MESSAGE("Start derived clip test");
+    for (unsigned int storage = 0; storage < 2; storage++) {
+        ClipGrid clipGrid;
+        InitTestClip(&clipGrid, 0, &TEST_DERIVED_LATTICE, storage == 1, FillTestCell, NULL);
+        TEST_ASSERT_TRUE(ComputeClipProducts(&clipGrid, TEST_DERIVED_THRESHOLD));
+        TEST_ASSERT_NOT_NULL(clipGrid.products);
+        TEST_ASSERT_EQUAL_FLOAT(40.0f, Product(&clipGrid, 0, 1, 2));
+        TEST_ASSERT_EQUAL_FLOAT(1000.0f + 4 * 500.0f, Product(&clipGrid, 1, 1, 2));
+        TEST_ASSERT_FLOAT_WITHIN(1e-5f, (float)TestVIL(TEST_COLUMN, 10, 500.0), Product(&clipGrid, 2, 1, 2));
+        // the weak echo never reaches the echo top threshold
+        TEST_ASSERT_EQUAL_FLOAT(12.0f, Product(&clipGrid, 0, 2, 2));
+        TEST_ASSERT_EQUAL_FLOAT(-999.0f, Product(&clipGrid, 1, 2, 2));
+        TEST_ASSERT_TRUE(Product(&clipGrid, 2, 2, 2) > 0.0f);
+        for (unsigned int product = 0; product < DERIVED_PRODUCT_COUNT; product++)
+            TEST_ASSERT_EQUAL_FLOAT(-999.0f, Product(&clipGrid, product, 3, 0));
+        ReleaseClipGridCells(&clipGrid);
+        TEST_ASSERT_NULL(clipGrid.products);
+    }
+    TEST_MESSAGE("Derived clip test completed");
+}
+
+void test_derived_write(void) {
+    TEST_MESSAGE("Start derived product write test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.output_compression = OUTPUT_COMPRESSION_DEFLATE;
+    config.output_chunk_size = 4;
+    config.output_deflate_level = 1;
+    config.crop_empty_borders = true;
+    config.derived_products = DERIVED_PRODUCT_COMPOSITE | DERIVED_PRODUCT_VIL;
+    g_config = &config;
+
+    ClipGridResult result = {0};
+    CreateTestClips(&result, 1, &TEST_DERIVED_LATTICE, true, FillTestCell, NULL);
+    TEST_ASSERT_TRUE(ComputeClipProducts(&result.clipGrids[0], TEST_DERIVED_THRESHOLD));
+    FindClipValidBox(&result.clipGrids[0]);
+    TEST_ASSERT_TRUE(WriteClipResult(0, TEST_DERIVED_FILE_NAME, &result));
+
+    // the products cover the columns of the cropped box, longitude 1 to 2 and latitude 2
+    hid_t fileID = H5Fopen(TEST_DERIVED_FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+    TEST_ASSERT_TRUE(fileID >= 0);
+    hid_t groupID = H5Gopen(fileID, "/Ka/slice_0", H5P_DEFAULT);
+    TEST_ASSERT_TRUE(groupID >= 0);
+    TEST_ASSERT_TRUE(H5Lexists(groupID, "Echo_Top_Height", H5P_DEFAULT) == 0);
+    hid_t datasetID = H5Dopen(groupID, "Composite_Reflectivity", H5P_DEFAULT);
+    TEST_ASSERT_TRUE(datasetID >= 0);
+    hid_t dataspaceID = H5Dget_space(datasetID);
+    hsize_t dims[2];
+    TEST_ASSERT_EQUAL_INT(2, H5Sget_simple_extent_dims(dataspaceID, dims, NULL));
+    H5Sclose(dataspaceID);
+    TEST_ASSERT_EQUAL_UINT64(2, dims[0]);
+    TEST_ASSERT_EQUAL_UINT64(1, dims[1]);
+    // chunked and deflated as the value
+    hid_t propertyID = H5Dget_create_plist(datasetID);
+    TEST_ASSERT_EQUAL_INT(H5D_CHUNKED, H5Pget_layout(propertyID));
+    TEST_ASSERT_EQUAL_INT(2, H5Pget_nfilters(propertyID));
+    H5Pclose(propertyID);
+    float read[2];
+    TEST_ASSERT_TRUE(H5Dread(datasetID, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, read) >= 0);
+    TEST_ASSERT_EQUAL_FLOAT(40.0f, read[0]);
+    TEST_ASSERT_EQUAL_FLOAT(12.0f, read[1]);
+    char units[16] = {0};
+    hid_t attributeID = H5Aopen(datasetID, "Units", H5P_DEFAULT);
+    hid_t typeID = H5Aget_type(attributeID);
+    TEST_ASSERT_TRUE(H5Aread(attributeID, typeID, units) >= 0);
+    H5Tclose(typeID);
+    H5Aclose(attributeID);
+    TEST_ASSERT_EQUAL_STRING("dBZ", units);
+    H5Dclose(datasetID);
+    datasetID = H5Dopen(groupID, "VIL", H5P_DEFAULT);
+    TEST_ASSERT_TRUE(datasetID >= 0);
+    TEST_ASSERT_TRUE(H5Dread(datasetID, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, read) >= 0);
+    TEST_ASSERT_FLOAT_WITHIN(1e-5f, (float)TestVIL(TEST_COLUMN, 10, 500.0), read[0]);
+    // the units fill the attribute up to its size with zeros
+    char vilUnits[16];
+    memset(vilUnits, 0x7f, sizeof(vilUnits));
+    attributeID = H5Aopen(datasetID, "Units", H5P_DEFAULT);
+    typeID = H5Aget_type(attributeID);
+    TEST_ASSERT_EQUAL_UINT64(sizeof(vilUnits), H5Tget_size(typeID));
+    TEST_ASSERT_TRUE(H5Aread(attributeID, typeID, vilUnits) >= 0);
+    H5Tclose(typeID);
+    H5Aclose(attributeID);
+    TEST_ASSERT_EQUAL_STRING("kg/m^2", vilUnits);
+    for (size_t c = strlen("kg/m^2"); c < sizeof(vilUnits); c++)
+        TEST_ASSERT_EQUAL_INT(0, vilUnits[c]);
+    H5Dclose(datasetID);
+    H5Gclose(groupID);
+    H5Fclose(fileID);
+
+    remove(TEST_DERIVED_FILE_NAME);
+    DestroyClipGridResult(&result);
+    g_config = previousConfig;
+    TEST_MESSAGE("Derived product write test completed");
+}
+
+void test_derived_products(void) {
+    TEST_MESSAGE("Start derived product test");
+    RUN_TEST(test_derived_column);
+    RUN_TEST(test_derived_clip);
+    RUN_TEST(test_derived_write);
+    TEST_MESSAGE("Derived product test completed");
+}
@@ -0,0 +1,98 @@
+#include "test_suites.h"
+#include <math.h>
+#include "echotop.h"
+
+#define TEST_LINE_COUNT 20
+#define TEST_BIN_COUNT 100
+#define TEST_BIN_STEP 100.0f
+#define TEST_REACH 12000.0f
+#define TEST_METERS_PER_DEGREE 111000.0
+
+static float TestEchoTop(const unsigned int line, const unsigned int angle) {
+    // a tall cell on the first lines, a shallow one after, no echo on the right of the swath
+    if (angle >= 40) return -INFINITY;
+    return line < TEST_LINE_COUNT / 2 ? 6000.0f : 3000.0f;
+}
+
+static void InitTestEchoTopGrid(GeodeticGrid* grid) {
+    // slanted rays about 5 km apart, bin 0 at the top
+    TEST_ASSERT_TRUE(InitGeodeticGrid(grid, TEST_LINE_COUNT, TEST_BIN_COUNT));
+    for (unsigned int l = 0; l < TEST_LINE_COUNT; l++)
+        for (unsigned int a = 0; a < SCAN_ANGLE_COUNT; a++)
+            for (unsigned int bin = 0; bin < TEST_BIN_COUNT; bin++) {
+                const unsigned int index = (l * SCAN_ANGLE_COUNT + a) * TEST_BIN_COUNT + bin;
+                const float height = (TEST_BIN_COUNT - 1 - bin) * TEST_BIN_STEP;
+                grid->latitudeArray[index] = 30.0f + l * 0.045f;
+                grid->longitudeArray[index] = 120.0f + ((int)a - SCAN_ANGLE_COUNT / 2) * 0.052f + height * 1e-6f * ((int)a - SCAN_ANGLE_COUNT / 2);
+                grid->elevationArray[index] = height;
+                grid->validArray[index] = height <= TestEchoTop(l, a) && (bin % 3 != 0 || height == TestEchoTop(l, a));
+                grid->valueArray[index] = grid->validArray[index] ? 30.0f : -999;
+            }
+}
+
+static float TrueColumnTop(const GeodeticGrid* grid, const float latitude, const float longitude) {
+    // the highest valid bin closer than the reach, in a flat local metric a bit shorter than the true one
+    float top = -INFINITY;
+    const double metersPerLongitude = TEST_METERS_PER_DEGREE * cos(latitude * M_PI / 180.0);
+    for (unsigned int point = 0; point < TEST_LINE_COUNT * SCAN_ANGLE_COUNT * TEST_BIN_COUNT; point++) {
+        if (!grid->validArray[point]) continue;
+        const double north = (grid->latitudeArray[point] - latitude) * TEST_METERS_PER_DEGREE;
+        const double east = (grid->longitudeArray[point] - longitude) * metersPerLongitude;
+        if (north * north + east * east <= (double)TEST_REACH * TEST_REACH && grid->elevationArray[point] > top) top = grid->elevationArray[point];
+    }
+    return top;
+}
+
+void test_echo_top_columns(void) {
+    TEST_MESSAGE("Start echo top column test");
+    GeodeticGrid grid;
+    InitTestEchoTopGrid(&grid);
+    EchoTopRaster* raster = CreateEchoTopRaster(&grid);
+    TEST_ASSERT_NOT_NULL(raster);
+    for (unsigned int l = 0; l < TEST_LINE_COUNT; l++)
+        for (unsigned int a = 0; a < SCAN_ANGLE_COUNT; a++) {
+            const float top = TestEchoTop(l, a);
+            TEST_ASSERT_TRUE(top == raster->topHeights[l * SCAN_ANGLE_COUNT + a]);
+        }
+
+    ClipGrid clipGrid = {0};
+    clipGrid.latitudeCount = 25;
+    clipGrid.longitudeCount = 70;
+    clipGrid.minLatitude = 29.9f;
+    clipGrid.minLongitude = 118.4f;
+    clipGrid.latitudeGap = clipGrid.longitudeGap = 0.05f;
+    TEST_ASSERT_NULL(EstimateClipColumnTops(raster, &clipGrid, 0, TEST_LINE_COUNT, TEST_REACH));
+    float* columnTops = EstimateClipColumnTops(raster, &clipGrid, 0, TEST_LINE_COUNT - 1, TEST_REACH);
+    TEST_ASSERT_NOT_NULL(columnTops);
+    unsigned int emptyCount = 0, shallowCount = 0;
+    for (unsigned int l = 0; l < clipGrid.longitudeCount; l++)
+        for (unsigned int b = 0; b < clipGrid.latitudeCount; b++) {
+            const float estimate = columnTops[l * clipGrid.latitudeCount + b];
+            const float top = TrueColumnTop(&grid, clipGrid.minLatitude + b * clipGrid.latitudeGap, clipGrid.minLongitude + l * clipGrid.longitudeGap);
+            // never below a bin within the reach, and only the tops of the granule
+            TEST_ASSERT_TRUE(estimate >= top);
+            TEST_ASSERT_TRUE(estimate == -INFINITY || estimate == 3000.0f || estimate == 6000.0f);
+            emptyCount += estimate == -INFINITY;
+            shallowCount += estimate == 3000.0f;
+        }
+    // the box stays close to the reach, the columns far from the echo keep no top
+    TEST_ASSERT_TRUE(emptyCount > 0);
+    TEST_ASSERT_TRUE(shallowCount > 0);
+    free(columnTops);
+
+    // a per-clip index only sees the lines of the clip
+    columnTops = EstimateClipColumnTops(raster, &clipGrid, TEST_LINE_COUNT / 2, TEST_LINE_COUNT - 1, TEST_REACH);
+    TEST_ASSERT_NOT_NULL(columnTops);
+    for (unsigned int column = 0; column < clipGrid.longitudeCount * clipGrid.latitudeCount; column++)
+        TEST_ASSERT_TRUE(columnTops[column] == -INFINITY || columnTops[column] == 3000.0f);
+    free(columnTops);
+    DestroyEchoTopRaster(raster);
+    DestroyGeodeticGrid(&grid);
+    TEST_MESSAGE("Echo top column test completed");
+}
+
+void test_echo_top(void) {
+    TEST_MESSAGE("Start echo top test");
+    RUN_TEST(test_echo_top_columns);
+    TEST_MESSAGE("Echo top test completed");
+}
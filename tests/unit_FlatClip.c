@@ -0,0 +1,160 @@
+#include "test_suites.h"
+#include <string.h>
+#include <unistd.h>
+#include "interface.h"
+#include "writebehind.h"
+#include "flatclip.h"
+#include "config.h"
+#include "test_helpers.h"
+
+#define TEST_FLAT_CLIP_HDF_NAME "/tmp/FY3G_unit_flat_clip.HDF"
+#define TEST_FLAT_CLIP_FILE_NAME "/tmp/FY3G_unit_flat_clip_Ka.flat"
+#define TEST_FLAT_CLIP_INDEX_NAME "/tmp/FY3G_unit_flat_clip_Ka.flat.idx"
+#define TEST_FLAT_CLIP_COUNT 5
+
+static const TestClipLattice TEST_FLAT_CLIP_LATTICE = {11, 19, 37, 3, -30.0f, 100.0f, 500.0f, 7.5f, 1.0f, 0.05f, 250.0f, 1};
+
+static float FillTestCell(const void* context, const unsigned int clipIndex, const unsigned int variable, const unsigned int l, const unsigned int b, const unsigned int h, const size_t index) {
+    // a low layer of echo
+    return index % 37 >= 10 ? -999.0f : (float)(clipIndex * 100 + variable * 50) + (float)(index % 89) * 0.25f;
+}
+
+static void InitTestClips(ClipGridResult* result, const bool sparse) {
+    // clips of odd sizes so the blocks are padded to the page
+    CreateTestClips(result, TEST_FLAT_CLIP_COUNT, &TEST_FLAT_CLIP_LATTICE, sparse, FillTestCell, NULL);
+    result->globalAttribute.scanLineCount = 321;
+    result->globalAttribute.ascending = true;
+    result->globalAttribute.startDateTime = (DateTime){2024, 5, 6, 7, 8, 9};
+}
+
+static void ReadClipAttribute(hid_t groupID, const char* name, float* value) {
+    hid_t attributeID = H5Aopen(groupID, name, H5P_DEFAULT);
+    TEST_ASSERT_TRUE(attributeID >= 0);
+    TEST_ASSERT_TRUE(H5Aread(attributeID, H5T_NATIVE_FLOAT, value) >= 0);
+    H5Aclose(attributeID);
+}
+
+static void CompareWithHDF(const char* flatFileName, const unsigned int clipCount) {
+    // the mapped blocks and the clip table hold what the HDF5 path wrote
+    FlatClipFile* file = OpenFlatClipFile(flatFileName);
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_EQUAL_UINT(clipCount, file->header->clipCount);
+    TEST_ASSERT_EQUAL_UINT(2, file->header->variableCount);
+    TEST_ASSERT_EQUAL_UINT(321, file->header->scanLineCount);
+    TEST_ASSERT_EQUAL_UINT(2024, file->header->startDateTime.year);
+    TEST_ASSERT_EQUAL_STRING("Value", file->header->variableNames[0]);
+    TEST_ASSERT_EQUAL_STRING("Extra", file->header->variableNames[1]);
+    hid_t fileID = H5Fopen(TEST_FLAT_CLIP_HDF_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+    TEST_ASSERT_TRUE(fileID >= 0);
+    for (unsigned int clipIndex = 0; clipIndex < clipCount; clipIndex++) {
+        const FlatClipHeader* clip = &file->clips[clipIndex];
+        TEST_ASSERT_EQUAL_UINT64(0, clip->offset % FLAT_CLIP_PAGE_SIZE);
+        char path[64];
+        snprintf(path, sizeof(path), "/%s/slice_%u", BAND_NAMES[0], clipIndex);
+        hid_t groupID = H5Gopen(fileID, path, H5P_DEFAULT);
+        TEST_ASSERT_TRUE(groupID >= 0);
+        float attribute;
+        ReadClipAttribute(groupID, "Min_Latitude", &attribute);
+        TEST_ASSERT_EQUAL_FLOAT(attribute, clip->minLatitude);
+        ReadClipAttribute(groupID, "Max_Longitude", &attribute);
+        TEST_ASSERT_EQUAL_FLOAT(attribute, clip->maxLongitude);
+        ReadClipAttribute(groupID, "Height_Gap", &attribute);
+        TEST_ASSERT_EQUAL_FLOAT(attribute, clip->heightGap);
+
+        const size_t cellCount = (size_t)clip->longitudeCount * clip->latitudeCount * clip->heightCount;
+        float* read = (float*)malloc(cellCount * sizeof(float));
+        for (unsigned int variable = 0; variable < file->header->variableCount; variable++) {
+            hid_t datasetID = H5Dopen(groupID, file->header->variableNames[variable], H5P_DEFAULT);
+            TEST_ASSERT_TRUE(datasetID >= 0);
+            hid_t dataspaceID = H5Dget_space(datasetID);
+            hsize_t dims[3];
+            H5Sget_simple_extent_dims(dataspaceID, dims, NULL);
+            H5Sclose(dataspaceID);
+            TEST_ASSERT_EQUAL_UINT64(dims[0], clip->longitudeCount);
+            TEST_ASSERT_EQUAL_UINT64(dims[1], clip->latitudeCount);
+            TEST_ASSERT_EQUAL_UINT64(dims[2], clip->heightCount);
+            TEST_ASSERT_TRUE(H5Dread(datasetID, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, read) >= 0);
+            H5Dclose(datasetID);
+            const float* block = GetFlatClipBlock(file, clipIndex, variable);
+            TEST_ASSERT_NOT_NULL(block);
+            TEST_ASSERT_EQUAL_INT(0, memcmp(read, block, cellCount * sizeof(float)));
+        }
+        free(read);
+        H5Gclose(groupID);
+    }
+    TEST_ASSERT_NULL(GetFlatClipBlock(file, clipCount, 0));
+    TEST_ASSERT_NULL(GetFlatClipBlock(file, 0, 2));
+    H5Fclose(fileID);
+    CloseFlatClipFile(file);
+}
+
+void test_flat_clip_round_trip(void) {
+    TEST_MESSAGE("Start flat clip round trip test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.output_compression = OUTPUT_COMPRESSION_DEFLATE;
+    config.output_chunk_size = 8;
+    config.output_deflate_level = 1;
+    config.output_encoding = OUTPUT_ENCODING_FLOAT32;
+    strcpy(config.extra_variables[0], "Extra");
+    config.extra_variable_count = 1;
+    g_config = &config;
+
+    char* flatFileName = ConstructFlatClipFilename(TEST_FLAT_CLIP_HDF_NAME, 0);
+    TEST_ASSERT_EQUAL_STRING(TEST_FLAT_CLIP_FILE_NAME, flatFileName);
+
+    // the same dense clips through both writers
+    ClipGridResult result = {0};
+    InitTestClips(&result, false);
+    TEST_ASSERT_TRUE(WriteClipResult(0, TEST_FLAT_CLIP_HDF_NAME, &result));
+    TEST_ASSERT_TRUE(WriteFlatClipResult(0, TEST_FLAT_CLIP_HDF_NAME, &result));
+    CompareWithHDF(flatFileName, result.clipCount);
+    FILE* indexFile = fopen(TEST_FLAT_CLIP_INDEX_NAME, "r");
+    TEST_ASSERT_NOT_NULL(indexFile);
+    unsigned int lineCount = 0;
+    char line[512];
+    while (fgets(line, sizeof(line), indexFile))
+        if (line[0] != '#') lineCount++;
+    fclose(indexFile);
+    TEST_ASSERT_EQUAL_UINT(result.clipCount * 2, lineCount);
+    DestroyClipGridResult(&result);
+
+    // sparse clips written behind in any order give the same container
+    config.output_format = OUTPUT_FORMAT_FLAT;
+    InitTestClips(&result, true);
+    ClipWriter* writer = CreateClipWriter(0, TEST_FLAT_CLIP_HDF_NAME, &result, 2);
+    TEST_ASSERT_NOT_NULL(writer);
+    for (unsigned int i = 0; i < result.clipCount; i++)
+        TEST_ASSERT_TRUE(SubmitClip(writer, result.clipCount - 1 - i));
+    TEST_ASSERT_TRUE(CloseClipWriter(writer));
+    CompareWithHDF(flatFileName, result.clipCount);
+    DestroyClipGridResult(&result);
+
+    // a container cut short is refused
+    TEST_ASSERT_EQUAL_INT(0, truncate(flatFileName, FLAT_CLIP_PAGE_SIZE));
+    TEST_ASSERT_NULL(OpenFlatClipFile(flatFileName));
+    TEST_ASSERT_NULL(OpenFlatClipFile(TEST_FLAT_CLIP_INDEX_NAME));
+
+    // a run failing before every clip is submitted leaves no container
+    InitTestClips(&result, false);
+    writer = CreateClipWriter(0, TEST_FLAT_CLIP_HDF_NAME, &result, 2);
+    TEST_ASSERT_NOT_NULL(writer);
+    TEST_ASSERT_TRUE(SubmitClip(writer, 0));
+    TEST_ASSERT_FALSE(CloseClipWriter(writer));
+    TEST_ASSERT_EQUAL_INT(-1, access(flatFileName, F_OK));
+    TEST_ASSERT_EQUAL_INT(-1, access(TEST_FLAT_CLIP_INDEX_NAME, F_OK));
+    DestroyClipGridResult(&result);
+
+    remove(TEST_FLAT_CLIP_HDF_NAME);
+    remove(flatFileName);
+    remove(TEST_FLAT_CLIP_INDEX_NAME);
+    free(flatFileName);
+    g_config = previousConfig;
+    TEST_MESSAGE("Flat clip round trip test completed");
+}
+
+void test_flat_clip(void) {
+    TEST_MESSAGE("Start flat clip test");
+    RUN_TEST(test_flat_clip_round_trip);
+    TEST_MESSAGE("Flat clip test completed");
+}
@@ -0,0 +1,121 @@
+#include "test_suites.h"
+#include <string.h>
+#include "geodeticwriter.h"
+#include "interface.h"
+#include "config.h"
+
+#define TEST_GEODETIC_FILE_NAME "/tmp/FY3G_unit_geodetic.HDF"
+#define TEST_GEODETIC_LINE_COUNT 37 // two whole blocks of 16 lines and a short one
+#define TEST_GEODETIC_BIN_BEGIN 100
+#define TEST_GEODETIC_BIN_END 260
+
+static float TestGeodeticCell(const unsigned int dataset, const size_t index) {
+    const unsigned int bin = index % SCAN_HEIGHT_COUNT;
+    if (dataset >= GEODETIC_COORDINATE_COUNT && (bin < 150 || bin % 7 == 0)) return -999.0f;
+    return (float)dataset * 1000.0f + (float)(index % 997) * 0.5f;
+}
+
+static void InitTestGeodeticGrid(GeodeticGrid* grid) {
+    TEST_ASSERT_TRUE(InitGeodeticGrid(grid, TEST_GEODETIC_LINE_COUNT, SCAN_HEIGHT_COUNT));
+    TEST_ASSERT_TRUE(InitGeodeticGridExtra(grid, 1));
+    float* arrays[5] = {grid->latitudeArray, grid->longitudeArray, grid->elevationArray, grid->valueArray, grid->extraValueArrays[0]};
+    const size_t cellCount = (size_t)TEST_GEODETIC_LINE_COUNT * SCAN_ANGLE_COUNT * SCAN_HEIGHT_COUNT;
+    for (unsigned int dataset = 0; dataset < 5; dataset++)
+        for (size_t index = 0; index < cellCount; index++)
+            arrays[dataset][index] = TestGeodeticCell(dataset, index);
+}
+
+static void CheckGeodeticFile(const unsigned int lineBlock) {
+    // every dataset holds the bin window of every ray, chunked by the line block
+    hid_t fileID = H5Fopen(TEST_GEODETIC_FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+    TEST_ASSERT_TRUE(fileID >= 0);
+    hid_t groupID = H5Gopen(fileID, "/Ka", H5P_DEFAULT);
+    TEST_ASSERT_TRUE(groupID >= 0);
+    unsigned int binBegin = 0, binCount = 0;
+    hid_t attributeID = H5Aopen(groupID, "Bin_Begin", H5P_DEFAULT);
+    TEST_ASSERT_TRUE(H5Aread(attributeID, H5T_NATIVE_UINT, &binBegin) >= 0);
+    H5Aclose(attributeID);
+    attributeID = H5Aopen(groupID, "Bin_Count", H5P_DEFAULT);
+    TEST_ASSERT_TRUE(H5Aread(attributeID, H5T_NATIVE_UINT, &binCount) >= 0);
+    H5Aclose(attributeID);
+    TEST_ASSERT_EQUAL_UINT(TEST_GEODETIC_BIN_BEGIN, binBegin);
+    TEST_ASSERT_EQUAL_UINT(TEST_GEODETIC_BIN_END - TEST_GEODETIC_BIN_BEGIN, binCount);
+
+    const char* names[5] = {"Latitude", "Longitude", "Elevation", "Value", "Extra"};
+    const size_t cellCount = (size_t)TEST_GEODETIC_LINE_COUNT * SCAN_ANGLE_COUNT * binCount;
+    float* read = (float*)malloc(cellCount * sizeof(float));
+    for (unsigned int dataset = 0; dataset < 5; dataset++) {
+        hid_t datasetID = H5Dopen(groupID, names[dataset], H5P_DEFAULT);
+        TEST_ASSERT_TRUE(datasetID >= 0);
+        hid_t propertyID = H5Dget_create_plist(datasetID);
+        hsize_t chunkDims[3] = {0};
+        TEST_ASSERT_EQUAL_INT(H5D_CHUNKED, H5Pget_layout(propertyID));
+        H5Pget_chunk(propertyID, 3, chunkDims);
+        H5Pclose(propertyID);
+        TEST_ASSERT_EQUAL_UINT64(lineBlock, chunkDims[0]);
+        TEST_ASSERT_EQUAL_UINT64(binCount, chunkDims[2]);
+        TEST_ASSERT_TRUE(H5Dread(datasetID, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, read) >= 0);
+        H5Dclose(datasetID);
+        size_t mismatchCount = 0;
+        for (size_t ray = 0; ray < (size_t)TEST_GEODETIC_LINE_COUNT * SCAN_ANGLE_COUNT; ray++)
+            for (unsigned int bin = 0; bin < binCount; bin++)
+                mismatchCount += read[ray * binCount + bin] != TestGeodeticCell(dataset, ray * SCAN_HEIGHT_COUNT + binBegin + bin);
+        TEST_ASSERT_EQUAL_UINT64(0, mismatchCount);
+    }
+    free(read);
+    H5Gclose(groupID);
+    H5Fclose(fileID);
+}
+
+void test_geodetic_writer_windows(void) {
+    TEST_MESSAGE("Start geodetic writer window test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.output_compression = OUTPUT_COMPRESSION_DEFLATE;
+    config.output_chunk_size = 16;
+    config.output_deflate_level = 1;
+    config.geodetic_bin_begin = TEST_GEODETIC_BIN_BEGIN;
+    config.geodetic_bin_end = TEST_GEODETIC_BIN_END;
+    config.geodetic_line_block = 16;
+    strcpy(config.extra_variables[0], "Extra");
+    config.extra_variable_count = 1;
+    g_config = &config;
+    GeodeticGrid grid;
+    InitTestGeodeticGrid(&grid);
+    const HDFGlobalAttribute globalAttribute = {TEST_GEODETIC_LINE_COUNT, {2024, 5, 6, 7, 0, 0}, {2024, 5, 6, 7, 10, 0}, true};
+
+    // the windows as ProcessDataset hands them over, a window off the line blocks is refused
+    GeodeticWriter* writer = CreateGeodeticWriter(0, TEST_GEODETIC_FILE_NAME, TEST_GEODETIC_LINE_COUNT, 1, &globalAttribute);
+    TEST_ASSERT_NOT_NULL(writer);
+    for (unsigned int firstLine = 0; firstLine < TEST_GEODETIC_LINE_COUNT; firstLine += 16)
+        TEST_ASSERT_TRUE(WriteGeodeticWindow(writer, &grid, firstLine, TEST_GEODETIC_LINE_COUNT - firstLine < 16 ? TEST_GEODETIC_LINE_COUNT - firstLine : 16));
+    TEST_ASSERT_TRUE(CloseGeodeticWriter(writer));
+    CheckGeodeticFile(16);
+    writer = CreateGeodeticWriter(0, TEST_GEODETIC_FILE_NAME, TEST_GEODETIC_LINE_COUNT, 1, &globalAttribute);
+    TEST_ASSERT_NOT_NULL(writer);
+    TEST_ASSERT_FALSE(WriteGeodeticWindow(writer, &grid, 8, 16));
+    TEST_ASSERT_FALSE(CloseGeodeticWriter(writer));
+
+    // the whole grid at once, still chunked by lines when the output is raw and contiguous
+    config.output_compression = OUTPUT_COMPRESSION_NONE;
+    config.output_chunk_size = 0;
+    config.geodetic_line_block = 8;
+    TEST_ASSERT_TRUE(WriteTotalGeodetic(0, TEST_GEODETIC_FILE_NAME, &grid, &globalAttribute));
+    CheckGeodeticFile(8);
+
+    // an empty bin window has nothing to write
+    config.geodetic_bin_begin = 300;
+    config.geodetic_bin_end = 300;
+    TEST_ASSERT_NULL(CreateGeodeticWriter(0, TEST_GEODETIC_FILE_NAME, TEST_GEODETIC_LINE_COUNT, 1, &globalAttribute));
+
+    remove(TEST_GEODETIC_FILE_NAME);
+    DestroyGeodeticGrid(&grid);
+    g_config = previousConfig;
+    TEST_MESSAGE("Geodetic writer window test completed");
+}
+
+void test_geodetic_writer(void) {
+    TEST_MESSAGE("Start geodetic writer test");
+    RUN_TEST(test_geodetic_writer_windows);
+    TEST_MESSAGE("Geodetic writer test completed");
+}
@@ -0,0 +1,153 @@
+#include "test_suites.h"
+#include <float.h>
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+#include "knnindex.h"
+#include "test_helpers.h"
+
+static unsigned int BruteForceKNN(const RStarPoint* points, unsigned int count, const double queryPoint[3], unsigned int k, double* distances) {
+    unsigned int found = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        if (points[i].h == -1) continue;
+        double distance = SquaredDistance(&points[i], queryPoint);
+        if (found < k) found++;
+        else if (distance >= distances[k - 1]) continue;
+        unsigned int j = found - 1;
+        while (j > 0 && distances[j - 1] > distance) {
+            distances[j] = distances[j - 1];
+            j--;
+        }
+        distances[j] = distance;
+    }
+    return found;
+}
+
+void test_knnindex_create_and_destroy(void) {
+    TEST_MESSAGE("Start KNN index create and destroy test");
+    TEST_ASSERT_NULL(CreateStaticKNNIndex(NULL, 0, 10, 32));
+
+    RStarPoint* points = CreateTestPoints(100, 1000.0f);
+    TEST_ASSERT_NOT_NULL(points);
+    TEST_ASSERT_NULL(CreateStaticKNNIndex(points, 10, 10, 32));
+    for (unsigned int i = 0; i < 100; i++)
+        points[i].h = -1;
+    TEST_ASSERT_NULL(CreateStaticKNNIndex(points, 0, 100, 32));
+    points[42].h = 1;
+    StaticKNNIndex* index = CreateStaticKNNIndex(points, 0, 100, 32);
+    TEST_ASSERT_NOT_NULL(index);
+    TEST_ASSERT_EQUAL_INT(1, index->pointCount);
+    TEST_ASSERT_EQUAL_INT(1, index->nodeCount);
+    TEST_ASSERT_TRUE(StaticKNNIndex_MemoryUsage(index) > 0);
+    DestroyStaticKNNIndex(index);
+    free(points);
+    TEST_MESSAGE("KNN index create and destroy test completed");
+}
+
+void test_knnindex_structure(void) {
+    TEST_MESSAGE("Start KNN index structure test");
+    const unsigned int count = 5000;
+    RStarPoint* points = CreateTestPoints(count, 100000.0f);
+    TEST_ASSERT_NOT_NULL(points);
+    StaticKNNIndex* index = CreateStaticKNNIndex(points, 0, count, 16);
+    TEST_ASSERT_NOT_NULL(index);
+
+    unsigned int validCount = 0;
+    for (unsigned int i = 0; i < count; i++)
+        if (points[i].h != -1) validCount++;
+    TEST_ASSERT_EQUAL_INT(validCount, index->pointCount);
+
+    unsigned int leafPointCount = 0;
+    for (unsigned int n = 0; n < index->nodeCount; n++) {
+        const KNNNode* node = &index->nodes[n];
+        for (unsigned int i = node->start; i < node->start + node->count; i++) {
+            TEST_ASSERT_TRUE(index->x[i] >= node->min[0] && index->x[i] <= node->max[0]);
+            TEST_ASSERT_TRUE(index->y[i] >= node->min[1] && index->y[i] <= node->max[1]);
+            TEST_ASSERT_TRUE(index->z[i] >= node->min[2] && index->z[i] <= node->max[2]);
+        }
+        if (!node->left) {
+            TEST_ASSERT_TRUE(node->count <= 16);
+            leafPointCount += node->count;
+        }
+        else
+            TEST_ASSERT_EQUAL_INT(node->count, index->nodes[node->left].count + index->nodes[node->right].count);
+    }
+    TEST_ASSERT_EQUAL_INT(index->pointCount, leafPointCount);
+
+    DestroyStaticKNNIndex(index);
+    free(points);
+    TEST_MESSAGE("KNN index structure test completed");
+}
+
+void test_knnindex_nearest_neighbor(void) {
+    TEST_MESSAGE("Start KNN index nearest neighbor test");
+    const unsigned int count = 20000, k = 7;
+    RStarPoint* points = CreateTestPoints(count, 200000.0f);
+    TEST_ASSERT_NOT_NULL(points);
+    StaticKNNIndex* index = CreateStaticKNNIndex(points, 0, count, 32);
+    TEST_ASSERT_NOT_NULL(index);
+
+    float heapDistances[7];
+    uint32_t heapIds[7];
+    double expected[7];
+    for (int q = 0; q < 200; q++) {
+        double queryPoint[3] = {6378137.0 + (double)rand() / RAND_MAX * 200000.0, (double)rand() / RAND_MAX * 200000.0, (double)rand() / RAND_MAX * 200000.0};
+        unsigned int found = StaticKNNIndex_NearestNeighborQuery(index, queryPoint, k, heapDistances, heapIds);
+        unsigned int expectedFound = BruteForceKNN(points, count, queryPoint, k, expected);
+        TEST_ASSERT_EQUAL_INT(expectedFound, found);
+        for (unsigned int i = 0; i < found; i++) {
+            TEST_ASSERT_DOUBLE_WITHIN(1.0, sqrt(expected[i]), sqrt(heapDistances[i]));
+            TEST_ASSERT_TRUE(points[heapIds[i]].h != -1);
+            TEST_ASSERT_DOUBLE_WITHIN(1.0, sqrt(expected[i]), sqrt(SquaredDistance(&points[heapIds[i]], queryPoint)));
+            if (i > 0) TEST_ASSERT_TRUE(heapDistances[i - 1] <= heapDistances[i]);
+        }
+    }
+
+    DestroyStaticKNNIndex(index);
+    free(points);
+    TEST_MESSAGE("KNN index nearest neighbor test completed");
+}
+
+void test_knnindex_batch_query(void) {
+    TEST_MESSAGE("Start KNN index batch query test");
+    const unsigned int count = 300, queryCount = 50, k = 400; // k larger than the point count
+    RStarPoint* points = CreateTestPoints(count, 5000.0f);
+    TEST_ASSERT_NOT_NULL(points);
+    StaticKNNIndex* index = CreateStaticKNNIndex(points, 0, count, 8);
+    TEST_ASSERT_NOT_NULL(index);
+
+    double* queryPoints = (double*)malloc(queryCount * 3 * sizeof(double));
+    int64_t* ids = (int64_t*)malloc((size_t)queryCount * k * sizeof(int64_t));
+    double* distances = (double*)malloc((size_t)queryCount * k * sizeof(double));
+    uint64_t* counts = (uint64_t*)malloc(queryCount * sizeof(uint64_t));
+    for (unsigned int i = 0; i < queryCount; i++) {
+        queryPoints[i * 3 + 0] = 6378137.0 + (double)rand() / RAND_MAX * 5000.0;
+        queryPoints[i * 3 + 1] = (double)rand() / RAND_MAX * 5000.0;
+        queryPoints[i * 3 + 2] = (double)rand() / RAND_MAX * 5000.0;
+    }
+    TEST_ASSERT_TRUE(StaticKNNIndex_NearestNeighborBatchQuery(index, k, queryCount, queryPoints, ids, counts, distances));
+    size_t resultIndex = 0;
+    for (unsigned int i = 0; i < queryCount; i++) {
+        TEST_ASSERT_EQUAL_INT(index->pointCount, counts[i]);
+        TEST_ASSERT_DOUBLE_WITHIN(0.5, sqrt(SquaredDistance(&points[ids[resultIndex]], &queryPoints[i * 3])), distances[resultIndex]);
+        resultIndex += counts[i];
+    }
+    TEST_ASSERT_FALSE(StaticKNNIndex_NearestNeighborBatchQuery(index, 0, queryCount, queryPoints, ids, counts, distances));
+
+    free(queryPoints);
+    free(ids);
+    free(distances);
+    free(counts);
+    DestroyStaticKNNIndex(index);
+    free(points);
+    TEST_MESSAGE("KNN index batch query test completed");
+}
+
+void test_knnindex(void) {
+    TEST_MESSAGE("Start KNN index test");
+    RUN_TEST(test_knnindex_create_and_destroy);
+    RUN_TEST(test_knnindex_structure);
+    RUN_TEST(test_knnindex_nearest_neighbor);
+    RUN_TEST(test_knnindex_batch_query);
+    TEST_MESSAGE("KNN index test completed");
+}
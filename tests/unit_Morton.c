@@ -0,0 +1,105 @@
+#include "test_suites.h"
+#include <stdlib.h>
+#include "morton.h"
+#include "core.h"
+
+void test_morton_encode(void) {
+    TEST_MESSAGE("Start Morton encode test");
+    TEST_ASSERT_TRUE(EncodeMorton3D(0, 0, 0) == 0);
+    TEST_ASSERT_TRUE(EncodeMorton3D(1, 0, 0) == 1);
+    TEST_ASSERT_TRUE(EncodeMorton3D(0, 1, 0) == 2);
+    TEST_ASSERT_TRUE(EncodeMorton3D(0, 0, 1) == 4);
+    TEST_ASSERT_TRUE(EncodeMorton3D(3, 5, 6) == 0x1AB); // x=011 y=101 z=110 interleaved as zyx per bit: 110 101 011
+    const uint32_t axisMax = (1u << MORTON_AXIS_BITS) - 1;
+    TEST_ASSERT_TRUE(EncodeMorton3D(axisMax, axisMax, axisMax) == 0x7FFFFFFFFFFFFFFFull);
+    TEST_ASSERT_TRUE(EncodeMorton3D(axisMax + 1, 0, 0) == 0); // bits beyond the axis are dropped
+    TEST_ASSERT_TRUE(EncodeMorton2D(3, 5) == EncodeMorton3D(3, 5, 0));
+    TEST_MESSAGE("Morton encode test completed");
+}
+
+void test_morton_radix_sort(void) {
+    TEST_MESSAGE("Start Morton radix sort test");
+    const unsigned int count = 10000;
+    uint64_t* keys = (uint64_t*)malloc(count * sizeof(uint64_t));
+    uint64_t* original = (uint64_t*)malloc(count * sizeof(uint64_t));
+    uint32_t* order = (uint32_t*)malloc(count * sizeof(uint32_t));
+    for (unsigned int i = 0; i < count; i++) {
+        keys[i] = original[i] = ((uint64_t)rand() << 20 ^ (uint64_t)rand()) % 5000000000ull; // spans three 16 bit digits
+        order[i] = i;
+    }
+    TEST_ASSERT_TRUE(RadixSortKeys(keys, order, count, 5000000000ull));
+    for (unsigned int i = 0; i < count; i++) {
+        TEST_ASSERT_TRUE(keys[i] == original[order[i]]);
+        if (i > 0) {
+            TEST_ASSERT_TRUE(keys[i - 1] <= keys[i]);
+            if (keys[i - 1] == keys[i]) TEST_ASSERT_TRUE(order[i - 1] < order[i]); // stable
+        }
+    }
+    free(keys);
+    free(original);
+    free(order);
+    TEST_MESSAGE("Morton radix sort test completed");
+}
+
+void test_morton_query_order(void) {
+    TEST_MESSAGE("Start Morton query order test");
+    ClipGrid clipGrid = {0};
+    clipGrid.longitudeCount = 13;
+    clipGrid.latitudeCount = 7;
+    clipGrid.heightCount = 60;
+    const unsigned int total = clipGrid.longitudeCount * clipGrid.latitudeCount * clipGrid.heightCount;
+    double* queryPoints = (double*)malloc(total * 3 * sizeof(double));
+    double* queryGeodetic = (double*)malloc(total * 3 * sizeof(double));
+    unsigned int* queryIDs = (unsigned int*)malloc(total * sizeof(unsigned int));
+    bool* seen = (bool*)calloc(total, sizeof(bool));
+    unsigned int queryCount = 0;
+    for (unsigned int index = 0; index < total; index++) { // lattice order, part of the nodes is filtered out
+        if (rand() % 3 == 0) continue;
+        queryPoints[queryCount * 3 + 0] = index;
+        queryPoints[queryCount * 3 + 2] = -(double)index;
+        queryGeodetic[queryCount * 3 + 1] = index * 0.5;
+        queryIDs[queryCount++] = index;
+    }
+    TEST_ASSERT_TRUE(SortQueriesByMorton(&clipGrid, queryCount, queryPoints, queryGeodetic, queryIDs, NULL));
+    uint64_t previousKey = 0;
+    for (unsigned int i = 0; i < queryCount; i++) {
+        const unsigned int index = queryIDs[i];
+        TEST_ASSERT_TRUE(index < total);
+        TEST_ASSERT_FALSE(seen[index]);
+        seen[index] = true;
+        TEST_ASSERT_EQUAL_DOUBLE(index, queryPoints[i * 3 + 0]); // the buffers move together
+        TEST_ASSERT_EQUAL_DOUBLE(-(double)index, queryPoints[i * 3 + 2]);
+        TEST_ASSERT_EQUAL_DOUBLE(index * 0.5, queryGeodetic[i * 3 + 1]);
+        const unsigned int h = index % clipGrid.heightCount;
+        const unsigned int b = index / clipGrid.heightCount % clipGrid.latitudeCount;
+        const unsigned int l = index / clipGrid.heightCount / clipGrid.latitudeCount;
+        const uint64_t key = EncodeMorton2D(l, b) * clipGrid.heightCount + h;
+        if (i > 0) TEST_ASSERT_TRUE(previousKey < key);
+        previousKey = key;
+    }
+    TEST_ASSERT_TRUE(SortQueriesByMorton(&clipGrid, queryCount, queryPoints, NULL, queryIDs, NULL)); // geodetic is optional
+    MortonSortBuffer* buffer = CreateMortonSortBuffer(queryCount); // the per-thread scratch gives the same order
+    TEST_ASSERT_NOT_NULL(buffer);
+    TEST_ASSERT_TRUE(SortQueriesByMorton(&clipGrid, queryCount, queryPoints, queryGeodetic, queryIDs, buffer));
+    for (unsigned int i = 1; i < queryCount; i++)
+        TEST_ASSERT_TRUE(queryIDs[i - 1] != queryIDs[i]);
+    TEST_ASSERT_EQUAL_DOUBLE(queryIDs[queryCount - 1], queryPoints[(queryCount - 1) * 3 + 0]);
+    buffer->capacity = queryCount - 1;
+    TEST_ASSERT_FALSE(SortQueriesByMorton(&clipGrid, queryCount, queryPoints, NULL, queryIDs, buffer));
+    DestroyMortonSortBuffer(buffer);
+    TEST_ASSERT_TRUE(SortQueriesByMorton(&clipGrid, 0, queryPoints, NULL, queryIDs, NULL));
+    TEST_ASSERT_FALSE(SortQueriesByMorton(NULL, queryCount, queryPoints, NULL, queryIDs, NULL));
+    free(queryPoints);
+    free(queryGeodetic);
+    free(queryIDs);
+    free(seen);
+    TEST_MESSAGE("Morton query order test completed");
+}
+
+void test_morton(void) {
+    TEST_MESSAGE("Start Morton test");
+    RUN_TEST(test_morton_encode);
+    RUN_TEST(test_morton_radix_sort);
+    RUN_TEST(test_morton_query_order);
+    TEST_MESSAGE("Morton test completed");
+}
@@ -0,0 +1,166 @@
+#include "test_suites.h"
+#include <string.h>
+#include "plan.h"
+#include "interpolate.h"
+#include "config.h"
+
+#define TEST_PLAN_FILE_NAME "/tmp/FY3G_unit_plan.bin"
+#define TEST_POINT_COUNT 100
+
+static void InitTestPlanClip(ClipGrid* clipGrid, const float minLatitude) {
+    clipGrid->latitudeCount = 4;
+    clipGrid->longitudeCount = 5;
+    clipGrid->heightCount = 10;
+    clipGrid->minLatitude = minLatitude;
+    clipGrid->minLongitude = 110.0f;
+    clipGrid->minHeight = 100.0f;
+    clipGrid->latitudeGap = clipGrid->longitudeGap = 0.05f;
+    clipGrid->heightGap = 200.0f;
+    const unsigned int cellCount = clipGrid->latitudeCount * clipGrid->longitudeCount * clipGrid->heightCount;
+    clipGrid->value = (float*)malloc(cellCount * sizeof(float));
+    clipGrid->extraCount = 1;
+    clipGrid->extraValue = (float*)malloc(cellCount * sizeof(float));
+}
+
+static unsigned int FillTestQueries(const unsigned int cellCount, const unsigned int k, unsigned int* queryIDs, uint64_t* counts, double* distances, int64_t* ids, double* queryGeodetic) {
+    // every other cell is queried, with ascending distances, some below the min and above the max neighbor distance
+    unsigned int queryCount = 0;
+    size_t offset = 0;
+    for (unsigned int cell = 0; cell < cellCount; cell += 2) {
+        queryIDs[queryCount] = cell;
+        queryGeodetic[queryCount * 3 + 2] = (double)rand() / RAND_MAX * 2000.0;
+        counts[queryCount] = rand() % (k + 1);
+        double distance = (rand() % 20 == 0) ? 50.0 : 150.0;
+        for (unsigned int j = 0; j < counts[queryCount]; j++) {
+            distance += (double)rand() / RAND_MAX * 3000.0;
+            distances[offset + j] = distance;
+            ids[offset + j] = rand() % TEST_POINT_COUNT;
+        }
+        offset += counts[queryCount];
+        queryCount++;
+    }
+    return queryCount;
+}
+
+void test_plan_record_apply(void) {
+    TEST_MESSAGE("Start resample plan record and apply test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.min_neighbor_distance = 100;
+    config.max_neighbor_distance = 10000;
+    config.max_vertical_distance = 400;
+    config.idw_power = 2.0f;
+    config.k_neighbor = 5;
+    g_config = &config;
+
+    const unsigned int k = config.k_neighbor;
+    float values[TEST_POINT_COUNT], extra[TEST_POINT_COUNT], heights[TEST_POINT_COUNT];
+    for (unsigned int i = 0; i < TEST_POINT_COUNT; i++) {
+        values[i] = i % 7 == 0 ? -999 : 10.0f + (float)rand() / RAND_MAX * 30.0f;
+        extra[i] = i % 5 == 0 ? -999 : (float)rand() / RAND_MAX * 5.0f;
+        heights[i] = (float)rand() / RAND_MAX * 2000.0f;
+    }
+    const float* valueArrays[2] = {values, extra};
+    ClipGridResult finalGrid = {0};
+    finalGrid.clipCount = 2;
+    finalGrid.clipGrids = (ClipGrid*)calloc(finalGrid.clipCount, sizeof(ClipGrid));
+    InitTestPlanClip(&finalGrid.clipGrids[0], 30.0f);
+    InitTestPlanClip(&finalGrid.clipGrids[1], 30.2f);
+    const unsigned int cellCount = 4 * 5 * 10;
+    HDFGlobalAttribute globalAttribute = {0};
+    globalAttribute.scanLineCount = 1;
+    ResamplePlanKey key;
+    InitResamplePlanKey(&globalAttribute, &key);
+    ResamplePlan* plan = CreateResamplePlan(TEST_PLAN_FILE_NAME, &key, &finalGrid, k);
+    TEST_ASSERT_NOT_NULL(plan);
+
+    unsigned int* queryIDs = (unsigned int*)malloc(cellCount * sizeof(unsigned int));
+    uint64_t* counts = (uint64_t*)malloc(cellCount * sizeof(uint64_t));
+    double* distances = (double*)malloc(cellCount * k * sizeof(double));
+    int64_t* ids = (int64_t*)malloc(cellCount * k * sizeof(int64_t));
+    double* queryGeodetic = (double*)calloc(cellCount * 3, sizeof(double));
+    float* neighborWeights = (float*)malloc(IDW_BATCH_BLOCK * k * sizeof(float));
+    int64_t* neighborIds = (int64_t*)malloc(IDW_BATCH_BLOCK * k * sizeof(int64_t));
+    float* expected = (float*)malloc(2 * cellCount * sizeof(float));
+    float* recorded = (float*)malloc(2 * cellCount * finalGrid.clipCount * sizeof(float));
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++) {
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        ClipResamplePlan* clip = &plan->clips[clipIndex];
+        TEST_ASSERT_TRUE(BeginClipResamplePlan(clip));
+        const unsigned int queryCount = FillTestQueries(cellCount, k, queryIDs, counts, distances, ids, queryGeodetic);
+        // two chunks as InterpolateClipGridBatch submits them
+        const unsigned int firstCount = queryCount / 3;
+        size_t firstEntries = 0;
+        for (unsigned int i = 0; i < firstCount; i++) firstEntries += counts[i];
+        RecordClipPlanChunk(clip, firstCount, queryIDs, config.idw_power, counts, distances, ids, heights, queryGeodetic, neighborWeights, neighborIds);
+        RecordClipPlanChunk(clip, queryCount - firstCount, queryIDs + firstCount, config.idw_power, counts + firstCount, distances + firstEntries, ids + firstEntries, heights,
+                            queryGeodetic + firstCount * 3, neighborWeights, neighborIds);
+        FinishClipResamplePlan(clip);
+        TEST_ASSERT_TRUE(ApplyClipResamplePlan(clip, values, (const float* const*)(valueArrays + 1), clipGrid));
+
+        InterpolateValuesIDWBatch(config.idw_power, queryCount, k, counts, distances, ids, 2, valueArrays, heights, queryGeodetic, neighborWeights, neighborIds, expected);
+        for (unsigned int i = 0; i < queryCount; i++) {
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected[i], clipGrid->value[queryIDs[i]]);
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f, expected[queryCount + i], clipGrid->extraValue[queryIDs[i]]);
+        }
+        for (unsigned int cell = 1; cell < cellCount; cell += 2) { // never queried
+            TEST_ASSERT_EQUAL_FLOAT(-999.0f, clipGrid->value[cell]);
+            TEST_ASSERT_EQUAL_FLOAT(-999.0f, clipGrid->extraValue[cell]);
+        }
+        memcpy(recorded + 2 * cellCount * clipIndex, clipGrid->value, cellCount * sizeof(float));
+        memcpy(recorded + 2 * cellCount * clipIndex + cellCount, clipGrid->extraValue, cellCount * sizeof(float));
+    }
+    TEST_ASSERT_TRUE(SaveResamplePlan(plan, &finalGrid));
+    DestroyResamplePlan(plan);
+
+    // the mapped plan reproduces the recorded run
+    plan = LoadResamplePlan(TEST_PLAN_FILE_NAME, &key, &finalGrid);
+    TEST_ASSERT_NOT_NULL(plan);
+    TEST_ASSERT_NOT_NULL(plan->mapping);
+    for (unsigned int clipIndex = 0; clipIndex < finalGrid.clipCount; clipIndex++) {
+        ClipGrid* clipGrid = &finalGrid.clipGrids[clipIndex];
+        for (unsigned int cell = 0; cell < cellCount; cell++) clipGrid->value[cell] = clipGrid->extraValue[cell] = 0;
+        TEST_ASSERT_TRUE(ApplyClipResamplePlan(&plan->clips[clipIndex], values, (const float* const*)(valueArrays + 1), clipGrid));
+        for (unsigned int cell = 0; cell < cellCount; cell++) {
+            TEST_ASSERT_EQUAL_FLOAT(recorded[2 * cellCount * clipIndex + cell], clipGrid->value[cell]);
+            TEST_ASSERT_EQUAL_FLOAT(recorded[2 * cellCount * clipIndex + cellCount + cell], clipGrid->extraValue[cell]);
+        }
+    }
+    DestroyResamplePlan(plan);
+
+    // another parameter, another clip lattice or no file: no plan
+    ResamplePlanKey otherKey = key;
+    otherKey.idwPower = 3.0f;
+    TEST_ASSERT_NULL(LoadResamplePlan(TEST_PLAN_FILE_NAME, &otherKey, &finalGrid));
+    // the shared index searches the lines beside a clip too
+    config.shared_index = !config.shared_index;
+    InitResamplePlanKey(&globalAttribute, &otherKey);
+    config.shared_index = !config.shared_index;
+    TEST_ASSERT_NULL(LoadResamplePlan(TEST_PLAN_FILE_NAME, &otherKey, &finalGrid));
+    InitResamplePlanKey(&globalAttribute, &otherKey);
+    TEST_ASSERT_NOT_NULL(plan = LoadResamplePlan(TEST_PLAN_FILE_NAME, &otherKey, &finalGrid));
+    DestroyResamplePlan(plan);
+    finalGrid.clipGrids[1].minLatitude += 0.05f;
+    TEST_ASSERT_NULL(LoadResamplePlan(TEST_PLAN_FILE_NAME, &key, &finalGrid));
+    remove(TEST_PLAN_FILE_NAME);
+    TEST_ASSERT_NULL(LoadResamplePlan(TEST_PLAN_FILE_NAME, &key, &finalGrid));
+
+    free(queryIDs);
+    free(counts);
+    free(distances);
+    free(ids);
+    free(queryGeodetic);
+    free(neighborWeights);
+    free(neighborIds);
+    free(expected);
+    free(recorded);
+    DestroyClipGridResult(&finalGrid);
+    g_config = previousConfig;
+    TEST_MESSAGE("Resample plan record and apply test completed");
+}
+
+void test_plan(void) {
+    TEST_MESSAGE("Start resample plan test");
+    RUN_TEST(test_plan_record_apply);
+    TEST_MESSAGE("Resample plan test completed");
+}
@@ -0,0 +1,99 @@
+#include "test_suites.h"
+#include "scatter.h"
+#include "config.h"
+
+#define TEST_LINE_COUNT 20
+#define TEST_BIN_COUNT 100
+#define TEST_BIN_STEP 100.0f
+#define TEST_ECHO_TOP 6000.0f
+#define TEST_VALUE 25.0f
+
+static void InitTestScatterGrid(GeodeticGrid* grid) {
+    // vertical rays about 5 km apart, bin 0 at the top, a constant value below the echo top
+    TEST_ASSERT_TRUE(InitGeodeticGrid(grid, TEST_LINE_COUNT, TEST_BIN_COUNT));
+    TEST_ASSERT_TRUE(InitGeodeticGridExtra(grid, 1));
+    for (unsigned int l = 0; l < TEST_LINE_COUNT; l++)
+        for (unsigned int a = 0; a < SCAN_ANGLE_COUNT; a++)
+            for (unsigned int bin = 0; bin < TEST_BIN_COUNT; bin++) {
+                const unsigned int index = (l * SCAN_ANGLE_COUNT + a) * TEST_BIN_COUNT + bin;
+                const float height = (TEST_BIN_COUNT - 1 - bin) * TEST_BIN_STEP;
+                grid->latitudeArray[index] = 30.0f + l * 0.045f;
+                grid->longitudeArray[index] = 120.0f + ((int)a - SCAN_ANGLE_COUNT / 2) * 0.052f;
+                grid->elevationArray[index] = height;
+                grid->validArray[index] = height <= TEST_ECHO_TOP && rand() % 10 < 8;
+                grid->valueArray[index] = grid->validArray[index] ? TEST_VALUE : -999;
+                grid->extraValueArrays[0][index] = grid->validArray[index] && bin % 2 == 0 ? 2.0f * TEST_VALUE + 1.0f : -999;
+            }
+}
+
+void test_scatter_clip(void) {
+    TEST_MESSAGE("Start scatter clip test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.min_neighbor_distance = 100;
+    config.max_vertical_distance = 400;
+    config.vertical_scale = 1;
+    g_config = &config;
+    GeodeticGrid grid;
+    InitTestScatterGrid(&grid);
+    ClipGrid clipGrid = {0};
+    clipGrid.leftLineIndex = 0;
+    clipGrid.rightLineIndex = TEST_LINE_COUNT - 1;
+    clipGrid.latitudeCount = 15;
+    clipGrid.longitudeCount = 25;
+    clipGrid.heightCount = 40;
+    clipGrid.minLatitude = 30.1f;
+    clipGrid.minLongitude = 119.2f;
+    clipGrid.minHeight = 100;
+    clipGrid.latitudeGap = clipGrid.longitudeGap = 0.05f;
+    clipGrid.heightGap = 200;
+    const unsigned int cellCount = clipGrid.latitudeCount * clipGrid.longitudeCount * clipGrid.heightCount;
+    clipGrid.value = (float*)malloc(cellCount * sizeof(float));
+    clipGrid.extraCount = 1;
+    clipGrid.extraValue = (float*)malloc(cellCount * sizeof(float));
+    TEST_ASSERT_FALSE(InterpolateClipGridScatter(NULL, 5000, 2.0f, &clipGrid));
+    TEST_ASSERT_FALSE(InterpolateClipGridScatter(&grid, 0, 2.0f, &clipGrid));
+    const float powers[] = {2.0f, 1.5f};
+    for (unsigned int p = 0; p < 2; p++) {
+        TEST_ASSERT_TRUE(InterpolateClipGridScatter(&grid, 5000, powers[p], &clipGrid));
+        unsigned int validCount = 0, lowCount = 0;
+        for (unsigned int h = 0; h < clipGrid.heightCount; h++) {
+            const float height = clipGrid.minHeight + h * clipGrid.heightGap;
+            for (unsigned int column = 0; column < clipGrid.latitudeCount * clipGrid.longitudeCount; column++) {
+                const unsigned int index = column * clipGrid.heightCount + h;
+                if (height > TEST_ECHO_TOP + config.max_vertical_distance) { // out of the vertical reach of every bin
+                    TEST_ASSERT_EQUAL_FLOAT(-999.0f, clipGrid.value[index]);
+                    TEST_ASSERT_EQUAL_FLOAT(-999.0f, clipGrid.extraValue[index]);
+                    continue;
+                }
+                if (height <= TEST_ECHO_TOP) lowCount++;
+                if (clipGrid.value[index] <= -999) continue;
+                // the weights are normalized, a constant field stays constant
+                TEST_ASSERT_FLOAT_WITHIN(1e-4f, TEST_VALUE, clipGrid.value[index]);
+                if (clipGrid.extraValue[index] > -999) TEST_ASSERT_FLOAT_WITHIN(1e-4f, 2.0f * TEST_VALUE + 1.0f, clipGrid.extraValue[index]);
+                validCount++;
+            }
+        }
+        TEST_ASSERT_TRUE(validCount > lowCount / 2);
+    }
+
+    clipGrid.minLatitude = 40.0f; // far outside the swath
+    TEST_ASSERT_TRUE(InterpolateClipGridScatter(&grid, 5000, 2.0f, &clipGrid));
+    for (unsigned int i = 0; i < cellCount; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(-999.0f, clipGrid.value[i]);
+        TEST_ASSERT_EQUAL_FLOAT(-999.0f, clipGrid.extraValue[i]);
+    }
+    clipGrid.rightLineIndex = TEST_LINE_COUNT; // past the last line
+    TEST_ASSERT_FALSE(InterpolateClipGridScatter(&grid, 5000, 2.0f, &clipGrid));
+    free(clipGrid.value);
+    free(clipGrid.extraValue);
+    DestroyGeodeticGrid(&grid);
+    g_config = previousConfig;
+    TEST_MESSAGE("Scatter clip test completed");
+}
+
+void test_scatter(void) {
+    TEST_MESSAGE("Start scatter test");
+    RUN_TEST(test_scatter_clip);
+    TEST_MESSAGE("Scatter test completed");
+}
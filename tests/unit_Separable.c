@@ -0,0 +1,144 @@
+#include "test_suites.h"
+#include "separable.h"
+#include "geotransfer.h"
+#include "config.h"
+
+#define TEST_LINE_COUNT 30
+#define TEST_BIN_COUNT 100
+#define TEST_BIN_STEP 100.0f
+#define TEST_ECHO_TOP 6000.0f
+
+static float HeightField(const double height) {
+    // linear in height, so the 1D stage is exact between two valid bins and the 2D stage averages equal values
+    return 40.0f - 3.0f * height / 1000.0f;
+}
+
+static void InitTestScanGrid(GeodeticGrid* grid) {
+    // slanted rays as unit_Structured, bin 0 at the top, no valid bin above the echo top
+    TEST_ASSERT_TRUE(InitGeodeticGrid(grid, TEST_LINE_COUNT, TEST_BIN_COUNT));
+    for (unsigned int l = 0; l < TEST_LINE_COUNT; l++)
+        for (unsigned int a = 0; a < SCAN_ANGLE_COUNT; a++) {
+            const double latitude = 30.0 + l * 0.045;
+            const double longitude = 120.0 + ((int)a - SCAN_ANGLE_COUNT / 2) * 0.052;
+            const double slope = tan(ToRadians(((int)a - SCAN_ANGLE_COUNT / 2) * 0.3)) / (111320.0 * cos(ToRadians(latitude)));
+            for (unsigned int bin = 0; bin < TEST_BIN_COUNT; bin++) {
+                const unsigned int index = (l * SCAN_ANGLE_COUNT + a) * TEST_BIN_COUNT + bin;
+                const float height = (TEST_BIN_COUNT - 1 - bin) * TEST_BIN_STEP;
+                grid->latitudeArray[index] = latitude;
+                grid->longitudeArray[index] = longitude + height * slope;
+                grid->elevationArray[index] = height;
+                grid->validArray[index] = height <= TEST_ECHO_TOP && rand() % 10 < 8;
+                grid->valueArray[index] = grid->validArray[index] ? HeightField(height) : -999;
+            }
+        }
+}
+
+void test_separable_ray_profile(void) {
+    TEST_MESSAGE("Start separable ray profile test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.max_neighbor_distance = 10000;
+    g_config = &config;
+    TEST_ASSERT_NULL(CreateRayLevelProfile(NULL, 100, 200, 60, 400));
+    GeodeticGrid grid;
+    InitTestScanGrid(&grid);
+    RayLevelProfile* profile = CreateRayLevelProfile(&grid, 150, 200, 50, 400);
+    TEST_ASSERT_NOT_NULL(profile);
+    TEST_ASSERT_EQUAL_INT(TEST_LINE_COUNT * SCAN_ANGLE_COUNT, profile->rayCount);
+    for (unsigned int level = 0; level < profile->levelCount; level++) {
+        const float height = 150 + level * 200.0f;
+        for (unsigned int ray = 0; ray < profile->rayCount; ray++) {
+            const float value = profile->value[(size_t)level * profile->rayCount + ray];
+            if (height > TEST_ECHO_TOP + 400) TEST_ASSERT_EQUAL_FLOAT(-999.0f, value); // out of reach of the highest valid bin
+            else if (value > -999) {
+                TEST_ASSERT_FLOAT_WITHIN(0.4f * 3.0f + 1e-3f, HeightField(height), value); // a single bin is at most the 400 m reach away
+                const unsigned int line = ray / SCAN_ANGLE_COUNT;
+                TEST_ASSERT_FLOAT_WITHIN(1e-4f, 30.0f + line * 0.045f, profile->latitude[(size_t)level * profile->rayCount + ray]);
+            }
+        }
+    }
+    DestroyRayLevelProfile(profile);
+
+    // two valid bins around the level interpolate exactly
+    for (unsigned int bin = 0; bin < TEST_BIN_COUNT; bin++) {
+        const float height = grid.elevationArray[bin];
+        grid.validArray[bin] = height <= TEST_ECHO_TOP;
+        grid.valueArray[bin] = grid.validArray[bin] ? HeightField(height) : -999;
+    }
+    profile = CreateRayLevelProfile(&grid, 150, 200, 50, 400);
+    TEST_ASSERT_NOT_NULL(profile);
+    for (unsigned int level = 0; 150 + level * 200.0f < TEST_ECHO_TOP; level++)
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, HeightField(150 + level * 200.0f), profile->value[(size_t)level * profile->rayCount]);
+    DestroyRayLevelProfile(profile);
+    DestroyGeodeticGrid(&grid);
+    g_config = previousConfig;
+    TEST_MESSAGE("Separable ray profile test completed");
+}
+
+void test_separable_clip(void) {
+    TEST_MESSAGE("Start separable clip test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.max_neighbor_distance = 10000;
+    config.min_neighbor_distance = 100;
+    g_config = &config;
+    GeodeticGrid grid;
+    InitTestScanGrid(&grid);
+    TEST_ASSERT_TRUE(InitGeodeticGridExtra(&grid, 1)); // an extra variable linear in the value, resampled with the same weights
+    for (unsigned int i = 0; i < grid.lineCount * SCAN_ANGLE_COUNT * grid.heightCount; i++)
+        grid.extraValueArrays[0][i] = grid.validArray[i] ? 2.0f * grid.valueArray[i] + 1.0f : -999;
+    StructuredLocator* locator = CreateStructuredLocator(&grid, 1, 8, 1.0f);
+    RayLevelProfile* profile = CreateRayLevelProfile(&grid, 100, 200, 40, 400);
+    TEST_ASSERT_NOT_NULL(locator);
+    TEST_ASSERT_NOT_NULL(profile);
+    ClipGrid clipGrid = {0};
+    clipGrid.latitudeCount = 20;
+    clipGrid.longitudeCount = 25;
+    clipGrid.heightCount = 40;
+    clipGrid.minLatitude = 30.2f;
+    clipGrid.minLongitude = 119.5f;
+    clipGrid.minHeight = 100;
+    clipGrid.latitudeGap = clipGrid.longitudeGap = 0.05f;
+    clipGrid.heightGap = 200;
+    const unsigned int cellCount = clipGrid.latitudeCount * clipGrid.longitudeCount * clipGrid.heightCount;
+    clipGrid.value = (float*)malloc(cellCount * sizeof(float));
+    clipGrid.extraCount = 1;
+    clipGrid.extraValue = (float*)malloc(cellCount * sizeof(float));
+    TEST_ASSERT_FALSE(InterpolateClipGridSeparable(NULL, profile, 5, 2.0f, &clipGrid));
+    TEST_ASSERT_FALSE(InterpolateClipGridSeparable(locator, profile, 0, 2.0f, &clipGrid));
+    TEST_ASSERT_TRUE(InterpolateClipGridSeparable(locator, profile, 5, 2.0f, &clipGrid));
+    unsigned int validCount = 0;
+    for (unsigned int l = 0; l < clipGrid.longitudeCount; l++)
+        for (unsigned int b = 0; b < clipGrid.latitudeCount; b++)
+            for (unsigned int h = 0; h < clipGrid.heightCount; h++) {
+                const float height = clipGrid.minHeight + h * clipGrid.heightGap;
+                const float value = clipGrid.value[l * clipGrid.latitudeCount * clipGrid.heightCount + b * clipGrid.heightCount + h];
+                if (height > TEST_ECHO_TOP + 400) TEST_ASSERT_EQUAL_FLOAT(-999.0f, value);
+                if (value <= -999) continue;
+                TEST_ASSERT_FLOAT_WITHIN(0.4f * 3.0f + 1e-3f, HeightField(height), value); // the rays at the level carry the same value
+                TEST_ASSERT_FLOAT_WITHIN(1e-3f, 2.0f * value + 1.0f, clipGrid.extraValue[l * clipGrid.latitudeCount * clipGrid.heightCount + b * clipGrid.heightCount + h]);
+                validCount++;
+            }
+    TEST_ASSERT_TRUE(validCount > cellCount / 2);
+
+    clipGrid.minLatitude = 40.0f; // far outside the swath
+    TEST_ASSERT_TRUE(InterpolateClipGridSeparable(locator, profile, 5, 2.0f, &clipGrid));
+    for (unsigned int i = 0; i < cellCount; i++) {
+        TEST_ASSERT_EQUAL_FLOAT(-999.0f, clipGrid.value[i]);
+        TEST_ASSERT_EQUAL_FLOAT(-999.0f, clipGrid.extraValue[i]);
+    }
+    free(clipGrid.value);
+    free(clipGrid.extraValue);
+    DestroyRayLevelProfile(profile);
+    DestroyStructuredLocator(locator);
+    DestroyGeodeticGrid(&grid);
+    g_config = previousConfig;
+    TEST_MESSAGE("Separable clip test completed");
+}
+
+void test_separable(void) {
+    TEST_MESSAGE("Start separable test");
+    RUN_TEST(test_separable_ray_profile);
+    RUN_TEST(test_separable_clip);
+    TEST_MESSAGE("Separable test completed");
+}
@@ -0,0 +1,182 @@
+#include "test_suites.h"
+#include <limits.h>
+#include "structured.h"
+#include "geotransfer.h"
+
+#define TEST_LINE_COUNT 40
+#define TEST_BIN_COUNT 100
+#define TEST_BIN_STEP 100.0f
+
+static void InitTestScanGrid(GeodeticGrid* grid) {
+    // rays along a meridian-ish track, slanted with the scan angle, bin 0 at the top
+    TEST_ASSERT_TRUE(InitGeodeticGrid(grid, TEST_LINE_COUNT, TEST_BIN_COUNT));
+    for (unsigned int l = 0; l < TEST_LINE_COUNT; l++)
+        for (unsigned int a = 0; a < SCAN_ANGLE_COUNT; a++) {
+            const double latitude = 30.0 + l * 0.045;
+            const double longitude = 120.0 + ((int)a - SCAN_ANGLE_COUNT / 2) * 0.052;
+            const double slope = tan(ToRadians(((int)a - SCAN_ANGLE_COUNT / 2) * 0.3)) / (111320.0 * cos(ToRadians(latitude)));
+            for (unsigned int bin = 0; bin < TEST_BIN_COUNT; bin++) {
+                const unsigned int index = (l * SCAN_ANGLE_COUNT + a) * TEST_BIN_COUNT + bin;
+                const float height = (TEST_BIN_COUNT - 1 - bin) * TEST_BIN_STEP;
+                grid->latitudeArray[index] = latitude;
+                grid->longitudeArray[index] = longitude + height * slope;
+                grid->elevationArray[index] = height;
+                grid->valueArray[index] = 1.0f;
+                grid->validArray[index] = rand() % 10 < 7;
+            }
+        }
+}
+
+static double EcefDistance(const GeodeticGrid* grid, const unsigned int index, const double queryGeodetic[3], const double verticalScale) {
+    double x1, y1, z1, x2, y2, z2;
+    TransferGeodeticToScaledCartesian(grid->latitudeArray[index], grid->longitudeArray[index], grid->elevationArray[index], verticalScale, &x1, &y1, &z1);
+    TransferGeodeticToScaledCartesian(queryGeodetic[0], queryGeodetic[1], queryGeodetic[2], verticalScale, &x2, &y2, &z2);
+    return sqrt((x1 - x2) * (x1 - x2) + (y1 - y2) * (y1 - y2) + (z1 - z2) * (z1 - z2));
+}
+
+static double BruteForceNearest(const GeodeticGrid* grid, const double queryGeodetic[3], const double verticalScale) {
+    double best = INFINITY;
+    const unsigned int total = TEST_LINE_COUNT * SCAN_ANGLE_COUNT * TEST_BIN_COUNT;
+    for (unsigned int i = 0; i < total; i++)
+        if (grid->validArray[i])
+            best = fmin(best, EcefDistance(grid, i, queryGeodetic, verticalScale));
+    return best;
+}
+
+void test_structured_create_and_destroy(void) {
+    TEST_MESSAGE("Start structured locator create and destroy test");
+    TEST_ASSERT_NULL(CreateStructuredLocator(NULL, 1, 8, 1.0f));
+    GeodeticGrid grid;
+    InitTestScanGrid(&grid);
+    StructuredLocator* locator = CreateStructuredLocator(&grid, 1, 8, 1.0f);
+    TEST_ASSERT_NOT_NULL(locator);
+    TEST_ASSERT_EQUAL_INT(TEST_LINE_COUNT, locator->lineCount);
+    const ScanColumn* column = &locator->columns[5 * SCAN_ANGLE_COUNT + 40];
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, -TEST_BIN_STEP, column->binHeightStep);
+    TEST_ASSERT_FLOAT_WITHIN(1e-2, (TEST_BIN_COUNT - 1) * TEST_BIN_STEP, column->firstHeight);
+    TEST_ASSERT_TRUE(column->longitudeSlope > 0);
+    DestroyStructuredLocator(locator);
+    DestroyGeodeticGrid(&grid);
+    TEST_MESSAGE("Structured locator create and destroy test completed");
+}
+
+void test_structured_locate_column(void) {
+    TEST_MESSAGE("Start structured locator locate column test");
+    GeodeticGrid grid;
+    InitTestScanGrid(&grid);
+    StructuredLocator* locator = CreateStructuredLocator(&grid, 1, 8, 1.0f);
+    TEST_ASSERT_NOT_NULL(locator);
+    unsigned int warmLine = 0, warmAngle = 0;
+    for (int i = 0; i < 200; i++) {
+        const unsigned int l = rand() % TEST_LINE_COUNT, a = rand() % SCAN_ANGLE_COUNT, bin = rand() % TEST_BIN_COUNT;
+        const unsigned int index = (l * SCAN_ANGLE_COUNT + a) * TEST_BIN_COUNT + bin;
+        unsigned int line = UINT_MAX, angle = UINT_MAX;
+        TEST_ASSERT_TRUE(StructuredLocator_LocateColumn(locator, grid.latitudeArray[index], grid.longitudeArray[index], grid.elevationArray[index], &line, &angle));
+        TEST_ASSERT_EQUAL_INT(l, line);
+        TEST_ASSERT_EQUAL_INT(a, angle);
+        // warm started from the previous, unrelated column
+        TEST_ASSERT_TRUE(StructuredLocator_LocateColumn(locator, grid.latitudeArray[index], grid.longitudeArray[index], grid.elevationArray[index], &warmLine, &warmAngle));
+        TEST_ASSERT_EQUAL_INT(l, warmLine);
+        TEST_ASSERT_EQUAL_INT(a, warmAngle);
+    }
+    DestroyStructuredLocator(locator);
+    DestroyGeodeticGrid(&grid);
+    TEST_MESSAGE("Structured locator locate column test completed");
+}
+
+void test_structured_nearest_neighbor(void) {
+    TEST_MESSAGE("Start structured locator nearest neighbor test");
+    GeodeticGrid grid;
+    InitTestScanGrid(&grid);
+    StructuredLocator* locator = CreateStructuredLocator(&grid, 1, 8, 1.0f);
+    TEST_ASSERT_NOT_NULL(locator);
+    const unsigned int k = 5;
+    double distances[5];
+    int64_t ids[5];
+    unsigned int line = UINT_MAX, angle = UINT_MAX;
+    for (int i = 0; i < 50; i++) {
+        const double queryGeodetic[3] = {30.1 + (double)rand() / RAND_MAX * 1.5, 119.0 + (double)rand() / RAND_MAX * 2.0, (double)rand() / RAND_MAX * 9000.0};
+        const unsigned int count = StructuredLocator_NearestNeighborQuery(locator, queryGeodetic, k, &line, &angle, distances, ids);
+        TEST_ASSERT_EQUAL_INT(k, count);
+        for (unsigned int j = 0; j < count; j++) {
+            TEST_ASSERT_TRUE(grid.validArray[ids[j]]);
+            TEST_ASSERT_DOUBLE_WITHIN(distances[j] * 1e-3 + 1.0, EcefDistance(&grid, ids[j], queryGeodetic, 1), distances[j]);
+            if (j > 0) TEST_ASSERT_TRUE(distances[j - 1] <= distances[j]);
+        }
+        TEST_ASSERT_DOUBLE_WITHIN(distances[0] * 1e-3 + 1.0, BruteForceNearest(&grid, queryGeodetic, 1), distances[0]);
+    }
+    DestroyStructuredLocator(locator);
+    DestroyGeodeticGrid(&grid);
+    TEST_MESSAGE("Structured locator nearest neighbor test completed");
+}
+
+void test_structured_vertical_scale(void) {
+    TEST_MESSAGE("Start structured locator vertical scale test");
+    GeodeticGrid grid;
+    InitTestScanGrid(&grid);
+    const double verticalScale = 4;
+    StructuredLocator* locator = CreateStructuredLocator(&grid, 1, 8, verticalScale);
+    TEST_ASSERT_NOT_NULL(locator);
+    const unsigned int k = 5;
+    double distances[5];
+    int64_t ids[5];
+    unsigned int line = UINT_MAX, angle = UINT_MAX;
+    for (int i = 0; i < 50; i++) { // the distances are taken in the stretched space of the indexes
+        const double queryGeodetic[3] = {30.1 + (double)rand() / RAND_MAX * 1.5, 119.0 + (double)rand() / RAND_MAX * 2.0, (double)rand() / RAND_MAX * 9000.0};
+        const unsigned int count = StructuredLocator_NearestNeighborQuery(locator, queryGeodetic, k, &line, &angle, distances, ids);
+        TEST_ASSERT_EQUAL_INT(k, count);
+        for (unsigned int j = 0; j < count; j++)
+            TEST_ASSERT_DOUBLE_WITHIN(distances[j] * 1e-2 + 1.0, EcefDistance(&grid, ids[j], queryGeodetic, verticalScale), distances[j]);
+        TEST_ASSERT_DOUBLE_WITHIN(distances[0] * 1e-2 + 1.0, BruteForceNearest(&grid, queryGeodetic, verticalScale), distances[0]);
+    }
+    DestroyStructuredLocator(locator);
+    DestroyGeodeticGrid(&grid);
+    TEST_MESSAGE("Structured locator vertical scale test completed");
+}
+
+void test_structured_batch_query(void) {
+    TEST_MESSAGE("Start structured locator batch query test");
+    GeodeticGrid grid;
+    InitTestScanGrid(&grid);
+    StructuredLocator* locator = CreateStructuredLocator(&grid, 1, 8, 1.0f);
+    TEST_ASSERT_NOT_NULL(locator);
+    const unsigned int queryCount = 100, k = 4;
+    double* queryGeodetic = (double*)malloc(queryCount * 3 * sizeof(double));
+    int64_t* ids = (int64_t*)malloc(queryCount * k * sizeof(int64_t));
+    double* distances = (double*)malloc(queryCount * k * sizeof(double));
+    uint64_t* counts = (uint64_t*)malloc(queryCount * sizeof(uint64_t));
+    for (unsigned int i = 0; i < queryCount; i++) { // a column of the target grid, as queried by the interpolation
+        queryGeodetic[i * 3 + 0] = 30.5;
+        queryGeodetic[i * 3 + 1] = 120.3;
+        queryGeodetic[i * 3 + 2] = 100.0 + i * 80.0;
+    }
+    TEST_ASSERT_TRUE(StructuredLocator_NearestNeighborBatchQuery(locator, k, queryCount, queryGeodetic, ids, counts, distances));
+    size_t resultIndex = 0;
+    for (unsigned int i = 0; i < queryCount; i++) {
+        TEST_ASSERT_EQUAL_INT(k, counts[i]);
+        double single[4];
+        int64_t singleIds[4];
+        unsigned int line = UINT_MAX, angle = UINT_MAX;
+        TEST_ASSERT_EQUAL_INT(k, StructuredLocator_NearestNeighborQuery(locator, &queryGeodetic[i * 3], k, &line, &angle, single, singleIds));
+        TEST_ASSERT_DOUBLE_WITHIN(1e-6, single[0], distances[resultIndex]);
+        resultIndex += counts[i];
+    }
+    TEST_ASSERT_FALSE(StructuredLocator_NearestNeighborBatchQuery(locator, 0, queryCount, queryGeodetic, ids, counts, distances));
+    free(queryGeodetic);
+    free(ids);
+    free(distances);
+    free(counts);
+    DestroyStructuredLocator(locator);
+    DestroyGeodeticGrid(&grid);
+    TEST_MESSAGE("Structured locator batch query test completed");
+}
+
+void test_structured(void) {
+    TEST_MESSAGE("Start structured locator test");
+    RUN_TEST(test_structured_create_and_destroy);
+    RUN_TEST(test_structured_locate_column);
+    RUN_TEST(test_structured_nearest_neighbor);
+    RUN_TEST(test_structured_vertical_scale);
+    RUN_TEST(test_structured_batch_query);
+    TEST_MESSAGE("Structured locator test completed");
+}
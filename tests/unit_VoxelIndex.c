@@ -0,0 +1,164 @@
+#include "test_suites.h"
+#include <math.h>
+#include <stdlib.h>
+#include "voxelindex.h"
+#include "test_helpers.h"
+
+static unsigned int BruteForceRadiusKNN(const RStarPoint* points, unsigned int count, const double queryPoint[3], unsigned int k, double radius, double* distances) {
+    unsigned int found = 0;
+    for (unsigned int i = 0; i < count; i++) {
+        if (points[i].h == -1) continue;
+        double distance = SquaredDistance(&points[i], queryPoint);
+        if (distance > radius * radius) continue;
+        if (found < k) found++;
+        else if (distance >= distances[k - 1]) continue;
+        unsigned int j = found - 1;
+        while (j > 0 && distances[j - 1] > distance) {
+            distances[j] = distances[j - 1];
+            j--;
+        }
+        distances[j] = distance;
+    }
+    return found;
+}
+
+void test_voxelindex_create_and_destroy(void) {
+    TEST_MESSAGE("Start voxel index create and destroy test");
+    TEST_ASSERT_NULL(CreateVoxelIndex(NULL, 0, 10, 100.0f, 1));
+
+    RStarPoint* points = CreateTestPoints(100, 1000.0f);
+    TEST_ASSERT_NOT_NULL(points);
+    TEST_ASSERT_NULL(CreateVoxelIndex(points, 10, 10, 100.0f, 1));
+    TEST_ASSERT_NULL(CreateVoxelIndex(points, 0, 100, 0.0f, 1));
+    TEST_ASSERT_NULL(CreateVoxelIndex(points, 0, 100, 1e-4f, 1)); // too many voxels along an axis
+    for (unsigned int i = 0; i < 100; i++)
+        points[i].h = -1;
+    TEST_ASSERT_NULL(CreateVoxelIndex(points, 0, 100, 100.0f, 1));
+    points[42].h = 1;
+    VoxelIndex* index = CreateVoxelIndex(points, 0, 100, 100.0f, 1);
+    TEST_ASSERT_NOT_NULL(index);
+    TEST_ASSERT_EQUAL_INT(1, index->pointCount);
+    TEST_ASSERT_EQUAL_INT(1, index->cellCount);
+    TEST_ASSERT_EQUAL_INT(27, index->offsetCount);
+    TEST_ASSERT_TRUE(VoxelIndex_MemoryUsage(index) > 0);
+    DestroyVoxelIndex(index);
+    free(points);
+    TEST_MESSAGE("Voxel index create and destroy test completed");
+}
+
+void test_voxelindex_structure(void) {
+    TEST_MESSAGE("Start voxel index structure test");
+    const unsigned int count = 5000;
+    RStarPoint* points = CreateTestPoints(count, 100000.0f);
+    TEST_ASSERT_NOT_NULL(points);
+    VoxelIndex* index = CreateVoxelIndex(points, 0, count, 10000.0f, 2);
+    TEST_ASSERT_NOT_NULL(index);
+    TEST_ASSERT_FLOAT_WITHIN(1e-3, 5000.0f, index->cellSize);
+    TEST_ASSERT_EQUAL_INT(125, index->offsetCount);
+
+    unsigned int validCount = 0;
+    for (unsigned int i = 0; i < count; i++)
+        if (points[i].h != -1) validCount++;
+    TEST_ASSERT_EQUAL_INT(validCount, index->pointCount);
+    TEST_ASSERT_EQUAL_INT(index->pointCount, index->cellStarts[index->cellCount]);
+
+    for (unsigned int cell = 0; cell < index->cellCount; cell++) {
+        if (cell > 0) TEST_ASSERT_TRUE(index->cellKeys[cell - 1] < index->cellKeys[cell]);
+        TEST_ASSERT_TRUE(index->cellStarts[cell] < index->cellStarts[cell + 1]);
+        const uint64_t key = index->cellKeys[cell];
+        const unsigned int cx = key % index->cellCountX;
+        const unsigned int cy = key / index->cellCountX % index->cellCountY;
+        const unsigned int cz = key / index->cellCountX / index->cellCountY;
+        for (unsigned int i = index->cellStarts[cell]; i < index->cellStarts[cell + 1]; i++) {
+            TEST_ASSERT_EQUAL_INT(cx, (unsigned int)(index->x[i] / index->cellSize));
+            TEST_ASSERT_EQUAL_INT(cy, (unsigned int)(index->y[i] / index->cellSize));
+            TEST_ASSERT_EQUAL_INT(cz, (unsigned int)(index->z[i] / index->cellSize));
+        }
+    }
+    for (unsigned int o = 1; o < index->offsetCount; o++)
+        TEST_ASSERT_TRUE(index->offsets[o - 1].minDistance <= index->offsets[o].minDistance);
+
+    DestroyVoxelIndex(index);
+    free(points);
+    TEST_MESSAGE("Voxel index structure test completed");
+}
+
+void test_voxelindex_nearest_neighbor(void) {
+    TEST_MESSAGE("Start voxel index nearest neighbor test");
+    const unsigned int count = 20000, k = 7;
+    const float radius = 12000.0f;
+    RStarPoint* points = CreateTestPoints(count, 200000.0f);
+    TEST_ASSERT_NOT_NULL(points);
+
+    float heapDistances[7];
+    uint32_t heapIds[7];
+    double expected[7];
+    for (unsigned int ringCount = 1; ringCount <= 3; ringCount++) {
+        VoxelIndex* index = CreateVoxelIndex(points, 0, count, radius, ringCount);
+        TEST_ASSERT_NOT_NULL(index);
+        for (int q = 0; q < 200; q++) {
+            // queries slightly outside the point extent exercise the border voxels
+            double queryPoint[3] = {6378137.0 - 5000.0 + (double)rand() / RAND_MAX * 210000.0, -5000.0 + (double)rand() / RAND_MAX * 210000.0, -5000.0 + (double)rand() / RAND_MAX * 210000.0};
+            unsigned int found = VoxelIndex_NearestNeighborQuery(index, queryPoint, k, heapDistances, heapIds);
+            unsigned int expectedFound = BruteForceRadiusKNN(points, count, queryPoint, k, radius, expected);
+            TEST_ASSERT_EQUAL_INT(expectedFound, found);
+            for (unsigned int i = 0; i < found; i++) {
+                TEST_ASSERT_DOUBLE_WITHIN(1.0, sqrt(expected[i]), sqrt(heapDistances[i]));
+                TEST_ASSERT_TRUE(points[heapIds[i]].h != -1);
+                TEST_ASSERT_TRUE(sqrt(heapDistances[i]) <= radius);
+                if (i > 0) TEST_ASSERT_TRUE(heapDistances[i - 1] <= heapDistances[i]);
+            }
+        }
+        DestroyVoxelIndex(index);
+    }
+    free(points);
+    TEST_MESSAGE("Voxel index nearest neighbor test completed");
+}
+
+void test_voxelindex_batch_query(void) {
+    TEST_MESSAGE("Start voxel index batch query test");
+    const unsigned int count = 300, queryCount = 50, k = 400; // k larger than the point count
+    RStarPoint* points = CreateTestPoints(count, 5000.0f);
+    TEST_ASSERT_NOT_NULL(points);
+    VoxelIndex* index = CreateVoxelIndex(points, 0, count, 10000.0f, 1); // the radius covers every point
+    TEST_ASSERT_NOT_NULL(index);
+
+    double* queryPoints = (double*)malloc(queryCount * 3 * sizeof(double));
+    int64_t* ids = (int64_t*)malloc((size_t)queryCount * k * sizeof(int64_t));
+    double* distances = (double*)malloc((size_t)queryCount * k * sizeof(double));
+    uint64_t* counts = (uint64_t*)malloc(queryCount * sizeof(uint64_t));
+    for (unsigned int i = 0; i < queryCount; i++) {
+        queryPoints[i * 3 + 0] = 6378137.0 + (double)rand() / RAND_MAX * 5000.0;
+        queryPoints[i * 3 + 1] = (double)rand() / RAND_MAX * 5000.0;
+        queryPoints[i * 3 + 2] = (double)rand() / RAND_MAX * 5000.0;
+    }
+    TEST_ASSERT_TRUE(VoxelIndex_NearestNeighborBatchQuery(index, k, queryCount, queryPoints, ids, counts, distances));
+    size_t resultIndex = 0;
+    for (unsigned int i = 0; i < queryCount; i++) {
+        TEST_ASSERT_EQUAL_INT(index->pointCount, counts[i]);
+        TEST_ASSERT_DOUBLE_WITHIN(0.5, sqrt(SquaredDistance(&points[ids[resultIndex]], &queryPoints[i * 3])), distances[resultIndex]);
+        resultIndex += counts[i];
+    }
+    // a query far from every point has no neighbor within the radius
+    const double farPoint[3] = {6378137.0 + 1e6, 1e6, 1e6};
+    TEST_ASSERT_TRUE(VoxelIndex_NearestNeighborBatchQuery(index, k, 1, farPoint, ids, counts, distances));
+    TEST_ASSERT_EQUAL_INT(0, counts[0]);
+    TEST_ASSERT_FALSE(VoxelIndex_NearestNeighborBatchQuery(index, 0, queryCount, queryPoints, ids, counts, distances));
+
+    free(queryPoints);
+    free(ids);
+    free(distances);
+    free(counts);
+    DestroyVoxelIndex(index);
+    free(points);
+    TEST_MESSAGE("Voxel index batch query test completed");
+}
+
+void test_voxelindex(void) {
+    TEST_MESSAGE("Start voxel index test");
+    RUN_TEST(test_voxelindex_create_and_destroy);
+    RUN_TEST(test_voxelindex_structure);
+    RUN_TEST(test_voxelindex_nearest_neighbor);
+    RUN_TEST(test_voxelindex_batch_query);
+    TEST_MESSAGE("Voxel index test completed");
+}
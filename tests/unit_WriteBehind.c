@@ -0,0 +1,117 @@
+#include "test_suites.h"
+#include <string.h>
+#include "interface.h"
+#include "writebehind.h"
+#include "config.h"
+#include "test_helpers.h"
+
+#define TEST_WRITE_BEHIND_FILE_NAME "/tmp/FY3G_unit_write_behind.HDF"
+#define TEST_WRITE_BEHIND_CLIP_COUNT 6
+
+static const TestClipLattice TEST_WRITE_BEHIND_LATTICE = {17, 23, 40, 1, 0.0f, 0.0f, 0.0f, 10.0f, 0.0f, 0.05f, 200.0f, 1};
+
+static float TestClipCell(const unsigned int clipIndex, const unsigned int variable, const size_t index) {
+    // a low layer of echo, different for every clip and variable
+    if (index % 40 >= 12) return -999.0f;
+    return (float)(clipIndex * 1000 + variable * 100) + (float)(index % 97);
+}
+
+static float FillTestCell(const void* context, const unsigned int clipIndex, const unsigned int variable, const unsigned int l, const unsigned int b, const unsigned int h, const size_t index) {
+    return TestClipCell(clipIndex, variable, index);
+}
+
+static void CheckWrittenClips(const char* bandName, const ClipGridResult* result) {
+    hid_t fileID = H5Fopen(TEST_WRITE_BEHIND_FILE_NAME, H5F_ACC_RDONLY, H5P_DEFAULT);
+    TEST_ASSERT_TRUE(fileID >= 0);
+    for (unsigned int clipIndex = 0; clipIndex < result->clipCount; clipIndex++) {
+        const ClipGrid* clipGrid = &result->clipGrids[clipIndex];
+        const size_t cellCount = (size_t)clipGrid->longitudeCount * clipGrid->latitudeCount * clipGrid->heightCount;
+        float* read = (float*)malloc(cellCount * sizeof(float));
+        const char* datasetNames[2] = {"Value", "Extra"};
+        for (unsigned int variable = 0; variable < 2; variable++) {
+            char path[64];
+            snprintf(path, sizeof(path), "/%s/slice_%u/%s", bandName, clipIndex, datasetNames[variable]);
+            hid_t datasetID = H5Dopen(fileID, path, H5P_DEFAULT);
+            TEST_ASSERT_TRUE(datasetID >= 0);
+            TEST_ASSERT_TRUE(H5Dread(datasetID, H5T_NATIVE_FLOAT, H5S_ALL, H5S_ALL, H5P_DEFAULT, read) >= 0);
+            H5Dclose(datasetID);
+            for (size_t index = 0; index < cellCount; index++)
+                TEST_ASSERT_EQUAL_FLOAT(TestClipCell(clipIndex, variable, index), read[index]);
+        }
+        free(read);
+    }
+    H5Fclose(fileID);
+}
+
+static void WriteTestClipsBehind(const unsigned int bandIndex, ClipGridResult* result, const unsigned int depth) {
+    // the clips are filled by many threads in the order of the interpolation and handed to the writer
+    ClipWriter* writer = CreateClipWriter(bandIndex, TEST_WRITE_BEHIND_FILE_NAME, result, depth);
+    TEST_ASSERT_NOT_NULL(writer);
+    bool success = true;
+    #pragma omp parallel for schedule(dynamic) reduction(&&:success)
+    for (unsigned int i = 0; i < result->clipCount; i++) {
+        const unsigned int clipIndex = i & 1 ? result->clipCount - 1 - i / 2 : i / 2;
+        ClipGrid* clipGrid = &result->clipGrids[clipIndex];
+        const bool allocated = AllocateClipGridCells(clipGrid, g_config->clip_storage == CLIP_STORAGE_SPARSE);
+        if (allocated) FillTestClip(clipGrid, clipIndex, FillTestCell, NULL);
+        if (!allocated || !SubmitClip(writer, clipIndex)) success = false;
+    }
+    TEST_ASSERT_TRUE(success);
+    TEST_ASSERT_TRUE(writer->peakPendingCount <= depth);
+    TEST_ASSERT_TRUE(CloseClipWriter(writer));
+    // the writer frees every written clip and keeps its lattice
+    for (unsigned int clipIndex = 0; clipIndex < result->clipCount; clipIndex++) {
+        TEST_ASSERT_NULL(result->clipGrids[clipIndex].value);
+        TEST_ASSERT_NULL(result->clipGrids[clipIndex].extraValue);
+        TEST_ASSERT_NULL(result->clipGrids[clipIndex].sparse);
+        TEST_ASSERT_EQUAL_UINT(1, result->clipGrids[clipIndex].extraCount);
+    }
+    TEST_ASSERT_TRUE(ClipGridResultBytes(result) == 0);
+}
+
+void test_write_behind_clips(void) {
+    TEST_MESSAGE("Start write-behind clip test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.write_behind_depth = 1;
+    config.clip_storage = CLIP_STORAGE_DENSE;
+    config.output_compression = OUTPUT_COMPRESSION_DEFLATE;
+    config.output_chunk_size = 8;
+    config.output_deflate_level = 1;
+    strcpy(config.extra_variables[0], "Extra");
+    config.extra_variable_count = 1;
+    g_config = &config;
+
+    // dense clips behind a queue of one, then sparse clips of the second band in the same file
+    ClipGridResult result = {0};
+    CreateTestClips(&result, TEST_WRITE_BEHIND_CLIP_COUNT, &TEST_WRITE_BEHIND_LATTICE, false, NULL, NULL);
+    TEST_ASSERT_NULL(result.clipGrids[0].value);
+    WriteTestClipsBehind(0, &result, config.write_behind_depth);
+    config.clip_storage = CLIP_STORAGE_SPARSE;
+    config.write_behind_depth = 3;
+    WriteTestClipsBehind(1, &result, config.write_behind_depth);
+    CheckWrittenClips(BAND_NAMES[0], &result);
+    CheckWrittenClips(BAND_NAMES[1], &result);
+    DestroyClipGridResult(&result);
+
+    // the same file as the clips written after the interpolation
+    config.clip_storage = CLIP_STORAGE_DENSE;
+    CreateTestClips(&result, TEST_WRITE_BEHIND_CLIP_COUNT, &TEST_WRITE_BEHIND_LATTICE, false, NULL, NULL);
+    for (unsigned int clipIndex = 0; clipIndex < result.clipCount; clipIndex++) {
+        TEST_ASSERT_TRUE(AllocateClipGridCells(&result.clipGrids[clipIndex], false));
+        FillTestClip(&result.clipGrids[clipIndex], clipIndex, FillTestCell, NULL);
+    }
+    TEST_ASSERT_TRUE(WriteClipResult(0, TEST_WRITE_BEHIND_FILE_NAME, &result));
+    CheckWrittenClips(BAND_NAMES[0], &result);
+    DestroyClipGridResult(&result);
+
+    remove(TEST_WRITE_BEHIND_FILE_NAME);
+    g_config = previousConfig;
+    TEST_MESSAGE("Write-behind clip test completed");
+}
+
+void test_write_behind(void) {
+    TEST_MESSAGE("Start write-behind test");
+    RUN_TEST(test_write_behind_clips);
+    TEST_MESSAGE("Write-behind test completed");
+}
@@ -35,4 +35,17 @@ void test_geotransfer(void) {
         TEST_ASSERT_DOUBLE_WITHIN_MESSAGE(1e-10, in_longitude, lagrange_coordinate.b, "longitude calculated by Lagrange method is equal to the input longitude");
         TEST_ASSERT_DOUBLE_WITHIN_MESSAGE(1e-4, in_height, lagrange_coordinate.h, "height calculated by Lagrange method is equal to the input height");
     }
+    for (int i = 0; i < 100; i++) { // the stretched height keeps the position and scales the height
+        const double in_latitude = random_latitude(), in_longitude = random_longitude(), in_height = (double)rand() / RAND_MAX * 20000;
+        double x, y, z, scaled_x, scaled_y, scaled_z;
+        TransferGeodeticToCartesian(in_latitude, in_longitude, in_height, &x, &y, &z);
+        TEST_ASSERT_TRUE(TransferGeodeticToScaledCartesian(in_latitude, in_longitude, in_height, 1, &scaled_x, &scaled_y, &scaled_z));
+        TEST_ASSERT_DOUBLE_WITHIN(1e-6, x, scaled_x);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-6, z, scaled_z);
+        TEST_ASSERT_TRUE(TransferGeodeticToScaledCartesian(in_latitude, in_longitude, in_height, 4, &scaled_x, &scaled_y, &scaled_z));
+        Coordinate scaled_coordinate = TransferCartesianToGeodetic(scaled_x, scaled_y, scaled_z, true);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-8, in_latitude, scaled_coordinate.l);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-8, in_longitude, scaled_coordinate.b);
+        TEST_ASSERT_DOUBLE_WITHIN(1e-3, in_height * 4, scaled_coordinate.h);
+    }
 }
\ No newline at end of file
@@ -1,6 +1,7 @@
 #include "test_suites.h"
 #include "interface.h"
 #include "interpolate.h"
+#include "config.h"
 
 static const char* TEST_INPUT_FILE = "/mnt/repo/hxlc/FY-3G-Georesample/tests/FY3G_PMR--_ORBA_L1_20250519_1924_5000M_V1.HDF";
 
@@ -13,4 +14,216 @@ void test_interpolate(void) {
     TEST_MESSAGE("Init clip grid array successfully");
     DestroyHDFDataset(&dataset);
     DestroyClipGridResult(&finalGrid);
-}
\ No newline at end of file
+}
+static void FillPackedNeighbors(unsigned int queryCount, unsigned int k, uint64_t* counts, double* distances, int64_t* ids, unsigned int valueCount) {
+    // random neighbor counts, ascending distances, some below the min and above the max neighbor distance
+    size_t offset = 0;
+    for (unsigned int i = 0; i < queryCount; i++) {
+        counts[i] = rand() % (k + 1);
+        double distance = (rand() % 20 == 0) ? 50.0 : 150.0;
+        for (unsigned int j = 0; j < counts[i]; j++) {
+            distance += (double)rand() / RAND_MAX * 3000.0;
+            distances[offset + j] = distance;
+            ids[offset + j] = rand() % valueCount;
+        }
+        offset += counts[i];
+    }
+}
+
+void test_idw_batch_kernels(void) {
+    TEST_MESSAGE("Start IDW batch kernels test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.min_neighbor_distance = 100;
+    config.max_neighbor_distance = 10000;
+    g_config = &config;
+
+    const unsigned int queryCount = 1000, k = 5, valueCount = 100;
+    float values[100];
+    for (unsigned int i = 0; i < valueCount; i++)
+        values[i] = 10.0f + (float)rand() / RAND_MAX * 30.0f;
+    uint64_t* counts = (uint64_t*)malloc(queryCount * sizeof(uint64_t));
+    double* distances = (double*)malloc(queryCount * k * sizeof(double));
+    int64_t* ids = (int64_t*)malloc(queryCount * k * sizeof(int64_t));
+    float* neighborDistances = (float*)malloc(queryCount * k * sizeof(float));
+    float* neighborValues = (float*)malloc(queryCount * k * sizeof(float));
+    float* results = (float*)malloc(queryCount * sizeof(float));
+    FillPackedNeighbors(queryCount, k, counts, distances, ids, valueCount);
+    size_t offset = 0;
+    for (unsigned int i = 0; i < queryCount; i++) { // the SoA layout of the batch path
+        for (unsigned int j = 0; j < k; j++) {
+            neighborDistances[j * queryCount + i] = j < counts[i] ? (float)distances[offset + j] : INFINITY;
+            neighborValues[j * queryCount + i] = j < counts[i] ? values[ids[offset + j]] : 0.0f;
+        }
+        offset += counts[i];
+    }
+
+    const float powers[] = {1.0f, 2.0f, 3.0f, 2.5f};
+    for (unsigned int p = 0; p < 4; p++) {
+        IDWBatchKernel kernel = SelectIDWBatchKernel(powers[p]);
+        TEST_ASSERT_NOT_NULL(kernel);
+        kernel(queryCount, k, queryCount, neighborDistances, neighborValues, powers[p], results);
+        offset = 0;
+        for (unsigned int i = 0; i < queryCount; i++) {
+            const double expected = InterpolateValueIDW_v(counts[i], distances + offset, ids + offset, values, powers[p]);
+            if (expected == -999) TEST_ASSERT_EQUAL_FLOAT(-999.0f, results[i]);
+            else TEST_ASSERT_FLOAT_WITHIN(1e-3f, (float)expected, results[i]);
+            offset += counts[i];
+        }
+    }
+    TEST_ASSERT_TRUE(SelectIDWBatchKernel(2.0f) != SelectIDWBatchKernel(2.5f));
+
+    // the packed results are unpacked block by block, queryCount is not a multiple of the block
+    float* blockDistances = (float*)malloc(IDW_BATCH_BLOCK * k * sizeof(float));
+    float* blockValues = (float*)malloc(IDW_BATCH_BLOCK * k * sizeof(float));
+    InterpolateValueIDWBatch(SelectIDWBatchKernel(2.0f), 2.0f, queryCount, k, counts, distances, ids, values, NULL, NULL, blockDistances, blockValues, results);
+    offset = 0;
+    for (unsigned int i = 0; i < queryCount; i++) {
+        const double expected = InterpolateValueIDW_v(counts[i], distances + offset, ids + offset, values, 2.0f);
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, (float)expected, results[i]);
+        offset += counts[i];
+    }
+    free(blockDistances);
+    free(blockValues);
+
+    free(counts);
+    free(distances);
+    free(ids);
+    free(neighborDistances);
+    free(neighborValues);
+    free(results);
+    g_config = previousConfig;
+    TEST_MESSAGE("IDW batch kernels test completed");
+}
+
+void test_idw_vertical_distance(void) {
+    TEST_MESSAGE("Start IDW vertical distance test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.min_neighbor_distance = 100;
+    config.max_neighbor_distance = 10000;
+    config.max_vertical_distance = 400;
+    g_config = &config;
+
+    const unsigned int queryCount = 600, k = 5, valueCount = 100;
+    float values[100], heights[100];
+    for (unsigned int i = 0; i < valueCount; i++) {
+        values[i] = 10.0f + (float)rand() / RAND_MAX * 30.0f;
+        heights[i] = (float)rand() / RAND_MAX * 2000.0f;
+    }
+    uint64_t* counts = (uint64_t*)malloc(queryCount * sizeof(uint64_t));
+    double* distances = (double*)malloc(queryCount * k * sizeof(double));
+    int64_t* ids = (int64_t*)malloc(queryCount * k * sizeof(int64_t));
+    double* queryGeodetic = (double*)malloc(queryCount * 3 * sizeof(double));
+    float* blockDistances = (float*)malloc(IDW_BATCH_BLOCK * k * sizeof(float));
+    float* blockValues = (float*)malloc(IDW_BATCH_BLOCK * k * sizeof(float));
+    float* results = (float*)malloc(queryCount * sizeof(float));
+    FillPackedNeighbors(queryCount, k, counts, distances, ids, valueCount);
+    for (unsigned int i = 0; i < queryCount; i++)
+        queryGeodetic[i * 3 + 2] = (double)rand() / RAND_MAX * 2000.0;
+    InterpolateValueIDWBatch(SelectIDWBatchKernel(2.0f), 2.0f, queryCount, k, counts, distances, ids, values, heights, queryGeodetic, blockDistances, blockValues, results);
+    size_t offset = 0;
+    for (unsigned int i = 0; i < queryCount; i++) { // the neighbors within the vertical distance only
+        double keptDistances[5];
+        int64_t keptIds[5];
+        unsigned int keptCount = 0;
+        for (unsigned int j = 0; j < counts[i]; j++)
+            if (fabs(heights[ids[offset + j]] - queryGeodetic[i * 3 + 2]) <= config.max_vertical_distance) {
+                keptDistances[keptCount] = distances[offset + j];
+                keptIds[keptCount++] = ids[offset + j];
+            }
+        const double expected = InterpolateValueIDW_v(keptCount, keptDistances, keptIds, values, 2.0f);
+        TEST_ASSERT_FLOAT_WITHIN(1e-3f, (float)expected, results[i]);
+        offset += counts[i];
+    }
+    free(counts);
+    free(distances);
+    free(ids);
+    free(queryGeodetic);
+    free(blockDistances);
+    free(blockValues);
+    free(results);
+    g_config = previousConfig;
+    TEST_MESSAGE("IDW vertical distance test completed");
+}
+
+void test_idw_multi_variable(void) {
+    TEST_MESSAGE("Start IDW multi variable test");
+    struct Config* previousConfig = g_config;
+    struct Config config = {0};
+    config.min_neighbor_distance = 100;
+    config.max_neighbor_distance = 10000;
+    config.max_vertical_distance = 400;
+    g_config = &config;
+
+    const unsigned int queryCount = 700, k = 5, valueCount = 100;
+    float values[100], heights[100], linear[100], sparse[100];
+    for (unsigned int i = 0; i < valueCount; i++) {
+        values[i] = 10.0f + (float)rand() / RAND_MAX * 30.0f;
+        heights[i] = (float)rand() / RAND_MAX * 2000.0f;
+        linear[i] = 2.0f * values[i] + 1.0f;
+        sparse[i] = i % 3 == 0 ? -9999.9f : values[i]; // a fill value of its own
+    }
+    uint64_t* counts = (uint64_t*)malloc(queryCount * sizeof(uint64_t));
+    double* distances = (double*)malloc(queryCount * k * sizeof(double));
+    int64_t* ids = (int64_t*)malloc(queryCount * k * sizeof(int64_t));
+    double* queryGeodetic = (double*)malloc(queryCount * 3 * sizeof(double));
+    float* blockDistances = (float*)malloc(IDW_BATCH_BLOCK * k * sizeof(float));
+    float* blockValues = (float*)malloc(IDW_BATCH_BLOCK * k * sizeof(float));
+    int64_t* blockIds = (int64_t*)malloc(IDW_BATCH_BLOCK * k * sizeof(int64_t));
+    float* single = (float*)malloc(queryCount * sizeof(float));
+    float* results = (float*)malloc(3 * queryCount * sizeof(float));
+    FillPackedNeighbors(queryCount, k, counts, distances, ids, valueCount);
+    for (unsigned int i = 0; i < queryCount; i++)
+        queryGeodetic[i * 3 + 2] = (double)rand() / RAND_MAX * 2000.0;
+    const float powers[] = {2.0f, 2.5f};
+    for (unsigned int p = 0; p < 2; p++) {
+        const float* valueArrays[3] = {values, linear, sparse};
+        InterpolateValueIDWBatch(SelectIDWBatchKernel(powers[p]), powers[p], queryCount, k, counts, distances, ids, values, heights, queryGeodetic, blockDistances, blockValues, single);
+        InterpolateValuesIDWBatch(powers[p], queryCount, k, counts, distances, ids, 3, valueArrays, heights, queryGeodetic, blockDistances, blockIds, results);
+        size_t offset = 0;
+        for (unsigned int i = 0; i < queryCount; i++) {
+            // the first variable matches the single variable path, the weights are normalized so a linear map commutes
+            TEST_ASSERT_FLOAT_WITHIN(1e-4f, single[i], results[i]);
+            if (single[i] == -999) TEST_ASSERT_EQUAL_FLOAT(-999.0f, results[queryCount + i]);
+            else TEST_ASSERT_FLOAT_WITHIN(1e-3f, 2.0f * single[i] + 1.0f, results[queryCount + i]);
+            // the filled neighbors are skipped for their variable only
+            double keptDistances[5];
+            int64_t keptIds[5];
+            unsigned int keptCount = 0;
+            for (unsigned int j = 0; j < counts[i]; j++)
+                if (fabs(heights[ids[offset + j]] - queryGeodetic[i * 3 + 2]) <= config.max_vertical_distance && ids[offset + j] % 3 != 0) {
+                    keptDistances[keptCount] = distances[offset + j];
+                    keptIds[keptCount++] = ids[offset + j];
+                }
+            bool exactFilled = false; // a filled nearest neighbor closer than the min distance still takes the whole weight
+            for (unsigned int j = 0; j < counts[i]; j++)
+                if (fabs(heights[ids[offset + j]] - queryGeodetic[i * 3 + 2]) <= config.max_vertical_distance) {
+                    exactFilled = distances[offset + j] < config.min_neighbor_distance && ids[offset + j] % 3 == 0;
+                    break;
+                }
+            const double expected = exactFilled ? -999 : InterpolateValueIDW_v(keptCount, keptDistances, keptIds, values, powers[p]);
+            TEST_ASSERT_FLOAT_WITHIN(1e-3f, (float)expected, results[2 * queryCount + i]);
+            offset += counts[i];
+        }
+    }
+    free(counts);
+    free(distances);
+    free(ids);
+    free(queryGeodetic);
+    free(blockDistances);
+    free(blockValues);
+    free(blockIds);
+    free(single);
+    free(results);
+    g_config = previousConfig;
+    TEST_MESSAGE("IDW multi variable test completed");
+}
+
+void test_idw(void) {
+    TEST_MESSAGE("Start IDW test");
+    RUN_TEST(test_idw_batch_kernels);
+    RUN_TEST(test_idw_vertical_distance);
+    RUN_TEST(test_idw_multi_variable);
+    TEST_MESSAGE("IDW test completed");
+}
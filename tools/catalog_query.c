@@ -0,0 +1,83 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "catalog.h"
+
+static bool ParseDateTime(const char* text, int64_t* seconds){
+    // 2024-05-06T07:08:09 as written to the clip output files
+    if (strlen(text) != 19 || text[4] != '-' || text[7] != '-' || text[10] != 'T' || text[13] != ':' || text[16] != ':') return false;
+    const DateTime dateTime = CreateDateTime(text, text + 11);
+    *seconds = DateTimeToSeconds(&dateTime);
+    return true;
+}
+
+static void PrintUsage(const char* name){
+    printf("Usage: %s <catalog_file> [-b minLat maxLat minLon maxLon] [-t start end] [-z minHeight maxHeight] [-v minValue]\n", name);
+    printf("  -b  clips with values in the box, degrees\n");
+    printf("  -t  clips observed in the time range, e.g. 2024-05-06T07:00:00 2024-05-06T08:00:00\n");
+    printf("  -z  clips with values in the height range, and the levels looked at by -v, meters\n");
+    printf("  -v  clips with a level reaching the value, e.g. 40 for echoes of 40 dBZ\n");
+}
+
+int main(int argc, char *argv[]) {
+    /**
+     * @brief list the clips of a catalog matching a box, a time range and a value, without opening the clip files
+     * @param argv[1]: path to the catalog file, see CATALOG_FILE
+     * @return 0 if success, other if failed
+    */
+    if (argc < 2){
+        PrintUsage(argv[0]);
+        return -1;
+    }
+    CatalogQuery query;
+    InitCatalogQuery(&query);
+    for (int i = 2; i < argc; i++){
+        bool parsed = false;
+        if (strcmp(argv[i], "-b") == 0 && i + 4 < argc){
+            query.minLatitude = atof(argv[i + 1]);
+            query.maxLatitude = atof(argv[i + 2]);
+            query.minLongitude = atof(argv[i + 3]);
+            query.maxLongitude = atof(argv[i + 4]);
+            parsed = true;
+            i += 4;
+        } else if (strcmp(argv[i], "-t") == 0 && i + 2 < argc){
+            parsed = ParseDateTime(argv[i + 1], &query.startTime) && ParseDateTime(argv[i + 2], &query.endTime);
+            i += 2;
+        } else if (strcmp(argv[i], "-z") == 0 && i + 2 < argc){
+            query.minHeight = atof(argv[i + 1]);
+            query.maxHeight = atof(argv[i + 2]);
+            parsed = true;
+            i += 2;
+        } else if (strcmp(argv[i], "-v") == 0 && i + 1 < argc){
+            query.minValue = atof(argv[i + 1]);
+            parsed = true;
+            i += 1;
+        }
+        if (!parsed){
+            PrintUsage(argv[0]);
+            return -1;
+        }
+    }
+
+    CatalogFile* file = OpenCatalogFile(argv[1]);
+    if (!file){
+        printf("Failed to open catalog file\n");
+        return -2;
+    }
+    unsigned int matchCount = 0;
+    printf("%-6s %-6s %-20s %-20s %9s %9s %10s %10s %10s %8s  %s\n", "band", "slice", "start", "end", "min lat", "max lat", "min lon", "max lon", "cells", "max", "file");
+    for (const CatalogRecord* record = NextCatalogRecord(file, NULL); record; record = NextCatalogRecord(file, record)){
+        if (!MatchCatalogRecord(file, record, &query)) continue;
+        const DateTime start = SecondsToDateTime(record->startTime), end = SecondsToDateTime(record->endTime);
+        char* startString = ConstructDateTimeString(&start);
+        char* endString = ConstructDateTimeString(&end);
+        printf("%-6s %-6u %-20s %-20s %9.3f %9.3f %10.3f %10.3f %10u %8.2f  %s\n", BAND_NAMES[record->bandIndex & 1], record->clipIndex, startString, endString,
+            record->minLatitude, record->maxLatitude, record->minLongitude, record->maxLongitude, record->validCount, record->maxValue, record->fileName);
+        free(startString);
+        free(endString);
+        matchCount++;
+    }
+    printf("%u of %u clips match\n", matchCount, file->recordCount);
+    CloseCatalogFile(file);
+    return 0;
+}